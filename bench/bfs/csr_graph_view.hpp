@@ -0,0 +1,76 @@
+// Copyright 2023 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+#ifndef METALL_BENCH_BFS_CSR_GRAPH_VIEW_HPP
+#define METALL_BENCH_BFS_CSR_GRAPH_VIEW_HPP
+
+#include <cstddef>
+#include <utility>
+
+namespace bfs_bench {
+
+/// \brief Gives the interface the BFS kernel and the driver use (the one of
+/// the adjacency lists) to a metall::container::csr_graph.
+/// The view only refers to the graph; the graph is not copied.
+template <typename csr_graph_type>
+class csr_graph_view {
+ public:
+  using key_type = typename csr_graph_type::vertex_id_type;
+  using const_value_iterator =
+      typename csr_graph_type::const_neighbor_iterator;
+
+  /// \brief Iterates over the vertex IDs as the key iterator of the adjacency
+  /// lists does, i.e., itr->first is a vertex ID.
+  class const_key_iterator {
+   public:
+    explicit const_key_iterator(const key_type vid) : m_value(vid, 0) {}
+
+    bool operator==(const const_key_iterator &other) const {
+      return m_value.first == other.m_value.first;
+    }
+
+    bool operator!=(const const_key_iterator &other) const {
+      return !(*this == other);
+    }
+
+    const_key_iterator &operator++() {
+      ++m_value.first;
+      return *this;
+    }
+
+    const std::pair<key_type, std::size_t> *operator->() const {
+      return &m_value;
+    }
+
+   private:
+    std::pair<key_type, std::size_t> m_value;
+  };
+
+  explicit csr_graph_view(const csr_graph_type &graph) : m_graph(graph) {}
+
+  std::size_t num_values(const key_type &key) const {
+    return (key < m_graph.num_vertices()) ? m_graph.degree(key) : 0;
+  }
+
+  const_value_iterator values_begin(const key_type &key) const {
+    return m_graph.neighbors_begin(key);
+  }
+
+  const_value_iterator values_end(const key_type &key) const {
+    return m_graph.neighbors_end(key);
+  }
+
+  const_key_iterator keys_begin() const { return const_key_iterator(0); }
+
+  const_key_iterator keys_end() const {
+    return const_key_iterator(m_graph.num_vertices());
+  }
+
+ private:
+  const csr_graph_type &m_graph;
+};
+
+}  // namespace bfs_bench
+#endif  // METALL_BENCH_BFS_CSR_GRAPH_VIEW_HPP
@@ -153,6 +153,17 @@ run() {
     try_to_get_compiler_ver ${exec_file_name}
     execute ${NUM_THREADS} ${SCHEDULE} ${exec_file_name} -g "${GRAPH_DIR}/${GRAPH_NAME}" -k ${ADJ_LIST_KEY_NAME} -r ${BFS_ROOT} -m ${MAX_VERTEX_ID}
 
+    # Builds a CSR graph from the adjacency list and runs BFS on it
+    if [[ ${EXEC_NAME} = "metall" ]]; then
+        echo "" | tee -a ${LOG_FILE}
+        echo "----------------------------------------" | tee -a ${LOG_FILE}
+        echo "BFS with" ${EXEC_NAME} "CSR graph" | tee -a ${LOG_FILE}
+        echo "----------------------------------------" | tee -a ${LOG_FILE}
+
+        ${INIT_COMMAND}
+        exec_file_name="./run_bfs_bench_metall_csr"
+        execute ${NUM_THREADS} ${SCHEDULE} ${exec_file_name} -g "${GRAPH_DIR}/${GRAPH_NAME}" -k ${ADJ_LIST_KEY_NAME} -r ${BFS_ROOT} -m ${MAX_VERTEX_ID}
+    fi
 
     if ${NO_CLEANING_FILES_AT_END}; then
         echo "Do not delete the used directory"
@@ -165,6 +176,7 @@ run() {
 main() {
     run bip
     run metall
+    #run metall_huge_pages
     #run metall_numa
 }
 
@@ -0,0 +1,89 @@
+// Copyright 2023 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+/// \brief Runs BFS on a metall::container::csr_graph.
+/// If the datastore does not have the CSR graph yet, builds it from the
+/// adjacency list in the same datastore (key: the key of the adjacency list +
+/// "_csr") and stores it in the datastore.
+/// The BFS is run on the graph in the datastore reopened with the read-only
+/// mode.
+
+#include <iostream>
+#include <string>
+#include <cstddef>
+
+#include <metall/metall.hpp>
+#include <metall/container/csr_graph.hpp>
+#include "../data_structure/multithread_adjacency_list.hpp"
+#include "bench_driver.hpp"
+#include "csr_graph_view.hpp"
+
+using namespace bfs_bench;
+
+using vertex_id_type = uint64_t;
+
+using adjacency_list_type = data_structure::multithread_adjacency_list<
+    vertex_id_type, vertex_id_type,
+    typename metall::manager::allocator_type<std::byte>>;
+
+using csr_graph_type = metall::container::csr_graph<vertex_id_type, uint64_t>;
+
+void build_csr_graph(const bench_options<vertex_id_type> &option,
+                     const std::string &csr_key_name) {
+  metall::manager manager(metall::open_only, option.graph_file_name_list[0]);
+  if (manager.find<csr_graph_type>(csr_key_name.c_str()).first) return;
+
+  const auto *const adj_list =
+      manager.find<adjacency_list_type>(option.graph_key_name.c_str()).first;
+  if (!adj_list) {
+    std::cerr << "Cannot find " << option.graph_key_name << std::endl;
+    std::abort();
+  }
+
+  std::cout << "\nBuild CSR graph" << std::endl;
+  const auto start = mdtl::elapsed_time_sec();
+  auto *const graph = manager.construct<csr_graph_type>(csr_key_name.c_str())(
+      manager.get_allocator());
+  // Each bank of the adjacency list is a partition of the edge stream
+  graph->build(option.max_vertex_id + 1, adj_list->num_banks(),
+               [adj_list](const std::size_t bank_no, auto &&emit) {
+                 for (auto itr = adj_list->keys_begin(bank_no),
+                           end = adj_list->keys_end(bank_no);
+                      itr != end; ++itr) {
+                   for (const auto &neighbor : itr->second) {
+                     emit(itr->first, neighbor);
+                   }
+                 }
+               });
+  const auto elapsed_time = mdtl::elapsed_time_sec(start);
+  std::cout << "Finished building CSR graph (s)\t" << elapsed_time
+            << "\n#of vertices\t" << graph->num_vertices() << "\n#of edges\t"
+            << graph->num_edges() << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  bench_options<vertex_id_type> option;
+  if (!parse_options(argc, argv, &option)) {
+    std::abort();
+  }
+
+  const std::string csr_key_name = option.graph_key_name + "_csr";
+  build_csr_graph(option, csr_key_name);
+
+  {
+    metall::manager manager(metall::open_read_only,
+                            option.graph_file_name_list[0]);
+    const auto *const graph =
+        manager.find<csr_graph_type>(csr_key_name.c_str()).first;
+    if (!graph) {
+      std::cerr << "Cannot find " << csr_key_name << std::endl;
+      std::abort();
+    }
+
+    run_bench(csr_graph_view<csr_graph_type>(*graph), option);
+  }
+
+  return 0;
+}
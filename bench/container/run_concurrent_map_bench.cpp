@@ -0,0 +1,130 @@
+// Copyright 2023 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+/// \brief Benchmarks the concurrent map containers with Metall.
+/// Usage:
+/// ./run_concurrent_map_bench [#threads]
+/// # modify the values in the main(), if needed.
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <metall/container/concurrent_map.hpp>
+#include <metall/container/concurrent_unordered_flat_map.hpp>
+#include <metall/metall.hpp>
+#include <metall/detail/time.hpp>
+
+#include "bench_common.hpp"
+
+using input_type = std::vector<std::pair<uint64_t, uint64_t>>;
+
+/// \brief Calls func(begin, end) with the parts of the inputs in parallel.
+template <typename func_type>
+void run_in_parallel(const input_type &inputs, const std::size_t num_threads,
+                     const func_type &func) {
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&inputs, num_threads, t, &func]() {
+      const auto begin = inputs.begin() + inputs.size() * t / num_threads;
+      const auto end = inputs.begin() + inputs.size() * (t + 1) / num_threads;
+      func(begin, end);
+    });
+  }
+  for (auto &th : threads) {
+    th.join();
+  }
+}
+
+template <typename func_type>
+void measure(const std::string &name, const func_type &func) {
+  const auto start = mdtl::elapsed_time_sec();
+  func();
+  const auto elapsed_time = mdtl::elapsed_time_sec(start);
+  std::cout << name << " took (s)\t" << elapsed_time << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  std::size_t scale = 17;
+  std::size_t num_inputs = (1ULL << scale) * 16;
+  const std::size_t num_threads =
+      (argc > 1) ? std::stoull(argv[1]) : std::thread::hardware_concurrency();
+  input_type inputs;
+
+  // gen_edges(scale, num_inputs, inputs);
+  gen_random_values(num_inputs, inputs);
+  std::cout << "Generated inputs\t" << inputs.size() << "\n#of threads\t"
+            << num_threads << std::endl;
+
+  {
+    metall::manager mngr(metall::create_only, "/tmp/metall");
+    using map_type = metall::container::concurrent_map<
+        uint64_t, uint64_t, std::less<uint64_t>, std::hash<uint64_t>,
+        metall::manager::allocator_type<std::pair<const uint64_t, uint64_t>>>;
+    auto *map = mngr.construct<map_type>(metall::unique_instance)(
+        mngr.get_allocator());
+
+    measure("concurrent_map insert", [&]() {
+      run_in_parallel(inputs, num_threads, [map](auto begin, auto end) {
+        for (auto itr = begin; itr != end; ++itr) {
+          map->insert(std::make_pair(itr->first, itr->second));
+        }
+      });
+    });
+
+    measure("concurrent_map find", [&]() {
+      run_in_parallel(inputs, num_threads, [map](auto begin, auto end) {
+        for (auto itr = begin; itr != end; ++itr) {
+          if (!map->count(itr->first)) std::abort();
+        }
+      });
+    });
+  }
+
+  using flat_map_type =
+      metall::container::concurrent_unordered_flat_map<uint64_t, uint64_t>;
+  {
+    metall::manager mngr(metall::create_only, "/tmp/metall");
+    auto *map = mngr.construct<flat_map_type>(metall::unique_instance)(
+        mngr.get_allocator());
+
+    measure("concurrent_unordered_flat_map insert", [&]() {
+      run_in_parallel(inputs, num_threads, [map](auto begin, auto end) {
+        for (auto itr = begin; itr != end; ++itr) {
+          map->insert(std::make_pair(itr->first, itr->second));
+        }
+      });
+    });
+
+    measure("concurrent_unordered_flat_map find", [&]() {
+      run_in_parallel(inputs, num_threads, [map](auto begin, auto end) {
+        for (auto itr = begin; itr != end; ++itr) {
+          if (!map->contains(itr->first)) std::abort();
+        }
+      });
+    });
+
+    measure("concurrent_unordered_flat_map visit_all", [&]() {
+      uint64_t sum = 0;
+      map->visit_all([&sum](const auto &kv) { sum += kv.second; });
+      if (sum == 1) std::abort();  // Prevents the loop from being optimized out
+    });
+  }
+
+  {
+    metall::manager mngr(metall::create_only, "/tmp/metall");
+    auto *map = mngr.construct<flat_map_type>(metall::unique_instance)(
+        mngr.get_allocator());
+
+    measure("concurrent_unordered_flat_map bulk insert", [&]() {
+      run_in_parallel(inputs, num_threads,
+                      [map](auto begin, auto end) { map->insert(begin, end); });
+    });
+  }
+
+  metall::manager::remove("/tmp/metall");
+
+  return 0;
+}
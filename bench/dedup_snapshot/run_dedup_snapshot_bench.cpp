@@ -0,0 +1,180 @@
+// Copyright 2023 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+// Takes snapshots of a datastore repeatedly, updating a contiguous part of the
+// data between snapshots, with the default segment storage (reflink or copy)
+// and the deduplicating segment storage, and reports the time and space the
+// snapshots take.
+// 'Disk usage' counts the blocks of each file once (hard links are not
+// double counted) but cannot see blocks shared by reflink;
+// 'Used space' is the change of the used space of the file system.
+
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <random>
+#include <filesystem>
+
+#include <metall/metall.hpp>
+#include <metall/detail/time.hpp>
+
+namespace {
+namespace mdtl = metall::mtlldetail;
+namespace fs = std::filesystem;
+
+struct option_type {
+  std::string datastore_path{"/tmp/datastore"};
+  std::size_t data_size = 1ULL << 30ULL;
+  std::size_t num_snapshots = 8;
+  double update_ratio = 0.01;
+  bool clone = true;
+};
+
+option_type parse_option(int argc, char **argv) {
+  int p;
+  option_type option;
+  while ((p = ::getopt(argc, argv, "o:s:n:u:c")) != -1) {
+    switch (p) {
+      case 'o':
+        option.datastore_path = optarg;
+        break;
+
+      case 's':
+        option.data_size = std::stoll(optarg);
+        break;
+
+      case 'n':
+        option.num_snapshots = std::stoll(optarg);
+        break;
+
+      case 'u':
+        option.update_ratio = std::stod(optarg);
+        break;
+
+      case 'c':  // Copy instead of reflink
+        option.clone = false;
+        break;
+
+      default:
+        std::cerr << "Invalid option" << std::endl;
+        std::abort();
+    }
+  }
+  return option;
+}
+
+void check(const bool ok, const char *const message) {
+  if (!ok) {
+    std::cerr << message << std::endl;
+    std::abort();
+  }
+}
+
+/// \brief Returns the disk usage of the files under 'paths' in bytes.
+/// Files that have multiple links are counted once.
+std::size_t disk_usage(const std::vector<std::string> &paths) {
+  std::set<std::pair<dev_t, ino_t>> counted;
+  std::size_t usage = 0;
+  for (const auto &path : paths) {
+    for (const auto &entry : fs::recursive_directory_iterator(path)) {
+      struct stat st;
+      if (!entry.is_regular_file() || ::stat(entry.path().c_str(), &st) != 0)
+        continue;
+      if (counted.emplace(st.st_dev, st.st_ino).second) {
+        usage += st.st_blocks * 512;
+      }
+    }
+  }
+  return usage;
+}
+
+std::size_t used_space(const std::string &path) {
+  struct statvfs st;
+  check(::statvfs(path.c_str(), &st) == 0, "Failed to statvfs");
+  return (st.f_blocks - st.f_bfree) * st.f_frsize;
+}
+
+std::string snapshot_path(const option_type &option, const std::size_t no) {
+  return option.datastore_path + "_snapshot" + std::to_string(no);
+}
+
+template <typename manager_type>
+void run_bench(const char *const name, const option_type &option) {
+  const std::size_t num_elements = option.data_size / sizeof(uint64_t);
+  const std::size_t num_updates = num_elements * option.update_ratio;
+
+  manager_type::remove(option.datastore_path.c_str());
+  for (std::size_t i = 0; i < option.num_snapshots; ++i) {
+    manager_type::remove(snapshot_path(option, i).c_str());
+  }
+
+  const auto parent_dir =
+      fs::absolute(option.datastore_path).parent_path().string();
+  std::vector<std::string> snapshot_paths;
+  double snapshot_time = 0;
+  std::size_t used_space_by_snapshots = 0;
+  {
+    manager_type manager(metall::create_only, option.datastore_path.c_str());
+    auto *const data = static_cast<uint64_t *>(
+        manager.allocate(num_elements * sizeof(uint64_t)));
+    check(data, "Failed to allocate");
+
+    std::mt19937_64 rnd(123);
+    for (std::size_t i = 0; i < num_elements; ++i) data[i] = rnd();
+
+    for (std::size_t n = 0; n < option.num_snapshots; ++n) {
+      // Updates a contiguous range at a random position
+      const std::size_t first = rnd() % (num_elements - num_updates + 1);
+      for (std::size_t i = first; i < first + num_updates; ++i) {
+        data[i] = rnd();
+      }
+      // Excludes the cost of flushing the updates from the snapshot time
+      manager.flush();
+
+      const auto used_before = used_space(parent_dir);
+      const auto start = mdtl::elapsed_time_sec();
+      snapshot_paths.push_back(snapshot_path(option, n));
+      check(manager.snapshot(snapshot_paths.back().c_str(), option.clone),
+            "Failed to take a snapshot");
+      snapshot_time += mdtl::elapsed_time_sec(start);
+      used_space_by_snapshots +=
+          std::max(used_space(parent_dir), used_before) - used_before;
+    }
+  }
+
+  std::cout << name << "\nSnapshot time (s)\t" << snapshot_time
+            << "\nDisk usage of datastore and snapshots (MB)\t"
+            << [&]() {
+                 auto paths = snapshot_paths;
+                 paths.push_back(option.datastore_path);
+                 return disk_usage(paths) >> 20ULL;
+               }()
+            << "\nUsed space by snapshots (MB)\t"
+            << (used_space_by_snapshots >> 20ULL) << std::endl;
+
+  manager_type::remove(option.datastore_path.c_str());
+  for (const auto &path : snapshot_paths) {
+    manager_type::remove(path.c_str());
+  }
+}
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const auto option = parse_option(argc, argv);
+
+  std::cout << "Data size (MB)\t" << (option.data_size >> 20ULL)
+            << "\nSnapshots\t" << option.num_snapshots << "\nUpdate ratio\t"
+            << option.update_ratio << "\nClone\t" << option.clone << std::endl;
+
+  run_bench<metall::basic_manager<>>("Default segment storage", option);
+  run_bench<metall::manager_dedup>("Deduplicating segment storage", option);
+
+  return 0;
+}
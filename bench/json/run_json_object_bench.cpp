@@ -0,0 +1,121 @@
+// Copyright 2023 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+/// \brief Benchmarks insert, find, and memory usage of JSON object
+/// implementations with different numbers of keys (widths).
+/// Usage:
+/// ./run_json_object_bench
+/// # modify the values in the main(), if needed.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <limits>
+
+#include <metall/json/json.hpp>
+#include <metall/detail/time.hpp>
+
+namespace mdtl = metall::mtlldetail;
+namespace mj = metall::json;
+
+std::size_t g_allocated_bytes = 0;
+
+/// \brief An allocator that counts the number of allocated bytes.
+template <typename T>
+struct counting_allocator {
+  using value_type = T;
+
+  counting_allocator() = default;
+
+  template <typename U>
+  counting_allocator(const counting_allocator<U> &) noexcept {}
+
+  T *allocate(const std::size_t n) {
+    g_allocated_bytes += n * sizeof(T);
+    return std::allocator<T>{}.allocate(n);
+  }
+
+  void deallocate(T *const p, const std::size_t n) noexcept {
+    g_allocated_bytes -= n * sizeof(T);
+    std::allocator<T>{}.deallocate(p, n);
+  }
+
+  template <typename U>
+  bool operator==(const counting_allocator<U> &) const noexcept {
+    return true;
+  }
+
+  template <typename U>
+  bool operator!=(const counting_allocator<U> &) const noexcept {
+    return false;
+  }
+};
+
+using allocator_type = counting_allocator<std::byte>;
+
+template <typename object_type>
+void run_bench(const std::string &name, const std::vector<std::string> &keys,
+               const std::size_t num_objects, const std::size_t num_finds) {
+  const std::size_t base_bytes = g_allocated_bytes;
+  std::vector<object_type> objects(num_objects);
+
+  const auto insert_start = mdtl::elapsed_time_sec();
+  for (auto &object : objects) {
+    for (const auto &key : keys) {
+      object[key].emplace_null();
+    }
+  }
+  const auto insert_time = mdtl::elapsed_time_sec(insert_start);
+  const std::size_t bytes = g_allocated_bytes - base_bytes;
+
+  std::size_t num_found = 0;
+  const auto find_start = mdtl::elapsed_time_sec();
+  for (std::size_t i = 0; i < num_finds; ++i) {
+    for (const auto &object : objects) {
+      for (const auto &key : keys) {
+        num_found += object.find(key) != object.end();
+      }
+    }
+  }
+  const auto find_time = mdtl::elapsed_time_sec(find_start);
+  if (num_found != num_finds * num_objects * keys.size()) {
+    std::cerr << "Failed to find keys" << std::endl;
+    std::abort();
+  }
+
+  const double num_keys = num_objects * keys.size();
+  std::cout << keys.size() << "\t" << name << "\t"
+            << insert_time / num_keys * 1e9 << "\t"
+            << find_time / (num_keys * num_finds) * 1e9 << "\t"
+            << bytes / num_keys << std::endl;
+}
+
+int main() {
+  // The total number of keys inserted in each run
+  const std::size_t total_num_keys = 1ULL << 20ULL;
+  // The number of times each key is looked up
+  const std::size_t num_finds = 4;
+
+  std::cout << "Width\tObject\tInsert (ns/key)\tFind (ns/key)\tBytes/key"
+            << std::endl;
+  for (std::size_t width = 4; width <= (1ULL << 12ULL); width *= 4) {
+    std::vector<std::string> keys;
+    for (std::size_t i = 0; i < width; ++i) {
+      keys.emplace_back("key_" + std::to_string(i));
+    }
+    const auto num_objects = total_num_keys / width;
+
+    run_bench<mj::jsndtl::compact_object<allocator_type>>("compact", keys,
+                                                          num_objects,
+                                                          num_finds);
+    run_bench<mj::jsndtl::adaptive_object<allocator_type, 0>>(
+        "indexed", keys, num_objects, num_finds);
+    run_bench<mj::jsndtl::adaptive_object<allocator_type>>(
+        "adaptive", keys, num_objects, num_finds);
+  }
+
+  return 0;
+}
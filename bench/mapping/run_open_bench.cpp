@@ -0,0 +1,105 @@
+// Copyright 2023 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+/// \brief Benchmarks the latency to open a datastore that has many block
+/// files, i.e., the time until the first allocation is possible.
+/// This program is built with a small segment block size
+/// so that a datastore with thousands of blocks fits in a small space.
+/// Usage:
+/// ./run_open_bench -o /path/to/datastore -b #blocks -r #repeats
+
+#include <unistd.h>
+#include <iostream>
+#include <string>
+#include <algorithm>
+
+#include <metall/metall.hpp>
+#include <metall/detail/time.hpp>
+
+namespace {
+namespace mdtl = metall::mtlldetail;
+
+struct option_type {
+  std::string datastore_path{"/tmp/datastore"};
+  std::size_t num_blocks = 4096;
+  std::size_t num_repeats = 5;
+};
+
+option_type parse_option(int argc, char **argv) {
+  int p;
+  option_type option;
+  while ((p = ::getopt(argc, argv, "o:b:r:")) != -1) {
+    switch (p) {
+      case 'o':
+        option.datastore_path = optarg;
+        break;
+
+      case 'b':
+        option.num_blocks = std::stoll(optarg);
+        break;
+
+      case 'r':
+        option.num_repeats = std::stoll(optarg);
+        break;
+
+      default:
+        std::cerr << "Invalid option" << std::endl;
+        std::abort();
+    }
+  }
+  return option;
+}
+
+void check(const bool ok, const char *const message) {
+  if (!ok) {
+    std::cerr << message << std::endl;
+    std::abort();
+  }
+}
+
+/// \brief Opens the datastore, allocates an object, and returns the elapsed
+/// time in seconds.
+template <typename open_mode_type>
+double open_and_allocate(const option_type &option, const open_mode_type mode,
+                         const bool allocate) {
+  const auto start = mdtl::elapsed_time_sec();
+  metall::manager manager(mode, option.datastore_path.c_str());
+  check(manager.check_sanity(), "Failed to open");
+  if (allocate) check(manager.allocate(8), "Failed to allocate");
+  const auto elapsed = mdtl::elapsed_time_sec(start);
+  return elapsed;
+}
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const auto option = parse_option(argc, argv);
+
+  {
+    metall::manager manager(metall::create_only,
+                            option.datastore_path.c_str());
+    // Files are sparse as the allocated region is not touched
+    check(manager.allocate(METALL_SEGMENT_BLOCK_SIZE * (option.num_blocks - 1)),
+          "Failed to allocate");
+  }
+
+  std::cout << "Block size (MB)\t" << (METALL_SEGMENT_BLOCK_SIZE >> 20ULL)
+            << "\nBlocks\t" << option.num_blocks << std::endl;
+
+  double open_time = 1e9;
+  double open_read_only_time = 1e9;
+  for (std::size_t r = 0; r < option.num_repeats; ++r) {
+    open_time = std::min(
+        open_time, open_and_allocate(option, metall::open_only, true));
+    open_read_only_time =
+        std::min(open_read_only_time,
+                 open_and_allocate(option, metall::open_read_only, false));
+  }
+  std::cout << "Open and allocate (s)\t" << open_time
+            << "\nOpen read only (s)\t" << open_read_only_time << std::endl;
+
+  metall::manager::remove(option.datastore_path.c_str());
+
+  return 0;
+}
@@ -0,0 +1,132 @@
+// Copyright 2023 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+/// \brief Benchmarks the latency of random reads right after opening a
+/// datastore with the read-only mode, with and without prefaulting the
+/// segment at open.
+/// Usage:
+/// ./run_prefault_bench -o /path/to/datastore -s data size -n #reads
+/// -t #threads
+
+#include <unistd.h>
+#include <sys/resource.h>
+#include <iostream>
+#include <string>
+#include <random>
+
+#include <metall/metall.hpp>
+#include <metall/detail/time.hpp>
+
+namespace {
+namespace mdtl = metall::mtlldetail;
+
+struct option_type {
+  std::string datastore_path{"/tmp/datastore"};
+  std::size_t data_size = 1ULL << 30ULL;
+  std::size_t num_reads = 1ULL << 20ULL;
+  std::size_t num_threads = 0;
+};
+
+option_type parse_option(int argc, char **argv) {
+  int p;
+  option_type option;
+  while ((p = ::getopt(argc, argv, "o:s:n:t:")) != -1) {
+    switch (p) {
+      case 'o':
+        option.datastore_path = optarg;
+        break;
+
+      case 's':
+        option.data_size = std::stoll(optarg);
+        break;
+
+      case 'n':
+        option.num_reads = std::stoll(optarg);
+        break;
+
+      case 't':
+        option.num_threads = std::stoll(optarg);
+        break;
+
+      default:
+        std::cerr << "Invalid option" << std::endl;
+        std::abort();
+    }
+  }
+  return option;
+}
+
+void check(const bool ok, const char *const message) {
+  if (!ok) {
+    std::cerr << message << std::endl;
+    std::abort();
+  }
+}
+
+std::size_t num_page_faults() {
+  struct rusage usage;
+  check(::getrusage(RUSAGE_SELF, &usage) == 0, "Failed to getrusage");
+  return usage.ru_minflt + usage.ru_majflt;
+}
+
+/// \brief Reads random elements and returns the elapsed time in seconds.
+double random_reads(const metall::manager &manager, const option_type &option) {
+  const auto [data, length] = manager.find<uint64_t>("data");
+  check(data, "Failed to find data");
+
+  std::mt19937_64 rnd(123);
+  uint64_t sum = 0;
+  const auto start = mdtl::elapsed_time_sec();
+  for (std::size_t i = 0; i < option.num_reads; ++i) {
+    sum += data[rnd() % length];
+  }
+  const auto elapsed = mdtl::elapsed_time_sec(start);
+  check(sum != 1, "");  // Prevents the loop from being optimized out
+  return elapsed;
+}
+
+void run_bench(const option_type &option, const bool prefault) {
+  const auto start = mdtl::elapsed_time_sec();
+  metall::prefault_option prefault_option;
+  prefault_option.num_threads = option.num_threads;
+  auto manager =
+      prefault ? metall::manager(metall::open_read_only,
+                                 option.datastore_path.c_str(), prefault_option)
+               : metall::manager(metall::open_read_only,
+                                 option.datastore_path.c_str());
+  check(manager.check_sanity(), "Failed to open");
+  const auto open_time = mdtl::elapsed_time_sec(start);
+  const auto num_faults_before = num_page_faults();
+  const auto read_time = random_reads(manager, option);
+
+  std::cout << (prefault ? "With prefault" : "Without prefault")
+            << "\nOpen (s)\t" << open_time << "\nRandom reads (s)\t"
+            << read_time << "\nPage faults during reads\t"
+            << num_page_faults() - num_faults_before << std::endl;
+}
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const auto option = parse_option(argc, argv);
+
+  {
+    metall::manager manager(metall::create_only,
+                            option.datastore_path.c_str());
+    const std::size_t length = option.data_size / sizeof(uint64_t);
+    auto *const data = manager.construct<uint64_t>("data")[length]();
+    check(data, "Failed to allocate");
+    for (std::size_t i = 0; i < length; ++i) data[i] = i;
+  }
+
+  std::cout << "Data size (MB)\t" << (option.data_size >> 20ULL)
+            << "\nReads\t" << option.num_reads << std::endl;
+
+  run_bench(option, false);
+  run_bench(option, true);
+
+  metall::manager::remove(option.datastore_path.c_str());
+
+  return 0;
+}
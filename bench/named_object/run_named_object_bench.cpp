@@ -0,0 +1,158 @@
+// Copyright 2023 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+// Constructs, finds, and destroys named objects with multiple threads
+// and reports the time of each phase.
+// The 'mixed' phase runs finds while other threads construct and destroy
+// objects, which shows whether lookups are blocked by updates.
+
+#include <unistd.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <functional>
+
+#include <metall/metall.hpp>
+#include <metall/detail/time.hpp>
+
+namespace {
+namespace mdtl = metall::mtlldetail;
+
+struct option_type {
+  std::string datastore_path{"/tmp/datastore"};
+  std::size_t num_objects = 1ULL << 16ULL;
+  std::size_t num_finds = 1ULL << 20ULL;
+  int num_threads = static_cast<int>(std::thread::hardware_concurrency());
+};
+
+option_type parse_option(int argc, char **argv) {
+  int p;
+  option_type option;
+  while ((p = ::getopt(argc, argv, "o:n:f:t:")) != -1) {
+    switch (p) {
+      case 'o':
+        option.datastore_path = optarg;
+        break;
+
+      case 'n':
+        option.num_objects = std::stoll(optarg);
+        break;
+
+      case 'f':
+        option.num_finds = std::stoll(optarg);
+        break;
+
+      case 't':
+        option.num_threads = std::stoi(optarg);
+        break;
+
+      default:
+        std::cerr << "Invalid option" << std::endl;
+        std::abort();
+    }
+  }
+  option.num_threads = std::max(option.num_threads, 1);
+  return option;
+}
+
+std::string gen_name(const std::size_t i) { return "obj" + std::to_string(i); }
+
+/// \brief Runs 'func(thread_no)' with 'num_threads' threads and returns the
+/// elapsed time in seconds.
+double run_in_parallel(const int num_threads,
+                       const std::function<void(int)> &func) {
+  const auto start = mdtl::elapsed_time_sec();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back(func, t);
+  }
+  for (auto &th : threads) th.join();
+  return mdtl::elapsed_time_sec(start);
+}
+
+void check(const bool ok, const char *const message) {
+  if (!ok) {
+    std::cerr << message << std::endl;
+    std::abort();
+  }
+}
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const auto option = parse_option(argc, argv);
+  const auto num_threads = option.num_threads;
+
+  std::cout << "Threads\t" << num_threads << "\nObjects\t"
+            << option.num_objects << "\nFinds\t" << option.num_finds
+            << std::endl;
+
+  {
+    metall::manager manager(metall::create_only, option.datastore_path.c_str());
+
+    const auto construct_time = run_in_parallel(num_threads, [&](const int t) {
+      for (std::size_t i = t; i < option.num_objects; i += num_threads) {
+        check(manager.construct<std::size_t>(gen_name(i).c_str())(i),
+              "Failed to construct");
+      }
+    });
+    std::cout << "Construct (s)\t" << construct_time << std::endl;
+
+    const auto find_time = run_in_parallel(num_threads, [&](const int t) {
+      std::mt19937_64 rnd(t);
+      for (std::size_t n = t; n < option.num_finds; n += num_threads) {
+        const auto i = rnd() % option.num_objects;
+        const auto *const obj =
+            manager.find<std::size_t>(gen_name(i).c_str()).first;
+        check(obj && *obj == i, "Failed to find");
+      }
+    });
+    std::cout << "Find (s)\t" << find_time << std::endl;
+
+    // Half of the threads find existing objects while the others construct
+    // and destroy temporary ones
+    const int num_finders = std::max(num_threads / 2, 1);
+    std::atomic_int num_running_finders{num_finders};
+    double mixed_find_time = 0;
+    const auto mixed_time =
+        run_in_parallel(num_threads + (num_threads == 1), [&](const int t) {
+          if (t < num_finders) {
+            std::mt19937_64 rnd(t);
+            const auto start = mdtl::elapsed_time_sec();
+            for (std::size_t n = t; n < option.num_finds; n += num_finders) {
+              const auto i = rnd() % option.num_objects;
+              check(manager.find<std::size_t>(gen_name(i).c_str()).first,
+                    "Failed to find");
+            }
+            if (t == 0) mixed_find_time = mdtl::elapsed_time_sec(start);
+            --num_running_finders;
+            return;
+          }
+          for (std::size_t i = 0; num_running_finders.load() > 0; ++i) {
+            const auto name = "tmp" + std::to_string(t) + "_" +
+                              std::to_string(i % option.num_objects);
+            check(manager.construct<std::size_t>(name.c_str())(i),
+                  "Failed to construct");
+            check(manager.destroy<std::size_t>(name.c_str()),
+                  "Failed to destroy");
+          }
+        });
+    std::cout << "Mixed (s)\t" << mixed_time << "\nFind in mixed (s)\t"
+              << mixed_find_time << std::endl;
+
+    const auto destroy_time = run_in_parallel(num_threads, [&](const int t) {
+      for (std::size_t i = t; i < option.num_objects; i += num_threads) {
+        check(manager.destroy<std::size_t>(gen_name(i).c_str()),
+              "Failed to destroy");
+      }
+    });
+    std::cout << "Destroy (s)\t" << destroy_time << std::endl;
+  }
+  metall::manager::remove(option.datastore_path.c_str());
+
+  return 0;
+}
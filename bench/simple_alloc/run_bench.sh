@@ -11,4 +11,13 @@ rm -rf ${FILE}*
 ./run_simple_allocation_bench_bip -n ${NUM_ALLOCS} -o ${FILE} | tee ${LOG_FILE_PREFIX}"bip.log"
 
 rm -rf ${FILE}*
-./run_simple_allocation_bench_metall -n ${NUM_ALLOCS} -o ${FILE} | tee ${LOG_FILE_PREFIX}"metall.log"
\ No newline at end of file
+./run_simple_allocation_bench_metall -n ${NUM_ALLOCS} -o ${FILE} | tee ${LOG_FILE_PREFIX}"metall.log"
+
+rm -rf ${FILE}*
+./run_simple_allocation_bench_metall_no_stats -n ${NUM_ALLOCS} -o ${FILE} | tee ${LOG_FILE_PREFIX}"metall_no_stats.log"
+
+rm -rf ${FILE}*
+./run_simple_allocation_bench_metall -n ${NUM_ALLOCS} -o ${FILE} -p | tee ${LOG_FILE_PREFIX}"metall_parallel.log"
+
+rm -rf ${FILE}*
+./run_simple_allocation_bench_metall_arena -n ${NUM_ALLOCS} -o ${FILE} -p | tee ${LOG_FILE_PREFIX}"metall_arena_parallel.log"
\ No newline at end of file
@@ -0,0 +1,134 @@
+// Copyright 2019 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+// Grows and shrinks multi-chunk buffers at random, like vectors of vectors do,
+// and reports how the segment footprint follows the live data.
+
+#include <unistd.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <iomanip>
+
+#include <metall/metall.hpp>
+#include <metall/detail/time.hpp>
+
+namespace {
+namespace mdtl = metall::mtlldetail;
+
+struct option_type {
+  std::string datastore_path{"/tmp/datastore"};
+  std::size_t num_buffers = 64;
+  std::size_t num_rounds = 10000;
+  std::size_t max_num_chunks = 32;
+};
+
+option_type parse_option(int argc, char **argv) {
+  int p;
+  option_type option;
+  while ((p = ::getopt(argc, argv, "o:n:r:c:")) != -1) {
+    switch (p) {
+      case 'o':
+        option.datastore_path = optarg;
+        break;
+
+      case 'n':
+        option.num_buffers = std::stoll(optarg);
+        break;
+
+      case 'r':
+        option.num_rounds = std::stoll(optarg);
+        break;
+
+      case 'c':
+        option.max_num_chunks = std::stoll(optarg);
+        break;
+
+      default:
+        std::cerr << "Invalid option" << std::endl;
+        std::abort();
+    }
+  }
+  return option;
+}
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const auto option = parse_option(argc, argv);
+  constexpr std::size_t k_chunk_size = metall::manager::chunk_size();
+
+  std::cout << "Buffers\t" << option.num_buffers << "\nRounds\t"
+            << option.num_rounds << "\nMax buffer size (chunks)\t"
+            << option.max_num_chunks << std::endl;
+
+  {
+    metall::manager manager(metall::create_only, option.datastore_path.c_str());
+
+    std::mt19937_64 rnd(123);
+    std::uniform_int_distribution<std::size_t> size_dist(
+        k_chunk_size, option.max_num_chunks * k_chunk_size);
+    std::uniform_int_distribution<std::size_t> buffer_dist(
+        0, option.num_buffers - 1);
+
+    std::vector<void *> buffers(option.num_buffers, nullptr);
+    std::vector<std::size_t> sizes(option.num_buffers, 0);
+    std::size_t live_size = 0;
+    for (std::size_t i = 0; i < option.num_buffers; ++i) {
+      sizes[i] = size_dist(rnd);
+      buffers[i] = manager.allocate(sizes[i]);
+      live_size += sizes[i];
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    // 'Used range' is the distance from the segment head to the end of the
+    // highest live buffer, which is what the allocator has to keep backed.
+    std::cout << "Round\tLive (MB)\tUsed range (MB)\tUsed range/Live\t"
+                 "Segment (MB)\tTime (s)"
+              << std::endl;
+    const auto report_interval =
+        std::max(option.num_rounds / 10, std::size_t(1));
+    const auto start = mdtl::elapsed_time_sec();
+    for (std::size_t r = 0; r < option.num_rounds; ++r) {
+      // Grow or shrink a buffer by moving it to a new block
+      const auto i = buffer_dist(rnd);
+      const std::size_t new_size =
+          (rnd() % 2) ? std::min(sizes[i] * 3 / 2,
+                                 option.max_num_chunks * k_chunk_size)
+                      : std::max(sizes[i] / 2, k_chunk_size);
+      void *const new_buffer = manager.allocate(new_size);
+      if (!new_buffer) {
+        std::cerr << "Failed allocation" << std::endl;
+        std::abort();
+      }
+      manager.deallocate(buffers[i]);
+      live_size = live_size - sizes[i] + new_size;
+      buffers[i] = new_buffer;
+      sizes[i] = new_size;
+
+      if ((r + 1) % report_interval == 0) {
+        std::size_t used_range = 0;
+        for (std::size_t k = 0; k < buffers.size(); ++k) {
+          const auto end = static_cast<char *>(buffers[k]) -
+                           static_cast<const char *>(manager.get_address()) +
+                           sizes[k];
+          used_range = std::max(used_range, std::size_t(end));
+        }
+        const double live_mb = double(live_size) / (1ULL << 20);
+        const double used_range_mb = double(used_range) / (1ULL << 20);
+        const double segment_mb = double(manager.get_size()) / (1ULL << 20);
+        std::cout << r + 1 << "\t" << live_mb << "\t" << used_range_mb << "\t"
+                  << used_range_mb / live_mb << "\t" << segment_mb << "\t"
+                  << mdtl::elapsed_time_sec(start) << std::endl;
+      }
+    }
+
+    for (auto buffer : buffers) manager.deallocate(buffer);
+  }
+  metall::manager::remove(option.datastore_path.c_str());
+
+  return 0;
+}
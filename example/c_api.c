@@ -20,6 +20,22 @@ int main(void) {
     metall_remove("/tmp/metall1");
   }
 
+  // Allocate many objects at once
+  {
+    metall_manager* manager = metall_create("/tmp/metall-many");
+
+    void* ptrs[16];
+    if (metall_malloc_many(manager, sizeof(uint64_t), 16, ptrs)) {
+      for (int i = 0; i < 16; ++i) {
+        *(uint64_t*)ptrs[i] = i;
+      }
+      metall_free_many(manager, ptrs, 16);
+    }
+
+    metall_close(manager);
+    metall_remove("/tmp/metall-many");
+  }
+
   // Allocate named object
   {
     metall_manager* manager = metall_create("/tmp/metall2");
@@ -12,7 +12,10 @@
 using index_t = uint64_t;
 using vid_t = uint64_t;
 
-// We have two CSR graph data structures that have the same interfaces
+// We have two CSR graph data structures that have the same interfaces.
+// These show how to write a data structure that takes an allocator;
+// metall::container::csr_graph (metall/container/csr_graph.hpp) is a
+// ready-to-use CSR graph that is built from edges in parallel.
 #if 0
 using csr_graph_t = csr<index_t, vid_t, metall::manager::allocator_type<char>>;
 #else
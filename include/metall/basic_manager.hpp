@@ -10,6 +10,7 @@
 #include <memory>
 
 #include <metall/tags.hpp>
+#include <metall/stats.hpp>
 #include <metall/stl_allocator.hpp>
 #include <metall/container/scoped_allocator.hpp>
 #include <metall/container/fallback_allocator.hpp>
@@ -187,6 +188,48 @@ class basic_manager {
     }
   }
 
+  /// \brief Opens an existing data store and populates the page tables of
+  /// the application data segment (or the named objects) using multiple
+  /// threads so that the first accesses do not wait for page faults.
+  /// The progress is reported through the logger at the info level.
+  /// For named objects, memory they point to (e.g., container elements) is
+  /// not populated; see prefault_option::object_names.
+  /// \param base_path Path to a data store.
+  /// \param prefault Regions to populate and the number of threads.
+  basic_manager(open_only_t, const path_type &base_path,
+                const prefault_option &prefault) noexcept {
+    try {
+      m_kernel = std::make_unique<manager_kernel_type>();
+      if (m_kernel->open(base_path)) m_kernel->prefault(prefault);
+    } catch (...) {
+      m_kernel.reset(nullptr);
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "An exception has been thrown");
+    }
+  }
+
+  /// \brief Opens an existing data store with the read only mode and
+  /// populates the page tables of the application data segment (or the named
+  /// objects) using multiple threads so that the first accesses do not wait
+  /// for page faults.
+  /// The progress is reported through the logger at the info level.
+  /// For named objects, memory they point to (e.g., container elements) is
+  /// not populated; see prefault_option::object_names.
+  /// Write accesses will cause segmentation fault.
+  /// \param base_path Path to a data store.
+  /// \param prefault Regions to populate and the number of threads.
+  basic_manager(open_read_only_t, const path_type &base_path,
+                const prefault_option &prefault) noexcept {
+    try {
+      m_kernel = std::make_unique<manager_kernel_type>();
+      if (m_kernel->open_read_only(base_path)) m_kernel->prefault(prefault);
+    } catch (...) {
+      m_kernel.reset(nullptr);
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "An exception has been thrown");
+    }
+  }
+
   /// \brief Creates a new data store (an existing data store will be
   /// overwritten). \param base_path Path to create a data store.
   basic_manager(create_only_t, const path_type &base_path) noexcept {
@@ -897,6 +940,28 @@ class basic_manager {
     return nullptr;
   }
 
+  /// \brief Allocates nbytes bytes on a NUMA node.
+  /// If METALL_USE_NUMA is defined, the memory is taken from the regions of the
+  /// segment bound to the node; otherwise, this function works as allocate().
+  /// \copydoc doc_thread_safe_alloc
+  ///
+  /// \param nbytes Number of bytes to allocate.
+  /// \param node A NUMA node number.
+  /// \return Returns a pointer to the allocated memory.
+  void *allocate_on_node(size_type nbytes, unsigned int node) noexcept {
+    if (!check_sanity()) {
+      return nullptr;
+    }
+    try {
+      return m_kernel->allocate_on_node(nbytes, node);
+    } catch (...) {
+      m_kernel.reset(nullptr);
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "An exception has been thrown");
+    }
+    return nullptr;
+  }
+
   /// \brief Allocates nbytes bytes. The address of the allocated memory will be
   /// a multiple of alignment.
   /// \copydoc doc_thread_safe_alloc
@@ -919,8 +984,30 @@ class basic_manager {
     return nullptr;
   }
 
-  // void allocate_many(const std::nothrow_t &tag, size_type elem_bytes,
-  // size_type n_elements, multiallocation_chain &chain);
+  /// \brief Allocates num_allocates memory blocks of nbytes bytes each at once.
+  /// Small blocks are taken holding an internal lock only once.
+  /// \copydoc doc_thread_safe_alloc
+  ///
+  /// \param nbytes Number of bytes of each memory block.
+  /// \param num_allocates Number of memory blocks to allocate.
+  /// \param addrs A buffer to store the addresses of the allocated blocks.
+  /// Must have space for num_allocates elements.
+  /// \return Returns true on success. On error, returns false and nothing is
+  /// allocated.
+  bool allocate_many(size_type nbytes, size_type num_allocates,
+                     void **addrs) noexcept {
+    if (!check_sanity()) {
+      return false;
+    }
+    try {
+      return m_kernel->allocate_many(nbytes, num_allocates, addrs);
+    } catch (...) {
+      m_kernel.reset(nullptr);
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "An exception has been thrown");
+    }
+    return false;
+  }
 
   /// \brief Deallocates the allocated memory.
   /// \copydoc doc_thread_safe_alloc
@@ -939,7 +1026,73 @@ class basic_manager {
     }
   }
 
-  // void deallocate_many(multiallocation_chain &chain);
+  /// \brief Deallocates many memory blocks at once.
+  /// \copydoc doc_thread_safe_alloc
+  ///
+  /// \param addrs Pointers to the allocated memory to be deallocated.
+  /// nullptr is ignored.
+  /// \param num_deallocates Number of elements in addrs.
+  void deallocate_many(void *const *addrs, size_type num_deallocates) noexcept {
+    if (!check_sanity()) {
+      return;
+    }
+    try {
+      return m_kernel->deallocate_many(addrs, num_deallocates);
+    } catch (...) {
+      m_kernel.reset(nullptr);
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "An exception has been thrown");
+    }
+  }
+
+  /// \brief Changes the size of the allocated memory.
+  /// Grows or shrinks the memory in place if possible, e.g., a large allocation
+  /// (equal to or larger than the chunk size) followed by free chunks.
+  /// Otherwise, allocates new memory, copies the data, and deallocates the old
+  /// memory.
+  /// \copydoc doc_thread_safe_alloc
+  ///
+  /// \param addr A pointer to the allocated memory.
+  /// If nullptr, this function works as allocate().
+  /// \param nbytes New size in bytes.
+  /// \return Returns a pointer to the resized memory.
+  /// Returns nullptr on error, and the original memory is left untouched.
+  void *reallocate(void *addr, size_type nbytes) noexcept {
+    if (!check_sanity()) {
+      return nullptr;
+    }
+    try {
+      return m_kernel->reallocate(addr, nbytes);
+    } catch (...) {
+      m_kernel.reset(nullptr);
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "An exception has been thrown");
+    }
+    return nullptr;
+  }
+
+  /// \brief Tries to expand the allocated memory to nbytes bytes without moving
+  /// it. Succeeds if the memory is large enough already or it is a large
+  /// allocation followed by enough free chunks.
+  /// \copydoc doc_thread_safe_alloc
+  ///
+  /// \param addr A pointer to the allocated memory.
+  /// \param nbytes New size in bytes.
+  /// \return Returns true if the memory at addr can hold nbytes bytes;
+  /// otherwise, false.
+  bool expand_in_place(void *addr, size_type nbytes) noexcept {
+    if (!check_sanity()) {
+      return false;
+    }
+    try {
+      return m_kernel->expand_in_place(addr, nbytes);
+    } catch (...) {
+      m_kernel.reset(nullptr);
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "An exception has been thrown");
+    }
+    return false;
+  }
 
   /// \brief Check if all allocated memory has been deallocated.
   /// \copydoc doc_no_alloc_thread_safe
@@ -981,6 +1134,57 @@ class basic_manager {
     }
   }
 
+  // ---------- Access pattern hints ---------- //
+  /// \brief Gives advice about the access pattern of a region in the
+  /// application data segment to the kernel,
+  /// e.g., before scanning a large object.
+  /// The behavior depends on the running system and the segment storage.
+  /// \copydoc doc_single_thread
+  ///
+  /// \param addr The address of the region.
+  /// \param nbytes The size of the region. The part of the region beyond the
+  /// allocated segment is ignored; thus, get_address() and get_size() can be
+  /// given to advise on the whole segment.
+  /// \param pattern The access pattern.
+  /// \return Returns true if the advice is given; otherwise, false.
+  bool advise(const void *const addr, const size_type nbytes,
+              const access_pattern pattern) noexcept {
+    if (!check_sanity()) {
+      return false;
+    }
+    try {
+      return m_kernel->advise(addr, nbytes, pattern);
+    } catch (...) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "An exception has been thrown");
+    }
+    return false;
+  }
+
+  /// \brief Reads a region in the application data segment in a background
+  /// thread so that accessing the region later does not wait for page faults.
+  /// \copydoc doc_single_thread
+  /// \details The manager waits for the read when it is closed.
+  ///
+  /// \param addr The address of the region.
+  /// \param nbytes The size of the region. The part of the region beyond the
+  /// allocated segment is ignored.
+  /// \return Returns an object of std::future. If succeeded, its get() returns
+  /// true; other false.
+  std::future<bool> prefetch_async(const void *const addr,
+                                   const size_type nbytes) noexcept {
+    if (!check_sanity()) {
+      return std::future<bool>();
+    }
+    try {
+      return m_kernel->prefetch_async(addr, nbytes);
+    } catch (...) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "An exception has been thrown");
+    }
+    return std::future<bool>();
+  }
+
   // -------- Snapshot, copy, data store management -------- //
   /// \brief Takes a snapshot of the current data. The snapshot has a new UUID.
   /// \copydoc doc_single_thread
@@ -1005,6 +1209,111 @@ class basic_manager {
     return false;
   }
 
+  /// \brief Takes a snapshot of the current data in the background.
+  /// The snapshot has a new UUID.
+  /// \copydoc doc_single_thread
+  /// \details The management data is copied before this function returns,
+  /// and the application data is copied by background threads.
+  /// The application can keep using this manager while the copy is in
+  /// progress; writing to data that has not been copied yet waits until the
+  /// data is copied, so that the snapshot holds the data at the time this
+  /// function is called. flush() and the destructor wait for the copy.
+  /// Writes done by the kernel (e.g., read(2) into objects in this manager)
+  /// fail with EFAULT while the data is being copied.
+  /// While the data is being copied, this function takes over the
+  /// process-wide SIGSEGV and SIGBUS handlers to detect writes.
+  /// Signals that are not caused by writes to this manager are forwarded to
+  /// the handlers installed before. The previous handlers are restored when
+  /// all background copies finish, unless another handler has been installed
+  /// in the meantime. Handlers must not be changed while a copy is in progress.
+  ///
+  /// \param destination_path Path to store a snapshot.
+  /// \param clone Use the file clone mechanism (reflink) instead of normal copy
+  /// if it is available.
+  /// \param num_max_copy_threads The maximum number of copy threads to use. If
+  /// <= 0 is given, the value is automatically determined.
+  /// \return Returns an object of std::future. If succeeded, its get() returns
+  /// true; other false. The snapshot must not be used before get() returns.
+  /// The destructor of the returned object blocks until the copy finishes,
+  /// so discarding it makes this function synchronous.
+  /// If the copy could not be started, the returned object is not valid().
+  [[nodiscard]] std::future<bool> snapshot_async(
+      const path_type &destination_path, const bool clone = true,
+      const int num_max_copy_threads = 0) noexcept {
+    if (!check_sanity()) {
+      return std::future<bool>();
+    }
+    try {
+      return m_kernel->snapshot_async(destination_path, clone,
+                                      num_max_copy_threads);
+    } catch (...) {
+      m_kernel.reset(nullptr);
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "An exception has been thrown");
+    }
+    return std::future<bool>();
+  }
+
+  /// \brief Takes a delta snapshot, which holds only the data changed since
+  /// the last snapshot taken by snapshot() or snapshot_delta() (the parent),
+  /// and a manifest that points to the parent. The snapshot has a new UUID.
+  /// \copydoc doc_single_thread
+  /// \details A delta snapshot cannot be opened directly;
+  /// use materialize_snapshot() to build a full data store from it.
+  /// The parent and its ancestors must not be moved or removed until then.
+  /// If the segment storage cannot tell which data have changed (e.g., the
+  /// soft-dirty bits are not available), the data are compared with the
+  /// parent to find the changes.
+  ///
+  /// \param destination_path Path to store a delta snapshot.
+  /// \param clone Use the file clone mechanism (reflink) instead of normal copy
+  /// if it is available.
+  /// \param num_max_copy_threads The maximum number of copy threads to use. If
+  /// <= 0 is given, the value is automatically determined.
+  /// \return Returns true on success; other false.
+  bool snapshot_delta(const path_type &destination_path,
+                      const bool clone = true,
+                      const int num_max_copy_threads = 0) noexcept {
+    if (!check_sanity()) {
+      return false;
+    }
+    try {
+      return m_kernel->snapshot_delta(destination_path, clone,
+                                      num_max_copy_threads);
+    } catch (...) {
+      m_kernel.reset(nullptr);
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "An exception has been thrown");
+    }
+    return false;
+  }
+
+  /// \brief Builds a full data store from a delta snapshot taken by
+  /// snapshot_delta() and its parents.
+  /// The data store has the same UUID as the delta snapshot.
+  /// \copydoc doc_thread_safe
+  ///
+  /// \param delta_snapshot_path Path to a delta snapshot.
+  /// \param destination_path Destination data store path.
+  /// \param clone Use the file clone mechanism (reflink) instead of normal copy
+  /// if it is available.
+  /// \param num_max_copy_threads The maximum number of copy threads to use. If
+  /// <= 0 is given, the value is automatically determined.
+  /// \return If succeeded, returns true; other false.
+  static bool materialize_snapshot(const path_type &delta_snapshot_path,
+                                   const path_type &destination_path,
+                                   const bool clone = true,
+                                   const int num_max_copy_threads = 0) noexcept {
+    try {
+      return manager_kernel_type::materialize_snapshot(
+          delta_snapshot_path, destination_path, clone, num_max_copy_threads);
+    } catch (...) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "An exception has been thrown");
+    }
+    return false;
+  }
+
   /// \brief Copies data store synchronously.
   /// The behavior of copying a data store that is open without the read-only
   /// mode is undefined.
@@ -1378,6 +1687,31 @@ class basic_manager {
     return 0;
   }
 
+  /// \brief Returns the statistics of the allocator, e.g., the number of
+  /// objects and chunks of each size class, the fragmentation ratio,
+  /// the hit rate of the object cache, the segment size,
+  /// and the time taken by flush().
+  /// This function only reads counters, which are updated with relaxed atomic
+  /// operations, and does not stop the allocator;
+  /// it is cheap enough to be called periodically, e.g., by a monitoring
+  /// thread. If METALL_DISABLE_STATS is defined, only the sizes are set.
+  /// \copydoc doc_thread_safe
+  ///
+  /// \return Returns the statistics.
+  /// Returns a default-constructed object on error.
+  manager_stats get_stats() const noexcept {
+    if (!check_sanity()) {
+      return {};
+    }
+    try {
+      return m_kernel->get_stats();
+    } catch (...) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "An exception has been thrown");
+    }
+    return {};
+  }
+
   /// \brief Returns if this manager was opened as read-only
   /// \copydoc doc_thread_safe
   ///
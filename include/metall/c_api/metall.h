@@ -90,6 +90,26 @@ void* metall_malloc(metall_manager* manager, size_t size);
  */
 void metall_free(metall_manager* manager, void* ptr);
 
+/**
+ * \brief Allocates n memory blocks of size bytes each at once
+ * \param manager manager to allocate with
+ * \param size number of bytes of each memory block
+ * \param n number of memory blocks to allocate
+ * \param ptrs array of at least n elements to store pointers to the allocated memory blocks
+ * \return true if successful. Otherwise, returns false, allocates nothing, and sets errno to one of the following values
+ *      - ENOMEM if the memory could not be allocated
+ */
+bool metall_malloc_many(metall_manager* manager, size_t size, size_t n,
+                        void** ptrs);
+
+/**
+ * \brief Frees n memory blocks previously allocated by metall_malloc or metall_malloc_many at once
+ * \param manager manager from which to free
+ * \param ptrs array of n pointers to the memory blocks to free. NULL elements are ignored.
+ * \param n number of elements in ptrs
+ */
+void metall_free_many(metall_manager* manager, void* const* ptrs, size_t n);
+
 /**
  * \brief Allocates size bytes and associates the allocated memory with a name
  * \param manager manager to allocate with
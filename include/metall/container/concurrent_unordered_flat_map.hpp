@@ -0,0 +1,341 @@
+// Copyright 2023 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+#ifndef METALL_CONTAINER_CONCURRENT_UNORDERED_FLAT_MAP_HPP
+#define METALL_CONTAINER_CONCURRENT_UNORDERED_FLAT_MAP_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <array>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <iterator>
+
+#include <boost/container/vector.hpp>
+#include <boost/container/scoped_allocator.hpp>
+
+#include <metall/container/unordered_flat_map.hpp>
+
+namespace metall::container {
+
+/// \brief A concurrent hash map container which can be stored in persistent
+/// memory.
+/// The elements are divided into shards by their hash values.
+/// Each shard is a boost::unordered_flat_map guarded by its own lock owned by
+/// the container; thus, operations on different shards run in parallel.
+/// As boost::concurrent_flat_map, this container does not provide iterators;
+/// elements are accessed through visitation functions, which are called with
+/// the lock of the shard held.
+/// The visitation functions must not call the member functions of the same
+/// container.
+/// \tparam _key_type A key type.
+/// \tparam _mapped_type A mapped type.
+/// \tparam _hash A hash function.
+/// \tparam _key_equal A key equal function.
+/// \tparam _allocator An allocator.
+/// \tparam k_num_shards The number of shards.
+template <typename _key_type, typename _mapped_type,
+          typename _hash = std::hash<_key_type>,
+          typename _key_equal = std::equal_to<_key_type>,
+          typename _allocator = manager::allocator_type<
+              std::pair<const _key_type, _mapped_type>>,
+          std::size_t k_num_shards = 64>
+class concurrent_unordered_flat_map {
+  static_assert(k_num_shards > 0, "k_num_shards must be greater than 0");
+
+ private:
+  template <typename T>
+  using other_allocator_type =
+      typename std::allocator_traits<_allocator>::template rebind_alloc<T>;
+
+  using shard_map_type = boost::unordered_flat_map<
+      _key_type, _mapped_type, _hash, _key_equal,
+      other_allocator_type<std::pair<const _key_type, _mapped_type>>>;
+  using shard_table_type = boost::container::vector<
+      shard_map_type, boost::container::scoped_allocator_adaptor<
+                          other_allocator_type<shard_map_type>>>;
+
+  /// \brief A spin lock that is stored in the container.
+  /// Only an atomic variable is used so that it works in a reopened datastore.
+  /// Padded to a cache line to avoid false sharing.
+  struct shard_lock_type {
+    void lock() noexcept {
+      while (locked.exchange(true, std::memory_order_acquire)) {
+        while (locked.load(std::memory_order_relaxed)) {
+          std::this_thread::yield();
+        }
+      }
+    }
+
+    void unlock() noexcept { locked.store(false, std::memory_order_release); }
+
+    std::atomic<bool> locked{false};
+    char padding[64 - sizeof(std::atomic<bool>)];
+  };
+  using lock_guard_type = std::lock_guard<shard_lock_type>;
+
+ public:
+  // -------------------- //
+  // Public types and static values
+  // -------------------- //
+  /// \brief A key type.
+  using key_type = typename shard_map_type::key_type;
+  /// \brief A mapped type.
+  using mapped_type = typename shard_map_type::mapped_type;
+  /// \brief A value type (i.e., std::pair<const key_type, mapped_type>).
+  using value_type = typename shard_map_type::value_type;
+  /// \brief A hasher type.
+  using hasher = _hash;
+  /// \brief A key equal type.
+  using key_equal = _key_equal;
+  /// \brief A unsigned integer type (usually std::size_t).
+  using size_type = std::size_t;
+  /// \brief An allocator type.
+  using allocator_type = _allocator;
+
+  // -------------------- //
+  // Constructor & assign operator
+  // -------------------- //
+  explicit concurrent_unordered_flat_map(
+      const allocator_type &allocator = allocator_type())
+      : m_shards(k_num_shards, allocator), m_size(0) {}
+
+  // The locks and the size counter are not copyable.
+  concurrent_unordered_flat_map(const concurrent_unordered_flat_map &) =
+      delete;
+  concurrent_unordered_flat_map &operator=(
+      const concurrent_unordered_flat_map &) = delete;
+
+  // -------------------- //
+  // Public methods
+  // -------------------- //
+
+  // ---------- Capacity ---------- //
+  /// \brief Returns the number of elements in the container.
+  /// The value is not a snapshot if the container is being updated.
+  size_type size() const noexcept {
+    return m_size.load(std::memory_order_relaxed);
+  }
+
+  /// \brief Checks if the container has no elements.
+  bool empty() const noexcept { return size() == 0; }
+
+  /// \brief Reserves space for at least the specified number of elements in
+  /// total, assuming that the elements are evenly distributed over the shards.
+  void reserve(const size_type n) {
+    for (size_type shard_no = 0; shard_no < k_num_shards; ++shard_no) {
+      lock_guard_type guard(m_locks[shard_no]);
+      m_shards[shard_no].reserve((n + k_num_shards - 1) / k_num_shards);
+    }
+  }
+
+  // ---------- Modifier ---------- //
+  /// \brief Inserts an element if the container doesn't already contain an
+  /// element with an equivalent key.
+  /// \param value An element value to insert.
+  /// \return A bool denoting whether the insertion took place.
+  bool insert(const value_type &value) {
+    const auto shard_no = priv_shard_no(value.first);
+    lock_guard_type guard(m_locks[shard_no]);
+    return priv_count_insertion(m_shards[shard_no].insert(value).second);
+  }
+
+  /// \brief Inserts an element if the container doesn't already contain an
+  /// element with an equivalent key.
+  /// \param value An element value to insert.
+  /// \return A bool denoting whether the insertion took place.
+  bool insert(value_type &&value) {
+    const auto shard_no = priv_shard_no(value.first);
+    lock_guard_type guard(m_locks[shard_no]);
+    return priv_count_insertion(
+        m_shards[shard_no].insert(std::move(value)).second);
+  }
+
+  /// \brief Inserts elements in [first, last).
+  /// The elements are grouped by their shards so that the lock of each shard
+  /// is taken only once.
+  /// \param first A forward iterator to the first element.
+  /// \param last A forward iterator to the end of the elements.
+  /// \return The number of elements inserted.
+  /// If an exception is thrown, the elements inserted before it remain
+  /// and are counted in size().
+  template <typename forward_iterator>
+  size_type insert(forward_iterator first, forward_iterator last) {
+    std::array<std::vector<forward_iterator>, k_num_shards> buckets;
+    for (auto itr = first; itr != last; ++itr) {
+      buckets[priv_shard_no(itr->first)].push_back(itr);
+    }
+
+    size_type num_inserted = 0;
+    try {
+      for (size_type shard_no = 0; shard_no < k_num_shards; ++shard_no) {
+        if (buckets[shard_no].empty()) continue;
+        lock_guard_type guard(m_locks[shard_no]);
+        for (const auto &itr : buckets[shard_no]) {
+          num_inserted += m_shards[shard_no].insert(*itr).second ? 1 : 0;
+        }
+      }
+    } catch (...) {
+      m_size.fetch_add(num_inserted, std::memory_order_relaxed);
+      throw;
+    }
+    m_size.fetch_add(num_inserted, std::memory_order_relaxed);
+    return num_inserted;
+  }
+
+  /// \brief Inserts an element constructed from key and args if the container
+  /// doesn't already contain an element with an equivalent key.
+  /// \param key A key of the element to insert.
+  /// \param args Arguments to construct the mapped value.
+  /// \return A bool denoting whether the insertion took place.
+  template <typename... args_type>
+  bool try_emplace(const key_type &key, args_type &&...args) {
+    const auto shard_no = priv_shard_no(key);
+    lock_guard_type guard(m_locks[shard_no]);
+    return priv_count_insertion(
+        m_shards[shard_no]
+            .try_emplace(key, std::forward<args_type>(args)...)
+            .second);
+  }
+
+  /// \brief Inserts an element if the container doesn't already contain an
+  /// element with an equivalent key. Otherwise, calls visitor with the
+  /// existing element.
+  /// \param value An element value to insert.
+  /// \param visitor A function object called as visitor(value_type &).
+  /// \return A bool denoting whether the insertion took place.
+  template <typename visitor_type>
+  bool insert_or_visit(const value_type &value, visitor_type &&visitor) {
+    const auto shard_no = priv_shard_no(value.first);
+    lock_guard_type guard(m_locks[shard_no]);
+    const auto ret = m_shards[shard_no].insert(value);
+    if (!ret.second) visitor(*ret.first);
+    return priv_count_insertion(ret.second);
+  }
+
+  /// \brief Erases the element with an equivalent key.
+  /// \param key A key of the element to erase.
+  /// \return The number of elements erased (0 or 1).
+  size_type erase(const key_type &key) {
+    const auto shard_no = priv_shard_no(key);
+    lock_guard_type guard(m_locks[shard_no]);
+    const auto num_erased = m_shards[shard_no].erase(key);
+    m_size.fetch_sub(num_erased, std::memory_order_relaxed);
+    return num_erased;
+  }
+
+  /// \brief Erases all elements.
+  void clear() {
+    for (size_type shard_no = 0; shard_no < k_num_shards; ++shard_no) {
+      lock_guard_type guard(m_locks[shard_no]);
+      m_size.fetch_sub(m_shards[shard_no].size(), std::memory_order_relaxed);
+      m_shards[shard_no].clear();
+    }
+  }
+
+  // ---------- Look up ---------- //
+  /// \brief Returns the number of elements with an equivalent key.
+  /// \return 1 or 0.
+  size_type count(const key_type &key) const {
+    const auto shard_no = priv_shard_no(key);
+    lock_guard_type guard(m_locks[shard_no]);
+    return m_shards[shard_no].count(key);
+  }
+
+  /// \brief Checks if the container contains an element with an equivalent
+  /// key.
+  bool contains(const key_type &key) const { return count(key) > 0; }
+
+  /// \brief Calls visitor with the element with an equivalent key.
+  /// \param key A key of the element to visit.
+  /// \param visitor A function object called as visitor(value_type &).
+  /// \return True if the element was found; otherwise, false.
+  template <typename visitor_type>
+  bool visit(const key_type &key, visitor_type &&visitor) {
+    const auto shard_no = priv_shard_no(key);
+    lock_guard_type guard(m_locks[shard_no]);
+    auto itr = m_shards[shard_no].find(key);
+    if (itr == m_shards[shard_no].end()) return false;
+    visitor(*itr);
+    return true;
+  }
+
+  /// \brief Calls visitor with the element with an equivalent key.
+  /// \param key A key of the element to visit.
+  /// \param visitor A function object called as visitor(const value_type &).
+  /// \return True if the element was found; otherwise, false.
+  template <typename visitor_type>
+  bool visit(const key_type &key, visitor_type &&visitor) const {
+    const auto shard_no = priv_shard_no(key);
+    lock_guard_type guard(m_locks[shard_no]);
+    const auto itr = m_shards[shard_no].find(key);
+    if (itr == m_shards[shard_no].end()) return false;
+    visitor(*itr);
+    return true;
+  }
+
+  /// \brief Calls visitor with every element.
+  /// The shards are locked one by one; thus, elements inserted or erased
+  /// concurrently may or may not be visited.
+  /// \param visitor A function object called as visitor(value_type &).
+  /// \return The number of elements visited.
+  template <typename visitor_type>
+  size_type visit_all(visitor_type &&visitor) {
+    return priv_visit_all(*this, visitor);
+  }
+
+  /// \brief Calls visitor with every element.
+  /// \param visitor A function object called as visitor(const value_type &).
+  /// \return The number of elements visited.
+  template <typename visitor_type>
+  size_type visit_all(visitor_type &&visitor) const {
+    return priv_visit_all(*this, visitor);
+  }
+
+  // ---------- Allocator ---------- //
+  /// \brief Returns the allocator associated with the container.
+  allocator_type get_allocator() const {
+    return allocator_type(m_shards.get_allocator());
+  }
+
+ private:
+  size_type priv_shard_no(const key_type &key) const {
+    // Mix the hash value since the shard maps use the same hash function
+    const uint64_t hash =
+        static_cast<uint64_t>(m_shards[0].hash_function()(key));
+    return ((hash * 0x9E3779B97F4A7C15ULL) >> 32ULL) % k_num_shards;
+  }
+
+  bool priv_count_insertion(const bool inserted) {
+    if (inserted) m_size.fetch_add(1, std::memory_order_relaxed);
+    return inserted;
+  }
+
+  template <typename self_type, typename visitor_type>
+  static size_type priv_visit_all(self_type &self, visitor_type &visitor) {
+    size_type num_visited = 0;
+    for (size_type shard_no = 0; shard_no < k_num_shards; ++shard_no) {
+      lock_guard_type guard(self.m_locks[shard_no]);
+      for (auto &value : self.m_shards[shard_no]) {
+        visitor(value);
+      }
+      num_visited += self.m_shards[shard_no].size();
+    }
+    return num_visited;
+  }
+
+  shard_table_type m_shards;
+  mutable std::array<shard_lock_type, k_num_shards> m_locks;
+  std::atomic<size_type> m_size;
+};
+
+}  // namespace metall::container
+
+#endif  // METALL_CONTAINER_CONCURRENT_UNORDERED_FLAT_MAP_HPP
@@ -0,0 +1,526 @@
+// Copyright 2023 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+#ifndef METALL_CONTAINER_CSR_GRAPH_HPP
+#define METALL_CONTAINER_CSR_GRAPH_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <limits>
+#include <type_traits>
+#include <tuple>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include <boost/container/vector.hpp>
+
+#include <metall/metall.hpp>
+
+namespace metall::container {
+
+/// \brief Options for csr_graph::build().
+struct csr_graph_build_option {
+  /// \brief The number of threads to use.
+  /// If 0 is given, the value is automatically determined.
+  std::size_t num_threads{0};
+  /// \brief If true, sorts the neighbors of each vertex by their IDs
+  /// (with their weights). Otherwise, the order of the neighbors depends on
+  /// the thread timing.
+  bool sort_neighbors{true};
+};
+
+/// \brief A graph in the compressed sparse row (CSR) format which can be
+/// stored in persistent memory.
+/// The offsets, the neighbor IDs, and the edge weights are kept in three
+/// contiguous arrays; thus, a graph found in a reopened Metall datastore is
+/// used as it is without any conversion or copy.
+/// The graph is immutable once built, except that it can be rebuilt.
+/// \tparam _vertex_id_type A vertex ID type.
+/// Vertex IDs must be in [0, the number of vertices).
+/// \tparam _offset_type An unsigned integer type for the offsets to the
+/// neighbor array, e.g., uint32_t for graphs with less than 2^32 edges.
+/// \tparam _weight_type An edge weight type, or void for unweighted graphs.
+/// \tparam _allocator An allocator type.
+template <typename _vertex_id_type = uint64_t,
+          typename _offset_type = uint64_t, typename _weight_type = void,
+          typename _allocator = metall::manager::allocator_type<std::byte>>
+class csr_graph {
+  static_assert(std::is_integral_v<_vertex_id_type>,
+                "The vertex ID type must be an integer type");
+  static_assert(std::is_integral_v<_offset_type> &&
+                    std::is_unsigned_v<_offset_type>,
+                "The offset type must be an unsigned integer type");
+
+ public:
+  // -------------------- //
+  // Public types and static values
+  // -------------------- //
+  /// \brief A vertex ID type.
+  using vertex_id_type = _vertex_id_type;
+  /// \brief An offset type.
+  using offset_type = _offset_type;
+  /// \brief An edge weight type (void for unweighted graphs).
+  using weight_type = _weight_type;
+  /// \brief A unsigned integer type (usually std::size_t).
+  using size_type = std::size_t;
+  /// \brief An allocator type.
+  using allocator_type = _allocator;
+  /// \brief A const iterator type for the neighbors of a vertex.
+  using const_neighbor_iterator = const vertex_id_type *;
+
+  /// \brief True if the graph has edge weights.
+  static constexpr bool k_weighted = !std::is_void_v<weight_type>;
+
+ private:
+  template <typename T>
+  using other_allocator =
+      typename std::allocator_traits<allocator_type>::template rebind_alloc<T>;
+
+  /// \brief An allocator that default-initializes elements requested by
+  /// resize(n, boost::container::default_init) even if the base allocator has
+  /// its own construct(), so that the edge arrays are not zero-filled before
+  /// they are written in parallel.
+  template <typename T>
+  struct default_init_allocator : other_allocator<T> {
+    using base_type = other_allocator<T>;
+    using base_type::base_type;
+
+    default_init_allocator(const base_type &allocator) : base_type(allocator) {}
+
+    template <typename U>
+    struct rebind {
+      using other = default_init_allocator<U>;
+    };
+
+    template <typename U, typename... args_type>
+    void construct(U *const ptr, args_type &&...args) {
+      std::allocator_traits<base_type>::construct(
+          *this, ptr, std::forward<args_type>(args)...);
+    }
+
+    template <typename U>
+    void construct(U *const ptr, const boost::container::default_init_t &) {
+      ::new (static_cast<void *>(ptr)) U;
+    }
+  };
+
+  // Unweighted graphs keep an empty weight array of this type.
+  using weight_storage_type =
+      std::conditional_t<k_weighted, weight_type, unsigned char>;
+
+  using offset_array_type =
+      boost::container::vector<offset_type, other_allocator<offset_type>>;
+  using neighbor_array_type =
+      boost::container::vector<vertex_id_type,
+                               default_init_allocator<vertex_id_type>>;
+  using weight_array_type =
+      boost::container::vector<weight_storage_type,
+                               default_init_allocator<weight_storage_type>>;
+
+  using counter_type = std::atomic<size_type>;
+
+ public:
+  /// \brief A const iterator type for the edge weights of a vertex.
+  using const_weight_iterator = const weight_storage_type *;
+
+  // -------------------- //
+  // Constructor & assign operator
+  // -------------------- //
+  /// \brief Constructs an empty graph.
+  explicit csr_graph(const allocator_type &allocator = allocator_type())
+      : m_offsets(allocator), m_neighbors(allocator), m_weights(allocator) {}
+
+  // -------------------- //
+  // Public methods
+  // -------------------- //
+  /// \brief Returns the number of vertices.
+  size_type num_vertices() const noexcept {
+    return m_offsets.empty() ? 0 : m_offsets.size() - 1;
+  }
+
+  /// \brief Returns the number of edges.
+  size_type num_edges() const noexcept { return m_neighbors.size(); }
+
+  /// \brief Returns the number of neighbors (out-degree) of a vertex.
+  size_type degree(const vertex_id_type &vid) const noexcept {
+    return m_offsets[vid + 1] - m_offsets[vid];
+  }
+
+  /// \brief Returns an iterator to the first neighbor of a vertex.
+  const_neighbor_iterator neighbors_begin(
+      const vertex_id_type &vid) const noexcept {
+    return m_neighbors.data() + m_offsets[vid];
+  }
+
+  /// \brief Returns an iterator to the end of the neighbors of a vertex.
+  const_neighbor_iterator neighbors_end(
+      const vertex_id_type &vid) const noexcept {
+    return m_neighbors.data() + m_offsets[vid + 1];
+  }
+
+  /// \brief Returns an iterator to the weight of the edge to the first
+  /// neighbor of a vertex. Available only if the graph has edge weights.
+  const_weight_iterator weights_begin(
+      const vertex_id_type &vid) const noexcept {
+    static_assert(k_weighted, "The graph does not have edge weights");
+    return m_weights.data() + m_offsets[vid];
+  }
+
+  /// \brief Returns an iterator to the end of the edge weights of a vertex.
+  /// Available only if the graph has edge weights.
+  const_weight_iterator weights_end(const vertex_id_type &vid) const noexcept {
+    static_assert(k_weighted, "The graph does not have edge weights");
+    return m_weights.data() + m_offsets[vid + 1];
+  }
+
+  /// \brief Returns a pointer to the offset array,
+  /// which has num_vertices() + 1 elements.
+  const offset_type *offsets() const noexcept { return m_offsets.data(); }
+
+  /// \brief Returns a pointer to the neighbor array,
+  /// which has num_edges() elements.
+  const vertex_id_type *neighbors() const noexcept {
+    return m_neighbors.data();
+  }
+
+  /// \brief Returns a pointer to the edge weight array,
+  /// which has num_edges() elements.
+  /// Available only if the graph has edge weights.
+  const weight_storage_type *weights() const noexcept {
+    static_assert(k_weighted, "The graph does not have edge weights");
+    return m_weights.data();
+  }
+
+  /// \brief Builds the graph from edges in parallel, replacing the current
+  /// contents. See the other overload for the details.
+  /// \param num_vertices The number of vertices.
+  /// \param first A random access iterator to the first edge.
+  /// The edges are tuple-like objects, e.g., std::pair or std::tuple, that
+  /// have the source, the destination, and the weight if the graph is
+  /// weighted.
+  /// \param last A random access iterator to the end of the edges.
+  /// \param option Build options.
+  template <typename edge_iterator>
+  void build(const size_type num_vertices, edge_iterator first,
+             edge_iterator last,
+             const csr_graph_build_option &option = csr_graph_build_option()) {
+    static_assert(std::is_base_of_v<std::random_access_iterator_tag,
+                                    typename std::iterator_traits<
+                                        edge_iterator>::iterator_category>,
+                  "edge_iterator must be a random access iterator");
+
+    constexpr size_type k_partition_size = 1ULL << 16ULL;
+    const auto num_edges = static_cast<size_type>(std::distance(first, last));
+    const auto num_partitions =
+        (num_edges + k_partition_size - 1) / k_partition_size;
+    build(
+        num_vertices, num_partitions,
+        [first, num_edges](const size_type partition_no, auto &&emit) {
+          const auto begin = partition_no * k_partition_size;
+          const auto end = std::min(begin + k_partition_size, num_edges);
+          for (auto itr = first + begin; itr != first + end; ++itr) {
+            if constexpr (k_weighted) {
+              emit(std::get<0>(*itr), std::get<1>(*itr), std::get<2>(*itr));
+            } else {
+              emit(std::get<0>(*itr), std::get<1>(*itr));
+            }
+          }
+        },
+        option);
+  }
+
+  /// \brief Builds the graph from an edge stream in parallel, replacing the
+  /// current contents.
+  /// The edge stream is divided into partitions, and the partitions are read
+  /// twice by multiple threads: the first pass counts the degrees, and the
+  /// second pass scatters the edges to the offsets computed by a prefix sum
+  /// of the degrees. Thus, each partition must give the same edges at both
+  /// passes.
+  /// \param num_vertices The number of vertices.
+  /// \param num_partitions The number of partitions of the edge stream.
+  /// \param partition_reader A function that is called as
+  /// partition_reader(partition_no, emit) and calls emit(source, destination)
+  /// for each edge in the partition, or emit(source, destination, weight) if
+  /// the graph is weighted. Called concurrently with different partitions.
+  /// \param option Build options.
+  /// \exception std::out_of_range A vertex ID is not less than num_vertices.
+  /// \exception std::length_error The number of edges does not fit into
+  /// offset_type.
+  /// \exception std::logic_error A partition gave different edges at the two
+  /// passes.
+  /// Exceptions thrown by partition_reader are rethrown.
+  /// The contents of the graph are unspecified if an exception is thrown.
+  template <typename partition_reader_type>
+  void build(const size_type num_vertices, const size_type num_partitions,
+             partition_reader_type &&partition_reader,
+             const csr_graph_build_option &option = csr_graph_build_option()) {
+    clear();
+
+    const size_type num_threads =
+        option.num_threads > 0
+            ? option.num_threads
+            : std::max<size_type>(std::thread::hardware_concurrency(), 1);
+
+    // The degree counters become the insertion cursors after the prefix sum.
+    std::unique_ptr<counter_type[]> cursors(new counter_type[num_vertices]);
+    priv_run_in_parallel(
+        num_threads, num_vertices, 1ULL << 16ULL,
+        [&cursors](const size_type begin, const size_type end) {
+          for (auto v = begin; v < end; ++v) {
+            cursors[v].store(0, std::memory_order_relaxed);
+          }
+        });
+
+    // First pass: count the degrees
+    priv_run_in_parallel(
+        num_threads, num_partitions, 1,
+        [&](const size_type begin, const size_type end) {
+          for (auto partition_no = begin; partition_no < end; ++partition_no) {
+            partition_reader(
+                partition_no,
+                [&cursors, num_vertices](const auto &source,
+                                         const auto &destination,
+                                         const auto &...) {
+                  priv_check_vertex_id(source, num_vertices);
+                  priv_check_vertex_id(destination, num_vertices);
+                  cursors[source].fetch_add(1, std::memory_order_relaxed);
+                });
+          }
+        });
+
+    // Prefix sum
+    m_offsets.resize(num_vertices + 1);
+    const auto num_edges = priv_prefix_sum(num_threads, num_vertices, cursors);
+    if (num_edges > std::numeric_limits<offset_type>::max()) {
+      clear();
+      throw std::length_error("The number of edges exceeds the offset type");
+    }
+    // The elements are written by the second pass in parallel,
+    // so they are not value-initialized here
+    m_neighbors.resize(num_edges, boost::container::default_init);
+    if constexpr (k_weighted) {
+      m_weights.resize(num_edges, boost::container::default_init);
+    }
+
+    try {
+      priv_scatter_edges(num_threads, num_vertices, num_partitions,
+                         partition_reader, cursors);
+    } catch (...) {
+      clear();  // Do not leave uninitialized edges
+      throw;
+    }
+
+    if (option.sort_neighbors) {
+      priv_sort_neighbors(num_threads);
+    }
+  }
+
+  /// \brief Removes all vertices and edges.
+  void clear() {
+    m_offsets.clear();
+    m_neighbors.clear();
+    m_weights.clear();
+  }
+
+  /// \brief Returns an instance of the allocator.
+  allocator_type get_allocator() const {
+    return allocator_type(m_offsets.get_allocator());
+  }
+
+ private:
+  template <typename id_type>
+  static void priv_check_vertex_id(const id_type &vid,
+                                   const size_type num_vertices) {
+    if constexpr (std::is_signed_v<id_type>) {
+      if (vid < 0) throw std::out_of_range("Negative vertex ID");
+    }
+    if (static_cast<size_type>(vid) >= num_vertices) {
+      throw std::out_of_range("Vertex ID is not less than #of vertices");
+    }
+  }
+
+  /// \brief Second pass of build(): scatters the edges to the positions
+  /// pointed by 'cursors' and checks that every position has been written.
+  template <typename partition_reader_type>
+  void priv_scatter_edges(const size_type num_threads,
+                          const size_type num_vertices,
+                          const size_type num_partitions,
+                          partition_reader_type &partition_reader,
+                          std::unique_ptr<counter_type[]> &cursors) {
+    priv_run_in_parallel(
+        num_threads, num_partitions, 1,
+        [&](const size_type begin, const size_type end) {
+          for (auto partition_no = begin; partition_no < end; ++partition_no) {
+            partition_reader(
+                partition_no,
+                [this, &cursors, num_vertices](const auto &source,
+                                               const auto &destination,
+                                               const auto &...weight) {
+                  priv_check_vertex_id(source, num_vertices);
+                  priv_check_vertex_id(destination, num_vertices);
+                  const auto pos =
+                      cursors[source].fetch_add(1, std::memory_order_relaxed);
+                  if (pos >= m_offsets[source + 1]) {
+                    throw std::logic_error(
+                        "A partition gave different edges at the two passes");
+                  }
+                  m_neighbors[pos] = destination;
+                  if constexpr (k_weighted) {
+                    m_weights[pos] = (weight, ...);
+                  }
+                });
+          }
+        });
+
+    // The cursor of each vertex must reach the end of its neighbors;
+    // otherwise, a partition gave fewer edges at the second pass
+    priv_run_in_parallel(
+        num_threads, num_vertices, 1ULL << 16ULL,
+        [this, &cursors](const size_type begin, const size_type end) {
+          for (auto v = begin; v < end; ++v) {
+            if (cursors[v].load(std::memory_order_relaxed) !=
+                m_offsets[v + 1]) {
+              throw std::logic_error(
+                  "A partition gave different edges at the two passes");
+            }
+          }
+        });
+  }
+
+  /// \brief Calls function(begin, end) for the blocks of [0, size) using
+  /// multiple threads. The blocks are assigned to the threads dynamically.
+  /// The first exception thrown by the function is rethrown.
+  template <typename function_type>
+  static void priv_run_in_parallel(const size_type num_threads,
+                                   const size_type size,
+                                   const size_type block_size,
+                                   function_type &&function) {
+    std::atomic<size_type> block_no_cnt{0};
+    std::exception_ptr exception;
+    std::mutex exception_mutex;
+    const size_type num_blocks = (size + block_size - 1) / block_size;
+
+    auto worker = [&]() {
+      try {
+        while (true) {
+          const auto block_no = block_no_cnt.fetch_add(1);
+          if (block_no >= num_blocks) break;
+          const auto begin = block_no * block_size;
+          function(begin, std::min(begin + block_size, size));
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> guard(exception_mutex);
+        if (!exception) exception = std::current_exception();
+        block_no_cnt = num_blocks;  // Stop the other threads
+      }
+    };
+
+    const auto num_workers = std::min(num_threads, num_blocks);
+    if (num_workers <= 1) {
+      worker();
+    } else {
+      std::vector<std::thread> threads;
+      threads.reserve(num_workers);
+      for (size_type i = 0; i < num_workers; ++i) {
+        threads.emplace_back(worker);
+      }
+      for (auto &th : threads) {
+        th.join();
+      }
+    }
+
+    if (exception) std::rethrow_exception(exception);
+  }
+
+  /// \brief Writes the exclusive prefix sum of the degrees in 'cursors' to
+  /// the offset array and 'cursors'.
+  /// \return Returns the total number of edges.
+  size_type priv_prefix_sum(const size_type num_threads,
+                            const size_type num_vertices,
+                            std::unique_ptr<counter_type[]> &cursors) {
+    if (num_vertices == 0) {
+      m_offsets[0] = 0;
+      return 0;
+    }
+
+    const size_type num_blocks =
+        std::max<size_type>(std::min(num_threads, num_vertices), 1);
+    const size_type block_size = (num_vertices + num_blocks - 1) / num_blocks;
+
+    // Sum each block, then scan the block sums and each block
+    std::vector<size_type> block_sums(num_blocks + 1, 0);
+    priv_run_in_parallel(
+        num_threads, num_vertices, block_size,
+        [&](const size_type begin, const size_type end) {
+          size_type sum = 0;
+          for (auto v = begin; v < end; ++v) {
+            sum += cursors[v].load(std::memory_order_relaxed);
+          }
+          block_sums[begin / block_size + 1] = sum;
+        });
+    for (size_type i = 0; i < num_blocks; ++i) {
+      block_sums[i + 1] += block_sums[i];
+    }
+    const size_type num_edges = block_sums[num_blocks];
+    if (num_edges > std::numeric_limits<offset_type>::max()) return num_edges;
+
+    priv_run_in_parallel(
+        num_threads, num_vertices, block_size,
+        [&](const size_type begin, const size_type end) {
+          size_type offset = block_sums[begin / block_size];
+          for (auto v = begin; v < end; ++v) {
+            const auto degree = cursors[v].load(std::memory_order_relaxed);
+            m_offsets[v] = static_cast<offset_type>(offset);
+            cursors[v].store(offset, std::memory_order_relaxed);
+            offset += degree;
+          }
+        });
+    m_offsets[num_vertices] = static_cast<offset_type>(num_edges);
+
+    return num_edges;
+  }
+
+  void priv_sort_neighbors(const size_type num_threads) {
+    priv_run_in_parallel(
+        num_threads, num_vertices(), 1ULL << 12ULL,
+        [this](const size_type begin, const size_type end) {
+          std::vector<std::pair<vertex_id_type, weight_storage_type>> buf;
+          for (auto v = begin; v < end; ++v) {
+            auto *const first = m_neighbors.data() + m_offsets[v];
+            auto *const last = m_neighbors.data() + m_offsets[v + 1];
+            if constexpr (k_weighted) {
+              auto *const weights = m_weights.data() + m_offsets[v];
+              buf.clear();
+              for (auto *itr = first; itr != last; ++itr) {
+                buf.emplace_back(*itr, weights[itr - first]);
+              }
+              std::sort(buf.begin(), buf.end());
+              for (size_type i = 0; i < buf.size(); ++i) {
+                first[i] = buf[i].first;
+                weights[i] = buf[i].second;
+              }
+            } else {
+              std::sort(first, last);
+            }
+          }
+        });
+  }
+
+  offset_array_type m_offsets;
+  neighbor_array_type m_neighbors;
+  weight_array_type m_weights;
+};
+
+}  // namespace metall::container
+
+#endif  // METALL_CONTAINER_CSR_GRAPH_HPP
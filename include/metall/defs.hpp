@@ -46,6 +46,15 @@
 /// larger than the specified bytes is deallocated. Will be rounded up to a
 /// multiple of the page size internally.
 #define METALL_FREE_SMALL_OBJECT_SIZE_HINT
+
+/// \brief If defined, Metall uses four size classes between two powers of 2
+/// for large allocations (equal to or larger than the chunk size) instead of
+/// rounding them up to a power of 2. This reduces the internal fragmentation
+/// of large allocations.
+/// The setting is recorded in a datastore, and opening it with another setting
+/// fails. Datastores created by older versions use powers of 2; thus, they
+/// cannot be opened with this macro defined.
+#define METALL_USE_QUARTER_POWER_OF_TWO_LARGE_SIZE
 #endif
 
 // --------------------
@@ -62,6 +71,118 @@
 /// \brief If defined, the default segment storage does not free file space even
 /// thought the corresponding segment becomes free.
 #define METALL_DISABLE_FREE_FILE_SPACE
+
+/// \brief If defined, the default segment storage uses the soft-dirty bits of
+/// the page table to msync only the pages written since the last flush.
+/// Blocks without such pages are not msynced at all.
+/// The bits also tell which blocks have changed for delta snapshots.
+/// \details
+/// The soft-dirty bits are reset for the whole process at every flush.
+/// Thus, the bits are not reset while two or more segments are open with the
+/// write mode in the same process; flushes still work but write back all pages
+/// written since the last reset.
+/// If the running system does not support soft-dirty bits,
+/// all pages are msynced as done without this macro.
+#define METALL_USE_SOFT_DIRTY_FLUSH
+
+/// \brief If defined, the default segment storage asks the kernel to back
+/// the segment with transparent huge pages (madvise(MADV_HUGEPAGE)).
+/// \details
+/// Huge pages are requested for anonymous maps (METALL_USE_ANONYMOUS_NEW_MAP),
+/// files on tmpfs (used if shmem_enabled is 'advise' or 'always'),
+/// and read-only file maps.
+/// Writable maps of files on storage devices do not use huge pages
+/// since writing back huge pages amplifies writes.
+/// The segment is freed in units of the huge page size so that huge pages are
+/// not split; thus, the memory of small objects is not freed until their
+/// chunk becomes empty.
+/// The huge page size must not be larger than the chunk size;
+/// huge pages are not used if the huge page size does not divide
+/// METALL_SEGMENT_BLOCK_SIZE.
+#define METALL_USE_HUGE_PAGES
+#endif
+
+// --------------------
+// Macros for the deduplicating segment storage
+// --------------------
+
+/// \def METALL_DEDUP_SEGMENT_PAGE_SIZE
+/// The page size the deduplicating segment storage uses.
+/// Pages that have the same contents are stored only once.
+/// Each non-zero page is a separate map; thus, the amount of non-zero data is
+/// limited to this value times the maximum number of maps per process
+/// (vm.max_map_count, 65530 by default on Linux).
+/// The same value must be used to create and open a datastore.
+#ifndef METALL_DEDUP_SEGMENT_PAGE_SIZE
+#define METALL_DEDUP_SEGMENT_PAGE_SIZE (1ULL << 21ULL)
+#endif
+
+#ifdef DOXYGEN_SKIP
+/// \brief If defined, metall::manager uses the deduplicating segment storage
+/// (metall::manager_dedup) instead of the default segment storage.
+#define METALL_USE_DEDUP_SEGMENT_STORAGE
+#endif
+
+// --------------------
+// Macros for the segment allocator
+// --------------------
+
+/// \def METALL_NUM_ARENAS
+/// The number of arenas. Each arena has its own bins of non-full chunks and
+/// their locks, and threads are assigned to the arenas in a round-robin
+/// manner. Using more than one arena reduces lock contention in allocation
+/// heavy multi-threaded programs. Must be in [1, 256].
+/// The arenas are not persisted; any number can be used to open a datastore.
+#ifndef METALL_NUM_ARENAS
+#define METALL_NUM_ARENAS 1
+#endif
+
+#ifdef DOXYGEN_SKIP
+/// \brief If defined, the chunk directory is kept in files mapped with
+/// MAP_SHARED instead of being written to and read from files at close and
+/// open. Opening a datastore does not read the chunk directory,
+/// and flush() writes it back with msync.
+/// \details
+/// The non-full chunk bins and the free chunk index are rebuilt from the
+/// chunk directory when the first allocation or deallocation happens.
+/// The rebuild scans the whole chunk directory, so the first allocation or
+/// deallocation after opening takes time proportional to the number of
+/// chunks, and concurrent allocations and deallocations wait for it.
+/// A datastore created without this macro is converted when it is opened
+/// with the write mode; after that, the datastore must be opened with this
+/// macro.
+#define METALL_ENABLE_PERSISTENT_CHUNK_DIRECTORY
+#endif
+
+#ifdef DOXYGEN_SKIP
+/// \brief If defined, the segment allocator places memory on NUMA nodes.
+/// \details
+/// The segment is divided into regions of METALL_NUMA_REGION_SIZE bytes that
+/// are interleaved over the NUMA nodes, and each region is bound to its node
+/// when it is mapped.
+/// Threads use the arena of the node they run on,
+/// and new chunks are taken from the regions of that node.
+/// Objects freed by a thread on another node bypass the object cache.
+/// METALL_NUM_ARENAS should be equal to or greater than the number of nodes.
+/// The binding takes effect on anonymous maps
+/// (METALL_USE_ANONYMOUS_NEW_MAP) and files on tmpfs only; the page cache of
+/// other files is allocated by the memory policy of the task.
+#define METALL_USE_NUMA
+#endif
+
+/// \def METALL_NUMA_REGION_SIZE
+/// The size of a region interleaved over the NUMA nodes in bytes,
+/// used only if METALL_USE_NUMA is defined.
+/// Must be a multiple of the chunk size and divide METALL_SEGMENT_BLOCK_SIZE.
+#ifndef METALL_NUMA_REGION_SIZE
+#define METALL_NUMA_REGION_SIZE METALL_SEGMENT_BLOCK_SIZE
+#endif
+
+#ifdef DOXYGEN_SKIP
+/// \brief If defined, the counters for basic_manager::get_stats() are not
+/// maintained, i.e., allocation and flush do not update any counter.
+/// get_stats() still returns the sizes of the segment.
+#define METALL_DISABLE_STATS
 #endif
 
 // --------------------
@@ -89,6 +210,15 @@
 /// hand, Metall still may use multi-threading for internal operations, such
 /// as synchronizing data with files.
 #define METALL_DISABLE_CONCURRENCY
+
+/// \brief If defined, each thread has a small object cache in front of the
+/// per-CPU caches, and most small allocations and deallocations are done
+/// without taking any lock.
+/// \details
+/// Objects cached by a thread that has exited are handed over to the next
+/// thread that uses the same manager. All cached objects are returned to the
+/// allocator when the manager is flushed or closed.
+#define METALL_ENABLE_THREAD_LOCAL_OBJECT_CACHE
 #endif
 
 // --------------------
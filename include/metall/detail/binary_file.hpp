@@ -0,0 +1,306 @@
+// Copyright 2023 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+#ifndef METALL_DETAIL_BINARY_FILE_HPP
+#define METALL_DETAIL_BINARY_FILE_HPP
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <filesystem>
+#include <type_traits>
+
+#include <metall/detail/file.hpp>
+#include <metall/detail/mmap.hpp>
+#include <metall/logger.hpp>
+
+/// \namespace metall::mtlldetail::binary_file
+/// \brief Versioned binary files used to store management data.
+/// A file consists of a fixed-size header followed by a payload.
+/// All values are stored in the native byte order
+/// and every record is aligned to 8 bytes so that
+/// a mapped file can be accessed in place.
+namespace metall::mtlldetail::binary_file {
+
+namespace {
+namespace fs = std::filesystem;
+}
+
+/// \brief Length of the magic string at the beginning of a file.
+constexpr std::size_t k_magic_length = 8;
+
+/// \brief File header.
+struct header {
+  char magic[k_magic_length];
+  uint64_t version;
+  uint64_t num_records;
+  uint64_t reserved;
+};
+static_assert(sizeof(header) == 32, "Unexpected header size");
+static_assert(std::is_trivially_copyable_v<header>,
+              "header must be trivially copyable");
+
+/// \brief Returns the number of padding bytes to align 'size' to 8 bytes.
+inline constexpr std::size_t padding_size(const std::size_t size) {
+  return (8 - size % 8) % 8;
+}
+
+/// \brief Checks if a file starts with the given magic string.
+/// \param path A path to a file.
+/// \param magic A magic string, which must be k_magic_length bytes.
+/// \return Returns true if the file exists and starts with the magic string.
+/// Returns false otherwise, e.g., the file is written in the old text format.
+inline bool has_magic(const fs::path &path, const char *const magic) {
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd == -1) return false;
+  char buf[k_magic_length];
+  const ssize_t n = ::read(fd, buf, k_magic_length);
+  ::close(fd);
+  return n == static_cast<ssize_t>(k_magic_length) &&
+         std::memcmp(buf, magic, k_magic_length) == 0;
+}
+
+/// \brief Writes a binary file with large sequential writes.
+/// Data is buffered and written out in blocks.
+/// The number of records in the header is fixed up by close().
+class writer {
+ public:
+  static constexpr std::size_t k_buffer_size = 1ULL << 20ULL;
+
+  /// \brief Constructor.
+  /// Opens (truncates) a file and writes a header.
+  /// \param path A path to a file.
+  /// \param magic A magic string, which must be k_magic_length bytes.
+  /// \param version The format version.
+  writer(const fs::path &path, const char *const magic,
+         const uint64_t version) {
+    m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (m_fd == -1) {
+      std::stringstream ss;
+      ss << "Cannot open: " << path;
+      logger::perror(logger::level::error, __FILE__, __LINE__,
+                     ss.str().c_str());
+      return;
+    }
+    m_buffer.reserve(k_buffer_size);
+
+    header h{};
+    std::memcpy(h.magic, magic, k_magic_length);
+    h.version = version;
+    h.num_records = 0;
+    write(h);
+  }
+
+  ~writer() noexcept {
+    if (m_fd != -1) ::close(m_fd);
+  }
+
+  writer(const writer &) = delete;
+  writer &operator=(const writer &) = delete;
+
+  /// \brief Returns true if no error has occurred.
+  bool good() const { return m_fd != -1 && m_good; }
+
+  /// \brief Writes a trivially copyable value.
+  template <typename T>
+  bool write(const T &value) {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "T must be trivially copyable");
+    return write(&value, sizeof(T));
+  }
+
+  /// \brief Writes 'size' bytes from 'data'.
+  bool write(const void *const data, const std::size_t size) {
+    if (!good()) return false;
+    const char *const src = static_cast<const char *>(data);
+    std::size_t done = 0;
+    while (done < size) {
+      if (m_buffer.size() == k_buffer_size && !priv_flush()) return false;
+      const std::size_t n =
+          std::min(size - done, k_buffer_size - m_buffer.size());
+      m_buffer.insert(m_buffer.end(), src + done, src + done + n);
+      done += n;
+    }
+    return true;
+  }
+
+  /// \brief Writes zeros to align the current position to 8 bytes.
+  bool pad(const std::size_t size) {
+    static constexpr char zeros[8] = {0};
+    return write(zeros, padding_size(size));
+  }
+
+  /// \brief Writes out the buffer, records the number of records in the
+  /// header, flushes the file to the storage, and closes it.
+  /// \param num_records The number of records written.
+  /// \return Returns true on success; otherwise, false.
+  bool close(const uint64_t num_records) {
+    if (!good() || !priv_flush()) return false;
+
+    if (::pwrite(m_fd, &num_records, sizeof(num_records),
+                 offsetof(header, num_records)) !=
+        static_cast<ssize_t>(sizeof(num_records))) {
+      logger::perror(logger::level::error, __FILE__, __LINE__, "pwrite");
+      m_good = false;
+      return false;
+    }
+
+    const bool synced = os_fsync(m_fd);
+    const bool closed = os_close(m_fd);
+    m_fd = -1;
+    m_good = synced && closed;
+    return m_good;
+  }
+
+ private:
+  bool priv_flush() {
+    std::size_t done = 0;
+    while (done < m_buffer.size()) {
+      const ssize_t n =
+          ::write(m_fd, m_buffer.data() + done, m_buffer.size() - done);
+      if (n == -1) {
+        if (errno == EINTR) continue;
+        logger::perror(logger::level::error, __FILE__, __LINE__, "write");
+        m_good = false;
+        return false;
+      }
+      done += n;
+    }
+    m_buffer.clear();
+    return true;
+  }
+
+  int m_fd{-1};
+  bool m_good{true};
+  std::vector<char> m_buffer;
+};
+
+/// \brief Reads a binary file by mapping it into memory.
+/// Records can be read sequentially using read() or
+/// accessed in place through data().
+class reader {
+ public:
+  /// \brief Constructor.
+  /// Maps a file and validates its header.
+  /// \param path A path to a file.
+  /// \param magic A magic string, which must be k_magic_length bytes.
+  /// \param version The expected format version.
+  reader(const fs::path &path, const char *const magic,
+         const uint64_t version) {
+    const ssize_t file_size = get_file_size(path);
+    if (file_size < static_cast<ssize_t>(sizeof(header))) {
+      std::stringstream ss;
+      ss << "Too small or not readable file: " << path;
+      logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+      return;
+    }
+
+    const auto ret = map_file_read_mode(path, nullptr, file_size, 0);
+    if (ret.first == -1 || !ret.second) {
+      std::stringstream ss;
+      ss << "Failed to map: " << path;
+      logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+      return;
+    }
+    m_fd = ret.first;
+    m_addr = static_cast<const char *>(ret.second);
+    m_size = file_size;
+    os_madvise(const_cast<char *>(m_addr), m_size, MADV_SEQUENTIAL);
+
+    std::memcpy(&m_header, m_addr, sizeof(header));
+    m_pos = sizeof(header);
+    if (std::memcmp(m_header.magic, magic, k_magic_length) != 0) {
+      std::stringstream ss;
+      ss << "Invalid file type: " << path;
+      logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+      priv_unmap();
+      return;
+    }
+    if (m_header.version != version) {
+      std::stringstream ss;
+      ss << "Unsupported format version " << m_header.version << ": " << path;
+      logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+      priv_unmap();
+      return;
+    }
+  }
+
+  ~reader() noexcept { priv_unmap(); }
+
+  reader(const reader &) = delete;
+  reader &operator=(const reader &) = delete;
+
+  /// \brief Returns true if the file has been mapped and no read error has
+  /// occurred.
+  bool good() const { return m_addr != nullptr && m_good; }
+
+  /// \brief Returns the number of records stored in the header.
+  uint64_t num_records() const { return m_header.num_records; }
+
+  /// \brief Returns the address of the current position.
+  const char *data() const { return m_addr + m_pos; }
+
+  /// \brief Returns the number of bytes that have not been read.
+  std::size_t remaining() const { return good() ? m_size - m_pos : 0; }
+
+  /// \brief Reads a trivially copyable value.
+  template <typename T>
+  bool read(T *const value) {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "T must be trivially copyable");
+    return read(value, sizeof(T));
+  }
+
+  /// \brief Reads 'size' bytes into 'buf'.
+  bool read(void *const buf, const std::size_t size) {
+    if (remaining() < size) {
+      m_good = false;
+      return false;
+    }
+    std::memcpy(buf, m_addr + m_pos, size);
+    m_pos += size;
+    return true;
+  }
+
+  /// \brief Skips 'size' bytes.
+  bool skip(const std::size_t size) {
+    if (remaining() < size) {
+      m_good = false;
+      return false;
+    }
+    m_pos += size;
+    return true;
+  }
+
+ private:
+  void priv_unmap() noexcept {
+    if (m_addr) {
+      munmap(m_fd, const_cast<char *>(m_addr), m_size, false);
+    }
+    m_fd = -1;
+    m_addr = nullptr;
+    m_size = 0;
+    m_pos = 0;
+  }
+
+  int m_fd{-1};
+  const char *m_addr{nullptr};
+  std::size_t m_size{0};
+  std::size_t m_pos{0};
+  bool m_good{true};
+  header m_header{};
+};
+
+}  // namespace metall::mtlldetail::binary_file
+
+#endif  // METALL_DETAIL_BINARY_FILE_HPP
@@ -0,0 +1,328 @@
+// Copyright 2023 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+#ifndef METALL_DETAIL_CONCURRENT_STRING_MAP_HPP
+#define METALL_DETAIL_CONCURRENT_STRING_MAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <metall/detail/hash.hpp>
+
+namespace metall::mtlldetail {
+
+/// \brief A hash map from strings to trivially copyable values whose lookups
+/// do not take any lock.
+/// Lookups can run concurrently with updates and never block.
+/// Updates (insert, erase, and clear) must be serialized by the caller.
+/// Nodes and bucket arrays removed by updates are reclaimed after all lookups
+/// that could see them have finished (RCU-style reclamation).
+/// \tparam value_type A value type, which must be trivially copyable.
+template <typename value_type>
+class concurrent_string_map {
+ public:
+  static_assert(std::is_trivially_copyable_v<value_type>,
+                "value_type must be trivially copyable");
+
+  using size_type = std::size_t;
+  using key_view_type = std::string_view;
+
+ private:
+  static constexpr size_type k_initial_num_buckets = 64;
+  static constexpr size_type k_num_reader_slots = 64;
+  static constexpr size_type k_min_num_retired_to_reclaim = 64;
+  static constexpr unsigned int k_hash_seed = 123;
+
+  struct node_type {
+    node_type(const key_view_type key, const std::size_t hash,
+              const value_type &value, node_type *const next)
+        : key(key), hash(hash), value(value), next(next) {}
+
+    const std::string key;
+    const std::size_t hash;
+    const value_type value;
+    std::atomic<node_type *> next;
+  };
+
+  struct table_type {
+    explicit table_type(const size_type num_buckets)
+        : num_buckets(num_buckets),
+          buckets(std::make_unique<std::atomic<node_type *>[]>(num_buckets)) {
+      for (size_type i = 0; i < num_buckets; ++i) {
+        buckets[i].store(nullptr, std::memory_order_relaxed);
+      }
+    }
+
+    std::atomic<node_type *> &bucket(const std::size_t hash) const {
+      return buckets[hash & (num_buckets - 1)];
+    }
+
+    const size_type num_buckets;
+    const std::unique_ptr<std::atomic<node_type *>[]> buckets;
+  };
+
+  // Number of lookups in progress.
+  // Each lookup is counted in the slot of the thread and the parity of the
+  // epoch when the lookup started.
+  struct alignas(64) reader_slot_type {
+    std::atomic<size_type> count[2];
+  };
+
+ public:
+  concurrent_string_map()
+      : m_table(new table_type(k_initial_num_buckets)),
+        m_reader_slots(std::make_unique<reader_slot_type[]>(k_num_reader_slots)) {
+    for (size_type i = 0; i < k_num_reader_slots; ++i) {
+      m_reader_slots[i].count[0].store(0, std::memory_order_relaxed);
+      m_reader_slots[i].count[1].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  ~concurrent_string_map() noexcept {
+    table_type *const table = m_table.load(std::memory_order_relaxed);
+    priv_free_nodes(*table);
+    delete table;
+    priv_free_retired();
+  }
+
+  concurrent_string_map(const concurrent_string_map &) = delete;
+  concurrent_string_map &operator=(const concurrent_string_map &) = delete;
+  concurrent_string_map(concurrent_string_map &&) = delete;
+  concurrent_string_map &operator=(concurrent_string_map &&) = delete;
+
+  /// \brief Finds a value by key without taking any lock.
+  /// Can be called concurrently with any other function.
+  /// \param key A key to find.
+  /// \param value A pointer to store the found value. Can be nullptr.
+  /// \return Returns true if the key is found; otherwise, false.
+  bool find(const key_view_type key, value_type *const value) const noexcept {
+    const std::size_t hash = priv_hash(key);
+    const reader_guard guard(*this);
+    const table_type *const table = m_table.load(std::memory_order_acquire);
+    for (const node_type *node =
+             table->bucket(hash).load(std::memory_order_acquire);
+         node; node = node->next.load(std::memory_order_acquire)) {
+      if (node->hash == hash && node->key == key) {
+        if (value) *value = node->value;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// \brief Inserts a key-value pair.
+  /// Must not be called concurrently with other updates.
+  /// \param key A key to insert.
+  /// \param value A value to insert.
+  /// \return Returns false if the key already exists. Throws an exception
+  /// if it fails to allocate memory.
+  bool insert(const key_view_type key, const value_type &value) {
+    const std::size_t hash = priv_hash(key);
+    if (priv_find_link(hash, key)) return false;
+
+    if (m_size >= m_table.load(std::memory_order_relaxed)->num_buckets) {
+      priv_grow();
+    }
+
+    auto &head = m_table.load(std::memory_order_relaxed)->bucket(hash);
+    auto *const node = new node_type(
+        key, hash, value, head.load(std::memory_order_relaxed));
+    head.store(node, std::memory_order_release);
+    ++m_size;
+    return true;
+  }
+
+  /// \brief Erases a key.
+  /// Must not be called concurrently with other updates.
+  /// \param key A key to erase.
+  /// \return Returns true if the key is erased; otherwise, false.
+  bool erase(const key_view_type key) {
+    auto *const link = priv_find_link(priv_hash(key), key);
+    if (!link) return false;
+
+    node_type *const node = link->load(std::memory_order_relaxed);
+    link->store(node->next.load(std::memory_order_relaxed),
+                std::memory_order_release);
+    --m_size;
+    priv_retire(node);
+    return true;
+  }
+
+  /// \brief Erases all keys.
+  /// Must not be called concurrently with other updates.
+  void clear() {
+    const table_type *const table = m_table.load(std::memory_order_relaxed);
+    for (size_type i = 0; i < table->num_buckets; ++i) {
+      node_type *node =
+          table->buckets[i].exchange(nullptr, std::memory_order_acq_rel);
+      while (node) {
+        node_type *const next = node->next.load(std::memory_order_relaxed);
+        priv_retire(node);
+        node = next;
+      }
+    }
+    m_size = 0;
+  }
+
+  /// \brief Returns the number of keys.
+  /// Must not be called concurrently with updates.
+  size_type size() const noexcept { return m_size; }
+
+ private:
+  class reader_guard {
+   public:
+    explicit reader_guard(const concurrent_string_map &map) noexcept
+        : m_count(map.priv_enter_reader()) {}
+    ~reader_guard() noexcept {
+      m_count->fetch_sub(1, std::memory_order_release);
+    }
+
+    reader_guard(const reader_guard &) = delete;
+    reader_guard &operator=(const reader_guard &) = delete;
+
+   private:
+    std::atomic<size_type> *const m_count;
+  };
+
+  static std::size_t priv_hash(const key_view_type key) noexcept {
+    return murmur_hash_64a(key.data(), static_cast<int>(key.size()),
+                           k_hash_seed);
+  }
+
+  static size_type priv_reader_slot_no() noexcept {
+    static std::atomic<size_type> num_threads{0};
+    thread_local const size_type slot_no =
+        num_threads.fetch_add(1, std::memory_order_relaxed) %
+        k_num_reader_slots;
+    return slot_no;
+  }
+
+  std::atomic<size_type> *priv_enter_reader() const noexcept {
+    auto &slot = m_reader_slots[priv_reader_slot_no()];
+    const auto parity = m_epoch.load(std::memory_order_seq_cst) & 1;
+    slot.count[parity].fetch_add(1, std::memory_order_seq_cst);
+    // Pairs with the fence in priv_synchronize():
+    // either the writer sees this count or this reader sees the removal.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return &slot.count[parity];
+  }
+
+  /// \brief Waits until all lookups that started before this call finish.
+  /// A lookup is counted with the parity of the epoch it has read,
+  /// and a stale lookup can still be counted with the old parity after a flip;
+  /// thus, flips the epoch twice and waits for both parities to drain.
+  void priv_synchronize() {
+    for (int i = 0; i < 2; ++i) {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      const auto parity = m_epoch.fetch_add(1, std::memory_order_seq_cst) & 1;
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      for (size_type s = 0; s < k_num_reader_slots; ++s) {
+        while (m_reader_slots[s].count[parity].load(
+                   std::memory_order_acquire) != 0) {
+          std::this_thread::yield();
+        }
+      }
+    }
+  }
+
+  /// \brief Returns the link that points to the node of the key.
+  std::atomic<node_type *> *priv_find_link(const std::size_t hash,
+                                           const key_view_type key) const {
+    auto *link = &(m_table.load(std::memory_order_relaxed)->bucket(hash));
+    for (node_type *node = link->load(std::memory_order_relaxed); node;
+         node = link->load(std::memory_order_relaxed)) {
+      if (node->hash == hash && node->key == key) return link;
+      link = &(node->next);
+    }
+    return nullptr;
+  }
+
+  /// \brief Publishes a bucket array twice as large.
+  /// Nodes in the current array can be visited by lookups;
+  /// thus, they are copied instead of being relinked.
+  void priv_grow() {
+    table_type *const old_table = m_table.load(std::memory_order_relaxed);
+    auto new_table = std::make_unique<table_type>(old_table->num_buckets * 2);
+    try {
+      for (size_type i = 0; i < old_table->num_buckets; ++i) {
+        for (node_type *node =
+                 old_table->buckets[i].load(std::memory_order_relaxed);
+             node; node = node->next.load(std::memory_order_relaxed)) {
+          auto &head = new_table->bucket(node->hash);
+          head.store(new node_type(node->key, node->hash, node->value,
+                                   head.load(std::memory_order_relaxed)),
+                     std::memory_order_relaxed);
+        }
+      }
+    } catch (...) {
+      priv_free_nodes(*new_table);
+      throw;
+    }
+    m_table.store(new_table.release(), std::memory_order_release);
+
+    m_retired_tables.push_back(old_table);
+    for (size_type i = 0; i < old_table->num_buckets; ++i) {
+      for (node_type *node =
+               old_table->buckets[i].load(std::memory_order_relaxed);
+           node; node = node->next.load(std::memory_order_relaxed)) {
+        m_retired_nodes.push_back(node);
+      }
+    }
+    priv_reclaim_if_needed();
+  }
+
+  void priv_retire(node_type *const node) {
+    m_retired_nodes.push_back(node);
+    priv_reclaim_if_needed();
+  }
+
+  /// \brief Reclaims retired objects in batches
+  /// so that the cost of waiting for lookups is amortized.
+  void priv_reclaim_if_needed() {
+    if (m_retired_nodes.size() + m_retired_tables.size() <
+        std::max(k_min_num_retired_to_reclaim, m_size)) {
+      return;
+    }
+    priv_synchronize();
+    priv_free_retired();
+  }
+
+  void priv_free_retired() noexcept {
+    for (auto *node : m_retired_nodes) delete node;
+    m_retired_nodes.clear();
+    for (auto *table : m_retired_tables) delete table;
+    m_retired_tables.clear();
+  }
+
+  static void priv_free_nodes(const table_type &table) noexcept {
+    for (size_type i = 0; i < table.num_buckets; ++i) {
+      node_type *node = table.buckets[i].load(std::memory_order_relaxed);
+      while (node) {
+        node_type *const next = node->next.load(std::memory_order_relaxed);
+        delete node;
+        node = next;
+      }
+    }
+  }
+
+  std::atomic<table_type *> m_table;
+  size_type m_size{0};
+  std::atomic<size_type> m_epoch{0};
+  std::unique_ptr<reader_slot_type[]> m_reader_slots;
+  std::vector<node_type *> m_retired_nodes;
+  std::vector<table_type *> m_retired_tables;
+};
+
+}  // namespace metall::mtlldetail
+
+#endif  // METALL_DETAIL_CONCURRENT_STRING_MAP_HPP
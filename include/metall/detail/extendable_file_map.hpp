@@ -0,0 +1,248 @@
+// Copyright 2023 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+#ifndef METALL_DETAIL_EXTENDABLE_FILE_MAP_HPP
+#define METALL_DETAIL_EXTENDABLE_FILE_MAP_HPP
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <cstddef>
+#include <algorithm>
+#include <string>
+#include <sstream>
+#include <filesystem>
+
+#include <metall/detail/file.hpp>
+#include <metall/detail/mmap.hpp>
+#include <metall/detail/utilities.hpp>
+#include <metall/logger.hpp>
+
+namespace metall::mtlldetail {
+
+namespace {
+namespace fs = std::filesystem;
+}
+
+/// \brief A file mapped with MAP_SHARED that can be extended without moving
+/// the mapped address.
+/// A VM region of the capacity is reserved first and the file is mapped into
+/// it from the beginning. Extending the file maps only the new part;
+/// thus, addresses in the already mapped part stay valid while extending.
+/// This class assumes that race condition is handled by the caller;
+/// however, reading the mapped part while extending is safe.
+class extendable_file_map {
+ public:
+  /// \brief The file is extended by a multiple of this size.
+  static constexpr std::size_t k_extend_unit = 1ULL << 21ULL;
+
+  extendable_file_map() = default;
+  ~extendable_file_map() noexcept { release(); }
+
+  extendable_file_map(const extendable_file_map &) = delete;
+  extendable_file_map &operator=(const extendable_file_map &) = delete;
+
+  extendable_file_map(extendable_file_map &&other) noexcept
+      : m_fd(other.m_fd),
+        m_addr(other.m_addr),
+        m_capacity(other.m_capacity),
+        m_size(other.m_size),
+        m_read_only(other.m_read_only) {
+    other.m_fd = -1;
+    other.m_addr = nullptr;
+    other.m_capacity = 0;
+    other.m_size = 0;
+  }
+
+  extendable_file_map &operator=(extendable_file_map &&other) noexcept {
+    if (this != &other) {
+      release();
+      m_fd = other.m_fd;
+      m_addr = other.m_addr;
+      m_capacity = other.m_capacity;
+      m_size = other.m_size;
+      m_read_only = other.m_read_only;
+      other.m_fd = -1;
+      other.m_addr = nullptr;
+      other.m_capacity = 0;
+      other.m_size = 0;
+    }
+    return *this;
+  }
+
+  /// \brief Creates a new empty file and reserves a VM region for it.
+  /// An existing file is truncated.
+  /// \param path A path to the file.
+  /// \param capacity The maximum size the file can be extended to.
+  /// \return Returns true on success; otherwise, false.
+  bool create(const fs::path &path, const std::size_t capacity) {
+    if (is_open()) return false;
+
+    m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (m_fd == -1) {
+      std::stringstream ss;
+      ss << "Cannot create: " << path;
+      logger::perror(logger::level::error, __FILE__, __LINE__,
+                     ss.str().c_str());
+      return false;
+    }
+    m_read_only = false;
+    m_size = 0;
+
+    if (!priv_reserve_vm(capacity)) {
+      release();
+      return false;
+    }
+    return true;
+  }
+
+  /// \brief Opens and maps an existing file.
+  /// \param path A path to the file.
+  /// \param capacity The maximum size the file can be extended to.
+  /// Ignored if read_only is true.
+  /// \param read_only If true, the file is mapped with the read-only mode.
+  /// \return Returns true on success; otherwise, false.
+  bool open(const fs::path &path, const std::size_t capacity,
+            const bool read_only) {
+    if (is_open()) return false;
+
+    m_fd = ::open(path.c_str(), read_only ? O_RDONLY : O_RDWR);
+    if (m_fd == -1) {
+      std::stringstream ss;
+      ss << "Cannot open: " << path;
+      logger::perror(logger::level::error, __FILE__, __LINE__,
+                     ss.str().c_str());
+      return false;
+    }
+    m_read_only = read_only;
+
+    const ssize_t file_size = get_file_size(path);
+    if (file_size < 0) {
+      release();
+      return false;
+    }
+
+    if (!priv_reserve_vm(read_only ? file_size
+                                   : std::max(capacity,
+                                              std::size_t(file_size)))) {
+      release();
+      return false;
+    }
+
+    if (!priv_map(0, file_size)) {
+      release();
+      return false;
+    }
+    m_size = file_size;
+
+    return true;
+  }
+
+  /// \brief Extends the file if it is smaller than the requested size.
+  /// \param request_size The size to extend to.
+  /// \return Returns true if the file is extended to or already larger than
+  /// the requested size. Returns false on failure.
+  bool extend(const std::size_t request_size) {
+    if (!is_open() || m_read_only) return false;
+    if (request_size <= m_size) return true;
+
+    const std::size_t new_size = std::min(
+        std::size_t(round_up(request_size, k_extend_unit)), m_capacity);
+    if (new_size < request_size) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Requested size is bigger than the capacity");
+      return false;
+    }
+
+    if (!extend_file_size(m_fd, new_size, false)) {
+      return false;
+    }
+    if (!priv_map(m_size, new_size - m_size)) {
+      return false;
+    }
+    m_size = new_size;
+
+    return true;
+  }
+
+  /// \brief Syncs the mapped region with the file.
+  /// \param sync If false is specified, this function returns before finishing
+  /// the sync operation.
+  /// \return Returns true on success; otherwise, false.
+  bool sync(const bool sync) {
+    if (!is_open() || m_read_only || m_size == 0) return true;
+    return os_msync(m_addr, m_size, sync);
+  }
+
+  /// \brief Unmaps the file and releases the VM region.
+  /// Modified data is written back to the file by the OS.
+  /// \return Returns true on success; otherwise, false.
+  bool release() noexcept {
+    bool ret = true;
+    if (m_addr) {
+      ret &= os_munmap(m_addr, m_capacity);
+    }
+    if (m_fd != -1) {
+      ret &= os_close(m_fd);
+    }
+    m_fd = -1;
+    m_addr = nullptr;
+    m_capacity = 0;
+    m_size = 0;
+    return ret;
+  }
+
+  /// \brief Returns the address of the mapped region.
+  void *data() const { return m_addr; }
+
+  /// \brief Returns the current file size.
+  std::size_t size() const { return m_size; }
+
+  /// \brief Returns true if a file is open.
+  bool is_open() const { return m_fd != -1; }
+
+  /// \brief Returns true if the file is mapped with the read-only mode.
+  bool read_only() const { return m_read_only; }
+
+ private:
+  bool priv_reserve_vm(const std::size_t capacity) {
+    const ssize_t page_size = get_page_size();
+    if (page_size <= 0) return false;
+    m_capacity = round_up(std::max(capacity, std::size_t(1)), page_size);
+    m_addr = reserve_vm_region(m_capacity);
+    if (!m_addr) {
+      std::stringstream ss;
+      ss << "Cannot reserve a VM region " << m_capacity << " bytes";
+      logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+      m_capacity = 0;
+      return false;
+    }
+    return true;
+  }
+
+  bool priv_map(const std::size_t offset, const std::size_t length) {
+    if (length == 0) return true;
+    void *const addr = static_cast<char *>(m_addr) + offset;
+    const int prot = m_read_only ? PROT_READ : (PROT_READ | PROT_WRITE);
+    if (os_mmap(addr, length, prot, MAP_SHARED | MAP_FIXED, m_fd, offset) !=
+        addr) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Failed to map a file");
+      return false;
+    }
+    return true;
+  }
+
+  int m_fd{-1};
+  void *m_addr{nullptr};
+  std::size_t m_capacity{0};
+  std::size_t m_size{0};
+  bool m_read_only{false};
+};
+
+}  // namespace metall::mtlldetail
+
+#endif  // METALL_DETAIL_EXTENDABLE_FILE_MAP_HPP
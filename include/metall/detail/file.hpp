@@ -16,6 +16,8 @@
 
 #ifdef __linux__
 #include <linux/falloc.h>  // For FALLOC_FL_PUNCH_HOLE and FALLOC_FL_KEEP_SIZE
+#include <linux/magic.h>   // For TMPFS_MAGIC
+#include <sys/vfs.h>
 #endif
 
 #include <cstdlib>
@@ -255,6 +257,42 @@ inline ssize_t get_actual_file_size(const fs::path &file_path) {
   return ssize_t(stat_buf.st_blocks) * ssize_t(stat_buf.st_blksize);
 }
 
+/// \brief Gives advice about the access pattern of file data.
+/// \param advice One of POSIX_FADV_* values.
+/// \return Returns true on success; otherwise, false.
+inline bool os_fadvise([[maybe_unused]] const int fd,
+                       [[maybe_unused]] const off_t offset,
+                       [[maybe_unused]] const off_t len,
+                       [[maybe_unused]] const int advice) {
+#ifdef POSIX_FADV_NORMAL
+  const int ret = ::posix_fadvise(fd, offset, len, advice);
+  if (ret != 0) {
+    errno = ret;
+    logger::perror(logger::level::warning, __FILE__, __LINE__,
+                   "posix_fadvise");
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+/// \brief Checks if a file is on tmpfs.
+/// \return Returns true if the file is on tmpfs; otherwise, false is returned,
+/// including when the file system type is not available.
+inline bool on_tmpfs([[maybe_unused]] const fs::path &path) {
+#if defined(__linux__) && defined(TMPFS_MAGIC)
+  struct statfs statfs_buf;
+  if (::statfs(path.c_str(), &statfs_buf) != 0) {
+    return false;
+  }
+  return statfs_buf.f_type == TMPFS_MAGIC;
+#else
+  return false;
+#endif
+}
+
 /// \brief Remove a file or directory
 /// \return Upon successful completion, returns true; otherwise, false is
 /// returned. If the file or directory does not exist, true is returned.
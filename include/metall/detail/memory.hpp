@@ -26,6 +26,17 @@ inline ssize_t get_page_size() noexcept {
   return page_size;
 }
 
+/// \brief Returns the size of transparent huge pages.
+/// \return On success, returns the huge page size. On error, returns -1.
+inline ssize_t get_transparent_huge_page_size() noexcept {
+  std::ifstream fin("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size");
+  ssize_t size = -1;
+  if (!fin.is_open() || !(fin >> size)) {
+    return -1;
+  }
+  return size;
+}
+
 /// \brief Reads a value from /proc/meminfo
 /// \param key Target token looking for
 /// \return On success, returns read value. On error, returns -1.
@@ -317,6 +317,52 @@ inline bool uncommit_private_nonanonymous_pages(void *const addr,
   return true;
 }
 
+/// \brief Asks the kernel to back the region with transparent huge pages.
+/// Whether huge pages are actually used depends on the running system,
+/// e.g., the type of the mapped file and the THP settings.
+inline bool advise_huge_pages(void *const addr, const size_t length) {
+#ifdef MADV_HUGEPAGE
+  if (!os_madvise(addr, length, MADV_HUGEPAGE)) {
+    logger::perror(logger::level::info, __FILE__, __LINE__,
+                   "madvise MADV_HUGEPAGE");
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+/// \brief Populates the page table entries of a region for reading so that
+/// reading the region does not cause page faults.
+/// Uses MADV_POPULATE_READ if it is available;
+/// otherwise, reads a byte of each page.
+/// The region must be readable.
+inline bool populate_read(void *const addr, const size_t length) {
+  const ssize_t page_size = get_page_size();
+  if (page_size <= 0) return false;
+  if (length == 0) return true;
+  auto *const first = reinterpret_cast<char *>(
+      round_down(reinterpret_cast<uint64_t>(addr), page_size));
+  const std::size_t aligned_length =
+      length + (static_cast<char *>(addr) - first);
+
+#ifdef MADV_POPULATE_READ
+  if (os_madvise(first, aligned_length, MADV_POPULATE_READ)) return true;
+  // Kernels older than 5.14 do not support it
+  if (errno != EINVAL) {
+    logger::perror(logger::level::warning, __FILE__, __LINE__,
+                   "madvise MADV_POPULATE_READ");
+    return false;
+  }
+#endif
+  const auto *const pages = static_cast<const volatile char *>(first);
+  for (std::size_t i = 0; i < aligned_length; i += page_size) {
+    [[maybe_unused]] const char c = pages[i];
+  }
+  return true;
+}
+
 inline bool uncommit_shared_pages(void *const addr, const size_t length) {
   if (!os_madvise(addr, length, MADV_DONTNEED)) {
     logger::perror(logger::level::info, __FILE__, __LINE__,
@@ -452,6 +498,34 @@ class pagemap_reader {
     return buf;
   }
 
+  /// \brief Reads the pagemap values of contiguous pages at once.
+  /// \param page_no The first page number.
+  /// \param num_pages The number of pages to read.
+  /// \param buf A buffer to store the values.
+  /// \return Returns true on success; otherwise, false.
+  bool read(const uint64_t page_no, const std::size_t num_pages,
+            uint64_t *const buf) {
+    if (m_fd < 0) {
+      return false;
+    }
+
+    const std::size_t length = num_pages * sizeof(uint64_t);
+    std::size_t done = 0;
+    while (done < length) {
+      const ssize_t n =
+          ::pread(m_fd, reinterpret_cast<char *>(buf) + done, length - done,
+                  page_no * sizeof(uint64_t) + done);
+      if (n <= 0) {
+        if (n == -1 && errno == EINTR) continue;
+        logger::perror(logger::level::error, __FILE__, __LINE__, "pread");
+        return false;
+      }
+      done += n;
+    }
+
+    return true;
+  }
+
  private:
   int m_fd;
 };
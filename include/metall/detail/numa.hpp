@@ -0,0 +1,126 @@
+// Copyright 2023 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+#ifndef METALL_DETAIL_UTILITY_NUMA_HPP
+#define METALL_DETAIL_UTILITY_NUMA_HPP
+
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>  // For MPOL_PREFERRED
+#endif
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#include <metall/detail/proc.hpp>
+#include <metall/logger.hpp>
+
+namespace metall::mtlldetail {
+
+namespace numadtl {
+/// \brief Parses a list such as "0-3,8,10-11" in /sys/devices/system/.
+/// \return Returns the numbers in the list.
+inline std::vector<unsigned int> parse_list(const std::string &list) {
+  std::vector<unsigned int> numbers;
+  std::stringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    if (range.empty() || range == "\n") continue;
+    const auto hyphen = range.find('-');
+    try {
+      const unsigned int first = std::stoul(range.substr(0, hyphen));
+      const unsigned int last = (hyphen == std::string::npos)
+                                    ? first
+                                    : std::stoul(range.substr(hyphen + 1));
+      for (auto n = first; n <= last; ++n) numbers.push_back(n);
+    } catch (...) {
+      return {};
+    }
+  }
+  return numbers;
+}
+
+inline std::vector<unsigned int> read_list(const std::string &path) {
+  std::ifstream ifs(path);
+  std::string list;
+  if (!ifs.is_open() || !std::getline(ifs, list)) return {};
+  return parse_list(list);
+}
+
+/// \brief Returns a table that maps CPU numbers to NUMA node numbers.
+inline const std::vector<unsigned int> &cpu_to_node_table() {
+  static const std::vector<unsigned int> table = []() {
+    std::vector<unsigned int> table(get_num_cpus(), 0);
+    for (const auto node : read_list("/sys/devices/system/node/online")) {
+      for (const auto cpu :
+           read_list("/sys/devices/system/node/node" + std::to_string(node) +
+                     "/cpulist")) {
+        if (cpu >= table.size()) table.resize(cpu + 1, 0);
+        table[cpu] = node;
+      }
+    }
+    return table;
+  }();
+  return table;
+}
+}  // namespace numadtl
+
+/// \brief Returns the number of NUMA nodes, i.e., the largest online node
+/// number plus one. Returns 1 if the information is not available.
+/// The result is computed once.
+inline unsigned int get_num_numa_nodes() {
+  static const unsigned int num_nodes = []() {
+    const auto nodes =
+        numadtl::read_list("/sys/devices/system/node/online");
+    if (nodes.empty()) return 1U;
+    return *std::max_element(nodes.begin(), nodes.end()) + 1;
+  }();
+  return num_nodes;
+}
+
+/// \brief Returns the NUMA node number of the CPU on which the calling thread
+/// is currently executing.
+inline unsigned int get_numa_node_no() {
+  if (get_num_numa_nodes() == 1) return 0;
+  const auto &table = numadtl::cpu_to_node_table();
+  const auto cpu = get_cpu_no();
+  return (cpu < table.size()) ? table[cpu] : 0;
+}
+
+/// \brief Sets the memory policy of a region so that its pages are allocated
+/// on a NUMA node (mbind(2) with MPOL_PREFERRED).
+/// Pages are allocated on other nodes if the node does not have free memory.
+/// Takes effect on anonymous maps and files on tmpfs;
+/// the page cache of other files is allocated by the policy of the task.
+/// \param addr The address of the region. Must be page aligned.
+/// \param length The length of the region.
+/// \param node The NUMA node number.
+/// \return Returns true on success; otherwise, false.
+inline bool bind_to_numa_node([[maybe_unused]] void *const addr,
+                              [[maybe_unused]] const std::size_t length,
+                              [[maybe_unused]] const unsigned int node) {
+#if defined(__linux__) && defined(SYS_mbind)
+  constexpr std::size_t k_bits = sizeof(unsigned long) * 8;
+  std::vector<unsigned long> mask(node / k_bits + 1, 0);
+  mask[node / k_bits] = 1UL << (node % k_bits);
+  if (::syscall(SYS_mbind, addr, length, MPOL_PREFERRED, mask.data(),
+                mask.size() * k_bits, 0) != 0) {
+    logger::perror(logger::level::warning, __FILE__, __LINE__, "mbind");
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+}  // namespace metall::mtlldetail
+
+#endif  // METALL_DETAIL_UTILITY_NUMA_HPP
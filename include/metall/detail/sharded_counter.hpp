@@ -0,0 +1,77 @@
+// Copyright 2023 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+#ifndef METALL_DETAIL_SHARDED_COUNTER_HPP
+#define METALL_DETAIL_SHARDED_COUNTER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <atomic>
+
+namespace metall::mtlldetail {
+
+/// \brief An array of counters updated by multiple threads with relaxed
+/// atomic operations.
+/// The counters are split into shards, and threads are assigned to the shards
+/// in a round-robin manner, so that threads rarely update the same cache line.
+/// A counter in a shard can be negative, e.g., when an object is counted up by
+/// one thread and counted down by another.
+/// \tparam k_num_counters The number of counters.
+/// \tparam k_num_shards The number of shards.
+template <std::size_t k_num_counters, std::size_t k_num_shards = 16>
+class sharded_counter_array {
+ public:
+  using value_type = std::int64_t;
+
+  static constexpr std::size_t size() noexcept { return k_num_counters; }
+
+  /// \brief Adds a value to a counter.
+  void add(const std::size_t counter_no, const value_type value) noexcept {
+    m_shards[priv_shard_no()].counters[counter_no].fetch_add(
+        value, std::memory_order_relaxed);
+  }
+
+  /// \brief Returns the value of a counter.
+  /// The value is not a snapshot if the counter is being updated.
+  value_type load(const std::size_t counter_no) const noexcept {
+    value_type sum = 0;
+    for (const auto &shard : m_shards) {
+      sum += shard.counters[counter_no].load(std::memory_order_relaxed);
+    }
+    return sum;
+  }
+
+  /// \brief Sets zero to all counters.
+  /// Must not be called concurrently with add().
+  void clear() noexcept {
+    for (auto &shard : m_shards) {
+      for (auto &counter : shard.counters) {
+        counter.store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+
+ private:
+  struct alignas(64) shard_type {
+    std::array<std::atomic<value_type>, k_num_counters> counters{};
+  };
+
+  static std::size_t priv_shard_no() noexcept {
+    if constexpr (k_num_shards == 1) {
+      return 0;
+    }
+    static std::atomic_size_t thread_count{0};
+    thread_local static const std::size_t shard_no =
+        thread_count.fetch_add(1, std::memory_order_relaxed) % k_num_shards;
+    return shard_no;
+  }
+
+  std::array<shard_type, k_num_shards> m_shards{};
+};
+
+}  // namespace metall::mtlldetail
+
+#endif  // METALL_DETAIL_SHARDED_COUNTER_HPP
@@ -10,6 +10,7 @@
 #include <iostream>
 #include <fstream>
 #include <metall/detail/memory.hpp>
+#include <metall/detail/mmap.hpp>
 #include <metall/logger.hpp>
 
 namespace metall::mtlldetail {
@@ -46,6 +47,39 @@ inline constexpr bool check_present_page(const uint64_t pagemap_value) {
   return (pagemap_value >> 63ULL) & 1ULL;
 }
 
+/// \brief Checks if a page is a file page (or a shared anonymous page).
+/// A page of a private file map is no longer a file page once it is written,
+/// as it is replaced with an anonymous copy.
+inline constexpr bool check_file_page(const uint64_t pagemap_value) {
+  return (pagemap_value >> 61ULL) & 1ULL;
+}
+
+/// \brief Checks if soft-dirty bits are available.
+/// A page of a new mapping must be reported as soft-dirty once it is written.
+/// Kernels without soft-dirty support report the bit as 0 instead.
+/// The result is computed once.
+/// \return Returns true if soft-dirty bits are available.
+inline bool soft_dirty_page_supported() {
+  static const bool supported = []() {
+    const ssize_t page_size = get_page_size();
+    if (page_size <= 0) return false;
+
+    auto *const map =
+        static_cast<char *>(map_anonymous_write_mode(nullptr, page_size));
+    if (!map) return false;
+    map[0] = 1;
+
+    pagemap_reader reader;
+    const uint64_t pagemap =
+        reader.at(reinterpret_cast<uint64_t>(map) / page_size);
+    os_munmap(map, page_size);
+
+    return pagemap != pagemap_reader::error_value &&
+           check_soft_dirty_page(pagemap);
+  }();
+  return supported;
+}
+
 }  // namespace metall::mtlldetail
 
 #endif  // METALL_DETAIL_UTILITY_SOFT_DIRTY_PAGE_HPP
@@ -0,0 +1,412 @@
+// Copyright 2023 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+#ifndef METALL_JSON_DETAILS_ADAPTIVE_OBJECT_HPP
+#define METALL_JSON_DETAILS_ADAPTIVE_OBJECT_HPP
+
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <string_view>
+#include <algorithm>
+#include <limits>
+
+#include <metall/json/json_fwd.hpp>
+#include <metall/container/scoped_allocator.hpp>
+#include <metall/container/vector.hpp>
+#include <metall/utility/hash.hpp>
+
+namespace metall::json::jsndtl {
+
+namespace {
+namespace mc = metall::container;
+}
+
+// Forward declarations
+template <typename Alloc = std::allocator<std::byte>,
+          std::size_t k_index_threshold = 16>
+class adaptive_object;
+
+template <typename allocator_type, std::size_t k_index_threshold,
+          typename other_object_type>
+bool general_adaptive_object_equal(
+    const adaptive_object<allocator_type, k_index_threshold> &object,
+    const other_object_type &other_object) noexcept;
+
+/// \brief JSON object implementation.
+/// Key-value pairs are stored in the same layout as compact_object.
+/// Once the number of key-value pairs reaches 'k_index_threshold',
+/// a hash table (open addressing) that holds the positions of the key-value
+/// pairs is built to find keys in constant time.
+/// The hash table is released when the number goes below the threshold.
+/// While the hash table is used, erase moves the last key-value pair to the
+/// erased position; thus, it does not keep the order of the key-value pairs.
+/// \tparam Alloc An allocator type.
+/// \tparam k_index_threshold The number of key-value pairs to start using the
+/// hash table. If 0, the hash table is always used.
+/// If std::numeric_limits<std::size_t>::max(), the hash table is never used,
+/// i.e., the same as compact_object.
+template <typename Alloc, std::size_t k_index_threshold>
+class adaptive_object {
+ public:
+  using allocator_type = Alloc;
+  using value_type =
+      key_value_pair<char, std::char_traits<char>, allocator_type>;
+  using key_type = std::basic_string_view<
+      char, std::char_traits<char>>;          // typename value_type::key_type;
+  using mapped_type = value<allocator_type>;  // typename
+                                              // value_type::value_type;
+
+ private:
+  template <typename alloc, typename T>
+  using other_scoped_allocator = mc::scoped_allocator_adaptor<
+      typename std::allocator_traits<alloc>::template rebind_alloc<T>>;
+
+  using value_storage_alloc_type =
+      other_scoped_allocator<allocator_type, value_type>;
+  using value_storage_type = mc::vector<value_type, value_storage_alloc_type>;
+
+  // Value: the position of the corresponding item in the value_storage
+  using value_postion_type = typename value_storage_type::size_type;
+
+  // Each slot holds a position in the value_storage or k_empty_slot.
+  // As the table holds only positions, it can be used in persistent memory
+  // as is.
+  using index_table_type = mc::vector<
+      value_postion_type, typename std::allocator_traits<
+                              allocator_type>::template rebind_alloc<
+                              value_postion_type>>;
+
+  static constexpr value_postion_type k_empty_slot =
+      std::numeric_limits<value_postion_type>::max();
+
+ public:
+  using iterator = typename value_storage_type::iterator;
+  using const_iterator = typename value_storage_type::const_iterator;
+
+  /// \brief Constructor.
+  adaptive_object() {}
+
+  /// \brief Constructor.
+  /// \param alloc An allocator object.
+  explicit adaptive_object(const allocator_type &alloc)
+      : m_value_storage(alloc), m_index_table(alloc) {}
+
+  /// \brief Copy constructor
+  adaptive_object(const adaptive_object &) = default;
+
+  /// \brief Allocator-extended copy constructor
+  adaptive_object(const adaptive_object &other, const allocator_type &alloc)
+      : m_value_storage(other.m_value_storage, alloc),
+        m_index_table(other.m_index_table, alloc) {}
+
+  /// \brief Move constructor
+  adaptive_object(adaptive_object &&) noexcept = default;
+
+  /// \brief Allocator-extended move constructor
+  adaptive_object(adaptive_object &&other, const allocator_type &alloc) noexcept
+      : m_value_storage(std::move(other.m_value_storage), alloc),
+        m_index_table(std::move(other.m_index_table), alloc) {}
+
+  /// \brief Copy assignment operator
+  adaptive_object &operator=(const adaptive_object &) = default;
+
+  /// \brief Move assignment operator
+  adaptive_object &operator=(adaptive_object &&) noexcept = default;
+
+  /// \brief Swap contents.
+  void swap(adaptive_object &other) noexcept {
+    using std::swap;
+    swap(m_value_storage, other.m_value_storage);
+    swap(m_index_table, other.m_index_table);
+  }
+
+  /// \brief Access a mapped value with a key.
+  /// If there is no mapped value that is associated with 'key', allocates it
+  /// first. \param key The key of the mapped value to access. \return A
+  /// reference to the mapped value associated with 'key'.
+  mapped_type &operator[](const key_type &key) {
+    const auto pos = priv_locate_value(key);
+    if (pos < m_value_storage.max_size()) {
+      return m_value_storage[pos].value();
+    }
+
+    const auto emplaced_pos =
+        priv_emplace_value(key, mapped_type{m_value_storage.get_allocator()});
+    return m_value_storage[emplaced_pos].value();
+  }
+
+  /// \brief Access a mapped value.
+  /// \param key The key of the mapped value to access.
+  /// \return A reference to the mapped value associated with 'key'.
+  const mapped_type &operator[](const key_type &key) const {
+    return m_value_storage[priv_locate_value(key)].value();
+  }
+
+  /// \brief Return true if the key is found.
+  /// \return True if found; otherwise, false.
+  bool contains(const key_type &key) const { return count(key) > 0; }
+
+  /// \brief Count the number of elements with a specific key.
+  /// \return The number elements with a specific key.
+  std::size_t count(const key_type &key) const {
+    const auto pos = priv_locate_value(key);
+    return pos < m_value_storage.max_size() ? 1 : 0;
+  }
+
+  /// \brief Access a mapped value.
+  /// \param key The key of the mapped value to access.
+  /// \return A reference to the mapped value associated with 'key'.
+  mapped_type &at(const key_type &key) {
+    return m_value_storage[priv_locate_value(key)].value();
+  }
+
+  /// \brief Access a mapped value.
+  /// \param key The key of the mapped value to access.
+  /// \return A reference to the mapped value associated with 'key'.
+  const mapped_type &at(const key_type &key) const {
+    return m_value_storage[priv_locate_value(key)].value();
+  }
+
+  iterator find(const key_type &key) {
+    const auto pos = priv_locate_value(key);
+    if (pos < m_value_storage.max_size()) {
+      return m_value_storage.begin() + pos;
+    }
+    return m_value_storage.end();
+  }
+
+  const_iterator find(const key_type &key) const {
+    const auto pos = priv_locate_value(key);
+    if (pos < m_value_storage.max_size()) {
+      return m_value_storage.cbegin() + pos;
+    }
+    return m_value_storage.cend();
+  }
+
+  /// \brief Returns an iterator that is at the beginning of the objects.
+  /// \return An iterator that is at the beginning of the objects.
+  iterator begin() { return m_value_storage.begin(); }
+
+  /// \brief Returns an iterator that is at the beginning of the objects.
+  /// \return A const iterator that is at the beginning of the objects.
+  const_iterator begin() const { return m_value_storage.begin(); }
+
+  /// \brief Returns an iterator that is at the end of the objects.
+  /// \return An iterator that is at the end of the objects.
+  iterator end() { return m_value_storage.end(); }
+
+  /// \brief Returns an iterator that is at the end of the objects.
+  /// \return A const iterator that is at the end of the objects.
+  const_iterator end() const { return m_value_storage.end(); }
+
+  /// \brief Returns the number of key-value pairs.
+  /// \return The number of key-values pairs.
+  std::size_t size() const { return m_value_storage.size(); }
+
+  /// \brief Returns true if the hash table is used to find keys.
+  /// \return True if the hash table is used; otherwise, false.
+  bool indexed() const { return !m_index_table.empty(); }
+
+  /// \brief Erases the element at 'position'.
+  /// \param position The position of the element to erase.
+  /// \return Iterator following the removed element.
+  /// If 'position' refers to the last element, then the end() iterator is
+  /// returned.
+  iterator erase(iterator position) { return priv_erase(position); }
+
+  /// \brief Erases the element at 'position'.
+  /// \param position The position of the element to erase.
+  /// \return Iterator following the removed element.
+  /// If 'position' refers to the last element, then the end() iterator is
+  /// returned.
+  iterator erase(const_iterator position) { return priv_erase(position); }
+
+  /// \brief Erases the element associated with 'key'.
+  /// \param key The key of the element to erase.
+  /// \return Iterator following the removed element.
+  /// If 'position' refers to the last element, then the end() iterator is
+  /// returned.
+  iterator erase(const key_type &key) { return priv_erase(find(key)); }
+
+  /// \brief Return `true` if two objects are equal.
+  /// \param lhs An object to compare.
+  /// \param rhs An object to compare.
+  /// \return True if two objects are equal. Otherwise, false.
+  friend bool operator==(const adaptive_object &lhs,
+                         const adaptive_object &rhs) noexcept {
+    return jsndtl::general_adaptive_object_equal(lhs, rhs);
+  }
+
+  /// \brief Return `true` if two objects are not equal.
+  /// \param lhs An object to compare.
+  /// \param rhs An object to compare.
+  /// \return True if two objects are not equal. Otherwise, false.
+  friend bool operator!=(const adaptive_object &lhs,
+                         const adaptive_object &rhs) noexcept {
+    return !(lhs == rhs);
+  }
+
+  /// \brief Return an allocator object.
+  allocator_type get_allocator() const noexcept {
+    return allocator_type(m_value_storage.get_allocator());
+  }
+
+ private:
+  static std::size_t hash_key(const key_type &key) {
+    return metall::mtlldetail::murmur_hash_64a(key.data(), key.length(), 123);
+  }
+
+  value_postion_type priv_locate_value(const key_type &key) const {
+    if (m_index_table.empty()) {
+      for (value_postion_type i = 0; i < m_value_storage.size(); ++i) {
+        if (m_value_storage[i].key() == key) {
+          return i;  // Found the key
+        }
+      }
+      return m_value_storage.max_size();  // Couldn't find
+    }
+
+    const auto mask = m_index_table.size() - 1;
+    for (auto slot = hash_key(key) & mask;; slot = (slot + 1) & mask) {
+      const auto pos = m_index_table[slot];
+      if (pos == k_empty_slot) break;
+      if (m_value_storage[pos].key() == key) {
+        return pos;  // Found the key
+      }
+    }
+    return m_value_storage.max_size();  // Couldn't find
+  }
+
+  value_postion_type priv_emplace_value(const key_type &key,
+                                        mapped_type &&mapped_value) {
+    m_value_storage.emplace_back(key, std::move(mapped_value));
+    const value_postion_type pos = m_value_storage.size() - 1;
+
+    // Keep the load factor of the hash table at most 0.5
+    if (!m_index_table.empty() &&
+        m_value_storage.size() * 2 <= m_index_table.size()) {
+      priv_index_value(pos);
+    } else if (m_value_storage.size() >= k_index_threshold) {
+      priv_rebuild_index_table();
+    }
+    return pos;
+  }
+
+  void priv_index_value(const value_postion_type pos) {
+    const auto mask = m_index_table.size() - 1;
+    auto slot = hash_key(m_value_storage[pos].key()) & mask;
+    while (m_index_table[slot] != k_empty_slot) {
+      slot = (slot + 1) & mask;
+    }
+    m_index_table[slot] = pos;
+  }
+
+  void priv_rebuild_index_table() {
+    if (m_value_storage.size() < k_index_threshold) {
+      index_table_type(m_index_table.get_allocator()).swap(m_index_table);
+      return;
+    }
+
+    std::size_t table_size = 1;
+    while (table_size < m_value_storage.size() * 2) {
+      table_size *= 2;
+    }
+    m_index_table.assign(table_size, k_empty_slot);
+    for (value_postion_type pos = 0; pos < m_value_storage.size(); ++pos) {
+      priv_index_value(pos);
+    }
+  }
+
+  value_postion_type priv_find_slot(const value_postion_type pos) const {
+    const auto mask = m_index_table.size() - 1;
+    auto slot = hash_key(m_value_storage[pos].key()) & mask;
+    while (m_index_table[slot] != pos) {
+      slot = (slot + 1) & mask;
+    }
+    return slot;
+  }
+
+  /// \brief Removes a slot by the backward shift deletion so that
+  /// no tombstone is left in the table.
+  void priv_unindex_slot(value_postion_type hole) {
+    const auto mask = m_index_table.size() - 1;
+    for (auto slot = (hole + 1) & mask; m_index_table[slot] != k_empty_slot;
+         slot = (slot + 1) & mask) {
+      const auto home =
+          hash_key(m_value_storage[m_index_table[slot]].key()) & mask;
+      // Move the entry into the hole if the hole is between its home slot
+      // and the current slot
+      if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+        m_index_table[hole] = m_index_table[slot];
+        hole = slot;
+      }
+    }
+    m_index_table[hole] = k_empty_slot;
+  }
+
+  /// \brief Erases a value.
+  /// If the hash table is used, moves the last value to the erased position
+  /// so that erase is done in constant time regardless of the position.
+  auto priv_erase(const_iterator value_position) {
+    if (value_position == m_value_storage.cend()) {
+      return m_value_storage.end();
+    }
+
+    const value_postion_type pos =
+        std::distance(m_value_storage.cbegin(), value_position);
+    if (m_index_table.empty()) {
+      m_value_storage.erase(value_position);
+      return m_value_storage.begin() + pos;
+    }
+
+    const value_postion_type last = m_value_storage.size() - 1;
+    priv_unindex_slot(priv_find_slot(pos));
+    if (pos != last) {
+      m_index_table[priv_find_slot(last)] = pos;
+      m_value_storage[pos] = std::move(m_value_storage[last]);
+    }
+    m_value_storage.pop_back();
+
+    if (m_value_storage.size() < k_index_threshold) {
+      index_table_type(m_index_table.get_allocator()).swap(m_index_table);
+    }
+
+    return m_value_storage.begin() + pos;
+  }
+
+  value_storage_type m_value_storage{allocator_type{}};
+  index_table_type m_index_table{allocator_type{}};
+};
+
+/// \brief Swap value instances.
+template <typename allocator_type, std::size_t k_index_threshold>
+inline void swap(
+    adaptive_object<allocator_type, k_index_threshold> &lhd,
+    adaptive_object<allocator_type, k_index_threshold> &rhd) noexcept {
+  lhd.swap(rhd);
+}
+
+/// \brief Provides 'equal' calculation for other object types that have the
+/// same interface as the object class.
+template <typename allocator_type, std::size_t k_index_threshold,
+          typename other_object_type>
+inline bool general_adaptive_object_equal(
+    const adaptive_object<allocator_type, k_index_threshold> &object,
+    const other_object_type &other_object) noexcept {
+  if (object.size() != other_object.size()) return false;
+
+  for (const auto &key_value : object) {
+    auto itr = other_object.find(key_value.key_c_str());
+    if (itr == other_object.end()) return false;
+    if (key_value.value() != itr->value()) return false;
+  }
+
+  return true;
+}
+
+}  // namespace metall::json::jsndtl
+
+#endif  // METALL_JSON_DETAILS_ADAPTIVE_OBJECT_HPP
@@ -8,19 +8,42 @@
 
 #include <metall/json/json_fwd.hpp>
 #include <metall/json/details/compact_object.hpp>
+#include <metall/json/details/adaptive_object.hpp>
+
+#ifdef DOXYGEN_SKIP
+/// \brief If defined, metall::json::object is jsndtl::adaptive_object,
+/// which finds keys with a hash table once an object has many keys.
+/// Otherwise, it is jsndtl::compact_object.
+/// The two have different memory layouts; thus, JSON objects stored with
+/// one setting must not be opened with the other.
+#define METALL_JSON_USE_ADAPTIVE_OBJECT
+#endif
 
 namespace metall::json {
 
+namespace jsndtl {
+#ifdef METALL_JSON_USE_ADAPTIVE_OBJECT
+template <typename allocator_type>
+using object_base = adaptive_object<allocator_type>;
+#else
+template <typename allocator_type>
+using object_base = compact_object<allocator_type>;
+#endif
+}  // namespace jsndtl
+
 /// \brief JSON object.
 /// An object is a table key and value pairs.
 /// The order of key-value pairs depends on the implementation.
+/// Keys are found by a linear search by default.
+/// See METALL_JSON_USE_ADAPTIVE_OBJECT to find keys in wide objects with a
+/// hash table.
 #ifdef DOXYGEN_SKIP
 template <typename allocator_type = std::allocator<std::byte>>
 #else
 template <typename allocator_type>
 #endif
-class object : public jsndtl::compact_object<allocator_type> {
-  using jsndtl::compact_object<allocator_type>::compact_object;
+class object : public jsndtl::object_base<allocator_type> {
+  using jsndtl::object_base<allocator_type>::object_base;
 };
 
 /// \brief Swap value instances.
@@ -38,7 +61,11 @@ template <typename allocator_type, typename other_object_type>
 inline bool general_object_equal(
     const object<allocator_type> &object,
     const other_object_type &other_object) noexcept {
+#ifdef METALL_JSON_USE_ADAPTIVE_OBJECT
+  return general_adaptive_object_equal(object, other_object);
+#else
   return general_compact_object_equal(object, other_object);
+#endif
 }
 
 }  // namespace jsndtl
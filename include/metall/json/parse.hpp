@@ -7,10 +7,16 @@
 #define METALL_JSON_PARSE_HPP
 
 #include <iostream>
+#include <string>
 #include <string_view>
 #include <memory>
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <cstddef>
 
 #include <metall/json/json_fwd.hpp>
+#include <boost/json/basic_parser_impl.hpp>
 
 namespace metall::json {
 
@@ -18,6 +24,273 @@ namespace {
 namespace bj = boost::json;
 }
 
+namespace jsndtl {
+
+/// \brief A handler of boost::json::basic_parser that builds a JSON value in
+/// place, i.e., strings, arrays, and objects are constructed directly with
+/// the allocator of the value.
+template <typename allocator_type>
+class value_builder {
+ public:
+  using value_type = value<allocator_type>;
+
+  static constexpr std::size_t max_object_size =
+      std::numeric_limits<std::size_t>::max();
+  static constexpr std::size_t max_array_size =
+      std::numeric_limits<std::size_t>::max();
+  static constexpr std::size_t max_key_size =
+      std::numeric_limits<std::size_t>::max();
+  static constexpr std::size_t max_string_size =
+      std::numeric_limits<std::size_t>::max();
+
+  explicit value_builder(value_type *const root) : m_root(root) {}
+
+  /// \brief Sets the value to build the next document in.
+  void reset(value_type *const root) {
+    m_root = root;
+    m_stack.clear();
+    m_key.clear();
+    m_string = nullptr;
+  }
+
+  bool on_document_begin(bj::error_code &) { return true; }
+  bool on_document_end(bj::error_code &) { return true; }
+
+  bool on_array_begin(bj::error_code &) {
+    auto &slot = priv_next_slot();
+    slot.emplace_array();
+    m_stack.push_back(&slot);
+    return true;
+  }
+
+  bool on_array_end(std::size_t, bj::error_code &) {
+    m_stack.pop_back();
+    return true;
+  }
+
+  bool on_object_begin(bj::error_code &) {
+    auto &slot = priv_next_slot();
+    slot.emplace_object();
+    m_stack.push_back(&slot);
+    return true;
+  }
+
+  bool on_object_end(std::size_t, bj::error_code &) {
+    m_stack.pop_back();
+    return true;
+  }
+
+  bool on_string_part(bj::string_view s, std::size_t, bj::error_code &) {
+    if (!m_string) m_string = &priv_next_slot().emplace_string();
+    m_string->append(s.data(), s.size());
+    return true;
+  }
+
+  bool on_string(bj::string_view s, std::size_t n, bj::error_code &ec) {
+    on_string_part(s, n, ec);
+    m_string = nullptr;
+    return true;
+  }
+
+  bool on_key_part(bj::string_view s, std::size_t, bj::error_code &) {
+    m_key.append(s.data(), s.size());
+    return true;
+  }
+
+  bool on_key(bj::string_view s, std::size_t, bj::error_code &) {
+    m_key.append(s.data(), s.size());
+    return true;
+  }
+
+  bool on_number_part(bj::string_view, bj::error_code &) { return true; }
+
+  bool on_int64(std::int64_t i, bj::string_view, bj::error_code &) {
+    priv_next_slot().emplace_int64() = i;
+    return true;
+  }
+
+  bool on_uint64(std::uint64_t u, bj::string_view, bj::error_code &) {
+    priv_next_slot().emplace_uint64() = u;
+    return true;
+  }
+
+  bool on_double(double d, bj::string_view, bj::error_code &) {
+    priv_next_slot().emplace_double() = d;
+    return true;
+  }
+
+  bool on_bool(bool b, bj::error_code &) {
+    priv_next_slot().emplace_bool() = b;
+    return true;
+  }
+
+  bool on_null(bj::error_code &) {
+    priv_next_slot().emplace_null();
+    return true;
+  }
+
+  bool on_comment_part(bj::string_view, bj::error_code &) { return true; }
+  bool on_comment(bj::string_view, bj::error_code &) { return true; }
+
+ private:
+  /// \brief Returns the value to which the next JSON value is assigned.
+  /// Only the innermost array or object being built is modified;
+  /// thus, the pointers to the outer ones in the stack stay valid.
+  value_type &priv_next_slot() {
+    if (m_stack.empty()) return *m_root;
+
+    auto &parent = *m_stack.back();
+    if (parent.is_array()) {
+      auto &elements = parent.as_array();
+      elements.push_back(value_type{parent.get_allocator()});
+      return elements[elements.size() - 1];
+    }
+
+    auto &slot = parent.as_object()[std::string_view(m_key)];
+    m_key.clear();
+    return slot;
+  }
+
+  value_type *m_root;
+  // The arrays and objects being built
+  std::vector<value_type *> m_stack;
+  // The key of the next object member
+  std::string m_key;
+  // The string being built
+  typename value_type::string_type *m_string{nullptr};
+};
+
+template <typename allocator_type>
+using value_parser = bj::basic_parser<value_builder<allocator_type>>;
+
+inline bool is_json_whitespace(const char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/// \brief Parses a sequence of JSON documents from a stream by reading a
+/// fixed size buffer at a time.
+/// The documents are separated by whitespaces, e.g., newline-delimited JSON.
+/// \param input An input stream.
+/// \param get_slot A function that returns a pointer to the value to build
+/// the next document in, or nullptr if no more documents are expected.
+/// \param on_document A function called when a document has been built.
+/// \return Returns true on success; otherwise, false.
+template <typename allocator_type, typename get_slot_function,
+          typename on_document_function>
+inline bool parse_stream(std::istream &input, get_slot_function &&get_slot,
+                         on_document_function &&on_document) {
+  constexpr std::size_t k_buffer_size = 1ULL << 20ULL;
+
+  value_parser<allocator_type> parser(bj::parse_options{}, nullptr);
+  std::unique_ptr<char[]> buffer(new char[k_buffer_size]);
+  std::size_t begin = 0;  // The beginning of the unconsumed data
+  std::size_t end = 0;
+  bool eof = false;
+  bool in_document = false;
+  std::size_t num_documents = 0;
+
+  const auto refill = [&]() -> bool {
+    input.read(buffer.get(), k_buffer_size);
+    begin = 0;
+    end = input.gcount();
+    if (input.bad()) {
+      std::cerr << "Failed to read the input stream" << std::endl;
+      return false;
+    }
+    eof = !input;
+    return true;
+  };
+
+  while (true) {
+    if (!in_document) {
+      while (begin < end && is_json_whitespace(buffer[begin])) ++begin;
+      if (begin == end) {
+        if (eof) return true;
+        if (!refill()) return false;
+        continue;
+      }
+
+      auto *const slot = get_slot();
+      if (!slot) {
+        std::cerr << "Failed to parse: "
+                  << bj::error_code(bj::error::extra_data).message()
+                  << std::endl;
+        return false;
+      }
+      parser.reset();
+      parser.handler().reset(slot);
+      in_document = true;
+    }
+
+    if (begin == end && !eof) {
+      if (!refill()) return false;
+      continue;
+    }
+
+    bj::error_code ec;
+    try {
+      begin += parser.write_some(!eof, buffer.get() + begin, end - begin, ec);
+    } catch (const std::exception &e) {
+      std::cerr << "Failed to build document " << num_documents << ": "
+                << e.what() << std::endl;
+      return false;
+    }
+    if (ec) {
+      std::cerr << "Failed to parse document " << num_documents << ": "
+                << ec.message() << std::endl;
+      return false;
+    }
+
+    if (parser.done()) {
+      in_document = false;
+      on_document();
+      ++num_documents;
+    } else if (eof && begin == end) {
+      // Must not happen since the parser reports an error for an incomplete
+      // document when no more data is given
+      std::cerr << "Failed to parse document " << num_documents << std::endl;
+      return false;
+    }
+  }
+}
+
+}  // namespace jsndtl
+
+/// \brief Parses a JSON represented as a string and builds it in an existing
+/// value. Strings, arrays, and objects are constructed directly with the
+/// allocator of the value, i.e., the JSON is not materialized in another
+/// memory space.
+/// \tparam allocator_type An allocator type.
+/// \param input_json_string An input JSON string.
+/// \param out_value A pointer to a value to build the JSON in.
+/// The value is null if the input is not a valid JSON.
+/// \return Returns true on success; otherwise, false.
+template <typename allocator_type>
+inline bool parse(std::string_view input_json_string,
+                  value<allocator_type> *const out_value) {
+  jsndtl::value_parser<allocator_type> parser(bj::parse_options{}, out_value);
+  bj::error_code ec;
+  try {
+    const auto n = parser.write_some(false, input_json_string.data(),
+                                     input_json_string.size(), ec);
+    for (auto i = n; !ec && i < input_json_string.size(); ++i) {
+      if (!jsndtl::is_json_whitespace(input_json_string[i])) {
+        ec = bj::error::extra_data;
+      }
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "Failed to parse: " << e.what() << std::endl;
+    out_value->emplace_null();
+    return false;
+  }
+  if (ec) {
+    std::cerr << "Failed to parse: " << ec.message() << std::endl;
+    out_value->emplace_null();
+    return false;
+  }
+  return true;
+}
+
 /// \brief Parses a JSON represented as a string.
 /// \tparam allocator_type An allocator type.
 /// \param input_json_string An input JSON string.
@@ -34,14 +307,83 @@ inline value<allocator_type> parse(std::string_view input_json_string,
                                    const allocator_type &allocator)
 #endif
 {
-  bj::error_code ec;
-  auto bj_value = bj::parse(input_json_string.data(), ec);
-  if (ec) {
-    std::cerr << "Failed to parse: " << ec.message() << std::endl;
-    return value<allocator_type>{allocator};
+  value<allocator_type> out_value(allocator);
+  parse(input_json_string, &out_value);
+  return out_value;
+}
+
+/// \brief Parses a JSON from a stream and builds it in an existing value,
+/// reading a fixed size buffer at a time. Can be used for JSON files
+/// larger than the DRAM.
+/// \tparam allocator_type An allocator type.
+/// \param input An input stream.
+/// \param out_value A pointer to a value to build the JSON in.
+/// The value is null if the input is not a valid JSON.
+/// \return Returns true on success; otherwise, false.
+template <typename allocator_type>
+inline bool parse(std::istream &input, value<allocator_type> *const out_value) {
+  bool parsed = false;
+  const bool ret = jsndtl::parse_stream<allocator_type>(
+      input,
+      [&parsed, out_value]() { return parsed ? nullptr : out_value; },
+      [&parsed]() { parsed = true; });
+  if (!ret || !parsed) {
+    if (!parsed) std::cerr << "Failed to parse: no JSON" << std::endl;
+    out_value->emplace_null();
+    return false;
   }
+  return true;
+}
+
+/// \brief Parses newline-delimited JSON (NDJSON) from a stream, reading a
+/// fixed size buffer at a time.
+/// Each document is built in place with the allocator and is passed to
+/// 'handler'. Documents separated by any whitespace are also accepted.
+/// \tparam allocator_type An allocator type.
+/// \tparam handler_type A function type.
+/// \param input An input stream.
+/// \param allocator An allocator object.
+/// \param handler A function called as handler(value<allocator_type> &&)
+/// for each document.
+/// \return Returns true on success; otherwise, false.
+/// The documents before an invalid one have been passed to 'handler'.
+template <typename allocator_type, typename handler_type>
+inline bool parse_ndjson(std::istream &input, const allocator_type &allocator,
+                         handler_type &&handler) {
+  value<allocator_type> document(allocator);
+  return jsndtl::parse_stream<allocator_type>(
+      input,
+      [&document]() {
+        document.emplace_null();
+        return &document;
+      },
+      [&document, &handler]() { handler(std::move(document)); });
+}
 
-  return metall::json::value_from(std::move(bj_value), allocator);
+/// \brief Parses newline-delimited JSON (NDJSON) from a stream and appends
+/// each document to an array.
+/// The documents are built directly in the elements of the array.
+/// \tparam allocator_type An allocator type.
+/// \param input An input stream.
+/// \param out_array A pointer to an array to append the documents to.
+/// \return Returns true on success; otherwise, false.
+/// The documents before an invalid one have been appended.
+template <typename allocator_type>
+inline bool parse_ndjson(std::istream &input,
+                         array<allocator_type> *const out_array) {
+  bool building = false;
+  const bool ret = jsndtl::parse_stream<allocator_type>(
+      input,
+      [&building, out_array]() {
+        out_array->push_back(value<allocator_type>{out_array->get_allocator()});
+        building = true;
+        return &(*out_array)[out_array->size() - 1];
+      },
+      [&building]() { building = false; });
+  if (building) {
+    out_array->erase(out_array->end() - 1);
+  }
+  return ret;
 }
 
 }  // namespace metall::json
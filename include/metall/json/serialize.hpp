@@ -7,6 +7,12 @@
 #define METALL_JSON_SERIALIZE_HPP
 
 #include <iostream>
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <cmath>
+#include <charconv>
+#include <algorithm>
 
 #include <metall/container/string.hpp>
 #include <metall/json/json_fwd.hpp>
@@ -18,27 +24,296 @@ namespace mc = metall::container;
 namespace bj = boost::json;
 }  // namespace
 
+namespace jsndtl {
+
+/// \brief The size of the buffer used to write to a stream or a string.
+constexpr std::size_t k_serialize_buffer_size = 4096;
+
+/// \brief Writes characters into a caller-provided buffer and passes the
+/// buffer to an output function each time it becomes full.
+template <typename output_function_type>
+class chunked_writer {
+ public:
+  chunked_writer(char *const buffer, const std::size_t buffer_size,
+                 output_function_type &output)
+      : m_buffer(buffer), m_size(buffer_size), m_output(output) {}
+
+  void put(const char c) {
+    if (m_pos == m_size) flush();
+    m_buffer[m_pos++] = c;
+  }
+
+  void write(const char *s, std::size_t n) {
+    while (n > 0) {
+      if (m_pos == m_size) flush();
+      const auto len = std::min(n, m_size - m_pos);
+      std::memcpy(m_buffer + m_pos, s, len);
+      m_pos += len;
+      s += len;
+      n -= len;
+    }
+  }
+
+  void write(const std::string_view s) { write(s.data(), s.size()); }
+
+  /// \brief Passes the buffered characters to the output function.
+  void flush() {
+    if (m_pos == 0) return;
+    m_output(static_cast<const char *>(m_buffer), m_pos);
+    m_pos = 0;
+  }
+
+ private:
+  char *const m_buffer;
+  const std::size_t m_size;
+  std::size_t m_pos{0};
+  output_function_type &m_output;
+};
+
+template <typename writer_type>
+inline void write_string(writer_type &writer, const std::string_view s) {
+  static constexpr char k_hex[] = "0123456789abcdef";
+
+  writer.put('"');
+  std::size_t begin = 0;  // The beginning of the characters to copy as is
+  for (std::size_t i = 0; i < s.size(); ++i) {
+    const auto c = static_cast<unsigned char>(s[i]);
+    if (c != '"' && c != '\\' && c >= 0x20) continue;
+
+    writer.write(s.data() + begin, i - begin);
+    begin = i + 1;
+    writer.put('\\');
+    switch (c) {
+      case '"':
+        writer.put('"');
+        break;
+      case '\\':
+        writer.put('\\');
+        break;
+      case '\b':
+        writer.put('b');
+        break;
+      case '\f':
+        writer.put('f');
+        break;
+      case '\n':
+        writer.put('n');
+        break;
+      case '\r':
+        writer.put('r');
+        break;
+      case '\t':
+        writer.put('t');
+        break;
+      default:
+        writer.write("u00", 3);
+        writer.put(k_hex[c >> 4U]);
+        writer.put(k_hex[c & 0xFU]);
+    }
+  }
+  writer.write(s.data() + begin, s.size() - begin);
+  writer.put('"');
+}
+
+template <typename writer_type, typename integer_type>
+inline void write_integer(writer_type &writer, const integer_type n) {
+  char buf[24];
+  const auto result = std::to_chars(buf, buf + sizeof(buf), n);
+  writer.write(buf, result.ptr - buf);
+}
+
+/// \brief Writes a double so that it is read back as the same double.
+/// As JSON cannot represent infinity and NaN, infinity is written as a number
+/// that overflows to infinity when parsed, and NaN is written as null.
+template <typename writer_type>
+inline void write_double(writer_type &writer, const double d) {
+  if (std::isnan(d)) {
+    writer.write("null", 4);
+    return;
+  }
+  if (std::isinf(d)) {
+    writer.write(d < 0 ? "-1e99999" : "1e99999", d < 0 ? 8 : 7);
+    return;
+  }
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+  char buf[32];
+  const std::size_t len = std::to_chars(buf, buf + sizeof(buf), d).ptr - buf;
+#else
+  // Floating-point to_chars is not available; use the formatting of
+  // Boost.JSON, which does not depend on the locale unlike printf.
+  const std::string str = bj::serialize(bj::value(d));
+  const char *const buf = str.data();
+  const std::size_t len = str.size();
+#endif
+  writer.write(buf, len);
+
+  // Make sure that the number is not read back as an integer
+  if (std::find_if(buf, buf + len, [](const char c) {
+        return c == '.' || c == 'e' || c == 'E';
+      }) == buf + len) {
+    writer.write(".0", 2);
+  }
+}
+
+template <typename writer_type>
+inline void write_new_line(writer_type &writer, const int indent_size,
+                           const std::size_t depth) {
+  writer.put('\n');
+  for (std::size_t i = 0; i < static_cast<std::size_t>(indent_size) * depth;
+       ++i) {
+    writer.put(' ');
+  }
+}
+
+template <typename writer_type, typename allocator_type>
+void write_value(writer_type &, const value<allocator_type> &, int,
+                 std::size_t);
+
+/// \brief Writes an array.
+/// \param indent_size The size of the indent. If it is negative,
+/// no whitespace is written.
+/// \param depth The depth of the array.
+template <typename writer_type, typename allocator_type>
+void write_array(writer_type &writer, const array<allocator_type> &arr,
+                 const int indent_size, const std::size_t depth) {
+  writer.put('[');
+  for (std::size_t i = 0; i < arr.size(); ++i) {
+    if (i > 0) writer.put(',');
+    if (indent_size >= 0) write_new_line(writer, indent_size, depth + 1);
+    write_value(writer, arr[i], indent_size, depth + 1);
+  }
+  if (indent_size >= 0 && arr.size() > 0) {
+    write_new_line(writer, indent_size, depth);
+  }
+  writer.put(']');
+}
+
+/// \brief Writes an object.
+/// \param indent_size The size of the indent. If it is negative,
+/// no whitespace is written.
+/// \param depth The depth of the object.
+template <typename writer_type, typename allocator_type>
+void write_object(writer_type &writer, const object<allocator_type> &obj,
+                  const int indent_size, const std::size_t depth) {
+  writer.put('{');
+  for (auto itr = obj.begin(); itr != obj.end(); ++itr) {
+    if (itr != obj.begin()) writer.put(',');
+    if (indent_size >= 0) write_new_line(writer, indent_size, depth + 1);
+    write_string(writer, itr->key());
+    writer.put(':');
+    if (indent_size >= 0) writer.put(' ');
+    write_value(writer, itr->value(), indent_size, depth + 1);
+  }
+  if (indent_size >= 0 && obj.begin() != obj.end()) {
+    write_new_line(writer, indent_size, depth);
+  }
+  writer.put('}');
+}
+
+/// \brief Writes a value.
+/// \param indent_size The size of the indent. If it is negative,
+/// no whitespace is written.
+/// \param depth The depth of the value.
+template <typename writer_type, typename allocator_type>
+void write_value(writer_type &writer, const value<allocator_type> &jv,
+                 const int indent_size, const std::size_t depth) {
+  if (jv.is_null()) {
+    writer.write("null", 4);
+  } else if (jv.is_bool()) {
+    if (jv.as_bool()) {
+      writer.write("true", 4);
+    } else {
+      writer.write("false", 5);
+    }
+  } else if (jv.is_int64()) {
+    write_integer(writer, jv.as_int64());
+  } else if (jv.is_uint64()) {
+    write_integer(writer, jv.as_uint64());
+  } else if (jv.is_double()) {
+    write_double(writer, jv.as_double());
+  } else if (jv.is_string()) {
+    const auto &str = jv.as_string();
+    write_string(writer, std::string_view(str.data(), str.size()));
+  } else if (jv.is_array()) {
+    write_array(writer, jv.as_array(), indent_size, depth);
+  } else if (jv.is_object()) {
+    write_object(writer, jv.as_object(), indent_size, depth);
+  }
+}
+
+template <typename writer_type, typename allocator_type>
+void write_json(writer_type &writer, const value<allocator_type> &input,
+                const int indent_size) {
+  write_value(writer, input, indent_size, 0);
+}
+
+template <typename writer_type, typename allocator_type>
+void write_json(writer_type &writer, const object<allocator_type> &input,
+                const int indent_size) {
+  write_object(writer, input, indent_size, 0);
+}
+
+template <typename writer_type, typename allocator_type>
+void write_json(writer_type &writer, const array<allocator_type> &input,
+                const int indent_size) {
+  write_array(writer, input, indent_size, 0);
+}
+
+/// \brief Serializes a JSON value, object, or array directly, i.e., without
+/// converting it to another JSON representation.
+/// \param indent_size The size of the indent. If it is negative,
+/// no whitespace is written.
+template <typename json_type, typename output_function_type>
+inline bool serialize_chunked(const json_type &input, const int indent_size,
+                              char *const buffer, const std::size_t buffer_size,
+                              output_function_type &output) {
+  if (!buffer || buffer_size == 0) {
+    std::cerr << "Failed to serialize: empty buffer" << std::endl;
+    return false;
+  }
+  chunked_writer<output_function_type> writer(buffer, buffer_size, output);
+  write_json(writer, input, indent_size);
+  writer.flush();
+  return true;
+}
+
+template <typename json_type>
+inline void serialize_to_stream(const json_type &input, const int indent_size,
+                                std::ostream &os) {
+  char buffer[k_serialize_buffer_size];
+  auto output = [&os](const char *s, const std::size_t n) {
+    os.write(s, n);
+  };
+  serialize_chunked(input, indent_size, buffer, sizeof(buffer), output);
+}
+
+template <typename json_type>
+inline std::string serialize_to_string(const json_type &input) {
+  std::string out;
+  char buffer[k_serialize_buffer_size];
+  auto output = [&out](const char *s, const std::size_t n) {
+    out.append(s, n);
+  };
+  serialize_chunked(input, -1, buffer, sizeof(buffer), output);
+  return out;
+}
+
+}  // namespace jsndtl
+
 template <typename allocator_type>
 std::string serialize(const value<allocator_type> &input) {
-  return bj::serialize(value_to<bj::value>(input));
+  return jsndtl::serialize_to_string(input);
 }
 
 template <typename allocator_type>
 std::string serialize(const object<allocator_type> &input) {
-  bj::object object;
-  for (const auto &elem : input) {
-    object[elem.key().data()] = value_to<bj::value>(elem.value());
-  }
-  return bj::serialize(object);
+  return jsndtl::serialize_to_string(input);
 }
 
 template <typename allocator_type>
 std::string serialize(const array<allocator_type> &input) {
-  bj::array array;
-  for (const auto &elem : input) {
-    array.emplace_back(value_to<bj::value>(elem));
-  }
-  return bj::serialize(array);
+  return jsndtl::serialize_to_string(input);
 }
 
 template <typename char_type, typename traits, typename allocator_type>
@@ -47,21 +322,78 @@ std::string serialize(
   return input.data();
 }
 
+/// \brief Serializes a JSON value into a stream.
+/// The value is written directly through a small buffer,
+/// i.e., the memory usage does not depend on the size of the value.
+/// \param input A JSON value to serialize.
+/// \param os An output stream object.
+template <typename allocator_type>
+void serialize(const value<allocator_type> &input, std::ostream &os) {
+  jsndtl::serialize_to_stream(input, -1, os);
+}
+
+/// \brief Serializes a JSON object into a stream.
+/// \param input A JSON object to serialize.
+/// \param os An output stream object.
+template <typename allocator_type>
+void serialize(const object<allocator_type> &input, std::ostream &os) {
+  jsndtl::serialize_to_stream(input, -1, os);
+}
+
+/// \brief Serializes a JSON array into a stream.
+/// \param input A JSON array to serialize.
+/// \param os An output stream object.
+template <typename allocator_type>
+void serialize(const array<allocator_type> &input, std::ostream &os) {
+  jsndtl::serialize_to_stream(input, -1, os);
+}
+
+/// \brief Serializes a JSON value using a caller-provided buffer.
+/// Each time the buffer becomes full, and once at the end,
+/// the filled part of the buffer is passed to 'output'.
+/// \param input A JSON value to serialize.
+/// \param buffer A buffer to write serialized data into.
+/// \param buffer_size The size of the buffer.
+/// \param output A function called as output(const char *data, std::size_t
+/// size).
+/// \return Returns true on success; otherwise, false.
+template <typename allocator_type, typename output_function_type>
+bool serialize(const value<allocator_type> &input, char *const buffer,
+               const std::size_t buffer_size, output_function_type &&output) {
+  return jsndtl::serialize_chunked(input, -1, buffer, buffer_size, output);
+}
+
+/// \brief Serializes a JSON object using a caller-provided buffer.
+/// See the value version for details.
+template <typename allocator_type, typename output_function_type>
+bool serialize(const object<allocator_type> &input, char *const buffer,
+               const std::size_t buffer_size, output_function_type &&output) {
+  return jsndtl::serialize_chunked(input, -1, buffer, buffer_size, output);
+}
+
+/// \brief Serializes a JSON array using a caller-provided buffer.
+/// See the value version for details.
+template <typename allocator_type, typename output_function_type>
+bool serialize(const array<allocator_type> &input, char *const buffer,
+               const std::size_t buffer_size, output_function_type &&output) {
+  return jsndtl::serialize_chunked(input, -1, buffer, buffer_size, output);
+}
+
 template <typename allocator_type>
 std::ostream &operator<<(std::ostream &os, const value<allocator_type> &val) {
-  os << serialize(val);
+  serialize(val, os);
   return os;
 }
 
 template <typename allocator_type>
 std::ostream &operator<<(std::ostream &os, const object<allocator_type> &obj) {
-  os << serialize(obj);
+  serialize(obj, os);
   return os;
 }
 
 template <typename allocator_type>
 std::ostream &operator<<(std::ostream &os, const array<allocator_type> &arr) {
-  os << serialize(arr);
+  serialize(arr, os);
   return os;
 }
 
@@ -15,6 +15,7 @@
 #include <tuple>
 #include <sstream>
 #include <memory>
+#include <string_view>
 #include <filesystem>
 
 #include <boost/container/string.hpp>
@@ -24,6 +25,15 @@
 #include <metall/logger.hpp>
 #include <metall/detail/ptree.hpp>
 #include <metall/detail/hash.hpp>
+#include <metall/detail/binary_file.hpp>
+#include <metall/detail/concurrent_string_map.hpp>
+
+#ifndef METALL_DISABLE_CONCURRENCY
+#define METALL_ENABLE_MUTEX_IN_ATTRIBUTED_OBJECT_DIRECTORY
+#endif
+#ifdef METALL_ENABLE_MUTEX_IN_ATTRIBUTED_OBJECT_DIRECTORY
+#include <metall/detail/mutex.hpp>
+#endif
 
 namespace metall {
 namespace kernel {
@@ -45,6 +55,11 @@ inline auto gen_type_id() {
 }
 
 /// \brief Directory for attributed objects.
+/// Updates (insert, erase, clear, and set_description) are thread-safe.
+/// Finding an object by name with find(name, offset, length) does not take
+/// any lock and can run concurrently with updates.
+/// The other read functions, including iterators, must not be used
+/// concurrently with updates.
 /// \tparam _offset_type
 /// \tparam _size_type
 template <typename _offset_type, typename _size_type>
@@ -119,6 +134,19 @@ class attributed_object_directory {
       boost::unordered_map<name_type, typename entry_table_type::iterator,
                            mdtl::str_hash<>>;
 
+  // Copy of the name index that can be read without locks
+  struct lock_free_name_index_value_type {
+    offset_type offset;
+    length_type length;
+  };
+  using lock_free_name_index_type =
+      mdtl::concurrent_string_map<lock_free_name_index_value_type>;
+
+#ifdef METALL_ENABLE_MUTEX_IN_ATTRIBUTED_OBJECT_DIRECTORY
+  using mutex_type = mdtl::mutex;
+  using lock_guard_type = mdtl::mutex_lock_guard;
+#endif
+
  public:
   // -------------------- //
   // Public types and static values
@@ -144,7 +172,9 @@ class attributed_object_directory {
 
   attributed_object_directory &operator=(
       const attributed_object_directory &other) noexcept {
-    priv_deep_copy(other);
+    if (this != &other && clear()) {
+      priv_deep_copy(other);
+    }
     return *this;
   }
 
@@ -155,7 +185,12 @@ class attributed_object_directory {
   // Public methods
   // -------------------- //
   bool good() const noexcept {
-    return m_entry_table && m_offset_index_table && m_name_index_table;
+    return m_entry_table && m_offset_index_table && m_name_index_table &&
+           m_lock_free_name_index
+#ifdef METALL_ENABLE_MUTEX_IN_ATTRIBUTED_OBJECT_DIRECTORY
+           && m_mutex
+#endif
+        ;
   }
 
   /// \brief
@@ -164,17 +199,20 @@ class attributed_object_directory {
   /// \param length
   /// \param type_id
   /// \param description
-  /// \return
+  /// \return Returns false if the name or the offset already exists.
   bool insert(const name_type &name, const offset_type offset,
               const length_type length, const type_id_type type_id,
               const description_type &description = std::string()) noexcept {
     if (!good()) return false;
 
-    if (m_offset_index_table->count(offset) > 0) {
-      assert(name.empty() || m_name_index_table->count(name) > 0);
+#ifdef METALL_ENABLE_MUTEX_IN_ATTRIBUTED_OBJECT_DIRECTORY
+    lock_guard_type guard(*m_mutex);
+#endif
+
+    if (m_offset_index_table->count(offset) > 0 ||
+        (!name.empty() && m_name_index_table->count(name) > 0)) {
       return false;
     }
-    assert(name.empty() || m_name_index_table->count(name) == 0);
 
     try {
       auto inserted_itr = m_entry_table->emplace(
@@ -191,6 +229,12 @@ class attributed_object_directory {
             m_name_index_table->emplace(name, inserted_itr);
         assert(ret.first != m_name_index_table->end());
         assert(ret.second);
+        try {
+          m_lock_free_name_index->insert(name, {offset, length});
+        } catch (...) {
+          priv_erase_no_mutex(inserted_itr);
+          throw;
+        }
       }
     } catch (...) {
       logger::out(logger::level::error, __FILE__, __LINE__,
@@ -211,6 +255,10 @@ class attributed_object_directory {
 
     if (position == m_entry_table->cend()) return false;
 
+#ifdef METALL_ENABLE_MUTEX_IN_ATTRIBUTED_OBJECT_DIRECTORY
+    lock_guard_type guard(*m_mutex);
+#endif
+
     try {
       auto entry_itr = m_offset_index_table->find(position->offset())->second;
       assert(entry_itr != m_entry_table->end());
@@ -291,6 +339,23 @@ class attributed_object_directory {
     return m_entry_table->cend();
   }
 
+  /// \brief Finds by name without taking any lock.
+  /// This function can be called concurrently with updates.
+  /// \param name A name to find.
+  /// \param offset A pointer to store the offset of the found object.
+  /// \param length A pointer to store the length of the found object.
+  /// \return Returns true if the name is found; otherwise, false.
+  bool find(const std::string_view name, offset_type *const offset,
+            length_type *const length) const noexcept {
+    if (!good()) return false;
+
+    lock_free_name_index_value_type value;
+    if (!m_lock_free_name_index->find(name, &value)) return false;
+    if (offset) *offset = value.offset;
+    if (length) *length = value.length;
+    return true;
+  }
+
   /// \brief Finds by offset
   /// \param offset
   /// \return
@@ -344,18 +409,10 @@ class attributed_object_directory {
       return 0;
     }
 
-    try {
-      m_offset_index_table->erase(position->offset());
-      if (!position->name().empty())
-        m_name_index_table->erase(position->name());
-      m_entry_table->erase(position);
-    } catch (...) {
-      logger::out(logger::level::error, __FILE__, __LINE__,
-                  "Exception was thrown when erasing an entry");
-      return 0;
-    }
-
-    return 1;
+#ifdef METALL_ENABLE_MUTEX_IN_ATTRIBUTED_OBJECT_DIRECTORY
+    lock_guard_type guard(*m_mutex);
+#endif
+    return priv_erase_no_mutex(position);
   }
 
   /// \brief Erase by name
@@ -366,48 +423,39 @@ class attributed_object_directory {
       return 0;
     }
 
-    if (count(name) == 0) {
-      return 0;
-    }
+#ifdef METALL_ENABLE_MUTEX_IN_ATTRIBUTED_OBJECT_DIRECTORY
+    lock_guard_type guard(*m_mutex);
+#endif
 
-    try {
-      auto itr = find(name);
-      m_offset_index_table->erase(itr->offset());
-      m_entry_table->erase(itr);
-      if (!name.empty()) m_name_index_table->erase(name);
-    } catch (...) {
-      logger::out(logger::level::error, __FILE__, __LINE__,
-                  "Exception was thrown when erasing an entry");
+    const auto itr = m_name_index_table->find(name);
+    if (itr == m_name_index_table->end()) {
       return 0;
     }
 
-    return 1;
+    return priv_erase_no_mutex(itr->second);
   }
 
   /// \brief Erase offset
   /// \param offset
+  /// \param length If not nullptr, the length of the erased object is stored.
   /// \return
-  size_type erase(const offset_type &offset) noexcept {
+  size_type erase(const offset_type &offset,
+                  length_type *const length = nullptr) noexcept {
     if (!good()) {
-      return false;
-    }
-
-    if (count(offset) == 0) {
       return 0;
     }
 
-    try {
-      auto itr = find(offset);
-      m_offset_index_table->erase(itr->offset());
-      if (!itr->name().empty()) m_name_index_table->erase(itr->name());
-      m_entry_table->erase(itr);
-    } catch (...) {
-      logger::out(logger::level::error, __FILE__, __LINE__,
-                  "Exception was thrown when erasing an entry");
+#ifdef METALL_ENABLE_MUTEX_IN_ATTRIBUTED_OBJECT_DIRECTORY
+    lock_guard_type guard(*m_mutex);
+#endif
+
+    const auto itr = m_offset_index_table->find(offset);
+    if (itr == m_offset_index_table->end()) {
       return 0;
     }
 
-    return 1;
+    if (length) *length = itr->second->length();
+    return priv_erase_no_mutex(itr->second);
   }
 
   /// \brief Clears tables
@@ -417,7 +465,12 @@ class attributed_object_directory {
       return false;
     }
 
+#ifdef METALL_ENABLE_MUTEX_IN_ATTRIBUTED_OBJECT_DIRECTORY
+    lock_guard_type guard(*m_mutex);
+#endif
+
     try {
+      m_lock_free_name_index->clear();
       m_offset_index_table->clear();
       m_name_index_table->clear();
       m_entry_table->clear();
@@ -456,7 +509,21 @@ class attributed_object_directory {
   // Private types and static values
   // -------------------- //
 
-  // JSON structure
+  // Binary file format:
+  // a header and, for each entry, serialized_entry_type followed by
+  // the name and the description, padded to 8 bytes.
+  static constexpr const char *k_binary_file_magic = "MTLLATOD";
+  static constexpr uint64_t k_binary_file_version = 1;
+
+  struct serialized_entry_type {
+    uint64_t offset;
+    uint64_t length;
+    uint64_t type_id;
+    uint64_t name_length;
+    uint64_t description_length;
+  };
+
+  // JSON structure used by older versions
   // {
   // "attributed_objects" : [
   //  {"name" : "object0", "offset" : 0x845, "length" : 1, "type_id" : "424",
@@ -482,31 +549,54 @@ class attributed_object_directory {
       m_entry_table = std::make_unique<entry_table_type>();
       m_offset_index_table = std::make_unique<offset_index_table_type>();
       m_name_index_table = std::make_unique<name_index_table_type>();
+      m_lock_free_name_index = std::make_unique<lock_free_name_index_type>();
+#ifdef METALL_ENABLE_MUTEX_IN_ATTRIBUTED_OBJECT_DIRECTORY
+      m_mutex = std::make_unique<mutex_type>();
+#endif
     } catch (...) {
       logger::out(logger::level::error, __FILE__, __LINE__,
                   "Failed to allocate core data");
       m_entry_table.reset(nullptr);
       m_offset_index_table.reset(nullptr);
       m_name_index_table.reset(nullptr);
+      m_lock_free_name_index.reset(nullptr);
+#ifdef METALL_ENABLE_MUTEX_IN_ATTRIBUTED_OBJECT_DIRECTORY
+      m_mutex.reset(nullptr);
+#endif
       return false;
     }
     return true;
   }
 
+  /// \brief Inserts the entries of 'other' one by one
+  /// as the index tables hold iterators of the entry table.
   bool priv_deep_copy(const attributed_object_directory &other) noexcept {
+    if (!good() || !other.good()) return false;
+    for (const auto &entry : *(other.m_entry_table)) {
+      if (!insert(entry.name(), entry.offset(), entry.length(),
+                  entry.type_id(), entry.description())) {
+        logger::out(logger::level::error, __FILE__, __LINE__,
+                    "Failed to copy members");
+        return false;
+      }
+    }
+    return true;
+  }
+
+  size_type priv_erase_no_mutex(const const_iterator position) noexcept {
     try {
-      *m_entry_table = *(other.m_entry_table);
-      *m_offset_index_table = *(other.m_offset_index_table);
-      *m_name_index_table = *(other.m_name_index_table);
+      if (!position->name().empty()) {
+        m_lock_free_name_index->erase(position->name());
+        m_name_index_table->erase(position->name());
+      }
+      m_offset_index_table->erase(position->offset());
+      m_entry_table->erase(position);
     } catch (...) {
       logger::out(logger::level::error, __FILE__, __LINE__,
-                  "Failed to copy members");
-      m_entry_table.reset(nullptr);
-      m_offset_index_table.reset(nullptr);
-      m_name_index_table.reset(nullptr);
-      return false;
+                  "Exception was thrown when erasing an entry");
+      return 0;
     }
-    return true;
+    return 1;
   }
 
   bool priv_serialize_throw(const fs::path &path) const {
@@ -514,41 +604,91 @@ class attributed_object_directory {
       return false;
     }
 
-    json::node_type json_attributed_objects_list;
+    mdtl::binary_file::writer writer(path, k_binary_file_magic,
+                                     k_binary_file_version);
+    if (!writer.good()) {
+      return false;
+    }
+
     for (const auto &item : *m_entry_table) {
-      json::node_type json_named_object_entry;
-      if (!json::add_value(json_key::name, item.name(),
-                           &json_named_object_entry) ||
-          !json::add_value(json_key::offset, item.offset(),
-                           &json_named_object_entry) ||
-          !json::add_value(json_key::length, item.length(),
-                           &json_named_object_entry) ||
-          !json::add_value(json_key::type_id, item.type_id(),
-                           &json_named_object_entry) ||
-          !json::add_value(json_key::description, item.description(),
-                           &json_named_object_entry)) {
-        return false;
-      }
-      if (!json::push_back(json_named_object_entry,
-                           &json_attributed_objects_list)) {
+      serialized_entry_type entry{};
+      entry.offset = static_cast<uint64_t>(item.offset());
+      entry.length = static_cast<uint64_t>(item.length());
+      entry.type_id = static_cast<uint64_t>(item.type_id());
+      entry.name_length = item.name().size();
+      entry.description_length = item.description().size();
+      const std::size_t strings_length =
+          entry.name_length + entry.description_length;
+      if (!writer.write(entry) ||
+          !writer.write(item.name().data(), item.name().size()) ||
+          !writer.write(item.description().data(),
+                        item.description().size()) ||
+          !writer.pad(strings_length)) {
         return false;
       }
     }
 
-    json::node_type json_root;
-    if (!json::add_child(json_key::attributed_objects,
-                         json_attributed_objects_list, &json_root)) {
+    return writer.close(m_entry_table->size());
+  }
+
+  bool priv_deserialize_throw(const fs::path &path) {
+    if (mdtl::binary_file::has_magic(path, k_binary_file_magic)) {
+      return priv_deserialize_binary_throw(path);
+    }
+    return priv_deserialize_json_throw(path);
+  }
+
+  bool priv_deserialize_binary_throw(const fs::path &path) {
+    if (!good()) {
       return false;
     }
 
-    if (!json::write_json(json_root, path)) {
+    mdtl::binary_file::reader reader(path, k_binary_file_magic,
+                                     k_binary_file_version);
+    if (!reader.good()) {
       return false;
     }
 
+    for (uint64_t i = 0; i < reader.num_records(); ++i) {
+      serialized_entry_type entry;
+      if (!reader.read(&entry)) {
+        logger::out(logger::level::error, __FILE__, __LINE__,
+                    "Broken object directory file");
+        return false;
+      }
+      const std::size_t strings_length =
+          entry.name_length + entry.description_length;
+      if (reader.remaining() < strings_length) {
+        logger::out(logger::level::error, __FILE__, __LINE__,
+                    "Broken object directory file");
+        return false;
+      }
+      name_type name(reader.data(), entry.name_length);
+      description_type description(reader.data() + entry.name_length,
+                                   entry.description_length);
+      reader.skip(strings_length + mdtl::binary_file::padding_size(
+                                       strings_length));
+
+      if (count(name) > 0) {
+        logger::out(logger::level::error, __FILE__, __LINE__,
+                    "Failed to reconstruct object table");
+        return false;
+      }
+
+      if (!insert(name, static_cast<offset_type>(entry.offset),
+                  static_cast<length_type>(entry.length),
+                  static_cast<type_id_type>(entry.type_id), description)) {
+        logger::out(logger::level::error, __FILE__, __LINE__,
+                    "Failed to reconstruct object table");
+        return false;
+      }
+    }
+
     return true;
   }
 
-  bool priv_deserialize_throw(const fs::path &path) {
+  /// \brief Reads the JSON format used by older versions.
+  bool priv_deserialize_json_throw(const fs::path &path) {
     if (!good()) {
       return false;
     }
@@ -602,6 +742,10 @@ class attributed_object_directory {
   std::unique_ptr<entry_table_type> m_entry_table;
   std::unique_ptr<offset_index_table_type> m_offset_index_table;
   std::unique_ptr<name_index_table_type> m_name_index_table;
+  std::unique_ptr<lock_free_name_index_type> m_lock_free_name_index;
+#ifdef METALL_ENABLE_MUTEX_IN_ATTRIBUTED_OBJECT_DIRECTORY
+  std::unique_ptr<mutex_type> m_mutex;
+#endif
 };
 }  // namespace kernel
 }  // namespace metall
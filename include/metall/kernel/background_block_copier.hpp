@@ -0,0 +1,417 @@
+// Copyright 2023 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+#ifndef METALL_KERNEL_BACKGROUND_BLOCK_COPIER_HPP
+#define METALL_KERNEL_BACKGROUND_BLOCK_COPIER_HPP
+
+#include <signal.h>
+#include <sched.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <future>
+#include <mutex>
+#include <string>
+#include <limits>
+#include <algorithm>
+#include <filesystem>
+
+#include <metall/detail/file.hpp>
+#include <metall/detail/file_clone.hpp>
+#include <metall/detail/mmap.hpp>
+#include <metall/logger.hpp>
+
+namespace metall::kernel {
+
+namespace {
+namespace mdtl = metall::mtlldetail;
+}
+
+/// \brief Copies the block files of a segment in the background while the
+/// application keeps writing to the segment.
+/// The blocks are write-protected when copying starts.
+/// A write to a block that has not been copied raises a fault,
+/// and the fault handler lets the copy threads copy the block first
+/// and waits until the block becomes writable again.
+/// Thus, the copies hold the data at the time copying started.
+/// The fault handler is installed for SIGSEGV and SIGBUS when the first
+/// copier that write-protects blocks starts, and the previous handlers are
+/// restored when the last one finishes.
+/// Faults that are not caused by the copies are forwarded to the previous
+/// handlers.
+/// \warning A write done by the kernel on behalf of a system call
+/// (e.g., read(2) into the segment) fails with EFAULT while the block is
+/// write-protected instead of raising a fault.
+class background_block_copier {
+ public:
+  using path_type = std::filesystem::path;
+
+  /// \brief Starts copying blocks in the background.
+  /// \param segment The address of the first block.
+  /// \param block_size The size of a block.
+  /// \param source_paths Paths to the block files, one for each block.
+  /// \param destination_paths Paths to copy the block files to.
+  /// \param clone If true, uses clone (reflink) for copying files.
+  /// \param max_num_threads The maximum number of copy threads to use.
+  /// If <= 0 is given, the value is automatically determined.
+  /// \param write_protect If true, protects blocks until they are copied.
+  /// If the segment is not writable, false can be given.
+  /// \return Returns an object that tracks the copy. Returns nullptr if it
+  /// fails to start; nothing is protected in that case.
+  static std::shared_ptr<background_block_copier> start(
+      void *const segment, const std::size_t block_size,
+      std::vector<path_type> source_paths,
+      std::vector<path_type> destination_paths, const bool clone,
+      const int max_num_threads, const bool write_protect) {
+    std::shared_ptr<background_block_copier> copier(new background_block_copier(
+        segment, block_size, std::move(source_paths),
+        std::move(destination_paths), clone, write_protect));
+
+    if (write_protect && copier->m_num_blocks > 0) {
+      if (!copier->priv_register()) return nullptr;
+      if (!mdtl::mprotect_read_only(segment,
+                                    block_size * copier->m_num_blocks)) {
+        logger::out(logger::level::error, __FILE__, __LINE__,
+                    "Failed to write-protect the segment");
+        copier->priv_unregister();
+        return nullptr;
+      }
+    }
+
+    const int num_threads = static_cast<int>(std::max(
+        std::min(copier->m_num_blocks,
+                 max_num_threads > 0
+                     ? static_cast<std::size_t>(max_num_threads)
+                     : static_cast<std::size_t>(
+                           std::thread::hardware_concurrency())),
+        std::size_t(1)));
+    // Does not capture the shared pointer to avoid a reference cycle;
+    // the destructor waits for the copy threads.
+    auto *const raw_copier = copier.get();
+    copier->m_result =
+        std::async(std::launch::async, [raw_copier, num_threads]() {
+          return raw_copier->priv_run(num_threads);
+        }).share();
+
+    return copier;
+  }
+
+  ~background_block_copier() noexcept {
+    if (m_result.valid()) m_result.wait();
+  }
+
+  background_block_copier(const background_block_copier &) = delete;
+  background_block_copier &operator=(const background_block_copier &) = delete;
+
+  /// \brief Waits until the blocks that overlap with a region are copied.
+  /// Must be called before freeing the pages of a region
+  /// because freeing pages does not raise a fault.
+  /// \param offset An offset from the beginning of the segment.
+  /// \param nbytes The size of the region.
+  void wait_for_region(const std::ptrdiff_t offset,
+                       const std::size_t nbytes) noexcept {
+    if (nbytes == 0) return;
+    const std::size_t first = offset / m_block_size;
+    const std::size_t last =
+        std::min((offset + nbytes - 1) / m_block_size + 1, m_num_blocks);
+    for (std::size_t b = first; b < last; ++b) {
+      priv_wait_for_block(b);
+    }
+  }
+
+  /// \brief Waits until all blocks are copied.
+  /// \return Returns true if all blocks have been copied successfully.
+  bool wait() const { return m_result.get(); }
+
+  /// \brief Returns a future whose get() returns the result.
+  std::shared_future<bool> result() const { return m_result; }
+
+ private:
+  enum block_state : uint8_t { k_pending = 0, k_copying = 1, k_done = 2 };
+
+  static constexpr std::size_t k_max_num_active_copiers = 16;
+  static constexpr std::size_t k_no_block =
+      std::numeric_limits<std::size_t>::max();
+
+  background_block_copier(void *const segment, const std::size_t block_size,
+                          std::vector<path_type> source_paths,
+                          std::vector<path_type> destination_paths,
+                          const bool clone, const bool write_protect)
+      : m_segment(static_cast<char *>(segment)),
+        m_block_size(block_size),
+        m_num_blocks(source_paths.size()),
+        m_source_paths(std::move(source_paths)),
+        m_destination_paths(std::move(destination_paths)),
+        m_clone(clone),
+        m_write_protect(write_protect),
+        m_block_states(std::make_unique<std::atomic_uint8_t[]>(m_num_blocks)) {
+    for (std::size_t b = 0; b < m_num_blocks; ++b) {
+      m_block_states[b].store(k_pending, std::memory_order_relaxed);
+    }
+  }
+
+  // -------------------- //
+  // Copy threads
+  // -------------------- //
+  bool priv_run(const int num_threads) {
+    std::vector<std::thread> threads;
+    for (int t = 1; t < num_threads; ++t) {
+      threads.emplace_back([this]() { priv_copy_blocks(); });
+    }
+    priv_copy_blocks();
+    for (auto &th : threads) th.join();
+
+    if (m_write_protect && m_num_blocks > 0) priv_unregister();
+
+    return !m_failed.load();
+  }
+
+  void priv_copy_blocks() {
+    for (std::size_t b = priv_claim_block(); b != k_no_block;
+         b = priv_claim_block()) {
+      if (!priv_copy_block(b)) m_failed.store(true);
+
+      // Make the block writable even if copying failed
+      // so that the application can continue.
+      if (m_write_protect &&
+          !mdtl::mprotect_read_write(m_segment + b * m_block_size,
+                                     m_block_size)) {
+        logger::out(logger::level::critical, __FILE__, __LINE__,
+                    "Failed to make a block writable");
+        m_failed.store(true);
+      }
+      m_block_states[b].store(k_done, std::memory_order_release);
+    }
+  }
+
+  /// \brief Claims a block requested by a fault handler first.
+  std::size_t priv_claim_block() {
+    const std::size_t requested = m_requested_block.exchange(k_no_block);
+    if (requested != k_no_block && priv_try_claim(requested)) return requested;
+
+    for (std::size_t b = m_next_block.fetch_add(1); b < m_num_blocks;
+         b = m_next_block.fetch_add(1)) {
+      if (priv_try_claim(b)) return b;
+    }
+    return k_no_block;
+  }
+
+  bool priv_try_claim(const std::size_t block_no) {
+    uint8_t expected = k_pending;
+    return m_block_states[block_no].compare_exchange_strong(expected,
+                                                            k_copying);
+  }
+
+  bool priv_copy_block(const std::size_t block_no) {
+    if (m_write_protect &&
+        !mdtl::os_msync(m_segment + block_no * m_block_size, m_block_size,
+                        true)) {
+      return false;
+    }
+    const bool ret =
+        m_clone ? mdtl::clone_file(m_source_paths[block_no],
+                                   m_destination_paths[block_no])
+                : mdtl::copy_file(m_source_paths[block_no],
+                                  m_destination_paths[block_no]);
+    if (!ret) {
+      std::string s("Failed to copy " + m_source_paths[block_no].string());
+      logger::out(logger::level::error, __FILE__, __LINE__, s.c_str());
+    }
+    return ret;
+  }
+
+  /// \brief Asks the copy threads to copy a block first and waits for it.
+  /// Async-signal-safe.
+  void priv_wait_for_block(const std::size_t block_no) noexcept {
+    while (m_block_states[block_no].load(std::memory_order_acquire) !=
+           k_done) {
+      m_requested_block.store(block_no);
+      ::sched_yield();
+    }
+  }
+
+  // -------------------- //
+  // Fault handling
+  // -------------------- //
+  static std::atomic<background_block_copier *> *priv_active_copiers() {
+    static std::atomic<background_block_copier *>
+        copiers[k_max_num_active_copiers] = {};
+    return copiers;
+  }
+
+  static std::atomic_int &priv_num_running_handlers() {
+    static std::atomic_int count{0};
+    return count;
+  }
+
+  // Protects the registration and the installation of the fault handler
+  static std::mutex &priv_registry_mutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  static std::size_t &priv_num_registered_copiers() {
+    static std::size_t count = 0;
+    return count;
+  }
+
+  /// \brief Registers this object to the fault handler.
+  /// Installs the fault handler if this is the first registered object.
+  bool priv_register() {
+    std::lock_guard<std::mutex> guard(priv_registry_mutex());
+    auto *const copiers = priv_active_copiers();
+    std::size_t slot = 0;
+    for (; slot < k_max_num_active_copiers; ++slot) {
+      if (!copiers[slot].load()) break;
+    }
+    if (slot == k_max_num_active_copiers) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Too many background copies are running");
+      return false;
+    }
+    if (priv_num_registered_copiers() == 0 && !priv_install_fault_handler()) {
+      return false;
+    }
+    copiers[slot].store(this);
+    ++priv_num_registered_copiers();
+    return true;
+  }
+
+  /// \brief Unregisters this object and waits for the fault handlers that
+  /// might be accessing this object.
+  /// Restores the previous fault handlers if this is the last registered
+  /// object.
+  void priv_unregister() {
+    std::lock_guard<std::mutex> guard(priv_registry_mutex());
+    auto *const copiers = priv_active_copiers();
+    for (std::size_t i = 0; i < k_max_num_active_copiers; ++i) {
+      background_block_copier *expected = this;
+      copiers[i].compare_exchange_strong(expected, nullptr);
+    }
+    while (priv_num_running_handlers().load() > 0) {
+      std::this_thread::yield();
+    }
+    if (--priv_num_registered_copiers() == 0) {
+      priv_uninstall_fault_handler();
+    }
+  }
+
+  static struct sigaction &priv_previous_action(const int sig) {
+    static struct sigaction segv_action {};
+    static struct sigaction bus_action {};
+    return (sig == SIGBUS) ? bus_action : segv_action;
+  }
+
+  static bool &priv_fault_handler_installed() {
+    static bool installed = false;
+    return installed;
+  }
+
+  static bool priv_install_fault_handler() {
+    if (priv_fault_handler_installed()) return true;
+
+    struct sigaction action {};
+    action.sa_sigaction = priv_fault_handler;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    // Some systems raise SIGBUS for writes to protected pages.
+    if (::sigaction(SIGSEGV, &action, &priv_previous_action(SIGSEGV)) == -1) {
+      logger::perror(logger::level::error, __FILE__, __LINE__, "sigaction");
+      return false;
+    }
+    if (::sigaction(SIGBUS, &action, &priv_previous_action(SIGBUS)) == -1) {
+      logger::perror(logger::level::error, __FILE__, __LINE__, "sigaction");
+      ::sigaction(SIGSEGV, &priv_previous_action(SIGSEGV), nullptr);
+      return false;
+    }
+    priv_fault_handler_installed() = true;
+    return true;
+  }
+
+  /// \brief Restores the previous fault handlers.
+  /// If another handler has been installed after ours, leaves the handlers
+  /// as they are since the other handler might forward faults to ours.
+  static void priv_uninstall_fault_handler() {
+    if (!priv_fault_handler_installed()) return;
+
+    for (const int sig : {SIGSEGV, SIGBUS}) {
+      struct sigaction current {};
+      if (::sigaction(sig, nullptr, &current) == -1 ||
+          !(current.sa_flags & SA_SIGINFO) ||
+          current.sa_sigaction != priv_fault_handler) {
+        logger::out(logger::level::info, __FILE__, __LINE__,
+                    "The fault handler is left installed as it has been "
+                    "replaced by another one");
+        return;
+      }
+    }
+    for (const int sig : {SIGSEGV, SIGBUS}) {
+      if (::sigaction(sig, &priv_previous_action(sig), nullptr) == -1) {
+        logger::perror(logger::level::error, __FILE__, __LINE__,
+                       "sigaction");
+      }
+    }
+    priv_fault_handler_installed() = false;
+  }
+
+  static void priv_fault_handler(const int sig, siginfo_t *const info,
+                                 void *const context) {
+    priv_num_running_handlers().fetch_add(1);
+    bool handled = false;
+    auto *const copiers = priv_active_copiers();
+    for (std::size_t i = 0; i < k_max_num_active_copiers && !handled; ++i) {
+      auto *const copier = copiers[i].load();
+      if (copier) handled = copier->priv_handle_fault(info->si_addr);
+    }
+    priv_num_running_handlers().fetch_sub(1);
+    if (handled) return;
+
+    // Not ours; forward to the previous handler.
+    const struct sigaction &previous = priv_previous_action(sig);
+    if ((previous.sa_flags & SA_SIGINFO) && previous.sa_sigaction) {
+      previous.sa_sigaction(sig, info, context);
+    } else if (previous.sa_handler != SIG_DFL &&
+               previous.sa_handler != SIG_IGN) {
+      previous.sa_handler(sig);
+    } else {
+      // Retrying the faulting instruction raises the default action.
+      ::signal(sig, SIG_DFL);
+    }
+  }
+
+  /// \brief Async-signal-safe.
+  bool priv_handle_fault(const void *const addr) noexcept {
+    const char *const p = static_cast<const char *>(addr);
+    if (p < m_segment || p >= m_segment + m_block_size * m_num_blocks) {
+      return false;
+    }
+    priv_wait_for_block((p - m_segment) / m_block_size);
+    return true;
+  }
+
+  // -------------------- //
+  // Private fields
+  // -------------------- //
+  char *const m_segment;
+  const std::size_t m_block_size;
+  const std::size_t m_num_blocks;
+  const std::vector<path_type> m_source_paths;
+  const std::vector<path_type> m_destination_paths;
+  const bool m_clone;
+  const bool m_write_protect;
+  std::unique_ptr<std::atomic_uint8_t[]> m_block_states;
+  std::atomic<std::size_t> m_next_block{0};
+  std::atomic<std::size_t> m_requested_block{k_no_block};
+  std::atomic_bool m_failed{false};
+  std::shared_future<bool> m_result;
+};
+
+}  // namespace metall::kernel
+
+#endif  // METALL_KERNEL_BACKGROUND_BLOCK_COPIER_HPP
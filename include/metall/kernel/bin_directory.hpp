@@ -14,6 +14,7 @@
 #include <cassert>
 #include <functional>
 #include <memory>
+#include <vector>
 #include <filesystem>
 
 #include <boost/container/vector.hpp>
@@ -26,6 +27,7 @@
 #endif
 
 #include <metall/detail/utilities.hpp>
+#include <metall/detail/binary_file.hpp>
 #include <metall/logger.hpp>
 
 namespace metall {
@@ -195,38 +197,117 @@ class bin_directory {
     return m_table[bin_no].end();
   }
 
-  /// \brief
-  /// \param path
+  /// \brief Serializes the bins into a file in the binary format.
+  /// \param path A path to the file.
+  /// \return Returns true on success; otherwise, false.
   bool serialize(const fs::path &path) const {
-    std::ofstream ofs(path);
-    if (!ofs.is_open()) {
-      std::stringstream ss;
-      ss << "Cannot open: " << path;
-      logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+    mdtl::binary_file::writer writer(path, k_binary_file_magic,
+                                     k_binary_file_version);
+    if (!writer.good()) {
       return false;
     }
 
+    uint64_t num_records = 0;
+    std::vector<uint64_t> values;
     for (uint64_t i = 0; i < m_table.size(); ++i) {
-      for (const auto value : m_table[i]) {
-        ofs << static_cast<uint64_t>(i) << " " << static_cast<uint64_t>(value)
-            << "\n";
-        if (!ofs) {
-          std::stringstream ss;
-          ss << "Something happened in the ofstream: " << path;
-          logger::out(logger::level::error, __FILE__, __LINE__,
-                      ss.str().c_str());
-          return false;
-        }
+      if (m_table[i].empty()) continue;
+      values.assign(m_table[i].begin(), m_table[i].end());
+      const uint64_t record[2] = {i, static_cast<uint64_t>(values.size())};
+      if (!writer.write(record) ||
+          !writer.write(values.data(), values.size() * sizeof(uint64_t))) {
+        std::stringstream ss;
+        ss << "Failed to write: " << path;
+        logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+        return false;
       }
+      ++num_records;
+    }
+
+    if (!writer.close(num_records)) {
+      std::stringstream ss;
+      ss << "Failed to close: " << path;
+      logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+      return false;
     }
-    ofs.close();
 
     return true;
   }
 
-  /// \brief
-  /// \param path
+  /// \brief Deserializes the bins from a file.
+  /// Files written in the old text format are also accepted.
+  /// \param path A path to the file.
+  /// \return Returns true on success; otherwise, false.
   bool deserialize(const fs::path &path) {
+    if (mdtl::binary_file::has_magic(path, k_binary_file_magic)) {
+      return priv_deserialize_binary(path);
+    }
+    return priv_deserialize_text(path);
+  }
+
+ private:
+  // -------------------- //
+  // Private types and static values
+  // -------------------- //
+  // Binary file format:
+  // a header and, for each non-empty bin, the bin number, the number of
+  // values, and the values in the bin order.
+  static constexpr const char *k_binary_file_magic = "MTLLBIND";
+  static constexpr uint64_t k_binary_file_version = 1;
+
+  // -------------------- //
+  // Private methods
+  // -------------------- //
+  bool priv_deserialize_binary(const fs::path &path) {
+    mdtl::binary_file::reader reader(path, k_binary_file_magic,
+                                     k_binary_file_version);
+    if (!reader.good()) {
+      return false;
+    }
+
+    for (uint64_t i = 0; i < reader.num_records(); ++i) {
+      uint64_t record[2];
+      if (!reader.read(&record)) {
+        std::stringstream ss;
+        ss << "Broken file: " << path;
+        logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+        return false;
+      }
+      const uint64_t bin_no = record[0];
+      const uint64_t num_values = record[1];
+      if (m_table.size() <= bin_no) {
+        std::stringstream ss;
+        ss << "Too large bin number is found: " << bin_no;
+        logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+        return false;
+      }
+      if (reader.remaining() / sizeof(uint64_t) < num_values) {
+        std::stringstream ss;
+        ss << "Broken file: " << path;
+        logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+        return false;
+      }
+
+      // Values are read in place
+      const auto *const values =
+          reinterpret_cast<const uint64_t *>(reader.data());
+#ifdef METALL_USE_SORTED_BIN
+      m_table[bin_no].reserve(m_table[bin_no].size() + num_values);
+      for (uint64_t k = 0; k < num_values; ++k) {
+        m_table[bin_no].insert(static_cast<value_type>(values[k]));
+      }
+#else
+      for (uint64_t k = 0; k < num_values; ++k) {
+        m_table[bin_no].emplace_back(static_cast<value_type>(values[k]));
+      }
+#endif
+      reader.skip(num_values * sizeof(uint64_t));
+    }
+
+    return true;
+  }
+
+  /// \brief Reads the text format used by older versions.
+  bool priv_deserialize_text(const fs::path &path) {
     std::ifstream ifs(path);
     if (!ifs.is_open()) {
       std::stringstream ss;
@@ -266,15 +347,6 @@ class bin_directory {
     return true;
   }
 
- private:
-  // -------------------- //
-  // Private types and static values
-  // -------------------- //
-
-  // -------------------- //
-  // Private methods
-  // -------------------- //
-
   // -------------------- //
   // Private fields
   // -------------------- //
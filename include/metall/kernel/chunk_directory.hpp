@@ -7,6 +7,7 @@
 #define METALL_DETAIL_CHUNK_DIRECTORY_HPP
 
 #include <limits>
+#include <cstring>
 #include <fstream>
 #include <cassert>
 #include <type_traits>
@@ -15,7 +16,10 @@
 
 #include <metall/detail/utilities.hpp>
 #include <metall/detail/mmap.hpp>
+#include <metall/detail/binary_file.hpp>
+#include <metall/detail/extendable_file_map.hpp>
 #include <metall/kernel/multilayer_bitset.hpp>
+#include <metall/kernel/free_chunk_index.hpp>
 #include <metall/kernel/bin_number_manager.hpp>
 #include <metall/kernel/object_size_manager.hpp>
 #include <metall/logger.hpp>
@@ -69,16 +73,54 @@ class chunk_directory {
   struct entry_type {
     void init() {
       type = chunk_type::unused;
+      arena_no = 0;
       num_occupied_slots = 0;
       slot_occupancy.reset();
     }
 
     bin_no_type bin_no;                     // 1 byte
     chunk_type type;                        // 1 byte
+    uint8_t arena_no;                       // 1 byte, just for small chunk
     slot_count_type num_occupied_slots;     // 4 bytes, just for small chunk
     multilayer_bitset_type slot_occupancy;  // 8 bytes, just for small chunk
   };
 
+  // Binary file format:
+  // a header, serialized_entry_type of each used chunk in ascending order
+  // of the chunk number, and then the slot occupancy bitset blocks of the
+  // small chunks in the same order.
+  static constexpr const char *k_binary_file_magic = "MTLLCHKD";
+  static constexpr uint64_t k_binary_file_version = 1;
+
+  struct serialized_entry_type {
+    uint64_t chunk_no;
+    uint32_t bin_no;
+    uint32_t type;
+    uint64_t num_occupied_slots;
+  };
+  static_assert(sizeof(serialized_entry_type) == 24,
+                "Unexpected serialized entry size");
+
+  // Persistent mode:
+  // the table file consists of a header page followed by the entries.
+  // The multi-layer slot occupancy bitsets are stored in another file,
+  // at a fixed stride per chunk number, so that a bitset can be located from
+  // the chunk number without storing a pointer in the file.
+  static constexpr const char *k_persistent_file_magic = "MTLLCHKP";
+  static constexpr uint64_t k_persistent_file_version = 1;
+  static constexpr std::size_t k_persistent_header_size = 4096;
+
+  struct persistent_header_type {
+    char magic[mdtl::binary_file::k_magic_length];
+    uint64_t version;
+    uint64_t chunk_size;
+    uint64_t entry_size;
+    uint64_t slot_table_stride;
+    int64_t last_used_chunk_no;
+  };
+  static_assert(sizeof(persistent_header_type) <= k_persistent_header_size,
+                "Too large persistent header");
+
  public:
   // -------------------- //
   // Constructor & assign operator
@@ -89,7 +131,8 @@ class chunk_directory {
   explicit chunk_directory(const std::size_t max_num_chunks)
       : m_table(nullptr),
         m_max_num_chunks(max_num_chunks),
-        m_last_used_chunk_no(-1) {
+        m_last_used_chunk_no(-1),
+        m_free_chunk_index(max_num_chunks) {
     priv_allocate();
   }
 
@@ -104,17 +147,153 @@ class chunk_directory {
   // -------------------- //
   // Public methods
   // -------------------- //
+  /// \brief Switches to the persistent mode with new files.
+  /// In the persistent mode, the table lives in files mapped with MAP_SHARED
+  /// instead of anonymous memory; thus, serialize() and deserialize() are not
+  /// needed to store and restore it.
+  /// Must be called while the chunk directory is empty.
+  /// \param table_path A path to the file to store the table.
+  /// \param slot_table_path A path to the file to store the slot occupancy
+  /// bitsets.
+  /// \return Returns true on success; otherwise, false.
+  bool create_persistent(const fs::path &table_path,
+                         const fs::path &slot_table_path) {
+    if (persistent() || size() > 0) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Chunk directory must be empty to create persistent files");
+      return false;
+    }
+
+    mdtl::extendable_file_map table_map;
+    mdtl::extendable_file_map slot_table_map;
+    if (!table_map.create(table_path, priv_table_file_capacity()) ||
+        !table_map.extend(k_persistent_header_size) ||
+        !slot_table_map.create(slot_table_path,
+                               priv_slot_table_file_capacity())) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Failed to create chunk directory files");
+      return false;
+    }
+
+    auto *const header =
+        static_cast<persistent_header_type *>(table_map.data());
+    std::memcpy(header->magic, k_persistent_file_magic,
+                mdtl::binary_file::k_magic_length);
+    header->version = k_persistent_file_version;
+    header->chunk_size = k_chunk_size;
+    header->entry_size = sizeof(entry_type);
+    header->slot_table_stride = priv_slot_table_stride();
+    header->last_used_chunk_no = -1;
+
+    priv_attach_persistent_files(std::move(table_map),
+                                 std::move(slot_table_map));
+    m_free_chunk_index_ready = true;
+
+    return true;
+  }
+
+  /// \brief Switches to the persistent mode with existing files.
+  /// This function does not touch the entries;
+  /// the data derived from them is rebuilt when the chunk directory is
+  /// updated for the first time.
+  /// Must be called while the chunk directory is empty.
+  /// \param table_path A path to the file that stores the table.
+  /// \param slot_table_path A path to the file that stores the slot occupancy
+  /// bitsets.
+  /// \param read_only If true, the files are mapped with the read-only mode.
+  /// \return Returns true on success; otherwise, false.
+  bool open_persistent(const fs::path &table_path,
+                       const fs::path &slot_table_path, const bool read_only) {
+    if (persistent() || size() > 0) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Chunk directory must be empty to open persistent files");
+      return false;
+    }
+
+    mdtl::extendable_file_map table_map;
+    mdtl::extendable_file_map slot_table_map;
+    if (!table_map.open(table_path, priv_table_file_capacity(), read_only) ||
+        !slot_table_map.open(slot_table_path, priv_slot_table_file_capacity(),
+                             read_only)) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Failed to open chunk directory files");
+      return false;
+    }
+
+    if (table_map.size() < k_persistent_header_size) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Too small chunk directory file");
+      return false;
+    }
+    const auto *const header =
+        static_cast<const persistent_header_type *>(table_map.data());
+    if (std::memcmp(header->magic, k_persistent_file_magic,
+                    mdtl::binary_file::k_magic_length) != 0 ||
+        header->version != k_persistent_file_version ||
+        header->chunk_size != k_chunk_size ||
+        header->entry_size != sizeof(entry_type) ||
+        header->slot_table_stride != priv_slot_table_stride()) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Incompatible chunk directory file");
+      return false;
+    }
+    const int64_t last_used_chunk_no = header->last_used_chunk_no;
+    if (last_used_chunk_no >= (int64_t)m_max_num_chunks ||
+        table_map.size() < k_persistent_header_size +
+                               (last_used_chunk_no + 1) * sizeof(entry_type)) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Broken chunk directory file");
+      return false;
+    }
+
+    priv_attach_persistent_files(std::move(table_map),
+                                 std::move(slot_table_map));
+    m_last_used_chunk_no = last_used_chunk_no;
+    m_free_chunk_index_ready = false;
+
+    return true;
+  }
+
+  /// \brief Returns true if the chunk directory is in the persistent mode.
+  bool persistent() const { return m_table_map.is_open(); }
+
+  /// \brief Writes back the table to the files in the persistent mode.
+  /// Does nothing in the non-persistent mode.
+  /// \param sync If false is specified, this function returns before finishing
+  /// the sync operation.
+  /// \return Returns true on success; otherwise, false.
+  bool sync(const bool sync) {
+    if (!persistent() || m_table_map.read_only()) return true;
+    priv_header()->last_used_chunk_no = m_last_used_chunk_no;
+    return m_table_map.sync(sync) && m_slot_table_map.sync(sync);
+  }
+
+  /// \brief Rebuilds the data that is not stored in the persistent mode, i.e.,
+  /// the free chunk index, and resets the arena numbers of the small chunks to
+  /// 0. Does nothing if it has been done already.
+  /// The rebuild is deferred from open_persistent() so that opening costs
+  /// O(1); it is also done by insert(), erase(), and resize_large_chunk().
+  /// Requires a global lock to avoid race condition.
+  void rebuild_volatile_data() { priv_prepare_free_chunk_index(); }
+
   /// \brief Registers a new chunk for a bin whose bin number is 'bin_no'.
   /// Requires a global lock to avoid race condition.
   /// \param bin_no Bin number.
+  /// \param arena_no Number of the arena that owns the chunk.
+  /// Used only for a small chunk. The arena number is not persisted.
+  /// \param regions If not nullptr, the chunk is placed in one of the regions
+  /// if possible, e.g., to place it on a NUMA node.
   /// \return Returns the chunk number of the new chunk.
-  chunk_no_type insert(const bin_no_type bin_no) {
+  chunk_no_type insert(
+      const bin_no_type bin_no, const unsigned int arena_no = 0,
+      const interleaved_chunk_regions *const regions = nullptr) {
     chunk_no_type inserted_chunk_no;
 
+    priv_prepare_free_chunk_index();
     if (bin_no < bin_no_mngr::num_small_bins()) {
-      inserted_chunk_no = priv_insert_small_chunk(bin_no);
+      inserted_chunk_no = priv_insert_small_chunk(bin_no, arena_no, regions);
     } else {
-      inserted_chunk_no = priv_insert_large_chunk(bin_no);
+      inserted_chunk_no = priv_insert_large_chunk(bin_no, regions);
     }
     assert(inserted_chunk_no < size());
 
@@ -128,10 +307,11 @@ class chunk_directory {
     assert(chunk_no < size());
     if (unused_chunk(chunk_no)) return;
 
+    priv_prepare_free_chunk_index();
     if (m_table[chunk_no].type == chunk_type::small_chunk) {
-      const slot_count_type num_slots = slots(chunk_no);
-      m_table[chunk_no].slot_occupancy.free(num_slots);
+      priv_free_slot_occupancy(chunk_no, slots(chunk_no));
       m_table[chunk_no].init();
+      m_free_chunk_index.set_free(chunk_no, 1);
 
       if (chunk_no == m_last_used_chunk_no) {
         m_last_used_chunk_no = find_next_used_chunk_backward(chunk_no);
@@ -140,12 +320,14 @@ class chunk_directory {
     } else {
       m_table[chunk_no].init();
       chunk_no_type offset = 1;
-      for (; chunk_no + offset < m_max_num_chunks &&
+      for (; chunk_no + offset < size() &&
              m_table[chunk_no + offset].type == chunk_type::large_chunk_body;
            ++offset) {
         m_table[chunk_no + offset].init();
       }
 
+      m_free_chunk_index.set_free(chunk_no, offset);
+
       const chunk_no_type last_chunk_no = chunk_no + offset - 1;
       if (last_chunk_no == m_last_used_chunk_no) {
         m_last_used_chunk_no = find_next_used_chunk_backward(last_chunk_no);
@@ -153,6 +335,98 @@ class chunk_directory {
     }
   }
 
+  /// \brief Changes the bin of an empty small chunk to 'new_bin_no'.
+  /// As this function updates only the entry of the chunk, it does not require
+  /// the global lock; however, the caller must be the only one that accesses
+  /// the chunk.
+  /// \param chunk_no Chunk number of an empty small chunk.
+  /// \param new_bin_no New bin number. Must be a small bin.
+  /// \return Returns true on success; otherwise, false.
+  bool reassign_small_chunk(const chunk_no_type chunk_no,
+                            const bin_no_type new_bin_no) {
+    assert(m_table[chunk_no].type == chunk_type::small_chunk);
+    assert(m_table[chunk_no].num_occupied_slots == 0);
+    assert(new_bin_no < bin_no_mngr::num_small_bins());
+
+    if (m_table[chunk_no].bin_no == new_bin_no) return true;
+
+    const slot_count_type new_num_slots =
+        calc_num_slots(bin_no_mngr::to_object_size(new_bin_no));
+    if (new_num_slots > multilayer_bitset_type::max_size()) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Too many slots are requested.");
+      return false;
+    }
+
+    // Do not change the chunk type so that other threads can see the chunk as
+    // used while reassigning it
+    priv_free_slot_occupancy(chunk_no, slots(chunk_no));
+    m_table[chunk_no].slot_occupancy.reset();
+    m_table[chunk_no].bin_no = new_bin_no;
+    if (!priv_allocate_slot_occupancy(chunk_no, new_num_slots)) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Failed to allocates slot occupancy data");
+      return false;
+    }
+    return true;
+  }
+
+  /// \brief Changes the bin of a large chunk whose chunk number is 'chunk_no'
+  /// to 'new_bin_no' without moving it.
+  /// Growing succeeds only if the chunks following the current ones are free.
+  /// Shrinking always succeeds and frees the trailing chunks.
+  /// Requires a global lock to avoid race condition.
+  /// \param chunk_no Chunk number of a large chunk head.
+  /// \param new_bin_no New bin number. Must be a large bin.
+  /// \return Returns true on success; otherwise, false.
+  bool resize_large_chunk(const chunk_no_type chunk_no,
+                          const bin_no_type new_bin_no) {
+    assert(chunk_no < size());
+    assert(m_table[chunk_no].type == chunk_type::large_chunk_head);
+    assert(new_bin_no >= bin_no_mngr::num_small_bins());
+
+    priv_prepare_free_chunk_index();
+    const std::size_t old_num_chunks =
+        priv_num_large_chunks(m_table[chunk_no].bin_no);
+    const std::size_t new_num_chunks = priv_num_large_chunks(new_bin_no);
+
+    if (new_num_chunks > old_num_chunks) {
+      const std::size_t num_extra = new_num_chunks - old_num_chunks;
+      if (chunk_no + new_num_chunks > m_max_num_chunks ||
+          !m_free_chunk_index.free(chunk_no + old_num_chunks, num_extra) ||
+          !priv_reserve_entries(chunk_no + new_num_chunks - 1, false)) {
+        return false;
+      }
+      for (std::size_t offset = old_num_chunks; offset < new_num_chunks;
+           ++offset) {
+        m_table[chunk_no + offset].init();
+        m_table[chunk_no + offset].type = chunk_type::large_chunk_body;
+      }
+      m_free_chunk_index.set_used(chunk_no + old_num_chunks, num_extra);
+      m_last_used_chunk_no =
+          std::max((ssize_t)(chunk_no + new_num_chunks - 1),
+                   m_last_used_chunk_no);
+
+    } else if (new_num_chunks < old_num_chunks) {
+      for (std::size_t offset = new_num_chunks; offset < old_num_chunks;
+           ++offset) {
+        m_table[chunk_no + offset].init();
+      }
+      m_free_chunk_index.set_free(chunk_no + new_num_chunks,
+                                  old_num_chunks - new_num_chunks);
+      const chunk_no_type last_chunk_no = chunk_no + old_num_chunks - 1;
+      if (last_chunk_no == m_last_used_chunk_no) {
+        m_last_used_chunk_no = find_next_used_chunk_backward(last_chunk_no);
+      }
+    }
+
+    for (std::size_t offset = 0; offset < new_num_chunks; ++offset) {
+      m_table[chunk_no + offset].bin_no = new_bin_no;
+    }
+
+    return true;
+  }
+
   /// \brief Finds an available slot in the chunk whose chunk number is
   /// 'chunk_no' and marks it as occupied. slot in the chunk. This function
   /// modifies only the specified chunk; thus, the global lock is not required.
@@ -165,7 +439,7 @@ class chunk_directory {
 
     assert(m_table[chunk_no].num_occupied_slots < num_slots);
     const auto empty_slot_no =
-        m_table[chunk_no].slot_occupancy.find_and_set(num_slots);
+        priv_slot_occupancy(chunk_no, num_slots).find_and_set(num_slots);
     assert(empty_slot_no >= 0);
     ++m_table[chunk_no].num_occupied_slots;
 
@@ -193,8 +467,8 @@ class chunk_directory {
         std::min(num_slots,
                  static_cast<std::size_t>(
                      num_holding_slots - m_table[chunk_no].num_occupied_slots));
-    m_table[chunk_no].slot_occupancy.find_and_set_many(
-        num_holding_slots, num_slots_to_find, slots_buf);
+    priv_slot_occupancy(chunk_no, num_holding_slots)
+        .find_and_set_many(num_holding_slots, num_slots_to_find, slots_buf);
     m_table[chunk_no].num_occupied_slots += num_slots_to_find;
     assert(m_table[chunk_no].num_occupied_slots <= num_holding_slots);
 
@@ -211,7 +485,7 @@ class chunk_directory {
     assert(num_slots >= 1);
 
     assert(m_table[chunk_no].num_occupied_slots > 0);
-    m_table[chunk_no].slot_occupancy.reset(num_slots, slot_no);
+    priv_slot_occupancy(chunk_no, num_slots).reset(num_slots, slot_no);
     --m_table[chunk_no].num_occupied_slots;
   }
 
@@ -250,7 +524,7 @@ class chunk_directory {
     const slot_count_type num_slots =
         calc_num_slots(bin_no_mngr::to_object_size(bin_no(chunk_no)));
     assert(slot_no < num_slots);
-    return m_table[chunk_no].slot_occupancy.get(num_slots, slot_no);
+    return priv_slot_occupancy(chunk_no, num_slots).get(num_slots, slot_no);
   }
 
   /// \brief Returns the chunk directory size, which is the max chunk number +
@@ -276,6 +550,14 @@ class chunk_directory {
     return m_table[chunk_no].bin_no;
   }
 
+  /// \brief Returns the number of the arena that owns a small chunk.
+  /// \param chunk_no Chunk number of a small chunk.
+  /// \return Returns the arena number given at insert().
+  unsigned int arena_no(const chunk_no_type chunk_no) const {
+    assert(m_table[chunk_no].type == chunk_type::small_chunk);
+    return m_table[chunk_no].arena_no;
+  }
+
   /// \brief
   /// \param chunk_no
   /// \return
@@ -294,73 +576,400 @@ class chunk_directory {
     return m_table[chunk_no].num_occupied_slots;
   }
 
-  /// \brief
-  /// \param path
+  /// \brief Serializes the chunk directory into a file in the binary format.
+  /// \param path A path to the file.
+  /// \return Returns true on success; otherwise, false.
   bool serialize(const fs::path &path) const {
-    std::ofstream ofs(path);
-    if (!ofs.is_open()) {
+    mdtl::binary_file::writer writer(path, k_binary_file_magic,
+                                     k_binary_file_version);
+    if (!writer.good()) {
+      return false;
+    }
+
+    uint64_t num_records = 0;
+    for (chunk_no_type chunk_no = 0; chunk_no < size(); ++chunk_no) {
+      if (unused_chunk(chunk_no)) {
+        continue;
+      }
+
+      serialized_entry_type entry{};
+      entry.chunk_no = chunk_no;
+      entry.bin_no = m_table[chunk_no].bin_no;
+      entry.type = m_table[chunk_no].type;
+      if (m_table[chunk_no].type == chunk_type::small_chunk) {
+        entry.num_occupied_slots = m_table[chunk_no].num_occupied_slots;
+      }
+      if (!writer.write(entry)) {
+        std::stringstream ss;
+        ss << "Failed to write: " << path;
+        logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+        return false;
+      }
+      ++num_records;
+    }
+
+    // Slot occupancy of the small chunks, in the same order as the entries
+    std::vector<uint64_t> blocks;
+    for (chunk_no_type chunk_no = 0; chunk_no < size(); ++chunk_no) {
+      if (m_table[chunk_no].type != chunk_type::small_chunk) {
+        continue;
+      }
+      const slot_count_type num_slots = slots(chunk_no);
+      blocks.resize(multilayer_bitset_type::num_serialized_blocks(num_slots));
+      priv_slot_occupancy(chunk_no, num_slots)
+          .serialize(num_slots, blocks.data());
+      if (!writer.write(blocks.data(), blocks.size() * sizeof(uint64_t))) {
+        std::stringstream ss;
+        ss << "Failed to write: " << path;
+        logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+        return false;
+      }
+    }
+
+    if (!writer.close(num_records)) {
       std::stringstream ss;
-      ss << "Cannot open: " << path;
+      ss << "Failed to close: " << path;
       logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
       return false;
     }
 
+    return true;
+  }
+
+  /// \brief Deserializes the chunk directory from a file.
+  /// Files written in the old text format are also accepted.
+  /// \param path A path to the file.
+  /// \return Returns true on success; otherwise, false.
+  bool deserialize(const fs::path &path) {
+    if (mdtl::binary_file::has_magic(path, k_binary_file_magic)) {
+      return priv_deserialize_binary(path);
+    }
+    return priv_deserialize_text(path);
+  }
+
+  auto get_all_marked_slots() const {
+    std::vector<std::tuple<chunk_no_type, bin_no_type, slot_no_type>> buf;
+
     for (chunk_no_type chunk_no = 0; chunk_no < size(); ++chunk_no) {
-      if (unused_chunk(chunk_no)) {
+      if (m_table[chunk_no].type != chunk_type::small_chunk) {
         continue;
       }
 
-      ofs << static_cast<uint64_t>(chunk_no) << " "
-          << static_cast<uint64_t>(m_table[chunk_no].bin_no) << " "
-          << static_cast<uint64_t>(m_table[chunk_no].type);
-      if (!ofs) {
+      const slot_count_type num_slots = slots(chunk_no);
+      const auto slot_occupancy = priv_slot_occupancy(chunk_no, num_slots);
+      for (slot_no_type i = 0; i < num_slots; ++i) {
+        if (slot_occupancy.get(num_slots, i)) {
+          buf.push_back(std::make_tuple(chunk_no, m_table[chunk_no].bin_no, i));
+        }
+      }
+    }
+
+    return buf;
+  }
+
+  std::size_t num_used_large_chunks() const {
+    std::size_t count = 0;
+    for (chunk_no_type chunk_no = 0; chunk_no < size(); ++chunk_no) {
+      if (m_table[chunk_no].type == chunk_type::large_chunk_head ||
+          m_table[chunk_no].type == chunk_type::large_chunk_body) {
+        ++count;
+      }
+    }
+
+    return count;
+  }
+
+ private:
+  // -------------------- //
+  // Private types and static values
+  // -------------------- //
+
+  // -------------------- //
+  // Private methods
+  // -------------------- //
+  constexpr slot_count_type calc_num_slots(
+      const std::size_t object_size) const {
+    assert(k_chunk_size >= object_size);
+    return k_chunk_size / object_size;
+  }
+
+  static constexpr std::size_t priv_num_large_chunks(
+      const bin_no_type bin_no) {
+    return (bin_no_mngr::to_object_size(bin_no) + k_chunk_size - 1) /
+           k_chunk_size;
+  }
+
+  /// \brief Allocates memory for 'm_max_num_chunks' chunks.
+  /// This function assumes that 'm_max_num_chunks' is set.
+  /// Allocates 'uncommitted pages' so that not to waste physical memory until
+  /// the pages are touched. Accordingly, this function does not initialize an
+  /// allocate data.
+  bool priv_allocate() {
+    assert(!m_table);
+
+    // Assume that mmap + MAP_ANONYMOUS returns 'uncommitted pages'.
+    // An uncommitted page will be zero-initialized when it is touched first
+    // time; however, this class does not rely on that. The table entries will
+    // be initialized just before they are used.
+    m_table = static_cast<entry_type *>(mdtl::map_anonymous_write_mode(
+        nullptr, m_max_num_chunks * sizeof(entry_type)));
+
+    if (!m_table) {
+      logger::perror(logger::level::error, __FILE__, __LINE__,
+                     "Cannot allocate chunk table");
+      return false;
+    }
+
+    m_last_used_chunk_no = -1;
+    return true;
+  }
+
+  void priv_destroy() noexcept {
+    if (persistent()) {
+      // Keep the entries in the files
+      if (!m_table_map.read_only()) {
+        priv_header()->last_used_chunk_no = m_last_used_chunk_no;
+      }
+      m_table_map.release();
+      m_slot_table_map.release();
+      m_table = nullptr;
+      m_last_used_chunk_no = -1;
+      m_free_chunk_index.clear();
+      return;
+    }
+
+    for (chunk_no_type chunk_no = 0; chunk_no < size(); ++chunk_no) {
+      try {
+        erase(chunk_no);
+      } catch (...) {
+        logger::perror(logger::level::error, __FILE__, __LINE__,
+                       "An exception was thrown");
+      }
+    }
+    mdtl::os_munmap(m_table, m_max_num_chunks * sizeof(entry_type));
+    m_table = nullptr;
+    m_last_used_chunk_no = -1;
+    m_free_chunk_index.clear();
+  }
+
+  /// \brief Rebuilds the free chunk index from the chunk table.
+  /// Runs of used chunks are inserted at once;
+  /// thus, the cost is linear to size().
+  void priv_rebuild_free_chunk_index() {
+    m_free_chunk_index.clear();
+    for (chunk_no_type chunk_no = 0; chunk_no < size(); ++chunk_no) {
+      if (unused_chunk(chunk_no)) continue;
+      chunk_no_type run_length = 1;
+      while (chunk_no + run_length < size() &&
+             !unused_chunk(chunk_no + run_length)) {
+        ++run_length;
+      }
+      m_free_chunk_index.set_used(chunk_no, run_length);
+      chunk_no += run_length - 1;
+    }
+  }
+
+  /// \brief Rebuilds the free chunk index if it is not ready, which happens
+  /// only after open_persistent().
+  void priv_prepare_free_chunk_index() {
+    if (m_free_chunk_index_ready) return;
+    priv_rebuild_free_chunk_index();
+    if (!m_table_map.read_only()) {
+      for (chunk_no_type chunk_no = 0; chunk_no < size(); ++chunk_no) {
+        if (m_table[chunk_no].type == chunk_type::small_chunk) {
+          m_table[chunk_no].arena_no = 0;
+        }
+      }
+    }
+    m_free_chunk_index_ready = true;
+  }
+
+  // ---------- For the persistent mode ---------- //
+  static std::size_t priv_slot_table_stride() {
+    return multilayer_bitset_type::num_serialized_blocks(k_num_max_slots) *
+           sizeof(uint64_t);
+  }
+
+  std::size_t priv_table_file_capacity() const {
+    return k_persistent_header_size + m_max_num_chunks * sizeof(entry_type);
+  }
+
+  std::size_t priv_slot_table_file_capacity() const {
+    return m_max_num_chunks * priv_slot_table_stride();
+  }
+
+  persistent_header_type *priv_header() {
+    return static_cast<persistent_header_type *>(m_table_map.data());
+  }
+
+  /// \brief Replaces the anonymous table with the mapped files.
+  void priv_attach_persistent_files(mdtl::extendable_file_map &&table_map,
+                                    mdtl::extendable_file_map &&slot_table_map) {
+    mdtl::os_munmap(m_table, m_max_num_chunks * sizeof(entry_type));
+    m_table_map = std::move(table_map);
+    m_slot_table_map = std::move(slot_table_map);
+    m_table = reinterpret_cast<entry_type *>(
+        static_cast<char *>(m_table_map.data()) + k_persistent_header_size);
+  }
+
+  /// \brief Extends the files to hold the entry of 'chunk_no'
+  /// (and its slot occupancy bitset if 'small_chunk' is true)
+  /// before the entry is touched. Does nothing in the non-persistent mode.
+  bool priv_reserve_entries(const chunk_no_type chunk_no,
+                            const bool small_chunk) {
+    if (!persistent()) return true;
+    if (!m_table_map.extend(k_persistent_header_size +
+                            (chunk_no + 1) * sizeof(entry_type)) ||
+        (small_chunk &&
+         !m_slot_table_map.extend((chunk_no + 1) * priv_slot_table_stride()))) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Failed to extend chunk directory files");
+      return false;
+    }
+    return true;
+  }
+
+  uint64_t *priv_slot_table(const chunk_no_type chunk_no) const {
+    return reinterpret_cast<uint64_t *>(
+        static_cast<char *>(m_slot_table_map.data()) +
+        chunk_no * priv_slot_table_stride());
+  }
+
+  /// \brief Returns the slot occupancy bitset of a small chunk.
+  /// In the persistent mode, the pointer held by the entry can be one set in
+  /// a previous run; thus, the multi-layer table is attached on every access.
+  multilayer_bitset_type &priv_slot_occupancy(const chunk_no_type chunk_no,
+                                              const std::size_t num_slots) {
+    auto &slot_occupancy = m_table[chunk_no].slot_occupancy;
+    if (persistent() && multilayer_bitset_type::block_size() < num_slots) {
+      slot_occupancy.attach(num_slots, priv_slot_table(chunk_no), false);
+    }
+    return slot_occupancy;
+  }
+
+  /// \brief Const version. Returns a copy as the entry cannot be updated.
+  multilayer_bitset_type priv_slot_occupancy(
+      const chunk_no_type chunk_no, const std::size_t num_slots) const {
+    auto slot_occupancy = m_table[chunk_no].slot_occupancy;
+    if (persistent() && multilayer_bitset_type::block_size() < num_slots) {
+      slot_occupancy.attach(num_slots, priv_slot_table(chunk_no), false);
+    }
+    return slot_occupancy;
+  }
+
+  bool priv_allocate_slot_occupancy(const chunk_no_type chunk_no,
+                                    const std::size_t num_slots) {
+    if (persistent() && multilayer_bitset_type::block_size() < num_slots) {
+      m_table[chunk_no].slot_occupancy.attach(num_slots,
+                                              priv_slot_table(chunk_no), true);
+      return true;
+    }
+    return m_table[chunk_no].slot_occupancy.allocate(num_slots);
+  }
+
+  void priv_free_slot_occupancy(const chunk_no_type chunk_no,
+                                const std::size_t num_slots) {
+    if (persistent()) return;  // The table is owned by the file
+    m_table[chunk_no].slot_occupancy.free(num_slots);
+  }
+
+  static bool priv_to_chunk_type(const uint64_t value, chunk_type *const type) {
+    if (value == static_cast<uint64_t>(chunk_type::small_chunk)) {
+      *type = chunk_type::small_chunk;
+    } else if (value == static_cast<uint64_t>(chunk_type::large_chunk_head)) {
+      *type = chunk_type::large_chunk_head;
+    } else if (value == static_cast<uint64_t>(chunk_type::large_chunk_body)) {
+      *type = chunk_type::large_chunk_body;
+    } else {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Invalid chunk type");
+      return false;
+    }
+    return true;
+  }
+
+  bool priv_deserialize_binary(const fs::path &path) {
+    mdtl::binary_file::reader reader(path, k_binary_file_magic,
+                                     k_binary_file_version);
+    if (!reader.good()) {
+      return false;
+    }
+
+    const uint64_t num_records = reader.num_records();
+    if (reader.remaining() / sizeof(serialized_entry_type) < num_records) {
+      std::stringstream ss;
+      ss << "Broken file: " << path;
+      logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+      return false;
+    }
+    // The entries and the bitset blocks are read in place
+    const auto *const entries =
+        reinterpret_cast<const serialized_entry_type *>(reader.data());
+    reader.skip(num_records * sizeof(serialized_entry_type));
+    const auto *blocks = reinterpret_cast<const uint64_t *>(reader.data());
+    std::size_t num_remaining_blocks = reader.remaining() / sizeof(uint64_t);
+
+    for (uint64_t i = 0; i < num_records; ++i) {
+      const auto &entry = entries[i];
+      if (entry.chunk_no >= m_max_num_chunks) {
         std::stringstream ss;
-        ss << "Something happened in the ofstream: " << path;
+        ss << "Invalid chunk number: " << entry.chunk_no;
         logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
         return false;
       }
+      const auto chunk_no = static_cast<chunk_no_type>(entry.chunk_no);
+      const auto bin_no = static_cast<bin_no_type>(entry.bin_no);
+      if (!priv_reserve_entries(
+              chunk_no, entry.type == chunk_type::small_chunk)) {
+        return false;
+      }
+      m_table[chunk_no].bin_no = bin_no;
+      m_table[chunk_no].arena_no = 0;
+      if (!priv_to_chunk_type(entry.type, &m_table[chunk_no].type)) {
+        return false;
+      }
 
       if (m_table[chunk_no].type == chunk_type::small_chunk) {
-        const slot_count_type num_slots = slots(chunk_no);
-        ofs << " "
-            << static_cast<uint64_t>(m_table[chunk_no].num_occupied_slots)
-            << " " << m_table[chunk_no].slot_occupancy.serialize(num_slots)
-            << "\n";
-        if (!ofs) {
+        const slot_count_type num_slots =
+            calc_num_slots(bin_no_mngr::to_object_size(bin_no));
+        if (num_slots < entry.num_occupied_slots) {
           std::stringstream ss;
-          ss << "Something happened in the ofstream: " << path;
+          ss << "Invalid num_occupied_slots: " << entry.num_occupied_slots;
           logger::out(logger::level::error, __FILE__, __LINE__,
                       ss.str().c_str());
           return false;
         }
+        m_table[chunk_no].num_occupied_slots = entry.num_occupied_slots;
 
-      } else if (m_table[chunk_no].type == chunk_type::large_chunk_head ||
-                 m_table[chunk_no].type == chunk_type::large_chunk_body) {
-        ofs << "\n";
-        if (!ofs) {
+        const std::size_t num_blocks =
+            multilayer_bitset_type::num_serialized_blocks(num_slots);
+        if (num_remaining_blocks < num_blocks) {
           std::stringstream ss;
-          ss << "Something happened in the ofstream: " << path;
+          ss << "Not enough slot occupancy data: " << path;
           logger::out(logger::level::error, __FILE__, __LINE__,
                       ss.str().c_str());
           return false;
         }
-
-      } else {
-        logger::out(logger::level::error, __FILE__, __LINE__,
-                    "Unexpected chunk status");
-        return false;
+        if (!priv_allocate_slot_occupancy(chunk_no, num_slots)) {
+          logger::out(logger::level::error, __FILE__, __LINE__,
+                      "Failed to allocate slot occupancy data");
+          return false;
+        }
+        priv_slot_occupancy(chunk_no, num_slots).deserialize(num_slots, blocks);
+        blocks += num_blocks;
+        num_remaining_blocks -= num_blocks;
       }
+
+      m_last_used_chunk_no = std::max((ssize_t)chunk_no, m_last_used_chunk_no);
     }
 
-    ofs.close();
+    priv_rebuild_free_chunk_index();
 
     return true;
   }
 
-  /// \brief
-  /// \param path
-  /// \return
-  bool deserialize(const fs::path &path) {
+  /// \brief Reads the text format used by older versions.
+  bool priv_deserialize_text(const fs::path &path) {
     std::ifstream ifs(path);
     if (!ifs.is_open()) {
       std::stringstream ss;
@@ -375,22 +984,14 @@ class chunk_directory {
     while (ifs >> buf1 >> buf2 >> buf3) {
       const auto chunk_no = static_cast<chunk_no_type>(buf1);
       const auto bin_no = static_cast<bin_no_type>(buf2);
+      if (chunk_no >= m_max_num_chunks ||
+          !priv_reserve_entries(chunk_no, buf3 == chunk_type::small_chunk)) {
+        return false;
+      }
       m_table[chunk_no].bin_no = bin_no;
+      m_table[chunk_no].arena_no = 0;
 
-      using status_underlying_type = std::underlying_type_t<chunk_type>;
-      const auto type = static_cast<status_underlying_type>(buf3);
-      if (type ==
-          static_cast<status_underlying_type>(chunk_type::small_chunk)) {
-        m_table[chunk_no].type = chunk_type::small_chunk;
-      } else if (type == static_cast<status_underlying_type>(
-                             chunk_type::large_chunk_head)) {
-        m_table[chunk_no].type = chunk_type::large_chunk_head;
-      } else if (type == static_cast<status_underlying_type>(
-                             chunk_type::large_chunk_body)) {
-        m_table[chunk_no].type = chunk_type::large_chunk_body;
-      } else {
-        logger::out(logger::level::error, __FILE__, __LINE__,
-                    "Invalid chunk type");
+      if (!priv_to_chunk_type(buf3, &m_table[chunk_no].type)) {
         return false;
       }
 
@@ -424,14 +1025,14 @@ class chunk_directory {
         }
         bitset_buf.erase(0, 1);
 
-        if (!m_table[chunk_no].slot_occupancy.allocate(num_slots)) {
+        if (!priv_allocate_slot_occupancy(chunk_no, num_slots)) {
           logger::out(logger::level::error, __FILE__, __LINE__,
                       "Failed to allocate slot occupancy data");
           return false;
         }
 
-        if (!m_table[chunk_no].slot_occupancy.deserialize(num_slots,
-                                                          bitset_buf)) {
+        if (!priv_slot_occupancy(chunk_no, num_slots)
+                 .deserialize(num_slots, bitset_buf)) {
           std::stringstream ss;
           ss << "Invalid input for slot_occupancy: " << bitset_buf;
           logger::out(logger::level::error, __FILE__, __LINE__,
@@ -452,98 +1053,19 @@ class chunk_directory {
 
     ifs.close();
 
-    return true;
-  }
-
-  auto get_all_marked_slots() const {
-    std::vector<std::tuple<chunk_no_type, bin_no_type, slot_no_type>> buf;
-
-    for (chunk_no_type chunk_no = 0; chunk_no < size(); ++chunk_no) {
-      if (m_table[chunk_no].type != chunk_type::small_chunk) {
-        continue;
-      }
-
-      const slot_count_type num_slots = slots(chunk_no);
-      for (slot_no_type i = 0; i < num_slots; ++i) {
-        if (m_table[chunk_no].slot_occupancy.get(num_slots, i)) {
-          buf.push_back(std::make_tuple(chunk_no, m_table[chunk_no].bin_no, i));
-        }
-      }
-    }
+    priv_rebuild_free_chunk_index();
 
-    return buf;
-  }
-
-  std::size_t num_used_large_chunks() const {
-    std::size_t count = 0;
-    for (chunk_no_type chunk_no = 0; chunk_no < size(); ++chunk_no) {
-      if (m_table[chunk_no].type == chunk_type::large_chunk_head ||
-          m_table[chunk_no].type == chunk_type::large_chunk_body) {
-        ++count;
-      }
-    }
-
-    return count;
-  }
-
- private:
-  // -------------------- //
-  // Private types and static values
-  // -------------------- //
-
-  // -------------------- //
-  // Private methods
-  // -------------------- //
-  constexpr slot_count_type calc_num_slots(
-      const std::size_t object_size) const {
-    assert(k_chunk_size >= object_size);
-    return k_chunk_size / object_size;
-  }
-
-  /// \brief Allocates memory for 'm_max_num_chunks' chunks.
-  /// This function assumes that 'm_max_num_chunks' is set.
-  /// Allocates 'uncommitted pages' so that not to waste physical memory until
-  /// the pages are touched. Accordingly, this function does not initialize an
-  /// allocate data.
-  bool priv_allocate() {
-    assert(!m_table);
-
-    // Assume that mmap + MAP_ANONYMOUS returns 'uncommitted pages'.
-    // An uncommitted page will be zero-initialized when it is touched first
-    // time; however, this class does not rely on that. The table entries will
-    // be initialized just before they are used.
-    m_table = static_cast<entry_type *>(mdtl::map_anonymous_write_mode(
-        nullptr, m_max_num_chunks * sizeof(entry_type)));
-
-    if (!m_table) {
-      logger::perror(logger::level::error, __FILE__, __LINE__,
-                     "Cannot allocate chunk table");
-      return false;
-    }
-
-    m_last_used_chunk_no = -1;
     return true;
   }
 
-  void priv_destroy() noexcept {
-    for (chunk_no_type chunk_no = 0; chunk_no < size(); ++chunk_no) {
-      try {
-        erase(chunk_no);
-      } catch (...) {
-        logger::perror(logger::level::error, __FILE__, __LINE__,
-                       "An exception was thrown");
-      }
-    }
-    mdtl::os_munmap(m_table, m_max_num_chunks * sizeof(entry_type));
-    m_table = nullptr;
-    m_last_used_chunk_no = -1;
-  }
-
   /// \brief
   /// \param bin_no
-  /// \param num_slots
+  /// \param arena_no
+  /// \param regions
   /// \return
-  chunk_no_type priv_insert_small_chunk(const bin_no_type bin_no) {
+  chunk_no_type priv_insert_small_chunk(
+      const bin_no_type bin_no, const unsigned int arena_no,
+      const interleaved_chunk_regions *const regions) {
     const slot_count_type num_slots =
         calc_num_slots(bin_no_mngr::to_object_size(bin_no));
     assert(num_slots > 1);
@@ -553,73 +1075,85 @@ class chunk_directory {
       return m_max_num_chunks;
     }
 
-    for (chunk_no_type chunk_no = 0; chunk_no < m_max_num_chunks; ++chunk_no) {
-      if (chunk_no > m_last_used_chunk_no || unused_chunk(chunk_no)) {
-        m_table[chunk_no].init();  // init just in case
-
-        m_table[chunk_no].bin_no = bin_no;
-        m_table[chunk_no].type = chunk_type::small_chunk;
-        m_table[chunk_no].num_occupied_slots = 0;
-        if (!m_table[chunk_no].slot_occupancy.allocate(num_slots)) {
-          logger::out(logger::level::error, __FILE__, __LINE__,
-                      "Failed to allocates slot occupancy data");
-          return m_max_num_chunks;
-        }
+    chunk_no_type chunk_no = m_max_num_chunks;
+    if (regions) chunk_no = m_free_chunk_index.find_lowest(*regions);
+    if (chunk_no >= m_max_num_chunks) {
+      chunk_no = m_free_chunk_index.find_lowest();
+    }
+    if (chunk_no >= m_max_num_chunks) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "No empty chunk for small allocation");
+      return m_max_num_chunks;
+    }
+    if (!priv_reserve_entries(chunk_no, true)) {
+      return m_max_num_chunks;
+    }
+    assert(chunk_no > m_last_used_chunk_no || unused_chunk(chunk_no));
 
-        m_last_used_chunk_no =
-            std::max((ssize_t)chunk_no, m_last_used_chunk_no);
+    m_table[chunk_no].init();  // init just in case
 
-        return chunk_no;
-      }
+    m_table[chunk_no].bin_no = bin_no;
+    m_table[chunk_no].type = chunk_type::small_chunk;
+    m_table[chunk_no].arena_no = arena_no;
+    m_table[chunk_no].num_occupied_slots = 0;
+    if (!priv_allocate_slot_occupancy(chunk_no, num_slots)) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Failed to allocates slot occupancy data");
+      m_table[chunk_no].init();
+      return m_max_num_chunks;
     }
-    logger::out(logger::level::error, __FILE__, __LINE__,
-                "No empty chunk for small allocation");
-    return m_max_num_chunks;
+    m_free_chunk_index.set_used(chunk_no, 1);
+
+    m_last_used_chunk_no = std::max((ssize_t)chunk_no, m_last_used_chunk_no);
+
+    return chunk_no;
   }
 
   /// \brief
   /// \param bin_no
+  /// \param regions
   /// \return
-  chunk_no_type priv_insert_large_chunk(const bin_no_type bin_no) {
-    const std::size_t num_chunks =
-        (bin_no_mngr::to_object_size(bin_no) + k_chunk_size - 1) / k_chunk_size;
+  chunk_no_type priv_insert_large_chunk(
+      const bin_no_type bin_no,
+      const interleaved_chunk_regions *const regions) {
+    const std::size_t num_chunks = priv_num_large_chunks(bin_no);
     assert(num_chunks >= 1);
 
-    chunk_no_type count_continuous_empty_chunks = 0;
-    for (chunk_no_type chunk_no = 0; chunk_no < m_max_num_chunks; ++chunk_no) {
+    chunk_no_type top_chunk_no = m_max_num_chunks;
+    // Objects larger than a region are placed by best fit
+    if (regions && num_chunks <= regions->region_size) {
+      top_chunk_no = m_free_chunk_index.find_first_fit(num_chunks, *regions);
+    }
+    if (top_chunk_no >= m_max_num_chunks) {
+      top_chunk_no = m_free_chunk_index.find_best_fit(num_chunks);
+    }
+    if (top_chunk_no >= m_max_num_chunks) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "No available space for large allocation, which requires "
+                  "multiple contiguous chunks");
+      return m_max_num_chunks;
+    }
+    if (!priv_reserve_entries(top_chunk_no + num_chunks - 1, false)) {
+      return m_max_num_chunks;
+    }
+
+    for (chunk_no_type offset = 0; offset < num_chunks; ++offset) {
+      const chunk_no_type chunk_no = top_chunk_no + offset;
       if (chunk_no > m_last_used_chunk_no) {
         // Initialize (empty) it before just in case
         m_table[chunk_no].init();
       }
-
-      if (chunk_no <= m_last_used_chunk_no && !unused_chunk(chunk_no)) {
-        count_continuous_empty_chunks = 0;
-        continue;
-      }
-
-      ++count_continuous_empty_chunks;
-      if (count_continuous_empty_chunks == num_chunks) {
-        const chunk_no_type top_chunk_no =
-            chunk_no - (count_continuous_empty_chunks - 1);
-        m_table[top_chunk_no].bin_no = bin_no;
-        m_table[top_chunk_no].type = chunk_type::large_chunk_head;
-
-        for (chunk_no_type offset = 1; offset < num_chunks; ++offset) {
-          m_table[top_chunk_no + offset].bin_no = bin_no;  // just in case
-          m_table[top_chunk_no + offset].type = chunk_type::large_chunk_body;
-        }
-
-        m_last_used_chunk_no =
-            std::max((ssize_t)chunk_no, m_last_used_chunk_no);
-
-        return top_chunk_no;
-      }
+      assert(unused_chunk(chunk_no));
+      m_table[chunk_no].bin_no = bin_no;  // just in case for body chunks
+      m_table[chunk_no].type = (offset == 0) ? chunk_type::large_chunk_head
+                                             : chunk_type::large_chunk_body;
     }
+    m_free_chunk_index.set_used(top_chunk_no, num_chunks);
+
+    m_last_used_chunk_no = std::max((ssize_t)(top_chunk_no + num_chunks - 1),
+                                    m_last_used_chunk_no);
 
-    logger::out(logger::level::error, __FILE__, __LINE__,
-                "No available space for large allocation, which requires "
-                "multiple contiguous chunks");
-    return m_max_num_chunks;
+    return top_chunk_no;
   }
 
   ssize_t find_next_used_chunk_backward(
@@ -640,6 +1174,13 @@ class chunk_directory {
   // Use const here to avoid race condition risks
   const std::size_t m_max_num_chunks;
   ssize_t m_last_used_chunk_no;
+  // Derived from m_table; thus, it is not serialized but rebuilt on
+  // deserialization.
+  free_chunk_index<chunk_no_type> m_free_chunk_index;
+  bool m_free_chunk_index_ready{true};
+  // Used only in the persistent mode
+  mdtl::extendable_file_map m_table_map;
+  mdtl::extendable_file_map m_slot_table_map;
 };
 
 }  // namespace kernel
@@ -0,0 +1,1149 @@
+// Copyright 2023 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+#ifndef METALL_KERNEL_DEDUP_SEGMENT_STORAGE_HPP
+#define METALL_KERNEL_DEDUP_SEGMENT_STORAGE_HPP
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include <string>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <unordered_map>
+
+#include "metall/defs.hpp"
+#include "metall/detail/file.hpp"
+#include "metall/detail/file_clone.hpp"
+#include "metall/detail/binary_file.hpp"
+#include "metall/detail/hash.hpp"
+#include "metall/detail/mmap.hpp"
+#include "metall/detail/soft_dirty_page.hpp"
+#include "metall/detail/utilities.hpp"
+#include "metall/logger.hpp"
+#include "metall/tags.hpp"
+#include "metall/kernel/storage.hpp"
+#include "metall/kernel/segment_header.hpp"
+
+namespace metall::kernel {
+
+namespace {
+namespace mdtl = metall::mtlldetail;
+}
+
+/// \brief Segment storage that stores the segment in fixed-size pages keyed
+/// by the hash of their contents.
+/// Pages that have the same contents are stored only once;
+/// snapshots and copies share the page files by hard links instead of copying
+/// them.
+/// \details
+/// Each page is mapped from its page file with MAP_PRIVATE.
+/// sync() finds the written pages using the pagemap,
+/// writes pages with new contents to new page files, and remaps the pages from
+/// the files. Page files are never modified once they are written.
+/// The hash (two MurmurHash64A values) is not collision resistant;
+/// thus, it only locates a page file, and the contents of an existing page
+/// file are compared byte by byte before the file is reused.
+/// Pages that contain only zeros do not have files.
+/// As each non-zero page is a separate map, the amount of non-zero data is
+/// limited by the maximum number of maps per process (vm.max_map_count on
+/// Linux).
+class dedup_segment_storage {
+ private:
+  static constexpr const char *k_dir_name = "dedup_segment";
+  static constexpr const char *k_page_dir_name = "pages";
+
+  // A binary file that has the hash of each page
+  static constexpr const char *k_page_table_file_name = "page_table";
+  static constexpr const char *k_page_table_file_magic = "MTLLDPGT";
+  static constexpr uint64_t k_binary_file_version = 1;
+
+#ifndef METALL_DEDUP_SEGMENT_PAGE_SIZE
+#error "METALL_DEDUP_SEGMENT_PAGE_SIZE is not defined."
+#endif
+  static constexpr std::size_t k_page_size = METALL_DEDUP_SEGMENT_PAGE_SIZE;
+
+  // Seeds of the two hash values that make a 128-bit page hash
+  static constexpr uint64_t k_hash_seed_low = 123;
+  static constexpr uint64_t k_hash_seed_high = 456;
+
+  /// \brief 128-bit hash of the contents of a page.
+  /// Also used as the ID of a page file, which is the hash of its contents
+  /// unless another page file has the same hash.
+  /// The zero value is reserved for pages that contain only zeros.
+  /// Not initialized by the default constructor so that a large table can be
+  /// allocated without touching its memory.
+  struct page_hash {
+    uint64_t low;
+    uint64_t high;
+
+    bool zero() const { return low == 0 && high == 0; }
+    bool operator==(const page_hash &other) const {
+      return low == other.low && high == other.high;
+    }
+    bool operator!=(const page_hash &other) const { return !(*this == other); }
+  };
+  static_assert(sizeof(page_hash) == 16, "Unexpected page hash size");
+
+  struct page_hash_hasher {
+    std::size_t operator()(const page_hash &hash) const { return hash.low; }
+  };
+
+  using ref_count_table_type =
+      std::unordered_map<page_hash, std::size_t, page_hash_hasher>;
+
+ public:
+  using path_type = storage::path_type;
+  using segment_header_type = segment_header;
+
+  dedup_segment_storage() {
+    if (!priv_set_system_page_size()) {
+      priv_set_broken_status();
+    }
+  }
+
+  ~dedup_segment_storage() {
+    int ret = true;
+    if (is_open()) {
+      ret &= sync(true);
+      ret &= release();
+    }
+
+    if (!ret) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Failed to destruct");
+    }
+  }
+
+  dedup_segment_storage(const dedup_segment_storage &) = delete;
+  dedup_segment_storage &operator=(const dedup_segment_storage &) = delete;
+
+  dedup_segment_storage(dedup_segment_storage &&other) noexcept
+      : m_system_page_size(other.m_system_page_size),
+        m_vm_region_size(other.m_vm_region_size),
+        m_current_segment_size(other.m_current_segment_size),
+        m_vm_region(other.m_vm_region),
+        m_segment(other.m_segment),
+        m_segment_header(other.m_segment_header),
+        m_top_path(std::move(other.m_top_path)),
+        m_read_only(other.m_read_only),
+        m_max_num_pages(other.m_max_num_pages),
+        m_page_table(std::move(other.m_page_table)),
+        m_stored_page_table(std::move(other.m_stored_page_table)),
+        m_ref_counts(std::move(other.m_ref_counts)),
+        m_prefetch_tasks(std::move(other.m_prefetch_tasks)),
+        m_broken(other.m_broken) {
+    other.priv_set_broken_status();
+  }
+
+  dedup_segment_storage &operator=(dedup_segment_storage &&other) noexcept {
+    m_system_page_size = other.m_system_page_size;
+    m_vm_region_size = other.m_vm_region_size;
+    m_current_segment_size = other.m_current_segment_size;
+    m_vm_region = other.m_vm_region;
+    m_segment = other.m_segment;
+    m_segment_header = other.m_segment_header;
+    m_top_path = std::move(other.m_top_path);
+    m_read_only = other.m_read_only;
+    m_max_num_pages = other.m_max_num_pages;
+    m_page_table = std::move(other.m_page_table);
+    m_stored_page_table = std::move(other.m_stored_page_table);
+    m_ref_counts = std::move(other.m_ref_counts);
+    m_prefetch_tasks = std::move(other.m_prefetch_tasks);
+    m_broken = other.m_broken;
+
+    other.priv_set_broken_status();
+
+    return *this;
+  }
+
+  /// \brief Copies segment to another location.
+  /// Page files are hard linked; they are copied only if they cannot be
+  /// linked, e.g., the destination is on another file system.
+  /// \param source_path A path to a source segment.
+  /// \param destination_path A destination path.
+  /// \param clone If true, uses clone (reflink) for copying page files that
+  /// cannot be linked.
+  /// \param max_num_threads The maximum number of threads to use.
+  /// If <= 0 is given, the value is automatically determined.
+  /// \return Return true if success; otherwise, false.
+  static bool copy(const path_type &source_path,
+                   const path_type &destination_path, const bool clone,
+                   const int max_num_threads) {
+    return priv_copy(priv_top_dir_path(source_path),
+                     priv_top_dir_path(destination_path), clone,
+                     max_num_threads);
+  }
+
+  /// \brief Creates a new segment.
+  /// Calling this function fails if this class already manages an opened
+  /// segment.
+  /// \base_path A base directory path to create a segment.
+  /// \param capacity A segment capacity to reserve.
+  /// Return true if success; otherwise, false.
+  bool create(const path_type &base_path, const std::size_t capacity) {
+    return priv_create(priv_top_dir_path(base_path), capacity);
+  }
+
+  /// \brief Opens an existing segment.
+  /// Calling this function fails if this class already manages an opened
+  /// segment.
+  /// \param base_path A base directory path to open a segment.
+  /// \param capacity A segment capacity to reserve.
+  /// This value will is ignored if read_only is true.
+  /// \param read_only If true, this segment is read only.
+  /// \return Return true if success; otherwise, false.
+  bool open(const path_type &base_path, const std::size_t capacity,
+            const bool read_only) {
+    return priv_open(priv_top_dir_path(base_path), capacity, read_only);
+  }
+
+  /// \brief Extends the currently opened segment if necessary.
+  /// \param request_size A segment size to extend to.
+  /// \return Returns true if the segment is extended to or already larger than
+  /// the requested size. Returns false on failure.
+  bool extend(const std::size_t request_size) {
+    return priv_extend(request_size);
+  }
+
+  /// \brief Releases the segment --- the data will be lost.
+  /// To save data to files, sync() must be called beforehand.
+  bool release() { return priv_release_segment(); }
+
+  /// \brief Stores the written pages into page files.
+  /// \param sync If true, the page files and the page table are also fsynced.
+  bool sync(const bool sync) { return priv_sync(sync); }
+
+  /// \brief Tries to free the specified region in DRAM and file(s).
+  /// Pages fully covered by the region become zero pages,
+  /// which do not have files.
+  /// \param offset An offset to the region from the beginning of the segment.
+  /// \param nbytes The size of the region.
+  bool free_region(const std::ptrdiff_t offset, const std::size_t nbytes) {
+    return priv_free_region(offset, nbytes);
+  }
+
+  /// \brief Gives advice about the access pattern of a region to the kernel
+  /// by madvise(2).
+  /// \param offset An offset to the region from the beginning of the segment.
+  /// \param nbytes The size of the region.
+  /// The part beyond the current segment is ignored.
+  /// \param pattern The access pattern.
+  /// \return Returns true if the advice is given; otherwise, false.
+  bool advise(const std::ptrdiff_t offset, const std::size_t nbytes,
+              const access_pattern pattern) const {
+    return priv_advise(offset, nbytes, pattern);
+  }
+
+  /// \brief Reads the pages of a region in the background so that
+  /// accessing the region later does not wait for page faults.
+  /// The segment is not closed until the read finishes.
+  /// \param offset An offset to the region from the beginning of the segment.
+  /// \param nbytes The size of the region.
+  /// The part beyond the current segment is ignored.
+  /// \return Returns an object of std::shared_future.
+  /// If succeeded, its get() returns true; other false.
+  std::shared_future<bool> prefetch_async(const std::ptrdiff_t offset,
+                                          const std::size_t nbytes) {
+    return priv_prefetch_async(offset, nbytes);
+  }
+
+  /// \brief Takes a snapshot of the segment.
+  /// The snapshot shares the page files with this segment by hard links.
+  /// \param snapshot_path A path to a snapshot.
+  /// \param clone If true, uses clone (reflink) for copying page files that
+  /// cannot be linked.
+  /// \param max_num_threads The maximum number of threads to use.
+  /// If <= 0 is given, the value is automatically determined.
+  /// \return Return true if success; otherwise, false.
+  bool snapshot(const path_type &snapshot_path, const bool clone,
+                const int max_num_threads) {
+    if (!sync(true)) return false;
+    return priv_copy(m_top_path, priv_top_dir_path(snapshot_path), clone,
+                     max_num_threads);
+  }
+
+  /// \brief Returns the address of the segment.
+  /// \return The address of the segment.
+  void *get_segment() const { return m_segment; }
+
+  /// \brief Returns a reference to the segment header.
+  /// \return A reference to the segment header.
+  segment_header_type &get_segment_header() {
+    return *reinterpret_cast<segment_header_type *>(m_segment_header);
+  }
+
+  /// \brief Returns a reference to the segment header.
+  /// \return A reference to the segment header.
+  const segment_header_type &get_segment_header() const {
+    return *reinterpret_cast<segment_header_type *>(m_segment_header);
+  }
+
+  /// \brief Returns the current size.
+  /// \return The current segment size.
+  std::size_t size() const { return m_current_segment_size; }
+
+  /// \brief Returns the page size.
+  /// Regions of this size can be freed.
+  /// \return The page size of the system.
+  std::size_t page_size() const { return m_system_page_size; }
+
+  /// \brief Checks if the segment is read only.
+  /// \return Returns true if the segment is read only; otherwise, returns
+  /// false.
+  bool read_only() const { return m_read_only; }
+
+  /// \brief Checks if there is a segment being managed by this class.
+  /// \return Returns true if there is a segment being managed by this class;
+  /// otherwise, returns false.
+  bool is_open() const { return priv_is_open(); }
+
+  /// \brief Checks the sanity.
+  /// \return Returns true if there is no issue; otherwise, returns false.
+  /// If false is returned, the instance of this class cannot be used anymore.
+  bool check_sanity() const { return !m_broken; }
+
+ private:
+  static path_type priv_top_dir_path(const path_type &base_path) {
+    return storage::get_path(base_path, k_dir_name);
+  }
+
+  /// \warning The following functions take 'top_path' as an argument instead
+  /// of 'base_path'.
+  static path_type priv_page_dir_path(const path_type &top_path) {
+    return top_path / k_page_dir_name;
+  }
+
+  static path_type priv_page_table_file_path(const path_type &top_path) {
+    return top_path / k_page_table_file_name;
+  }
+
+  static path_type priv_page_file_path(const path_type &top_path,
+                                       const page_hash &hash) {
+    char name[33];
+    std::snprintf(name, sizeof(name), "%016llx%016llx",
+                  static_cast<unsigned long long>(hash.high),
+                  static_cast<unsigned long long>(hash.low));
+    return priv_page_dir_path(top_path) / name;
+  }
+
+  std::size_t priv_alignment() const {
+    return std::max((size_t)m_system_page_size, (size_t)k_page_size);
+  }
+
+  std::size_t priv_header_size() const {
+    return mdtl::round_up(sizeof(segment_header_type),
+                          int64_t(priv_alignment()));
+  }
+
+  void priv_clear_status() {
+    m_system_page_size = 0;
+    m_vm_region_size = 0;
+    m_current_segment_size = 0;
+    m_vm_region = nullptr;
+    m_segment = nullptr;
+    m_segment_header = nullptr;
+    m_max_num_pages = 0;
+    m_page_table.reset();
+    m_stored_page_table.clear();
+    m_ref_counts.clear();
+    // m_read_only must not be modified here.
+  }
+
+  void priv_set_broken_status() {
+    priv_clear_status();
+    m_broken = true;
+  }
+
+  bool priv_is_open() const {
+    return (check_sanity() && m_system_page_size > 0 && m_vm_region_size > 0 &&
+            m_current_segment_size > 0 && m_vm_region && m_segment &&
+            !m_top_path.empty() && m_page_table);
+  }
+
+  /// \brief Links (or copies) all page files and copies the page table.
+  static bool priv_copy(const path_type &source_top_path,
+                        const path_type &destination_top_path,
+                        const bool clone, const int max_num_threads) {
+    const auto dst_page_dir = priv_page_dir_path(destination_top_path);
+    if (!mdtl::directory_exist(dst_page_dir) &&
+        !mdtl::create_directory(dst_page_dir)) {
+      std::string s("Cannot create a directory: " + dst_page_dir.string());
+      logger::out(logger::level::error, __FILE__, __LINE__, s.c_str());
+      return false;
+    }
+
+    const auto src_page_dir = priv_page_dir_path(source_top_path);
+    std::vector<path_type> file_names;
+    if (!mdtl::get_regular_file_names(src_page_dir, &file_names)) {
+      std::string s("Failed to get file list in " + src_page_dir.string());
+      logger::out(logger::level::error, __FILE__, __LINE__, s.c_str());
+      return false;
+    }
+
+    {
+      std::stringstream ss;
+      ss << "Link " << file_names.size() << " page files in "
+         << src_page_dir.string();
+      logger::out(logger::level::info, __FILE__, __LINE__, ss.str().c_str());
+    }
+    const bool linked = priv_for_each_in_parallel(
+        file_names.size(), max_num_threads, [&](const std::size_t i) {
+          // Skip temporary files left by a crash
+          if (file_names[i].has_extension()) return true;
+          return priv_link_file(src_page_dir / file_names[i],
+                                dst_page_dir / file_names[i], clone);
+        });
+    if (!linked) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Failed to link page files");
+      return false;
+    }
+
+    if (!mdtl::copy_file(priv_page_table_file_path(source_top_path),
+                         priv_page_table_file_path(destination_top_path))) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Failed to copy the page table");
+      return false;
+    }
+
+    return true;
+  }
+
+  static bool priv_link_file(const path_type &source_path,
+                             const path_type &destination_path,
+                             const bool clone) {
+    if (::link(source_path.c_str(), destination_path.c_str()) == 0 ||
+        errno == EEXIST) {
+      return true;
+    }
+    return clone ? mdtl::clone_file(source_path, destination_path)
+                 : mdtl::copy_file(source_path, destination_path);
+  }
+
+  static bool priv_for_each_in_parallel(
+      const std::size_t num_items, const int max_num_threads,
+      const std::function<bool(std::size_t)> &func) {
+    std::atomic_uint_fast64_t item_no_count = 0;
+    std::atomic_uint_fast64_t num_successes = 0;
+    const auto num_threads = std::min<std::size_t>(
+        num_items, max_num_threads > 0 ? max_num_threads
+                                       : std::thread::hardware_concurrency());
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < num_threads; ++i) {
+      threads.emplace_back([&]() {
+        while (true) {
+          const auto item_no = item_no_count.fetch_add(1);
+          if (item_no >= num_items) break;
+          num_successes.fetch_add(func(item_no) ? 1 : 0);
+        }
+      });
+    }
+    for (auto &th : threads) th.join();
+    return num_successes == num_items;
+  }
+
+  bool priv_reserve_vm(const std::size_t nbytes) {
+    m_vm_region_size =
+        mdtl::round_up((int64_t)nbytes, (int64_t)priv_alignment());
+    m_vm_region =
+        mdtl::reserve_aligned_vm_region(priv_alignment(), m_vm_region_size);
+
+    if (!m_vm_region) {
+      std::stringstream ss;
+      ss << "Cannot reserve a VM region " << nbytes << " bytes";
+      logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+      m_vm_region_size = 0;
+      return false;
+    }
+    assert(reinterpret_cast<uint64_t>(m_vm_region) % priv_alignment() == 0);
+
+    return true;
+  }
+
+  /// \brief Reserves a VM region, maps the segment header,
+  /// and allocates the page table.
+  bool priv_init_segment(const path_type &top_path, const std::size_t capacity,
+                         const bool read_only) {
+    const auto segment_capacity =
+        mdtl::round_up((int64_t)capacity, (int64_t)k_page_size);
+    if (!priv_reserve_vm(priv_header_size() + segment_capacity)) {
+      return false;
+    }
+    m_segment = reinterpret_cast<char *>(m_vm_region) + priv_header_size();
+
+    if (mdtl::map_anonymous_write_mode(m_vm_region, priv_header_size(),
+                                       MAP_FIXED) != m_vm_region) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Cannot allocate segment header");
+      return false;
+    }
+    m_segment_header = reinterpret_cast<segment_header_type *>(m_vm_region);
+    new (m_segment_header) segment_header_type();
+
+    m_top_path = top_path;
+    m_read_only = read_only;
+    m_max_num_pages = segment_capacity / k_page_size;
+    // Allocated to the max size as free_region() can be called concurrently
+    // with extend(); untouched entries do not consume physical memory.
+    m_page_table.reset(new page_hash[m_max_num_pages]);
+
+    return true;
+  }
+
+  bool priv_create(const path_type &top_path, const std::size_t capacity) {
+    if (!check_sanity()) return false;
+    if (is_open())
+      return false;  // Cannot open multiple segments simultaneously.
+
+    {
+      std::string s("Create a segment under: " + top_path.string());
+      logger::out(logger::level::info, __FILE__, __LINE__, s.c_str());
+    }
+
+    const auto page_dir = priv_page_dir_path(top_path);
+    if (!mdtl::directory_exist(page_dir) && !mdtl::create_directory(page_dir)) {
+      std::string s("Cannot create a directory: " + page_dir.string());
+      logger::out(logger::level::error, __FILE__, __LINE__, s.c_str());
+      // As no internal value has been changed, m_broken is still false.
+      return false;
+    }
+
+    if (!priv_init_segment(top_path, capacity, false)) {
+      priv_release_vm_region();
+      priv_set_broken_status();
+      return false;
+    }
+
+    // Create the first page so that we can assume that there is a page always
+    // in a segment.
+    if (!priv_extend(k_page_size) || !priv_write_page_table(false)) {
+      priv_release_segment();
+      priv_set_broken_status();
+      return false;
+    }
+
+    return true;
+  }
+
+  bool priv_open(const path_type &top_path, const std::size_t capacity,
+                 const bool read_only) {
+    if (!check_sanity()) return false;
+    if (is_open())
+      return false;  // Cannot open multiple segments simultaneously.
+
+    {
+      std::string s("Open a segment under: " + top_path.string());
+      logger::out(logger::level::info, __FILE__, __LINE__, s.c_str());
+    }
+
+    if (!priv_read_page_table(top_path, &m_stored_page_table)) {
+      return false;
+    }
+    const std::size_t num_pages = m_stored_page_table.size();
+    if (num_pages == 0 || (!read_only && num_pages * k_page_size > capacity)) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Invalid segment size or too small capacity");
+      m_stored_page_table.clear();
+      return false;
+    }
+
+    if (!priv_init_segment(
+            top_path, read_only ? num_pages * k_page_size : capacity,
+            read_only)) {
+      priv_release_vm_region();
+      priv_set_broken_status();
+      return false;
+    }
+
+    // Maps runs of zero pages at once and other pages one by one
+    for (std::size_t page_no = 0; page_no < num_pages;) {
+      const auto &hash = m_stored_page_table[page_no];
+      std::size_t n = 1;
+      if (hash.zero()) {
+        while (page_no + n < num_pages &&
+               m_stored_page_table[page_no + n].zero()) {
+          ++n;
+        }
+      }
+      if (!priv_map_pages(page_no, n, hash, !read_only)) {
+        priv_release_segment();
+        priv_set_broken_status();
+        return false;
+      }
+      for (std::size_t i = 0; i < n; ++i) {
+        m_page_table[page_no + i] = hash;
+        if (!hash.zero()) ++m_ref_counts[hash];
+      }
+      page_no += n;
+    }
+    m_current_segment_size = num_pages * k_page_size;
+
+    return true;
+  }
+
+  bool priv_extend(const std::size_t request_size) {
+    if (!m_vm_region || !m_page_table) return false;
+
+    if (m_read_only) {
+      return false;
+    }
+
+    if (request_size > m_max_num_pages * k_page_size) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Requested segment size is bigger than the reserved VM size");
+      return false;
+    }
+
+    if (request_size <= m_current_segment_size) {
+      return true;  // Already has enough segment size
+    }
+
+    const std::size_t first_page_no = m_current_segment_size / k_page_size;
+    const std::size_t num_pages =
+        mdtl::round_up((int64_t)request_size, (int64_t)k_page_size) /
+            k_page_size -
+        first_page_no;
+    if (!priv_map_pages(first_page_no, num_pages, page_hash{0, 0}, true)) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Failed to extend the segment");
+      return false;
+    }
+    for (std::size_t i = 0; i < num_pages; ++i) {
+      m_page_table[first_page_no + i] = page_hash{0, 0};
+    }
+    m_current_segment_size = (first_page_no + num_pages) * k_page_size;
+
+    return true;
+  }
+
+  /// \brief Maps 'num_pages' pages from 'page_no' with the contents of
+  /// 'hash', replacing the existing maps.
+  /// A non-zero hash can be mapped to only one page at a time.
+  bool priv_map_pages(const std::size_t page_no, const std::size_t num_pages,
+                      const page_hash &hash, const bool writable) {
+    assert(hash.zero() || num_pages == 1);
+    void *const addr = static_cast<char *>(m_segment) + page_no * k_page_size;
+    const std::size_t length = num_pages * k_page_size;
+    const int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+
+    if (hash.zero()) {
+      return mdtl::os_mmap(addr, length, prot,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1,
+                           0) == addr;
+    }
+
+    const auto path = priv_page_file_path(m_top_path, hash);
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+      std::string s("Cannot open a page file: " + path.string());
+      logger::perror(logger::level::error, __FILE__, __LINE__, s.c_str());
+      return false;
+    }
+    const bool mapped =
+        mdtl::os_mmap(addr, length, prot, MAP_PRIVATE | MAP_FIXED, fd, 0) ==
+        addr;
+    mdtl::os_close(fd);
+    return mapped;
+  }
+
+  bool priv_release_vm_region() {
+    if (!m_vm_region) return true;
+    if (!mdtl::munmap(m_vm_region, m_vm_region_size, false)) {
+      std::stringstream ss;
+      ss << "Cannot release a VM region " << (uint64_t)m_vm_region << ", "
+         << m_vm_region_size << " bytes.";
+      logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+      return false;
+    }
+    m_vm_region = nullptr;
+    m_vm_region_size = 0;
+    return true;
+  }
+
+  bool priv_release_segment() {
+    if (!m_vm_region) return false;
+
+    priv_wait_prefetch();
+
+    // Unmapping the whole region also destroys the maps of the segment header
+    // and the pages.
+    if (m_segment_header) std::destroy_at(m_segment_header);
+    if (!priv_release_vm_region()) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Failed to release the segment");
+      priv_set_broken_status();
+      return false;
+    }
+    priv_clear_status();
+    return true;
+  }
+
+  bool priv_sync(const bool sync) {
+    if (!is_open()) return false;
+
+    if (m_read_only) return true;
+
+    // Protect the region to detect unexpected write by application during sync
+    if (!mdtl::mprotect_read_only(m_segment, m_current_segment_size)) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Failed to protect the segment with the read only mode");
+      return false;
+    }
+
+    bool ret = priv_store_written_pages(sync);
+    // Page files that are not referenced anymore are removed only after
+    // the new page table is written
+    ret &= priv_write_page_table(sync);
+    if (ret) priv_update_ref_counts();
+
+    if (!mdtl::mprotect_read_write(m_segment, m_current_segment_size)) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Failed to set the segment to readable and writable");
+      return false;
+    }
+
+    if (!ret) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Failed to synchronize the segment");
+    }
+    return ret;
+  }
+
+  /// \brief Hashes the pages written since the last sync, stores pages with
+  /// new contents, and remaps the written pages from the page files so that
+  /// their private copies are discarded.
+  bool priv_store_written_pages(const bool sync) {
+    const std::size_t num_pages = m_current_segment_size / k_page_size;
+    const std::size_t num_system_pages = k_page_size / m_system_page_size;
+    std::atomic_uint_fast64_t num_stored_pages = 0;
+
+    const auto num_threads =
+        (int)std::min(num_pages, (std::size_t)std::thread::hardware_concurrency());
+    {
+      std::stringstream ss;
+      ss << "Sync pages with " << num_threads << " threads";
+      logger::out(logger::level::info, __FILE__, __LINE__, ss.str().c_str());
+    }
+
+    std::atomic_uint_fast64_t page_no_count = 0;
+    std::atomic_uint_fast64_t num_successes = 0;
+    auto store = [&]() {
+      mdtl::pagemap_reader pagemap;
+      std::vector<uint64_t> pagemap_buf(num_system_pages);
+      while (true) {
+        const auto page_no = page_no_count.fetch_add(1);
+        if (page_no >= num_pages) break;
+
+        char *const addr = static_cast<char *>(m_segment) + page_no * k_page_size;
+        if (!priv_written(pagemap, addr, pagemap_buf.data())) {
+          num_successes.fetch_add(1);
+          continue;
+        }
+
+        // Even if the hash is the same as before, the contents could have
+        // changed; thus, priv_store_page() compares them.
+        auto id = priv_hash_page(addr);
+        if (!id.zero() && !priv_store_page(addr, sync, &id)) continue;
+        if (id != m_page_table[page_no]) ++num_stored_pages;
+        if (!priv_map_pages(page_no, 1, id, false)) continue;
+        m_page_table[page_no] = id;
+        num_successes.fetch_add(1);
+      }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) threads.emplace_back(store);
+    for (auto &th : threads) th.join();
+
+    {
+      std::stringstream ss;
+      ss << "Stored " << num_stored_pages.load() << " pages";
+      logger::out(logger::level::info, __FILE__, __LINE__, ss.str().c_str());
+    }
+
+    return num_successes == num_pages;
+  }
+
+  /// \brief Checks if a page could have been written since it was mapped.
+  /// A written page of a private file map or a touched page of an anonymous
+  /// map is not a file page.
+  bool priv_written(mdtl::pagemap_reader &pagemap, const char *const addr,
+                    uint64_t *const buf) const {
+    const std::size_t num_system_pages = k_page_size / m_system_page_size;
+    if (!pagemap.read(reinterpret_cast<uint64_t>(addr) / m_system_page_size,
+                      num_system_pages, buf)) {
+      return true;  // Treats all pages as written
+    }
+    for (std::size_t i = 0; i < num_system_pages; ++i) {
+      if (mdtl::check_swapped_page(buf[i]) ||
+          (mdtl::check_present_page(buf[i]) && !mdtl::check_file_page(buf[i]))) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static page_hash priv_hash_page(const char *const addr) {
+    const auto *const words = reinterpret_cast<const uint64_t *>(addr);
+    if (std::all_of(words, words + k_page_size / sizeof(uint64_t),
+                    [](const uint64_t w) { return w == 0; })) {
+      return page_hash{0, 0};
+    }
+
+    page_hash hash{
+        mdtl::murmur_hash_64a(addr, (int)k_page_size, k_hash_seed_low),
+        mdtl::murmur_hash_64a(addr, (int)k_page_size, k_hash_seed_high)};
+    if (hash.zero()) hash.low = 1;  // The zero value is reserved
+    return hash;
+  }
+
+  /// \brief Finds the page file that has the same contents as a page,
+  /// or writes a new one.
+  /// As different contents can have the same hash, the contents of an
+  /// existing page file are compared with the page before the file is reused.
+  /// If they differ, the next ID ('high' + 1) is tried.
+  /// \param addr The address of the page.
+  /// \param sync If true, the new page file is synchronized.
+  /// \param id Takes the hash of the page and returns the ID of the page file.
+  /// \return Returns true on success; otherwise, false.
+  bool priv_store_page(const char *const addr, const bool sync,
+                       page_hash *const id) const {
+    while (true) {
+      const auto path = priv_page_file_path(m_top_path, *id);
+      bool found = false;
+      bool same = false;
+      if (!priv_compare_page_file(path, addr, &found, &same)) return false;
+      if (same) return true;
+
+      if (!found) {
+        bool created = false;
+        if (!priv_write_page_file(path, addr, sync, &created)) return false;
+        if (created) return true;
+        // Another thread has just written the page file; compare it
+        continue;
+      }
+
+      ++id->high;
+      if (id->zero()) id->high = 1;  // The zero value is reserved
+    }
+  }
+
+  /// \brief Compares the contents of a page file with a page.
+  /// \param found Set to true if the page file exists.
+  /// \param same Set to true if the page file has the same contents.
+  /// \return Returns false on error.
+  static bool priv_compare_page_file(const path_type &path,
+                                     const char *const addr, bool *const found,
+                                     bool *const same) {
+    *found = false;
+    *same = false;
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+      if (errno == ENOENT) return true;
+      std::string s("Cannot open a page file: " + path.string());
+      logger::perror(logger::level::error, __FILE__, __LINE__, s.c_str());
+      return false;
+    }
+    *found = true;
+
+    if (mdtl::get_file_size(path) == (ssize_t)k_page_size) {
+      void *const file_addr =
+          mdtl::os_mmap(nullptr, k_page_size, PROT_READ, MAP_SHARED, fd, 0);
+      if (!file_addr) {
+        mdtl::os_close(fd);
+        return false;
+      }
+      *same = std::memcmp(file_addr, addr, k_page_size) == 0;
+      mdtl::os_munmap(file_addr, k_page_size);
+    }
+    return mdtl::os_close(fd);
+  }
+
+  /// \brief Writes a page file if it does not exist.
+  /// A page file is written to a temporary file first and linked so that
+  /// a page file always has the complete contents and an existing page file
+  /// is never replaced.
+  /// \param created Set to true if the page file has been written;
+  /// false if it already exists.
+  /// \return Returns false on error.
+  static bool priv_write_page_file(const path_type &path,
+                                   const char *const addr, const bool sync,
+                                   bool *const created) {
+    *created = false;
+    std::stringstream tmp_path;
+    tmp_path << path.string() << "." << std::this_thread::get_id();
+    const int fd =
+        ::open(tmp_path.str().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0444);
+    if (fd == -1) {
+      logger::perror(logger::level::error, __FILE__, __LINE__, "open");
+      return false;
+    }
+    bool ret = true;
+    for (std::size_t done = 0; ret && done < k_page_size;) {
+      const ssize_t n = ::write(fd, addr + done, k_page_size - done);
+      if (n == -1 && errno == EINTR) continue;
+      if (n == -1) {
+        logger::perror(logger::level::error, __FILE__, __LINE__, "write");
+        ret = false;
+      } else {
+        done += n;
+      }
+    }
+    if (ret && sync) ret &= mdtl::os_fsync(fd);
+    ret &= mdtl::os_close(fd);
+    if (ret) {
+      if (::link(tmp_path.str().c_str(), path.c_str()) == 0) {
+        *created = true;
+      } else if (errno != EEXIST) {
+        logger::perror(logger::level::error, __FILE__, __LINE__, "link");
+        ret = false;
+      }
+    }
+    mdtl::remove_file(tmp_path.str());
+    return ret;
+  }
+
+  bool priv_write_page_table(const bool sync) const {
+    const std::size_t num_pages = m_current_segment_size / k_page_size;
+    const auto path = priv_page_table_file_path(m_top_path);
+    const path_type tmp_path(path.string() + ".tmp");
+    {
+      mdtl::binary_file::writer writer(tmp_path, k_page_table_file_magic,
+                                       k_binary_file_version);
+      if (!writer.write(m_page_table.get(), num_pages * sizeof(page_hash)) ||
+          !writer.close(num_pages)) {
+        logger::out(logger::level::error, __FILE__, __LINE__,
+                    "Failed to write the page table");
+        return false;
+      }
+    }
+    if (sync && !mdtl::fsync(tmp_path)) return false;
+    if (::rename(tmp_path.c_str(), path.c_str()) != 0) {
+      logger::perror(logger::level::error, __FILE__, __LINE__, "rename");
+      return false;
+    }
+    return true;
+  }
+
+  static bool priv_read_page_table(const path_type &top_path,
+                                   std::vector<page_hash> *const table) {
+    mdtl::binary_file::reader reader(priv_page_table_file_path(top_path),
+                                     k_page_table_file_magic,
+                                     k_binary_file_version);
+    if (!reader.good()) return false;
+    table->resize(reader.num_records());
+    if (!reader.read(table->data(), table->size() * sizeof(page_hash))) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Failed to read the page table");
+      table->clear();
+      return false;
+    }
+    return true;
+  }
+
+  /// \brief Updates the reference counts of the page files with the page
+  /// table that has been written, and removes page files that are not
+  /// referenced anymore.
+  void priv_update_ref_counts() {
+    const std::size_t num_pages = m_current_segment_size / k_page_size;
+    m_stored_page_table.resize(num_pages, page_hash{0, 0});
+    std::vector<page_hash> unreferenced;
+    for (std::size_t page_no = 0; page_no < num_pages; ++page_no) {
+      const auto &hash = m_page_table[page_no];
+      auto &old_hash = m_stored_page_table[page_no];
+      if (hash == old_hash) continue;
+      if (!hash.zero()) ++m_ref_counts[hash];
+      if (!old_hash.zero() && --m_ref_counts[old_hash] == 0) {
+        unreferenced.push_back(old_hash);
+      }
+      old_hash = hash;
+    }
+
+    // A page file can be referenced again by another page
+    for (const auto &hash : unreferenced) {
+      const auto itr = m_ref_counts.find(hash);
+      if (itr == m_ref_counts.end() || itr->second > 0) continue;
+      m_ref_counts.erase(itr);
+      mdtl::remove_file(priv_page_file_path(m_top_path, hash));
+    }
+  }
+
+  bool priv_free_region(const std::ptrdiff_t offset,
+                        const std::size_t nbytes) {
+    if (!is_open() || m_read_only) return false;
+
+    if (offset + nbytes > m_current_segment_size) return false;
+
+    const std::size_t begin = offset;
+    const std::size_t end = offset + nbytes;
+    const std::size_t full_begin =
+        mdtl::round_up((int64_t)begin, (int64_t)k_page_size);
+    const std::size_t full_end =
+        mdtl::round_down((int64_t)end, (int64_t)k_page_size);
+    if (full_begin >= full_end) {
+      return priv_uncommit_pages(begin, end);
+    }
+
+    // Pages fully covered by the region become zero pages
+    const std::size_t first_page_no = full_begin / k_page_size;
+    const std::size_t num_pages = (full_end - full_begin) / k_page_size;
+    if (!priv_map_pages(first_page_no, num_pages, page_hash{0, 0}, true)) {
+      return false;
+    }
+    for (std::size_t i = 0; i < num_pages; ++i) {
+      m_page_table[first_page_no + i] = page_hash{0, 0};
+    }
+
+    return priv_uncommit_pages(begin, full_begin) &&
+           priv_uncommit_pages(full_end, end);
+  }
+
+  /// \brief Discards the private copies of the pages in the region.
+  /// The pages revert to the contents in the page files.
+  bool priv_uncommit_pages(const std::size_t begin, const std::size_t end) {
+    const std::size_t aligned_begin =
+        mdtl::round_up((int64_t)begin, (int64_t)m_system_page_size);
+    const std::size_t aligned_end =
+        mdtl::round_down((int64_t)end, (int64_t)m_system_page_size);
+    if (aligned_begin >= aligned_end) return true;
+    return mdtl::uncommit_private_nonanonymous_pages(
+        static_cast<char *>(m_segment) + aligned_begin,
+        aligned_end - aligned_begin);
+  }
+
+  /// \brief Returns the size of the part of a region in the current segment.
+  std::size_t priv_clamp_to_segment(const std::ptrdiff_t offset,
+                                    const std::size_t nbytes) const {
+    if ((std::size_t)offset >= m_current_segment_size) return 0;
+    return std::min(nbytes, m_current_segment_size - offset);
+  }
+
+  bool priv_advise(const std::ptrdiff_t offset, const std::size_t region_size,
+                   const access_pattern pattern) const {
+    if (!is_open() || offset < 0) return false;
+    const auto nbytes = priv_clamp_to_segment(offset, region_size);
+    if (nbytes == 0) return true;
+
+    const int advice = priv_madvice(pattern);
+    if (advice == -1) {
+      logger::out(logger::level::info, __FILE__, __LINE__,
+                  "The access pattern is not supported");
+      return false;
+    }
+
+    const auto begin = mdtl::round_down(offset, m_system_page_size);
+    if (!mdtl::os_madvise(static_cast<char *>(m_segment) + begin,
+                          offset + nbytes - begin, advice)) {
+      logger::perror(logger::level::warning, __FILE__, __LINE__, "madvise");
+      return false;
+    }
+    return true;
+  }
+
+  static int priv_madvice(const access_pattern pattern) {
+    switch (pattern) {
+      case access_pattern::normal:
+        return MADV_NORMAL;
+      case access_pattern::sequential:
+        return MADV_SEQUENTIAL;
+      case access_pattern::random:
+        return MADV_RANDOM;
+      case access_pattern::willneed:
+        return MADV_WILLNEED;
+      case access_pattern::cold:
+#ifdef MADV_COLD
+        return MADV_COLD;
+#else
+        return -1;
+#endif
+    }
+    return -1;
+  }
+
+  std::shared_future<bool> priv_prefetch_async(const std::ptrdiff_t offset,
+                                               const std::size_t region_size) {
+    if (!is_open() || offset < 0) {
+      std::promise<bool> failed;
+      failed.set_value(false);
+      return failed.get_future().share();
+    }
+    const auto nbytes = priv_clamp_to_segment(offset, region_size);
+
+    // Forgets finished ones
+    m_prefetch_tasks.erase(
+        std::remove_if(m_prefetch_tasks.begin(), m_prefetch_tasks.end(),
+                       [](const std::shared_future<bool> &task) {
+                         return task.wait_for(std::chrono::seconds(0)) ==
+                                std::future_status::ready;
+                       }),
+        m_prefetch_tasks.end());
+
+    // The pages stay mapped while sync() replaces their maps
+    auto *const addr = static_cast<char *>(m_segment) + offset;
+    auto task = std::async(std::launch::async, [addr, nbytes]() {
+                  return mdtl::populate_read(addr, nbytes);
+                }).share();
+    m_prefetch_tasks.push_back(task);
+    return task;
+  }
+
+  void priv_wait_prefetch() {
+    for (auto &task : m_prefetch_tasks) {
+      task.wait();
+    }
+    m_prefetch_tasks.clear();
+  }
+
+  bool priv_set_system_page_size() {
+    m_system_page_size = mdtl::get_page_size();
+    if (m_system_page_size == -1) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Failed to get system pagesize");
+      return false;
+    }
+    if (k_page_size % m_system_page_size != 0) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "The page size must be a multiple of the system page size");
+      return false;
+    }
+    return true;
+  }
+
+  // -------------------- //
+  // Private fields
+  // -------------------- //
+  ssize_t m_system_page_size{0};
+  std::size_t m_vm_region_size{0};
+  std::size_t m_current_segment_size{0};
+  void *m_vm_region{nullptr};
+  void *m_segment{nullptr};
+  segment_header_type *m_segment_header{nullptr};
+  path_type m_top_path;
+  bool m_read_only{false};
+  std::size_t m_max_num_pages{0};
+  // The hash of each page in memory
+  std::unique_ptr<page_hash[]> m_page_table;
+  // The page table that has been written to the file
+  std::vector<page_hash> m_stored_page_table;
+  // The number of pages that refer to each page file
+  ref_count_table_type m_ref_counts;
+  std::vector<std::shared_future<bool>> m_prefetch_tasks;
+  bool m_broken{false};
+};
+
+}  // namespace metall::kernel
+
+#endif  // METALL_KERNEL_DEDUP_SEGMENT_STORAGE_HPP
@@ -0,0 +1,324 @@
+// Copyright 2019 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+#ifndef METALL_KERNEL_FREE_CHUNK_INDEX_HPP
+#define METALL_KERNEL_FREE_CHUNK_INDEX_HPP
+
+#include <cassert>
+#include <map>
+#include <set>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+
+namespace metall {
+namespace kernel {
+
+/// \brief A set of chunk regions interleaved over the chunk number space.
+/// Region i holds chunks [i * region_size, (i + 1) * region_size).
+/// The set holds the regions whose (i % num_sets) is equal to set_no,
+/// e.g., the regions of a NUMA node.
+struct interleaved_chunk_regions {
+  std::size_t region_size{1};
+  std::size_t num_sets{1};
+  std::size_t set_no{0};
+
+  /// \brief Returns true if the set holds 'chunk_no'.
+  bool contains(const std::size_t chunk_no) const {
+    return (chunk_no / region_size) % num_sets == set_no;
+  }
+
+  /// \brief Returns the lowest chunk number in the set that is equal to or
+  /// greater than 'chunk_no'.
+  std::size_t lower_bound(const std::size_t chunk_no) const {
+    if (contains(chunk_no)) return chunk_no;
+    const std::size_t region_no = chunk_no / region_size;
+    const std::size_t cycle_first_region = region_no - region_no % num_sets;
+    // The first region of the set in this cycle or the next cycle
+    const std::size_t next_region = (region_no % num_sets < set_no)
+                                        ? cycle_first_region + set_no
+                                        : cycle_first_region + num_sets +
+                                              set_no;
+    return next_region * region_size;
+  }
+};
+
+/// \brief Index of free chunks.
+/// Holds free chunks as extents (runs of contiguous free chunks).
+/// Extents are kept in address order, and adjacent ones are always coalesced.
+/// Another index orders the extents by (length, first chunk number)
+/// to find the best-fit extent in O(log n).
+/// All chunks at or beyond end() are free and are not held as an extent.
+/// This class assumes that race condition is handled by the caller.
+/// \tparam _chunk_no_type Chunk number type.
+template <typename _chunk_no_type>
+class free_chunk_index {
+ public:
+  // -------------------- //
+  // Public types and static values
+  // -------------------- //
+  using chunk_no_type = _chunk_no_type;
+
+ private:
+  // -------------------- //
+  // Private types and static values
+  // -------------------- //
+  // Key: first chunk number, value: length
+  using address_ordered_table_type = std::map<chunk_no_type, std::size_t>;
+  // (length, first chunk number)
+  using size_ordered_table_type =
+      std::set<std::pair<std::size_t, chunk_no_type>>;
+
+ public:
+  // -------------------- //
+  // Constructor & assign operator
+  // -------------------- //
+  /// \brief Constructor.
+  /// \param max_num_chunks Maximum number of chunks that can be managed.
+  explicit free_chunk_index(const std::size_t max_num_chunks)
+      : m_max_num_chunks(max_num_chunks),
+        m_end(0),
+        m_address_ordered_table(),
+        m_size_ordered_table() {}
+
+  ~free_chunk_index() noexcept = default;
+  free_chunk_index(const free_chunk_index &) = default;
+  free_chunk_index(free_chunk_index &&) noexcept = default;
+  free_chunk_index &operator=(const free_chunk_index &) = default;
+  free_chunk_index &operator=(free_chunk_index &&) noexcept = default;
+
+  // -------------------- //
+  // Public methods
+  // -------------------- //
+  /// \brief Finds the lowest free chunk.
+  /// \return Returns the found chunk number.
+  /// Returns the maximum number of chunks if there is no free chunk.
+  chunk_no_type find_lowest() const {
+    const std::size_t found = m_address_ordered_table.empty()
+                                  ? m_end
+                                  : m_address_ordered_table.begin()->first;
+    if (found + 1 > m_max_num_chunks) {
+      return m_max_num_chunks;
+    }
+    return found;
+  }
+
+  /// \brief Finds the best-fit run of 'num_chunks' contiguous free chunks,
+  /// that is, the lowest one among the shortest extents that can hold them.
+  /// The chunks beyond end() are used only if there is no such extent.
+  /// \param num_chunks Number of chunks to find. Must be greater than 0.
+  /// \return Returns the first chunk number of the found run.
+  /// Returns the maximum number of chunks if there is no such run.
+  chunk_no_type find_best_fit(const std::size_t num_chunks) const {
+    assert(num_chunks > 0);
+    const auto itr =
+        m_size_ordered_table.lower_bound(
+            std::make_pair(num_chunks, chunk_no_type(0)));
+    if (itr != m_size_ordered_table.end()) {
+      return itr->second;
+    }
+
+    if (m_end + num_chunks > m_max_num_chunks) {
+      return m_max_num_chunks;
+    }
+    return m_end;
+  }
+
+  /// \brief Finds the lowest free chunk in 'regions'.
+  /// \param regions The set of regions to find a chunk from.
+  /// \return Returns the found chunk number.
+  /// Returns the maximum number of chunks if there is no free chunk.
+  chunk_no_type find_lowest(const interleaved_chunk_regions &regions) const {
+    std::size_t chunk_no = regions.lower_bound(0);
+    while (chunk_no < m_max_num_chunks) {
+      chunk_no = priv_find_lowest_from(chunk_no);
+      if (chunk_no >= m_max_num_chunks || regions.contains(chunk_no)) break;
+      chunk_no = regions.lower_bound(chunk_no);
+    }
+    return std::min(chunk_no, m_max_num_chunks);
+  }
+
+  /// \brief Finds the lowest run of 'num_chunks' contiguous free chunks
+  /// in a region of 'regions' (first fit).
+  /// \param num_chunks Number of chunks to find.
+  /// Must be greater than 0 and not greater than the region size.
+  /// \param regions The set of regions to find chunks from.
+  /// \return Returns the first chunk number of the found run.
+  /// Returns the maximum number of chunks if there is no such run.
+  chunk_no_type find_first_fit(
+      const std::size_t num_chunks,
+      const interleaved_chunk_regions &regions) const {
+    assert(num_chunks > 0 && num_chunks <= regions.region_size);
+    for (std::size_t first = regions.lower_bound(0);
+         first + num_chunks <= m_max_num_chunks;
+         first = regions.lower_bound(first + regions.region_size)) {
+      const std::size_t last =
+          std::min<std::size_t>(first + regions.region_size, m_max_num_chunks);
+      if (first >= m_end) return first;
+
+      auto itr = priv_find_extent(first);
+      if (itr == m_address_ordered_table.end()) {
+        itr = m_address_ordered_table.lower_bound(first);
+      }
+      for (; itr != m_address_ordered_table.end() && itr->first < last;
+           ++itr) {
+        const std::size_t run_first = std::max<std::size_t>(itr->first, first);
+        const std::size_t run_last = std::min(itr->first + itr->second, last);
+        if (run_first + num_chunks <= run_last) return run_first;
+      }
+      // The chunks beyond end() are free
+      if (m_end < last && std::max(m_end, first) + num_chunks <= last) {
+        return std::max(m_end, first);
+      }
+    }
+    return m_max_num_chunks;
+  }
+
+  /// \brief Marks chunks in [first_chunk_no, first_chunk_no + num_chunks) as
+  /// used. The chunks must be free.
+  /// \param first_chunk_no First chunk number.
+  /// \param num_chunks Number of chunks.
+  void set_used(const chunk_no_type first_chunk_no,
+                const std::size_t num_chunks) {
+    assert(first_chunk_no + num_chunks <= m_max_num_chunks);
+    assert(free(first_chunk_no, num_chunks));
+    if (num_chunks == 0) return;
+
+    const std::size_t last = first_chunk_no + num_chunks;
+    if (first_chunk_no >= m_end) {
+      if (first_chunk_no > m_end) {
+        priv_insert_extent(m_end, first_chunk_no - m_end);
+      }
+      m_end = last;
+      return;
+    }
+
+    const auto itr = priv_find_extent(first_chunk_no);
+    assert(itr != m_address_ordered_table.end());
+    const std::size_t extent_first = itr->first;
+    const std::size_t extent_last = itr->first + itr->second;
+    priv_erase_extent(itr);
+    if (extent_first < first_chunk_no) {
+      priv_insert_extent(extent_first, first_chunk_no - extent_first);
+    }
+    if (last < extent_last) {
+      priv_insert_extent(last, extent_last - last);
+    }
+  }
+
+  /// \brief Marks chunks in [first_chunk_no, first_chunk_no + num_chunks) as
+  /// free. The chunks must be used. Merges them with the adjacent extents.
+  /// \param first_chunk_no First chunk number.
+  /// \param num_chunks Number of chunks.
+  void set_free(const chunk_no_type first_chunk_no,
+                const std::size_t num_chunks) {
+    assert(first_chunk_no + num_chunks <= m_end);
+    if (num_chunks == 0) return;
+
+    std::size_t first = first_chunk_no;
+    std::size_t last = first_chunk_no + num_chunks;
+
+    auto next = m_address_ordered_table.lower_bound(first_chunk_no);
+    if (next != m_address_ordered_table.begin()) {
+      const auto prev = std::prev(next);
+      if (prev->first + prev->second == first) {
+        first = prev->first;
+        priv_erase_extent(prev);
+      }
+    }
+    if (next != m_address_ordered_table.end() && next->first == last) {
+      last = next->first + next->second;
+      priv_erase_extent(next);
+    }
+
+    if (last == m_end) {
+      m_end = first;
+    } else {
+      priv_insert_extent(first, last - first);
+    }
+  }
+
+  /// \brief Returns if all chunks in [first_chunk_no, first_chunk_no +
+  /// num_chunks) are free.
+  /// \param first_chunk_no First chunk number.
+  /// \param num_chunks Number of chunks.
+  /// \return Returns true if all the chunks are free.
+  bool free(const chunk_no_type first_chunk_no,
+            const std::size_t num_chunks) const {
+    if (first_chunk_no >= m_end) return true;
+    const auto itr = priv_find_extent(first_chunk_no);
+    return itr != m_address_ordered_table.end() &&
+           first_chunk_no + num_chunks <= itr->first + itr->second;
+  }
+
+  /// \brief Returns the chunk number next to the last used chunk.
+  /// All chunks at or beyond this point are free.
+  std::size_t end() const { return m_end; }
+
+  /// \brief Returns the number of free extents below end().
+  std::size_t num_extents() const { return m_address_ordered_table.size(); }
+
+  /// \brief Marks all chunks as free.
+  void clear() {
+    m_end = 0;
+    m_address_ordered_table.clear();
+    m_size_ordered_table.clear();
+  }
+
+ private:
+  // -------------------- //
+  // Private methods
+  // -------------------- //
+  /// \brief Finds the lowest free chunk that is equal to or greater than
+  /// 'chunk_no'.
+  std::size_t priv_find_lowest_from(const std::size_t chunk_no) const {
+    if (chunk_no >= m_end) return chunk_no;
+    if (priv_find_extent(chunk_no) != m_address_ordered_table.end()) {
+      return chunk_no;
+    }
+    const auto itr = m_address_ordered_table.lower_bound(chunk_no);
+    return (itr != m_address_ordered_table.end()) ? itr->first : m_end;
+  }
+
+  /// \brief Finds the extent that contains 'chunk_no'.
+  /// Returns end() of the table if there is no such extent.
+  typename address_ordered_table_type::const_iterator priv_find_extent(
+      const chunk_no_type chunk_no) const {
+    auto itr = m_address_ordered_table.upper_bound(chunk_no);
+    if (itr == m_address_ordered_table.begin()) {
+      return m_address_ordered_table.end();
+    }
+    --itr;
+    if (chunk_no < itr->first + itr->second) {
+      return itr;
+    }
+    return m_address_ordered_table.end();
+  }
+
+  void priv_insert_extent(const std::size_t first, const std::size_t length) {
+    assert(length > 0);
+    m_address_ordered_table.emplace(first, length);
+    m_size_ordered_table.emplace(length, first);
+  }
+
+  void priv_erase_extent(
+      typename address_ordered_table_type::const_iterator itr) {
+    m_size_ordered_table.erase(std::make_pair(itr->second, itr->first));
+    m_address_ordered_table.erase(itr);
+  }
+
+  // -------------------- //
+  // Private fields
+  // -------------------- //
+  std::size_t m_max_num_chunks;
+  std::size_t m_end;
+  address_ordered_table_type m_address_ordered_table;
+  size_ordered_table_type m_size_ordered_table;
+};
+
+}  // namespace kernel
+}  // namespace metall
+
+#endif  // METALL_KERNEL_FREE_CHUNK_INDEX_HPP
@@ -18,10 +18,17 @@
 #include <map>
 #include <sstream>
 #include <typeinfo>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+#include <thread>
+#include <atomic>
 
 #include <metall/logger.hpp>
 #include <metall/offset_ptr.hpp>
 #include <metall/version.hpp>
+#include <metall/tags.hpp>
+#include <metall/stats.hpp>
 #include <metall/kernel/manager_kernel_fwd.hpp>
 #include <metall/kernel/segment_header.hpp>
 #include <metall/kernel/segment_allocator.hpp>
@@ -35,6 +42,7 @@
 #include <metall/detail/char_ptr_holder.hpp>
 #include <metall/detail/uuid.hpp>
 #include <metall/detail/ptree.hpp>
+#include <metall/detail/time.hpp>
 
 #ifndef METALL_DISABLE_CONCURRENCY
 #define METALL_ENABLE_MUTEX_IN_MANAGER_KERNEL
@@ -124,15 +132,46 @@ class manager_kernel {
   static constexpr const char *k_manager_metadata_file_name =
       "manager_metadata";
   static constexpr const char *k_manager_metadata_key_for_version = "version";
+  // The oldest version whose datastores can be opened.
+  // Management data written in its text format is still readable.
+  static constexpr version_type k_min_supported_version = 2800;
   static constexpr const char *k_manager_metadata_key_for_uuid = "uuid";
+  // Large bin numbers in the chunk directory depend on the size classes
+  static constexpr const char *k_manager_metadata_key_for_large_size_class =
+      "large_size_class";
+  // The snapshot the next delta snapshot is taken from
+  static constexpr const char *k_manager_metadata_key_for_last_snapshot_path =
+      "last_snapshot_path";
+  static constexpr const char *k_manager_metadata_key_for_last_snapshot_uuid =
+      "last_snapshot_uuid";
+
+  // For delta snapshots
+  static constexpr const char *k_delta_snapshot_manifest_file_name =
+      "delta_snapshot_manifest";
+  static constexpr const char *k_delta_snapshot_manifest_key_for_parent_path =
+      "parent_path";
+  static constexpr const char *k_delta_snapshot_manifest_key_for_parent_uuid =
+      "parent_uuid";
 
   static constexpr const char *k_description_file_name = "description";
 
+  // Whether the segment storage tracks changed blocks for delta snapshots
+  template <typename T, typename = void>
+  struct tracks_changes : std::false_type {};
+  template <typename T>
+  struct tracks_changes<
+      T, std::void_t<decltype(std::declval<T &>().reset_change_tracking())>>
+      : std::true_type {};
+
   using json_store = mdtl::ptree::node_type;
 
 #ifdef METALL_ENABLE_MUTEX_IN_MANAGER_KERNEL
   using mutex_type = mdtl::mutex;
   using lock_guard_type = mdtl::mutex_lock_guard;
+
+  // Number of locks to serialize constructions and destructions of
+  // named and unique objects. A lock is chosen by the hash of the name.
+  static constexpr size_type k_num_object_name_mutexes = 64;
 #endif
 
  public:
@@ -201,11 +240,40 @@ class manager_kernel {
   /// otherwise, performs asynchronous operation.
   void flush(bool synchronous);
 
+  /// \brief Gives advice about the access pattern of a region in the
+  /// application data segment
+  /// \param addr The address of the region
+  /// \param nbytes The size of the region
+  /// \param pattern The access pattern
+  /// \return Returns true if the advice is given; otherwise, false.
+  bool advise(const void *addr, size_type nbytes, access_pattern pattern) const;
+
+  /// \brief Reads a region in the application data segment in the background
+  /// \param addr The address of the region
+  /// \param nbytes The size of the region
+  /// \return Returns an object of std::future.
+  /// If succeeded, its get() returns True; other false.
+  std::future<bool> prefetch_async(const void *addr, size_type nbytes);
+
+  /// \brief Populates the page tables of the application data segment or
+  /// named objects
+  /// Expect to be called by a single thread
+  /// \param option Regions to populate and the number of threads
+  /// \return Returns true if success; otherwise, returns false
+  bool prefault(const prefault_option &option);
+
   /// \brief Allocates memory space
   /// \param nbytes
   /// \return
   void *allocate(size_type nbytes);
 
+  /// \brief Allocates memory space on a NUMA node.
+  /// The node is ignored unless METALL_USE_NUMA is defined.
+  /// \param nbytes A size to allocate.
+  /// \param node A NUMA node number.
+  /// \return Returns a pointer to the allocated memory.
+  void *allocate_on_node(size_type nbytes, unsigned int node);
+
   /// \brief Allocate nbytes bytes of uninitialized storage whose alignment is
   /// specified by alignment. \param nbytes A size to allocate. Must be a
   /// multiple of alignment. \param alignment An alignment requirement.
@@ -219,6 +287,36 @@ class manager_kernel {
   /// \param addr
   void deallocate(void *addr);
 
+  /// \brief Allocates 'num_allocates' memory blocks of 'nbytes' bytes each.
+  /// \param nbytes Size of each memory block.
+  /// \param num_allocates Number of memory blocks to allocate.
+  /// \param addrs Buffer to store the addresses of the allocated blocks.
+  /// Must have space for 'num_allocates' elements.
+  /// \return Returns true on success. On error, returns false, nothing is
+  /// allocated, and all elements in 'addrs' are nullptr.
+  bool allocate_many(size_type nbytes, size_type num_allocates, void **addrs);
+
+  /// \brief Deallocates many memory blocks.
+  /// \param addrs Addresses of the memory blocks. nullptr is ignored.
+  /// \param num_deallocates Number of elements in 'addrs'.
+  void deallocate_many(void *const *addrs, size_type num_deallocates);
+
+  /// \brief Changes the size of the memory block pointed by 'addr'.
+  /// Grows or shrinks the block in place if possible;
+  /// otherwise, allocates a new block, copies data, and deallocates the old
+  /// one. \param addr Address of an allocated memory block.
+  /// If nullptr, works as allocate(). \param nbytes New size in bytes.
+  /// \return Returns the address of the resized block.
+  /// Returns nullptr on error, and the original block is left untouched.
+  void *reallocate(void *addr, size_type nbytes);
+
+  /// \brief Tries to grow the memory block pointed by 'addr' to 'nbytes' bytes
+  /// without moving it. \param addr Address of an allocated memory block.
+  /// \param nbytes New size in bytes.
+  /// \return Returns true if the block can hold 'nbytes' bytes;
+  /// otherwise, false.
+  bool expand_in_place(void *addr, size_type nbytes);
+
   /// \brief Check if all allocated memory has been deallocated.
   /// Note that this function clears object cache.
   bool all_memory_deallocated() const;
@@ -347,6 +445,11 @@ class manager_kernel {
   /// \return Returns the size of the application data segment.
   size_type get_segment_size() const;
 
+  /// \brief Returns the statistics of the allocator, the segment,
+  /// and flush().
+  /// \return Returns the statistics.
+  manager_stats get_stats();
+
   /// \brief Returns if this kernel was opened as read-only
   /// \return whether this kernel is read-only
   bool read_only() const;
@@ -360,6 +463,47 @@ class manager_kernel {
   bool snapshot(const path_type &destination_base_path, bool clone,
                 int num_max_copy_threads);
 
+  /// \brief Takes a snapshot in the background. The snapshot has a different
+  /// UUID. The management data is copied before this function returns, and
+  /// the application data is copied in the background. The application can
+  /// keep using the data store; a write to data that has not been copied
+  /// waits until the data is copied.
+  /// \param destination_base_path Destination path
+  /// \param clone Use clone (reflink) to copy data.
+  /// \param num_max_copy_threads The maximum number of copy threads to use.
+  /// If <= 0 is given, the value is automatically determined.
+  /// \return Returns an object of std::future.
+  /// If succeeded, its get() returns True; other false.
+  /// Its destructor blocks until the copy finishes.
+  [[nodiscard]] std::future<bool> snapshot_async(
+      const path_type &destination_base_path, bool clone,
+      int num_max_copy_threads);
+
+  /// \brief Takes a delta snapshot, which holds only the application data
+  /// changed since the last snapshot taken by snapshot() or snapshot_delta().
+  /// The delta snapshot has a different UUID and a manifest that points to
+  /// the last snapshot (the parent). It cannot be opened until it is
+  /// materialized by materialize_snapshot().
+  /// \param destination_base_path Destination path
+  /// \param clone Use clone (reflink) to copy data.
+  /// \param num_max_copy_threads The maximum number of copy threads to use.
+  /// If <= 0 is given, the value is automatically determined.
+  /// \return If succeeded, returns True; other false
+  bool snapshot_delta(const path_type &destination_base_path, bool clone,
+                      int num_max_copy_threads);
+
+  /// \brief Builds a full data store from a delta snapshot and its parents.
+  /// The data store has the same UUID as the delta snapshot.
+  /// \param delta_snapshot_base_path Path to a delta snapshot.
+  /// \param destination_base_path Destination path.
+  /// \param clone Use clone (reflink) to copy data.
+  /// \param num_max_copy_threads The maximum number of copy threads to use.
+  /// If <= 0 is given, the value is automatically determined.
+  /// \return If succeeded, returns True; other false.
+  static bool materialize_snapshot(const path_type &delta_snapshot_base_path,
+                                   const path_type &destination_base_path,
+                                   bool clone, int num_max_copy_threads);
+
   /// \brief Copies a data store synchronously, keeping the same UUID.
   /// \param source_base_path Source path.
   /// \param destination_base_path Destination path.
@@ -510,12 +654,28 @@ class manager_kernel {
                                           difference_type offset,
                                           size_type length);
 
-  bool priv_remove_attr_object_no_mutex(difference_type offset);
+  /// \brief Removes an object from the object directories.
+  /// \param offset The offset of the object.
+  /// \param length If not nullptr, the length of the object is stored.
+  /// \return Returns true if the object is removed.
+  /// Returns false without logging an error if the object is not in the
+  /// directories, e.g., it has been removed by another thread.
+  bool priv_remove_attr_object(difference_type offset,
+                               size_type *length = nullptr);
+
+#ifdef METALL_ENABLE_MUTEX_IN_MANAGER_KERNEL
+  template <typename T>
+  mutex_type &priv_object_name_mutex(char_ptr_holder_type name);
+#endif
 
   template <typename T>
   void priv_destruct_and_free_memory(difference_type offset, size_type length);
 
   // ---------- For segment  ---------- //
+  bool priv_populate_in_parallel(
+      const std::vector<std::pair<char *, size_type>> &regions,
+      std::size_t num_threads) const;
+
   bool priv_open(const path_type &base_path, bool read_only,
                  size_type vm_reserve_size_request = 0);
   bool priv_create(const path_type &base_path, size_type vm_reserve_size);
@@ -529,6 +689,28 @@ class manager_kernel {
   bool priv_snapshot(const path_type &destination_base_path, bool clone,
                      int num_max_copy_threads);
 
+  /// \brief Copies the management data and writes a new management metadata
+  /// with a new UUID for a snapshot.
+  bool priv_snapshot_management_data(const path_type &destination_base_path,
+                                     int num_max_copy_threads);
+
+  /// \brief Records a snapshot as the parent of the next delta snapshot
+  /// and resets the change tracking of the segment.
+  bool priv_set_last_snapshot(const path_type &snapshot_base_path);
+
+  /// \brief Collects a snapshot and its ancestors,
+  /// from the snapshot to the full snapshot at the root.
+  /// \param base_path Path to a snapshot.
+  /// \param uuid The expected UUID of the snapshot.
+  /// \param chain A buffer to append the paths.
+  static bool priv_get_snapshot_chain(const path_type &base_path,
+                                      const std::string &uuid,
+                                      std::vector<path_type> *chain);
+
+  static bool priv_read_delta_snapshot_manifest(const path_type &base_path,
+                                                std::string *parent_path,
+                                                std::string *parent_uuid);
+
   // ---------- File operations  ---------- //
   /// \brief Copies all backing files using reflink if possible
   static bool priv_copy_data_store(const path_type &src_base_path,
@@ -547,6 +729,11 @@ class manager_kernel {
   static version_type priv_get_version(const json_store &metadata_json);
   static bool priv_set_version(json_store *metadata_json);
 
+  static std::string priv_get_large_size_class(
+      const json_store &metadata_json);
+  static bool priv_check_large_size_class(const json_store &metadata_json);
+  static bool priv_set_large_size_class(json_store *metadata_json);
+
   static bool priv_set_uuid(json_store *metadata_json);
   static std::string priv_get_uuid(const json_store &metadata_json);
 
@@ -568,8 +755,19 @@ class manager_kernel {
   std::unique_ptr<json_store> m_manager_metadata{nullptr};
   segment_storage m_segment_storage{};
 
+#ifndef METALL_DISABLE_STATS
+  // Counters of flush() for get_stats(); times are in microseconds
+  struct flush_counter_type {
+    std::atomic_uint64_t num_flushes{0};
+    std::atomic_uint64_t flush_time{0};
+    std::atomic_uint64_t msync_time{0};
+  };
+  std::unique_ptr<flush_counter_type> m_flush_counter{
+      std::make_unique<flush_counter_type>()};
+#endif
+
 #ifdef METALL_ENABLE_MUTEX_IN_MANAGER_KERNEL
-  std::unique_ptr<mutex_type> m_object_directories_mutex{nullptr};
+  std::unique_ptr<mutex_type[]> m_object_name_mutexes{nullptr};
 #endif
 };
 
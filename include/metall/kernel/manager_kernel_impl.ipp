@@ -21,8 +21,9 @@ manager_kernel<st, sst, cn, cs>::manager_kernel()
     return;
   }
 #ifdef METALL_ENABLE_MUTEX_IN_MANAGER_KERNEL
-  m_object_directories_mutex = std::make_unique<mutex_type>();
-  if (!m_object_directories_mutex) {
+  m_object_name_mutexes =
+      std::make_unique<mutex_type[]>(k_num_object_name_mutexes);
+  if (!m_object_name_mutexes) {
     return;
   }
 #endif
@@ -77,7 +78,71 @@ void manager_kernel<st, sst, cn, cs>::close() {
 template <typename st, typename sst, typename cn, std::size_t cs>
 void manager_kernel<st, sst, cn, cs>::flush(const bool synchronous) {
   priv_check_sanity();
+#ifndef METALL_DISABLE_STATS
+  const auto start = mdtl::elapsed_time_sec();
+#endif
   m_segment_storage.sync(synchronous);
+#ifndef METALL_DISABLE_STATS
+  const auto msync_time = mdtl::elapsed_time_sec(start);
+#endif
+  if (!m_segment_storage.read_only()) {
+    m_segment_memory_allocator.sync(synchronous);
+  }
+#ifndef METALL_DISABLE_STATS
+  const auto flush_time = mdtl::elapsed_time_sec(start);
+  m_flush_counter->num_flushes.fetch_add(1, std::memory_order_relaxed);
+  m_flush_counter->flush_time.fetch_add(flush_time * 1e6,
+                                        std::memory_order_relaxed);
+  m_flush_counter->msync_time.fetch_add(msync_time * 1e6,
+                                        std::memory_order_relaxed);
+#endif
+}
+
+template <typename st, typename sst, typename cn, std::size_t cs>
+bool manager_kernel<st, sst, cn, cs>::advise(
+    const void *const addr, const size_type nbytes,
+    const access_pattern pattern) const {
+  priv_check_sanity();
+  const auto offset =
+      static_cast<const char *>(addr) -
+      static_cast<const char *>(m_segment_storage.get_segment());
+  return m_segment_storage.advise(offset, nbytes, pattern);
+}
+
+template <typename st, typename sst, typename cn, std::size_t cs>
+std::future<bool> manager_kernel<st, sst, cn, cs>::prefetch_async(
+    const void *const addr, const size_type nbytes) {
+  priv_check_sanity();
+  const auto offset =
+      static_cast<const char *>(addr) -
+      static_cast<const char *>(m_segment_storage.get_segment());
+  auto prefetch = m_segment_storage.prefetch_async(offset, nbytes);
+  return std::async(std::launch::deferred,
+                    [prefetch]() { return prefetch.get(); });
+}
+
+template <typename st, typename sst, typename cn, std::size_t cs>
+bool manager_kernel<st, sst, cn, cs>::prefault(const prefault_option &option) {
+  priv_check_sanity();
+
+  std::vector<std::pair<char *, size_type>> regions;
+  if (option.object_names.empty()) {
+    regions.emplace_back(static_cast<char *>(m_segment_storage.get_segment()),
+                         m_segment_storage.size());
+  } else {
+    for (const auto &name : option.object_names) {
+      difference_type offset = 0;
+      if (!m_named_object_directory.find(name, &offset, nullptr)) {
+        std::string s("Named object to prefault is not found: " + name);
+        logger::out(logger::level::error, __FILE__, __LINE__, s.c_str());
+        return false;
+      }
+      regions.emplace_back(static_cast<char *>(priv_to_address(offset)),
+                           m_segment_memory_allocator.allocated_size(offset));
+    }
+  }
+
+  return priv_populate_in_parallel(regions, option.num_threads);
 }
 
 template <typename st, typename sst, typename cn, std::size_t cs>
@@ -95,6 +160,22 @@ void *manager_kernel<st, sst, cn, cs>::allocate(
   return priv_to_address(offset);
 }
 
+template <typename st, typename sst, typename cn, std::size_t cs>
+void *manager_kernel<st, sst, cn, cs>::allocate_on_node(
+    const manager_kernel<st, sst, cn, cs>::size_type nbytes,
+    const unsigned int node) {
+  priv_check_sanity();
+  if (m_segment_storage.read_only()) return nullptr;
+
+  const auto offset = m_segment_memory_allocator.allocate_on_node(nbytes, node);
+  if (offset == segment_memory_allocator::k_null_offset) {
+    return nullptr;
+  }
+  assert(offset >= 0);
+
+  return priv_to_address(offset);
+}
+
 template <typename st, typename sst, typename cn, std::size_t cs>
 void *manager_kernel<st, sst, cn, cs>::allocate_aligned(
     const manager_kernel<st, sst, cn, cs>::size_type nbytes,
@@ -125,6 +206,82 @@ void manager_kernel<st, sst, cn, cs>::deallocate(void *const addr) {
   m_segment_memory_allocator.deallocate(priv_to_offset(addr));
 }
 
+template <typename st, typename sst, typename cn, std::size_t cs>
+bool manager_kernel<st, sst, cn, cs>::allocate_many(
+    const manager_kernel<st, sst, cn, cs>::size_type nbytes,
+    const manager_kernel<st, sst, cn, cs>::size_type num_allocates,
+    void **const addrs) {
+  priv_check_sanity();
+  if (!addrs) return false;
+  std::fill_n(addrs, num_allocates, nullptr);
+  if (m_segment_storage.read_only()) return false;
+
+  std::vector<difference_type> offsets(num_allocates);
+  if (!m_segment_memory_allocator.allocate_many(nbytes, num_allocates,
+                                                offsets.data())) {
+    return false;
+  }
+  for (size_type i = 0; i < num_allocates; ++i) {
+    addrs[i] = priv_to_address(offsets[i]);
+  }
+
+  return true;
+}
+
+template <typename st, typename sst, typename cn, std::size_t cs>
+void manager_kernel<st, sst, cn, cs>::deallocate_many(
+    void *const *const addrs,
+    const manager_kernel<st, sst, cn, cs>::size_type num_deallocates) {
+  priv_check_sanity();
+  if (m_segment_storage.read_only()) return;
+  if (!addrs) return;
+
+  std::vector<difference_type> offsets(num_deallocates);
+  for (size_type i = 0; i < num_deallocates; ++i) {
+    offsets[i] = (addrs[i]) ? priv_to_offset(addrs[i])
+                            : segment_memory_allocator::k_null_offset;
+  }
+  m_segment_memory_allocator.deallocate_many(offsets.data(), num_deallocates);
+}
+
+template <typename st, typename sst, typename cn, std::size_t cs>
+void *manager_kernel<st, sst, cn, cs>::reallocate(
+    void *const addr,
+    const manager_kernel<st, sst, cn, cs>::size_type nbytes) {
+  priv_check_sanity();
+  if (m_segment_storage.read_only()) return nullptr;
+  if (!addr) return allocate(nbytes);
+
+  const auto offset = priv_to_offset(addr);
+  if (m_segment_memory_allocator.resize_in_place(offset, nbytes)) {
+    return addr;
+  }
+
+  auto *const new_addr = allocate(nbytes);
+  if (!new_addr) return nullptr;
+  std::memcpy(new_addr, addr,
+              std::min(nbytes,
+                       m_segment_memory_allocator.allocated_size(offset)));
+  m_segment_memory_allocator.deallocate(offset);
+
+  return new_addr;
+}
+
+template <typename st, typename sst, typename cn, std::size_t cs>
+bool manager_kernel<st, sst, cn, cs>::expand_in_place(
+    void *const addr,
+    const manager_kernel<st, sst, cn, cs>::size_type nbytes) {
+  priv_check_sanity();
+  if (m_segment_storage.read_only()) return false;
+  if (!addr) return false;
+
+  const auto offset = priv_to_offset(addr);
+  if (nbytes <= m_segment_memory_allocator.allocated_size(offset)) {
+    return true;
+  }
+  return m_segment_memory_allocator.resize_in_place(offset, nbytes);
+}
+
 template <typename st, typename sst, typename cn, std::size_t cs>
 bool manager_kernel<st, sst, cn, cs>::all_memory_deallocated() const {
   priv_check_sanity();
@@ -141,20 +298,17 @@ manager_kernel<st, sst, cn, cs>::find(char_ptr_holder_type name) const {
     return std::make_pair(nullptr, 0);
   }
 
-  if (name.is_unique()) {
-    auto itr = m_unique_object_directory.find(gen_type_name<T>());
-    if (itr != m_unique_object_directory.end()) {
-      auto *const addr = reinterpret_cast<T *>(priv_to_address(itr->offset()));
-      const auto length = itr->length();
-      return std::make_pair(addr, length);
-    }
-  } else {
-    auto itr = m_named_object_directory.find(name.get());
-    if (itr != m_named_object_directory.end()) {
-      auto *const addr = reinterpret_cast<T *>(priv_to_address(itr->offset()));
-      const auto length = itr->length();
-      return std::make_pair(addr, length);
-    }
+  // Does not take any lock; the directories support lock-free name lookups.
+  difference_type offset = 0;
+  size_type length = 0;
+  const bool found =
+      name.is_unique()
+          ? m_unique_object_directory.find(gen_type_name<T>(), &offset,
+                                           &length)
+          : m_named_object_directory.find(name.get(), &offset, &length);
+  if (found) {
+    return std::make_pair(reinterpret_cast<T *>(priv_to_address(offset)),
+                          length);
   }
 
   return std::make_pair(nullptr, 0);
@@ -175,7 +329,7 @@ bool manager_kernel<st, sst, cn, cs>::destroy(char_ptr_holder_type name) {
 
   {
 #ifdef METALL_ENABLE_MUTEX_IN_MANAGER_KERNEL
-    lock_guard_type guard(*m_object_directories_mutex);
+    lock_guard_type guard(priv_object_name_mutex<T>(name));
 #endif
 
     std::tie(ptr, length) = find<T>(name);
@@ -183,7 +337,7 @@ bool manager_kernel<st, sst, cn, cs>::destroy(char_ptr_holder_type name) {
       return false;  // This is not a critical error --- could have been
                      // destroyed by another thread already.
     }
-    if (!priv_remove_attr_object_no_mutex(priv_to_offset(ptr))) {
+    if (!priv_remove_attr_object(priv_to_offset(ptr))) {
       return false;
     }
   }
@@ -199,20 +353,12 @@ bool manager_kernel<st, sst, cn, cs>::destroy_ptr(const T *ptr) {
   priv_check_sanity();
   if (m_segment_storage.read_only()) return false;
 
+  // Finding the length and removing the entry are done atomically by the
+  // object directories; only one of concurrent destroy calls succeeds.
   size_type length = 0;
-  {
-#ifdef METALL_ENABLE_MUTEX_IN_MANAGER_KERNEL
-    lock_guard_type guard(*m_object_directories_mutex);
-#endif
-
-    length = get_instance_length(ptr);
-    if (length == 0) {
-      return false;  // This is not a critical error --- could have been
-                     // destroyed by another thread already.
-    }
-    if (!priv_remove_attr_object_no_mutex(priv_to_offset(ptr))) {
-      return false;
-    }
+  if (!priv_remove_attr_object(priv_to_offset(ptr), &length)) {
+    return false;  // This is not a critical error --- could have been
+                   // destroyed by another thread already.
   }
 
   priv_destruct_and_free_memory<T>(priv_to_offset(ptr), length);
@@ -443,6 +589,23 @@ manager_kernel<st, sst, cn, cs>::get_segment_size() const {
   return m_segment_storage.size();
 }
 
+template <typename st, typename sst, typename cn, std::size_t cs>
+manager_stats manager_kernel<st, sst, cn, cs>::get_stats() {
+  priv_check_sanity();
+  manager_stats stats;
+  m_segment_memory_allocator.get_stats(&stats);
+  stats.mapped_size = m_segment_storage.size();
+#ifndef METALL_DISABLE_STATS
+  stats.num_flushes =
+      m_flush_counter->num_flushes.load(std::memory_order_relaxed);
+  stats.flush_time =
+      m_flush_counter->flush_time.load(std::memory_order_relaxed) / 1e6;
+  stats.msync_time =
+      m_flush_counter->msync_time.load(std::memory_order_relaxed) / 1e6;
+#endif
+  return stats;
+}
+
 template <typename st, typename sst, typename cn, std::size_t cs>
 bool manager_kernel<st, sst, cn, cs>::read_only() const {
   return m_segment_storage.read_only();
@@ -455,6 +618,172 @@ bool manager_kernel<st, sst, cn, cs>::snapshot(
   return priv_snapshot(destination_base_path, clone, num_max_copy_threads);
 }
 
+template <typename st, typename sst, typename cn, std::size_t cs>
+std::future<bool> manager_kernel<st, sst, cn, cs>::snapshot_async(
+    const path_type &destination_base_path, const bool clone,
+    const int num_max_copy_threads) {
+  priv_check_sanity();
+
+  // Copies the frozen management data synchronously
+  std::shared_future<bool> segment_copy;
+  if (priv_serialize_management_data() &&
+      priv_create_datastore_directory(destination_base_path) &&
+      priv_snapshot_management_data(destination_base_path,
+                                    num_max_copy_threads)) {
+    segment_copy = m_segment_storage.snapshot_async(
+        destination_base_path, clone, num_max_copy_threads);
+  }
+
+  if (!segment_copy.valid()) {
+    std::stringstream ss;
+    ss << "Failed to start a snapshot to " << destination_base_path;
+    logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+    std::promise<bool> failed;
+    failed.set_value(false);
+    return failed.get_future();
+  }
+
+  // The snapshot becomes usable once the segment has been copied
+  return std::async(std::launch::async,
+                    [segment_copy, destination_base_path]() {
+                      if (!segment_copy.get()) {
+                        logger::out(logger::level::error, __FILE__, __LINE__,
+                                    "Failed to copy the segment");
+                        return false;
+                      }
+                      return priv_mark_properly_closed(destination_base_path);
+                    });
+}
+
+template <typename st, typename sst, typename cn, std::size_t cs>
+bool manager_kernel<st, sst, cn, cs>::snapshot_delta(
+    const path_type &destination_base_path, const bool clone,
+    const int num_max_copy_threads) {
+  priv_check_sanity();
+  if (m_segment_storage.read_only()) {
+    logger::out(logger::level::error, __FILE__, __LINE__,
+                "Cannot take a delta snapshot in the read-only mode");
+    return false;
+  }
+
+  std::string parent_path;
+  std::string parent_uuid;
+  if (!mdtl::ptree::get_value(*m_manager_metadata,
+                              k_manager_metadata_key_for_last_snapshot_path,
+                              &parent_path) ||
+      !mdtl::ptree::get_value(*m_manager_metadata,
+                              k_manager_metadata_key_for_last_snapshot_uuid,
+                              &parent_uuid)) {
+    logger::out(logger::level::error, __FILE__, __LINE__,
+                "No snapshot to take a delta snapshot from; "
+                "take a snapshot with snapshot() first");
+    return false;
+  }
+
+  std::vector<path_type> parent_paths;
+  if (!priv_get_snapshot_chain(parent_path, parent_uuid, &parent_paths)) {
+    return false;
+  }
+
+  if (!priv_serialize_management_data()) {
+    logger::out(logger::level::error, __FILE__, __LINE__,
+                "Failed to serialize the management data");
+    return false;
+  }
+
+  if (!priv_create_datastore_directory(destination_base_path)) {
+    std::stringstream ss;
+    ss << "Failed to init the destination: " << destination_base_path;
+    logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+    return false;
+  }
+
+  if (!m_segment_storage.snapshot_delta(destination_base_path, parent_paths,
+                                        clone, num_max_copy_threads)) {
+    std::stringstream ss;
+    ss << "Failed to copy changed data to " << destination_base_path;
+    logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+    return false;
+  }
+
+  if (!priv_snapshot_management_data(destination_base_path,
+                                     num_max_copy_threads)) {
+    return false;
+  }
+
+  // The manifest, instead of a properly closed mark,
+  // prevents the delta snapshot from being opened
+  json_store manifest;
+  if (!mdtl::ptree::add_value(k_delta_snapshot_manifest_key_for_parent_path,
+                              parent_path, &manifest) ||
+      !mdtl::ptree::add_value(k_delta_snapshot_manifest_key_for_parent_uuid,
+                              parent_uuid, &manifest) ||
+      !mdtl::ptree::write_json(
+          manifest, storage::get_path(destination_base_path,
+                                      k_delta_snapshot_manifest_file_name))) {
+    logger::out(logger::level::error, __FILE__, __LINE__,
+                "Failed to write the delta snapshot manifest");
+    return false;
+  }
+
+  return priv_set_last_snapshot(destination_base_path);
+}
+
+template <typename st, typename sst, typename cn, std::size_t cs>
+bool manager_kernel<st, sst, cn, cs>::materialize_snapshot(
+    const path_type &delta_snapshot_base_path,
+    const path_type &destination_base_path, const bool clone,
+    const int num_max_copy_threads) {
+  std::string parent_path;
+  std::string parent_uuid;
+  if (!priv_read_delta_snapshot_manifest(delta_snapshot_base_path,
+                                         &parent_path, &parent_uuid)) {
+    return false;
+  }
+
+  std::vector<path_type> chain{delta_snapshot_base_path};
+  if (!priv_get_snapshot_chain(parent_path, parent_uuid, &chain)) {
+    return false;
+  }
+
+  if (!priv_create_datastore_directory(destination_base_path)) {
+    std::stringstream ss;
+    ss << "Failed to init the destination: " << destination_base_path;
+    logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+    return false;
+  }
+
+  if (!segment_storage::materialize(chain, destination_base_path, clone,
+                                    num_max_copy_threads)) {
+    std::stringstream ss;
+    ss << "Failed to build the segment of " << delta_snapshot_base_path;
+    logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+    return false;
+  }
+
+  // The delta snapshot has the complete management data
+  const auto src_mng_dir =
+      storage::get_path(delta_snapshot_base_path, k_management_dir_name);
+  const auto dst_mng_dir =
+      storage::get_path(destination_base_path, k_management_dir_name);
+  if (!mtlldetail::copy_files_in_directory_in_parallel(src_mng_dir, dst_mng_dir,
+                                                       num_max_copy_threads)) {
+    std::stringstream ss;
+    ss << "Failed to copy " << src_mng_dir << " to " << dst_mng_dir;
+    logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+    return false;
+  }
+
+  // Finally, mark it as properly-closed
+  if (!priv_mark_properly_closed(destination_base_path)) {
+    logger::out(logger::level::error, __FILE__, __LINE__,
+                "Failed to create a properly closed mark");
+    return false;
+  }
+
+  return true;
+}
+
 template <typename st, typename sst, typename cn, std::size_t cs>
 bool manager_kernel<st, sst, cn, cs>::copy(
     const path_type &source_base_path, const path_type &destination_base_path,
@@ -662,13 +991,16 @@ bool manager_kernel<st, sst, cn, cs>::priv_consistent(
   json_store metadata;
   return priv_properly_closed(base_path) &&
          (priv_read_management_metadata(base_path, &metadata) &&
-          priv_check_version(metadata));
+          priv_check_version(metadata) &&
+          priv_check_large_size_class(metadata));
 }
 
 template <typename st, typename sst, typename cn, std::size_t cs>
 bool manager_kernel<st, sst, cn, cs>::priv_check_version(
     const json_store &metadata_json) {
-  return priv_get_version(metadata_json) == version_type(METALL_VERSION);
+  const auto version = priv_get_version(metadata_json);
+  return k_min_supported_version <= version &&
+         version <= version_type(METALL_VERSION);
 }
 
 template <typename st, typename sst, typename cn, std::size_t cs>
@@ -705,7 +1037,11 @@ T *manager_kernel<st, sst, cn, cs>::priv_generic_construct(
   void *ptr = nullptr;
   try {
 #ifdef METALL_ENABLE_MUTEX_IN_MANAGER_KERNEL
-    lock_guard_type guard(*m_object_directories_mutex);
+    // Anonymous objects do not need to be serialized as they have no name.
+    std::unique_lock<mutex_type> name_lock;
+    if (!name.is_anonymous()) {
+      name_lock = std::unique_lock<mutex_type>(priv_object_name_mutex<T>(name));
+    }
 #endif
 
     if (!name.is_anonymous()) {
@@ -739,12 +1075,7 @@ T *manager_kernel<st, sst, cn, cs>::priv_generic_construct(
   std::unique_ptr<void, std::function<void(void *)>> ptr_holder(
       ptr, [this](void *const ptr) {
         try {
-          {
-#ifdef METALL_ENABLE_MUTEX_IN_MANAGER_KERNEL
-            lock_guard_type guard(*m_object_directories_mutex);
-#endif
-            priv_remove_attr_object_no_mutex(priv_to_offset(ptr));
-          }
+          priv_remove_attr_object(priv_to_offset(ptr));
           deallocate(ptr);
         } catch (...) {
           logger::out(logger::level::error, __FILE__, __LINE__,
@@ -800,20 +1131,42 @@ bool manager_kernel<st, sst, cn, cs>::priv_register_attr_object_no_mutex(
 }
 
 template <typename st, typename sst, typename cn, std::size_t cs>
-bool manager_kernel<st, sst, cn, cs>::priv_remove_attr_object_no_mutex(
-    difference_type offset) {
+bool manager_kernel<st, sst, cn, cs>::priv_remove_attr_object(
+    difference_type offset, size_type *const length) {
   // As the instance kind of the object is not given,
   // just call the eranse functions in all tables to simplify implementation.
-  if (!m_named_object_directory.erase(offset) &&
-      !m_unique_object_directory.erase(offset) &&
-      !m_anonymous_object_directory.erase(offset)) {
+  if (m_named_object_directory.erase(offset, length) ||
+      m_unique_object_directory.erase(offset, length) ||
+      m_anonymous_object_directory.erase(offset, length)) {
+    return true;
+  }
+
+  // Not an error if the entry has already been erased,
+  // e.g., by another thread destroying the same object
+  if (m_named_object_directory.find(offset) !=
+          m_named_object_directory.end() ||
+      m_unique_object_directory.find(offset) !=
+          m_unique_object_directory.end() ||
+      m_anonymous_object_directory.find(offset) !=
+          m_anonymous_object_directory.end()) {
     logger::out(logger::level::error, __FILE__, __LINE__,
                 "Failed to erase an entry from object directories");
-    return false;
   }
+  return false;
+}
 
-  return true;
+#ifdef METALL_ENABLE_MUTEX_IN_MANAGER_KERNEL
+template <typename st, typename sst, typename cn, std::size_t cs>
+template <typename T>
+typename manager_kernel<st, sst, cn, cs>::mutex_type &
+manager_kernel<st, sst, cn, cs>::priv_object_name_mutex(
+    char_ptr_holder_type name) {
+  const std::size_t hash =
+      name.is_unique() ? mdtl::str_hash<>{}(gen_type_name<T>())
+                       : mdtl::str_hash<>{}(name.get());
+  return m_object_name_mutexes[hash % k_num_object_name_mutexes];
 }
+#endif
 
 template <typename st, typename sst, typename cn, std::size_t cs>
 template <typename T>
@@ -826,6 +1179,72 @@ void manager_kernel<st, sst, cn, cs>::priv_destruct_and_free_memory(
   m_segment_memory_allocator.deallocate(offset);
 }
 
+template <typename st, typename sst, typename cn, std::size_t cs>
+bool manager_kernel<st, sst, cn, cs>::priv_populate_in_parallel(
+    const std::vector<std::pair<char *, size_type>> &regions,
+    const std::size_t num_threads) const {
+  // Splits the regions into units so that threads can balance the load
+  constexpr size_type k_unit_size = k_chunk_size * 32;
+  std::vector<std::pair<char *, size_type>> units;
+  size_type total_size = 0;
+  for (const auto &[addr, size] : regions) {
+    for (size_type off = 0; off < size; off += k_unit_size) {
+      units.emplace_back(addr + off, std::min(k_unit_size, size - off));
+    }
+    total_size += size;
+  }
+
+  const std::size_t max_num_threads =
+      (num_threads > 0) ? num_threads : std::thread::hardware_concurrency();
+  const std::size_t num_workers =
+      std::max((std::size_t)1, std::min(units.size(), max_num_threads));
+  {
+    std::stringstream ss;
+    ss << "Prefault " << total_size << " bytes using " << num_workers
+       << " threads";
+    logger::out(logger::level::info, __FILE__, __LINE__, ss.str().c_str());
+  }
+
+  std::atomic_size_t unit_index = 0;
+  std::atomic<size_type> populated_size = 0;
+  std::atomic_bool succeeded = true;
+  auto worker = [&]() {
+    while (true) {
+      const auto i = unit_index.fetch_add(1);
+      if (i >= units.size()) break;
+      if (!mdtl::populate_read(units[i].first, units[i].second)) {
+        succeeded = false;
+      }
+
+      // Reports the progress every 10 %
+      const auto before = populated_size.fetch_add(units[i].second);
+      const auto after = before + units[i].second;
+      if (before * 10 / total_size != after * 10 / total_size) {
+        std::stringstream ss;
+        ss << "Prefaulted " << after * 100 / total_size << " % (" << after
+           << " / " << total_size << " bytes)";
+        logger::out(logger::level::info, __FILE__, __LINE__,
+                    ss.str().c_str());
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (std::size_t t = 1; t < num_workers; ++t) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto &th : threads) {
+    th.join();
+  }
+
+  if (!succeeded) {
+    logger::out(logger::level::error, __FILE__, __LINE__,
+                "Failed to prefault the segment");
+  }
+  return succeeded;
+}
+
 template <typename st, typename sst, typename cn, std::size_t cs>
 bool manager_kernel<st, sst, cn, cs>::priv_open(
     const path_type &base_path, const bool read_only,
@@ -849,6 +1268,16 @@ bool manager_kernel<st, sst, cn, cs>::priv_open(
     return false;
   }
 
+  if (!priv_check_large_size_class(*m_manager_metadata)) {
+    std::stringstream ss;
+    ss << "Invalid large size class — it was created with '"
+       << priv_get_large_size_class(*m_manager_metadata)
+       << "' (currently using '"
+       << object_size_manager_detail::k_large_size_class_name << "')";
+    logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+    return false;
+  }
+
   if (!priv_properly_closed(base_path)) {
     logger::out(logger::level::error, __FILE__, __LINE__,
                 "Inconsistent data store — it was not closed properly and "
@@ -865,6 +1294,20 @@ bool manager_kernel<st, sst, cn, cs>::priv_open(
     return false;
   }
 
+  // Management data is written in the current format at close,
+  // so older versions must not open this datastore afterwards
+  if (!read_only && priv_get_version(*m_manager_metadata) !=
+                        version_type(METALL_VERSION)) {
+    mdtl::ptree::erase(k_manager_metadata_key_for_version,
+                       m_manager_metadata.get());
+    if (!priv_set_version(m_manager_metadata.get()) ||
+        !priv_write_management_metadata(m_base_path, *m_manager_metadata)) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Failed to update the version of the datastore");
+      return false;
+    }
+  }
+
   if (!m_segment_storage.open(m_base_path, vm_reserve_size_request,
                               read_only)) {
     logger::out(logger::level::error, __FILE__, __LINE__,
@@ -921,11 +1364,19 @@ bool manager_kernel<st, sst, cn, cs>::priv_create(
 
   if (!priv_set_uuid(m_manager_metadata.get()) ||
       !priv_set_version(m_manager_metadata.get()) ||
+      !priv_set_large_size_class(m_manager_metadata.get()) ||
       !priv_write_management_metadata(m_base_path, *m_manager_metadata)) {
     m_segment_storage.release();
     return false;
   }
 
+  if (!m_segment_memory_allocator.create(storage::get_path(
+          m_base_path,
+          {k_management_dir_name, k_segment_memory_allocator_prefix}))) {
+    m_segment_storage.release();
+    return false;
+  }
+
   return true;
 }
 
@@ -1016,7 +1467,11 @@ bool manager_kernel<st, sst, cn, cs>::priv_snapshot(
     const path_type &destination_base_path, const bool clone,
     const int num_max_copy_threads) {
   priv_check_sanity();
-  priv_serialize_management_data();
+  if (!priv_serialize_management_data()) {
+    logger::out(logger::level::error, __FILE__, __LINE__,
+                "Failed to serialize the management data");
+    return false;
+  }
 
   if (!priv_create_datastore_directory(destination_base_path)) {
     std::stringstream ss;
@@ -1034,6 +1489,31 @@ bool manager_kernel<st, sst, cn, cs>::priv_snapshot(
     return false;
   }
 
+  if (!priv_snapshot_management_data(destination_base_path,
+                                     num_max_copy_threads)) {
+    return false;
+  }
+
+  // Finally, mark it as properly-closed
+  if (!priv_mark_properly_closed(destination_base_path)) {
+    logger::out(logger::level::error, __FILE__, __LINE__,
+                "Failed to create a properly closed mark");
+    return false;
+  }
+
+  // The next delta snapshot is taken from this snapshot
+  if constexpr (tracks_changes<segment_storage>::value) {
+    if (!m_segment_storage.read_only()) {
+      return priv_set_last_snapshot(destination_base_path);
+    }
+  }
+
+  return true;
+}
+
+template <typename st, typename sst, typename cn, std::size_t cs>
+bool manager_kernel<st, sst, cn, cs>::priv_snapshot_management_data(
+    const path_type &destination_base_path, const int num_max_copy_threads) {
   // Copy management directory
   const auto src_mng_dir =
       storage::get_path(m_base_path, k_management_dir_name);
@@ -1059,19 +1539,111 @@ bool manager_kernel<st, sst, cn, cs>::priv_snapshot(
   json_store meta_data;
   if (!priv_set_uuid(&meta_data)) return false;
   if (!priv_set_version(&meta_data)) return false;
+  if (!priv_set_large_size_class(&meta_data)) return false;
   if (!priv_write_management_metadata(destination_base_path, meta_data))
     return false;
 
-  // Finally, mark it as properly-closed
-  if (!priv_mark_properly_closed(destination_base_path)) {
+  return true;
+}
+
+template <typename st, typename sst, typename cn, std::size_t cs>
+bool manager_kernel<st, sst, cn, cs>::priv_set_last_snapshot(
+    const path_type &snapshot_base_path) {
+  const auto uuid = get_uuid(snapshot_base_path);
+  if (uuid.empty()) return false;
+
+  // Update the metadata first; if resetting the change tracking fails,
+  // the next delta snapshot just holds more data.
+  mdtl::ptree::erase(k_manager_metadata_key_for_last_snapshot_path,
+                     m_manager_metadata.get());
+  mdtl::ptree::erase(k_manager_metadata_key_for_last_snapshot_uuid,
+                     m_manager_metadata.get());
+  if (!mdtl::ptree::add_value(
+          k_manager_metadata_key_for_last_snapshot_path,
+          std::filesystem::absolute(snapshot_base_path).string(),
+          m_manager_metadata.get()) ||
+      !mdtl::ptree::add_value(k_manager_metadata_key_for_last_snapshot_uuid,
+                              uuid, m_manager_metadata.get()) ||
+      !priv_write_management_metadata(m_base_path, *m_manager_metadata)) {
     logger::out(logger::level::error, __FILE__, __LINE__,
-                "Failed to create a properly closed mark");
+                "Failed to record the last snapshot");
+    return false;
+  }
+
+  if (!m_segment_storage.reset_change_tracking()) {
+    logger::out(logger::level::error, __FILE__, __LINE__,
+                "Failed to reset the change tracking");
+    return false;
+  }
+
+  return true;
+}
+
+template <typename st, typename sst, typename cn, std::size_t cs>
+bool manager_kernel<st, sst, cn, cs>::priv_get_snapshot_chain(
+    const path_type &base_path, const std::string &uuid,
+    std::vector<path_type> *chain) {
+  path_type path = base_path;
+  std::string expected_uuid = uuid;
+  while (true) {
+    if (get_uuid(path) != expected_uuid) {
+      std::stringstream ss;
+      ss << "Snapshot has been removed or replaced: " << path;
+      logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+      return false;
+    }
+    if (std::find(chain->begin(), chain->end(), path) != chain->end()) {
+      std::stringstream ss;
+      ss << "Snapshot refers to itself: " << path;
+      logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+      return false;
+    }
+    chain->push_back(path);
+
+    if (!mdtl::file_exist(
+            storage::get_path(path, k_delta_snapshot_manifest_file_name))) {
+      break;  // Reached a full snapshot
+    }
+    std::string parent_path;
+    if (!priv_read_delta_snapshot_manifest(path, &parent_path,
+                                           &expected_uuid)) {
+      return false;
+    }
+    path = parent_path;
+  }
+
+  if (!consistent(path)) {
+    std::stringstream ss;
+    ss << "Snapshot is not consistent: " << path;
+    logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
     return false;
   }
 
   return true;
 }
 
+template <typename st, typename sst, typename cn, std::size_t cs>
+bool manager_kernel<st, sst, cn, cs>::priv_read_delta_snapshot_manifest(
+    const path_type &base_path, std::string *parent_path,
+    std::string *parent_uuid) {
+  json_store manifest;
+  if (!mdtl::ptree::read_json(
+          storage::get_path(base_path, k_delta_snapshot_manifest_file_name),
+          &manifest) ||
+      !mdtl::ptree::get_value(manifest,
+                              k_delta_snapshot_manifest_key_for_parent_path,
+                              parent_path) ||
+      !mdtl::ptree::get_value(manifest,
+                              k_delta_snapshot_manifest_key_for_parent_uuid,
+                              parent_uuid)) {
+    std::stringstream ss;
+    ss << "Failed to read the delta snapshot manifest of " << base_path;
+    logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
+    return false;
+  }
+  return true;
+}
+
 // ---------- File operations ---------- //
 template <typename st, typename sst, typename cn, std::size_t cs>
 bool manager_kernel<st, sst, cn, cs>::priv_copy_data_store(
@@ -1189,6 +1761,47 @@ bool manager_kernel<st, sst, cn, cs>::priv_set_version(
   return true;
 }
 
+template <typename st, typename sst, typename cn, std::size_t cs>
+std::string manager_kernel<st, sst, cn, cs>::priv_get_large_size_class(
+    const json_store &metadata_json) {
+  // Datastores created before the name was recorded do not have the key
+  if (mdtl::ptree::count(metadata_json,
+                         k_manager_metadata_key_for_large_size_class) == 0) {
+    return object_size_manager_detail::k_legacy_large_size_class_name;
+  }
+
+  std::string name;
+  if (!mdtl::ptree::get_value(metadata_json,
+                              k_manager_metadata_key_for_large_size_class,
+                              &name)) {
+    return object_size_manager_detail::k_legacy_large_size_class_name;
+  }
+  return name;
+}
+
+template <typename st, typename sst, typename cn, std::size_t cs>
+bool manager_kernel<st, sst, cn, cs>::priv_check_large_size_class(
+    const json_store &metadata_json) {
+  return priv_get_large_size_class(metadata_json) ==
+         object_size_manager_detail::k_large_size_class_name;
+}
+
+template <typename st, typename sst, typename cn, std::size_t cs>
+bool manager_kernel<st, sst, cn, cs>::priv_set_large_size_class(
+    json_store *metadata_json) {
+  if (mdtl::ptree::count(*metadata_json,
+                         k_manager_metadata_key_for_large_size_class) > 0) {
+    logger::out(logger::level::error, __FILE__, __LINE__,
+                "Large size class information already exist");
+    return false;
+  }
+
+  return mdtl::ptree::add_value(
+      k_manager_metadata_key_for_large_size_class,
+      std::string(object_size_manager_detail::k_large_size_class_name),
+      metadata_json);
+}
+
 template <typename st, typename sst, typename cn, std::size_t cs>
 std::string manager_kernel<st, sst, cn, cs>::priv_get_uuid(
     const json_store &metadata_json) {
@@ -153,6 +153,23 @@ class multilayer_bitset {
     return false;
   }
 
+  /// \brief Uses memory given by the caller as the multi-layer table instead
+  /// of allocating one. The caller keeps the ownership of the memory; thus,
+  /// free() must not be called.
+  /// \param size The number of bits this bitset holds.
+  /// Must be larger than block_size().
+  /// \param table The table, which must be able to hold
+  /// num_serialized_blocks(size) blocks.
+  /// \param initialize If true, all bits are set to false.
+  void attach(const std::size_t size, uint64_t *const table,
+              const bool initialize) {
+    assert(block_size() < size);
+    m_data.array = table;
+    if (initialize) {
+      std::fill(&m_data.array[0], &m_data.array[num_all_blocks(size)], 0);
+    }
+  }
+
   /// \brief Users have to explicitly free bitset table
   /// \param size The number of bits this bitset holds.
   void free(const std::size_t size) {
@@ -256,6 +273,37 @@ class multilayer_bitset {
     return true;
   }
 
+  /// \brief Returns the number of blocks the binary serialization uses.
+  /// \param size The number of bits this bitset holds.
+  /// \return The number of 64-bit blocks.
+  static std::size_t num_serialized_blocks(const std::size_t size) {
+    return (size <= block_size()) ? 1 : num_all_blocks(size);
+  }
+
+  /// \brief Serializes the internal data in binary.
+  /// \param size The number of bits this bitset holds.
+  /// \param buf A buffer to write to.
+  /// Must be able to hold num_serialized_blocks(size) blocks.
+  void serialize(const std::size_t size, uint64_t *const buf) const {
+    if (size <= block_size()) {
+      buf[0] = static_cast<uint64_t>(m_data.block);
+    } else {
+      std::copy(&m_data.array[0], &m_data.array[num_all_blocks(size)], buf);
+    }
+  }
+
+  /// \brief Deserializes binary data.
+  /// \param size The number of bits this bitset holds.
+  /// \param buf Data written by the binary serialize().
+  /// Must hold num_serialized_blocks(size) blocks.
+  void deserialize(const std::size_t size, const uint64_t *const buf) {
+    if (size <= block_size()) {
+      m_data.block = static_cast<block_type>(buf[0]);
+    } else {
+      std::copy(&buf[0], &buf[num_all_blocks(size)], &m_data.array[0]);
+    }
+  }
+
  private:
   // -------------------- //
   // Private methods
@@ -475,7 +523,7 @@ class multilayer_bitset {
     return bs::empty_block(block) ? 0 : mdtl::clzll(~block);
   }
 
-  std::size_t num_all_blocks(const std::size_t size) const {
+  static std::size_t num_all_blocks(const std::size_t size) {
     const std::size_t idx = mdtl::log2_dynamic(mdtl::next_power_of_2(size));
     std::size_t num_blocks = 0;
     assert(idx < mlbs::k_num_layers_table.size());
@@ -14,6 +14,9 @@
 #include <memory>
 #include <sstream>
 #include <limits>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 
 #include <metall/detail/proc.hpp>
 #include <metall/detail/hash.hpp>
@@ -159,6 +162,7 @@ class free_blocks_list {
   free_blocks_list(const cache_block_type *uninit_top, std::size_t num_blocks)
       : m_blocks(nullptr),
         m_uninit_top(uninit_top),
+        m_first_block(uninit_top),
         m_last_block(uninit_top + num_blocks - 1) {
     assert(uninit_top);
     assert(num_blocks > 0);
@@ -193,10 +197,10 @@ class free_blocks_list {
     m_blocks = block;
   }
 
+  // Makes all blocks available again
   void clear() {
     m_blocks = nullptr;
-    m_uninit_top = nullptr;
-    m_last_block = nullptr;
+    m_uninit_top = m_first_block;
   }
 
  private:
@@ -204,6 +208,7 @@ class free_blocks_list {
   const cache_block_type *m_blocks;
   // The top block of the uninitialized blocks.
   const cache_block_type *m_uninit_top;
+  const cache_block_type *m_first_block;
   const cache_block_type *m_last_block;
 };
 
@@ -382,6 +387,112 @@ inline constexpr std::size_t comp_num_blocks_per_cache(
          cache_block_type::k_capacity;
 }
 
+#ifdef METALL_ENABLE_THREAD_LOCAL_OBJECT_CACHE
+/// A magazine is a small per-thread cache that holds object offsets of every
+/// bin. It is accessed only by its owner thread without any lock, except when
+/// the object cache is cleared.
+template <typename difference_type, typename bin_no_type,
+          std::size_t max_bin_no>
+struct magazine {
+  static constexpr unsigned int k_capacity = 16;
+
+  unsigned int size[max_bin_no + 1] = {};
+  difference_type objects[max_bin_no + 1][k_capacity];
+  // True if the owner thread has exited.
+  // The magazine is handed over to the next thread that needs one.
+  bool orphaned{false};
+};
+
+// The maximum number of objects a magazine holds for the bin.
+// Does not hold more than a page per bin.
+template <typename difference_type, typename bin_no_manager,
+          typename magazine_type>
+inline constexpr unsigned int comp_magazine_capacity(
+    const typename bin_no_manager::bin_no_type bin_no) noexcept {
+  const auto object_size = bin_no_manager::to_object_size(bin_no);
+  return std::max(std::min((unsigned int)(4096 / object_size),
+                           magazine_type::k_capacity),
+                  (unsigned int)(1));
+}
+
+/// A magazine pool holds all magazines of an object cache.
+/// It is shared by the object cache and the threads that use the cache so that
+/// it outlives both of them.
+template <typename magazine_type>
+struct magazine_pool {
+  std::mutex mutex;
+  // False once the object cache has been destroyed.
+  bool alive{true};
+  std::vector<std::unique_ptr<magazine_type>> magazines;
+};
+
+/// A per-thread table of the magazines the thread owns, one per object cache.
+/// When the thread exits, its magazines are marked as orphaned.
+template <typename magazine_type>
+class magazine_table {
+ public:
+  using pool_type = magazine_pool<magazine_type>;
+
+  magazine_table() = default;
+  magazine_table(const magazine_table &) = delete;
+  magazine_table &operator=(const magazine_table &) = delete;
+
+  ~magazine_table() noexcept {
+    for (auto &entry : m_entries) {
+      std::lock_guard<std::mutex> guard(entry.pool->mutex);
+      if (entry.pool->alive) {
+        entry.magazine->orphaned = true;
+      }
+    }
+  }
+
+  inline magazine_type *find(const std::uint64_t cache_id) noexcept {
+    if (m_last_cache_id == cache_id) {
+      return m_last_magazine;
+    }
+    for (const auto &entry : m_entries) {
+      if (entry.cache_id == cache_id) {
+        m_last_cache_id = cache_id;
+        m_last_magazine = entry.magazine;
+        return entry.magazine;
+      }
+    }
+    return nullptr;
+  }
+
+  void add(const std::uint64_t cache_id, std::shared_ptr<pool_type> pool,
+           magazine_type *const magazine) {
+    // Drop the entries of destroyed object caches
+    for (auto itr = m_entries.begin(); itr != m_entries.end();) {
+      std::unique_lock<std::mutex> lock(itr->pool->mutex);
+      const bool alive = itr->pool->alive;
+      lock.unlock();
+      itr = alive ? itr + 1 : m_entries.erase(itr);
+    }
+    m_entries.push_back(entry_type{cache_id, std::move(pool), magazine});
+    m_last_cache_id = cache_id;
+    m_last_magazine = magazine;
+  }
+
+ private:
+  struct entry_type {
+    std::uint64_t cache_id;
+    std::shared_ptr<pool_type> pool;
+    magazine_type *magazine;
+  };
+
+  // Cache IDs start from 1
+  std::uint64_t m_last_cache_id{0};
+  magazine_type *m_last_magazine{nullptr};
+  std::vector<entry_type> m_entries;
+};
+
+inline std::uint64_t generate_cache_id() noexcept {
+  static std::atomic_uint64_t counter{0};
+  return ++counter;
+}
+#endif
+
 }  // namespace obcdetail
 
 /// A cache for small objects.
@@ -390,6 +501,10 @@ inline constexpr std::size_t comp_num_blocks_per_cache(
 /// cache push and pop objects using a LIFO policy. When the cache is full
 /// (exceeds a pre-defined threshold), it deallocates some oldest objects first
 /// before caching new ones.
+/// If METALL_ENABLE_THREAD_LOCAL_OBJECT_CACHE is defined, each thread also has
+/// a small cache (magazine) in front of the per-CPU caches. Pop and push
+/// operations are done to the magazine without taking any lock, and only its
+/// underflow and overflow go to the per-CPU caches in batches.
 template <typename _size_type, typename _difference_type,
           typename _bin_no_manager, typename _object_allocator_type>
 class object_cache {
@@ -404,6 +519,11 @@ class object_cache {
   using object_deallocate_func_type = void (object_allocator_type::*const)(
       const bin_no_type, const size_type, const difference_type *const);
 
+  /// The offset the allocate function stores for an object that could not be
+  /// allocated, and pop() returns on error.
+  static constexpr difference_type k_null_offset =
+      std::numeric_limits<difference_type>::max();
+
  private:
   static constexpr unsigned int k_num_caches_per_cpu =
 #ifdef METALL_DISABLE_CONCURRENCY
@@ -446,6 +566,13 @@ class object_cache {
                                  k_num_blocks_per_cache>;
   using cache_block_type = typename cache_storage_type::cacbe_block_type;
 
+#ifdef METALL_ENABLE_THREAD_LOCAL_OBJECT_CACHE
+  using magazine_type =
+      obcdetail::magazine<difference_type, bin_no_type, k_max_bin_no>;
+  using magazine_pool_type = obcdetail::magazine_pool<magazine_type>;
+  using magazine_table_type = obcdetail::magazine_table<magazine_type>;
+#endif
+
  public:
   class const_bin_iterator;
 
@@ -466,12 +593,25 @@ class object_cache {
 #ifdef METALL_ENABLE_MUTEX_IN_OBJECT_CACHE
         ,
         m_mutex(m_num_caches)
+#endif
+#ifdef METALL_ENABLE_THREAD_LOCAL_OBJECT_CACHE
+        ,
+        m_cache_id(obcdetail::generate_cache_id()),
+        m_magazine_pool(std::make_shared<magazine_pool_type>())
 #endif
   {
     priv_allocate_cache();
   }
 
+#ifdef METALL_ENABLE_THREAD_LOCAL_OBJECT_CACHE
+  ~object_cache() noexcept {
+    if (!m_magazine_pool) return;  // Moved
+    std::lock_guard<std::mutex> guard(m_magazine_pool->mutex);
+    m_magazine_pool->alive = false;
+  }
+#else
   ~object_cache() noexcept = default;
+#endif
   object_cache(const object_cache &) = default;
   object_cache(object_cache &&) noexcept = default;
   object_cache &operator=(const object_cache &) = default;
@@ -479,12 +619,18 @@ class object_cache {
 
   /// Pop an object offset from the cache.
   /// If the cache is empty, allocate objects and cache them first.
+  /// Returns k_null_offset if no object could be allocated.
   difference_type pop(const bin_no_type bin_no,
                       object_allocator_type *const allocator_instance,
                       object_allocate_func_type allocator_function,
                       object_deallocate_func_type deallocator_function) {
+#ifdef METALL_ENABLE_THREAD_LOCAL_OBJECT_CACHE
+    return priv_pop_from_magazine(bin_no, allocator_instance,
+                                  allocator_function, deallocator_function);
+#else
     return priv_pop(bin_no, allocator_instance, allocator_function,
                     deallocator_function);
+#endif
   }
 
   /// Cache an object.
@@ -493,14 +639,32 @@ class object_cache {
   bool push(const bin_no_type bin_no, const difference_type object_offset,
             object_allocator_type *const allocator_instance,
             object_deallocate_func_type deallocator_function) {
+#ifdef METALL_ENABLE_THREAD_LOCAL_OBJECT_CACHE
+    return priv_push_to_magazine(bin_no, object_offset, allocator_instance,
+                                 deallocator_function);
+#else
     return priv_push(bin_no, object_offset, allocator_instance,
                      deallocator_function);
+#endif
   }
 
   /// Clear all cached objects.
   /// Cached objects are going to be deallocated.
+  /// This function must not be called concurrently with other functions.
   void clear(object_allocator_type *const allocator_instance,
              object_deallocate_func_type deallocator_function) {
+#ifdef METALL_ENABLE_THREAD_LOCAL_OBJECT_CACHE
+    // Do not call the deallocator while holding the pool lock
+    for (auto *const magazine : priv_all_magazines()) {
+      for (bin_no_type b = 0; b <= k_max_bin_no; ++b) {
+        if (magazine->size[b] > 0) {
+          (allocator_instance->*deallocator_function)(b, magazine->size[b],
+                                                      magazine->objects[b]);
+          magazine->size[b] = 0;
+        }
+      }
+    }
+#endif
     for (size_type c = 0; c < m_num_caches; ++c) {
       auto &cache = m_cache[c];
       for (bin_no_type b = 0; b <= k_max_bin_no; ++b) {
@@ -522,6 +686,29 @@ class object_cache {
 
   inline size_type num_caches() const noexcept { return m_num_caches; }
 
+#ifdef METALL_ENABLE_THREAD_LOCAL_OBJECT_CACHE
+  /// Calls 'func(bin_no, object_offset)' for every object cached in the
+  /// per-thread caches.
+  /// This function must not be called concurrently with other functions.
+  template <typename func_type>
+  void for_each_thread_local_object(func_type func) const {
+    for (const auto *const magazine : priv_all_magazines()) {
+      for (bin_no_type b = 0; b <= k_max_bin_no; ++b) {
+        for (unsigned int i = 0; i < magazine->size[b]; ++i) {
+          func(b, magazine->objects[b][i]);
+        }
+      }
+    }
+  }
+
+  /// Returns the number of per-thread caches, including the ones that are
+  /// not owned by any thread.
+  size_type num_thread_local_caches() const {
+    std::lock_guard<std::mutex> guard(m_magazine_pool->mutex);
+    return m_magazine_pool->magazines.size();
+  }
+#endif
+
   const_bin_iterator begin(const size_type cache_no,
                            const bin_no_type bin_no) const {
     assert(cache_no < m_num_caches);
@@ -618,7 +805,15 @@ class object_cache {
 #ifdef METALL_ENABLE_MUTEX_IN_OBJECT_CACHE
     lock_guard_type guard(m_mutex[cache_no]);
 #endif
+    return priv_pop_without_lock(cache_no, bin_no, allocator_instance,
+                                 allocator_function, deallocator_function);
+  }
 
+  difference_type priv_pop_without_lock(
+      const size_type cache_no, const bin_no_type bin_no,
+      object_allocator_type *const allocator_instance,
+      object_allocate_func_type allocator_function,
+      object_deallocate_func_type deallocator_function) {
     auto &cache = m_cache[cache_no];
     auto &cache_header = cache.header;
     auto &bin_header = cache.bin_headers[bin_no];
@@ -657,15 +852,25 @@ class object_cache {
         (allocator_instance->*allocator_function)(bin_no, num_new_objects,
                                                   new_block->cache);
 
+        // Do not cache the objects that could not be allocated
+        const auto num_allocated_objects = std::distance(
+            new_block->cache,
+            std::remove(new_block->cache, new_block->cache + num_new_objects,
+                        k_null_offset));
+        if (num_allocated_objects == 0) {
+          cache_header.free_blocks().push(new_block);
+          return k_null_offset;
+        }
+
         // Link the new block to the existing blocks
         new_block->link_to_older(cache_header.newest_block(),
                                  bin_header.active_block());
 
         // Update headers
         cache_header.register_new_block(new_block);
-        cache_header.total_size_byte() += new_objects_size;
+        cache_header.total_size_byte() += num_allocated_objects * object_size;
         assert(cache_header.total_size_byte() <= k_max_per_cpu_cache_size);
-        bin_header.update_active_block(new_block, num_new_objects);
+        bin_header.update_active_block(new_block, num_allocated_objects);
       }
     }
     assert(bin_header.active_block_size() > 0);
@@ -689,7 +894,15 @@ class object_cache {
 #ifdef METALL_ENABLE_MUTEX_IN_OBJECT_CACHE
     lock_guard_type guard(m_mutex[cache_no]);
 #endif
+    return priv_push_without_lock(cache_no, bin_no, object_offset,
+                                  allocator_instance, deallocator_function);
+  }
 
+  bool priv_push_without_lock(
+      const size_type cache_no, const bin_no_type bin_no,
+      const difference_type object_offset,
+      object_allocator_type *const allocator_instance,
+      object_deallocate_func_type deallocator_function) {
     auto &cache = m_cache[cache_no];
     auto &cache_header = cache.header;
     auto &bin_header = cache.bin_headers[bin_no];
@@ -725,6 +938,126 @@ class object_cache {
     return true;
   }
 
+#ifdef METALL_ENABLE_THREAD_LOCAL_OBJECT_CACHE
+  std::vector<magazine_type *> priv_all_magazines() const {
+    std::lock_guard<std::mutex> guard(m_magazine_pool->mutex);
+    std::vector<magazine_type *> magazines;
+    for (const auto &magazine : m_magazine_pool->magazines) {
+      magazines.push_back(magazine.get());
+    }
+    return magazines;
+  }
+
+  /// Returns the magazine of the calling thread.
+  /// Takes over an orphaned magazine or allocates a new one if the thread does
+  /// not have one yet.
+  magazine_type *priv_thread_local_magazine() {
+    thread_local static magazine_table_type table;
+    if (auto *const magazine = table.find(m_cache_id)) {
+      return magazine;
+    }
+
+    magazine_type *magazine = nullptr;
+    {
+      std::lock_guard<std::mutex> guard(m_magazine_pool->mutex);
+      for (auto &candidate : m_magazine_pool->magazines) {
+        if (candidate->orphaned) {
+          candidate->orphaned = false;
+          magazine = candidate.get();
+          break;
+        }
+      }
+      if (!magazine) {
+        m_magazine_pool->magazines.emplace_back(
+            std::make_unique<magazine_type>());
+        magazine = m_magazine_pool->magazines.back().get();
+      }
+    }
+    table.add(m_cache_id, m_magazine_pool, magazine);
+    return magazine;
+  }
+
+  difference_type priv_pop_from_magazine(
+      const bin_no_type bin_no, object_allocator_type *const allocator_instance,
+      object_allocate_func_type allocator_function,
+      object_deallocate_func_type deallocator_function) {
+    assert(bin_no <= max_bin_no());
+
+    auto *const magazine = priv_thread_local_magazine();
+    auto &size = magazine->size[bin_no];
+    auto *const objects = magazine->objects[bin_no];
+    if (size == 0) {
+      // Refill the magazine up to the half of its capacity
+      const auto num_refills = priv_magazine_batch_size(bin_no);
+      const auto cache_no = priv_cache_no();
+#ifdef METALL_ENABLE_MUTEX_IN_OBJECT_CACHE
+      lock_guard_type guard(m_mutex[cache_no]);
+#endif
+      unsigned int num_popped = 0;
+      for (; num_popped < num_refills; ++num_popped) {
+        const auto object_offset =
+            priv_pop_without_lock(cache_no, bin_no, allocator_instance,
+                                  allocator_function, deallocator_function);
+        if (object_offset == k_null_offset) break;
+        objects[num_popped] = object_offset;
+      }
+      // The objects popped first are used first
+      std::reverse(objects, objects + num_popped);
+      size = num_popped;
+      if (size == 0) return k_null_offset;
+    }
+
+    return objects[--size];
+  }
+
+  bool priv_push_to_magazine(const bin_no_type bin_no,
+                             const difference_type object_offset,
+                             object_allocator_type *const allocator_instance,
+                             object_deallocate_func_type deallocator_function) {
+    assert(object_offset >= 0);
+    assert(bin_no <= max_bin_no());
+
+    auto *const magazine = priv_thread_local_magazine();
+    auto &size = magazine->size[bin_no];
+    auto *const objects = magazine->objects[bin_no];
+    if (size == priv_magazine_capacity(bin_no)) {
+      // Move the oldest objects to the per-CPU cache
+      const auto num_flushes = priv_magazine_batch_size(bin_no);
+      {
+        const auto cache_no = priv_cache_no();
+#ifdef METALL_ENABLE_MUTEX_IN_OBJECT_CACHE
+        lock_guard_type guard(m_mutex[cache_no]);
+#endif
+        for (unsigned int i = 0; i < num_flushes; ++i) {
+          if (!priv_push_without_lock(cache_no, bin_no, objects[i],
+                                      allocator_instance,
+                                      deallocator_function)) {
+            return false;
+          }
+        }
+      }
+      std::copy(objects + num_flushes, objects + size, objects);
+      size -= num_flushes;
+    }
+
+    objects[size] = object_offset;
+    ++size;
+    return true;
+  }
+
+  static constexpr unsigned int priv_magazine_capacity(
+      const bin_no_type bin_no) noexcept {
+    return obcdetail::comp_magazine_capacity<difference_type, bin_no_manager,
+                                             magazine_type>(bin_no);
+  }
+
+  // The number of objects moved between a magazine and a per-CPU cache at once
+  static constexpr unsigned int priv_magazine_batch_size(
+      const bin_no_type bin_no) noexcept {
+    return std::max(priv_magazine_capacity(bin_no) / 2, (unsigned int)(1));
+  }
+#endif
+
   void priv_make_room_for_new_blocks(
       const size_type cache_no, const size_type new_objects_size,
       object_allocator_type *const allocator_instance,
@@ -768,6 +1101,10 @@ class object_cache {
   std::vector<mutex_type> m_mutex;
 #endif
   std::unique_ptr<cache_storage_type[], free_deleter> m_cache{nullptr};
+#ifdef METALL_ENABLE_THREAD_LOCAL_OBJECT_CACHE
+  std::uint64_t m_cache_id;
+  std::shared_ptr<magazine_pool_type> m_magazine_pool;
+#endif
 };
 
 /// An iterator to iterate over cached objects of the same bin.
@@ -53,10 +53,38 @@ inline constexpr uint64_t num_class2_small_sizes() noexcept {
   return num_class2_small_sizes;
 }
 
+// Large sizes are multiples of the chunk size and powers of 2.
+// If METALL_USE_QUARTER_POWER_OF_TWO_LARGE_SIZE is defined, there are four
+// sizes between two powers of 2 as well as the class2 small sizes,
+// i.e., 1, 2, 3, 4, 5, 6, 7, 8, 10, 12, 14, 16, 20, ... chunks.
+template <std::size_t k_chunk_size>
+inline constexpr std::size_t next_large_size(const std::size_t size) noexcept {
+#ifdef METALL_USE_QUARTER_POWER_OF_TWO_LARGE_SIZE
+  const std::size_t num_chunks = size / k_chunk_size;
+  if (num_chunks < 4) return size + k_chunk_size;
+  // A quarter of the largest power of 2 that is equal to or less than
+  // num_chunks
+  const std::size_t step = mdtl::next_power_of_2(num_chunks + 1) / 2 / 4;
+  return size + k_chunk_size * step;
+#else
+  return size * 2;
+#endif
+}
+
+// The name of the large size classes, which is recorded in datastores.
+// Datastores created before the name was recorded used 'power_of_two'.
+#ifdef METALL_USE_QUARTER_POWER_OF_TWO_LARGE_SIZE
+constexpr const char *k_large_size_class_name = "quarter_power_of_two";
+#else
+constexpr const char *k_large_size_class_name = "power_of_two";
+#endif
+constexpr const char *k_legacy_large_size_class_name = "power_of_two";
+
 template <std::size_t k_chunk_size, std::size_t k_max_size>
 inline constexpr uint64_t num_large_sizes() noexcept {
   uint64_t count = 0;
-  for (std::size_t size = k_chunk_size; size <= k_max_size; size *= 2) {
+  for (std::size_t size = k_chunk_size; size <= k_max_size;
+       size = next_large_size<k_chunk_size>(size)) {
     ++count;
   }
   return count;
@@ -98,7 +126,7 @@ init_size_table() noexcept {
     std::size_t size = k_chunk_size;
     for (uint64_t i = 0; i < num_large_sizes<k_chunk_size, k_max_size>(); ++i) {
       table[index] = size;
-      size *= 2;
+      size = next_large_size<k_chunk_size>(size);
       ++index;
     }
   }
@@ -121,6 +149,23 @@ inline constexpr int64_t find_in_size_table(
   return -1;  // Error
 }
 
+/// \brief Computes the index of a large size from the beginning of the large
+/// sizes without searching the size table.
+template <std::size_t k_chunk_size>
+inline constexpr int64_t large_size_index(const std::size_t size) noexcept {
+  const std::size_t num_chunks = (size + k_chunk_size - 1) / k_chunk_size;
+  if (num_chunks <= 1) return 0;
+#ifdef METALL_USE_QUARTER_POWER_OF_TWO_LARGE_SIZE
+  if (num_chunks <= 4) return static_cast<int64_t>(num_chunks - 1);
+  // (num_chunks - 1) is in [2^k, 2^(k+1)), where k >= 2
+  const int k = 63 - mdtl::clzll(num_chunks - 1);
+  const std::size_t sub_index = ((num_chunks - 1) >> (k - 2)) - 4;
+  return static_cast<int64_t>(4 + (k - 2) * 4 + sub_index);
+#else
+  return static_cast<int64_t>(64 - mdtl::clzll(num_chunks - 1));
+#endif
+}
+
 template <std::size_t k_chunk_size, std::size_t k_max_size>
 inline constexpr int64_t object_size_index(const std::size_t size) noexcept {
   if (size <= k_size_table<k_chunk_size, k_max_size>[0]) return 0;
@@ -134,6 +179,13 @@ inline constexpr int64_t object_size_index(const std::size_t size) noexcept {
     return static_cast<int64_t>(index);
   }
 
+  if (size > k_max_small_size<k_chunk_size>) {
+    if (size > k_max_size) return -1;  // Error
+    constexpr int64_t k_num_small_sizes =
+        k_num_class1_small_sizes + num_class2_small_sizes<k_chunk_size>();
+    return k_num_small_sizes + large_size_index<k_chunk_size>(size);
+  }
+
   return find_in_size_table<k_chunk_size, k_max_size>(size,
                                                       k_num_class1_small_sizes);
 }
@@ -15,6 +15,10 @@
 #include <iomanip>
 #include <limits>
 #include <set>
+#include <algorithm>
+#include <atomic>
+#include <array>
+#include <vector>
 #include <filesystem>
 
 #include <metall/kernel/bin_number_manager.hpp>
@@ -24,6 +28,7 @@
 #include <metall/detail/char_ptr_holder.hpp>
 #include <metall/detail/utilities.hpp>
 #include <metall/logger.hpp>
+#include <metall/stats.hpp>
 
 #ifndef METALL_DISABLE_CONCURRENCY
 #define METALL_ENABLE_MUTEX_IN_SEGMENT_ALLOCATOR
@@ -37,6 +42,14 @@
 #include <metall/kernel/object_cache.hpp>
 #endif
 
+#ifdef METALL_USE_NUMA
+#include <metall/detail/numa.hpp>
+#endif
+
+#ifndef METALL_DISABLE_STATS
+#include <metall/detail/sharded_counter.hpp>
+#endif
+
 namespace metall {
 namespace kernel {
 
@@ -91,6 +104,12 @@ class segment_allocator {
       chunk_directory<chunk_no_type, k_chunk_size, k_max_size>;
   using chunk_slot_no_type = typename chunk_directory_type::slot_no_type;
   static constexpr const char *k_chunk_directory_file_name = "chunk_directory";
+#ifdef METALL_ENABLE_PERSISTENT_CHUNK_DIRECTORY
+  static constexpr const char *k_chunk_directory_table_file_name =
+      "chunk_directory_table";
+  static constexpr const char *k_chunk_directory_slot_table_file_name =
+      "chunk_directory_slot_table";
+#endif
 
   // For object cache
 #ifndef METALL_DISABLE_OBJECT_CACHE
@@ -103,6 +122,57 @@ class segment_allocator {
   using lock_guard_type = mdtl::mutex_lock_guard;
 #endif
 
+  // For arenas
+#ifndef METALL_NUM_ARENAS
+#error "METALL_NUM_ARENAS must be defined"
+#endif
+  static constexpr unsigned int k_num_arenas =
+#ifdef METALL_DISABLE_CONCURRENCY
+      1;
+#else
+      METALL_NUM_ARENAS;
+#endif
+  static_assert(k_num_arenas >= 1 && k_num_arenas <= 256,
+                "The number of arenas must be in [1, 256]");
+
+  // The maximum number of empty small chunks an arena keeps for reuse.
+  // Nothing is kept if there is only one arena.
+  static constexpr std::size_t k_max_num_spare_chunks =
+      (k_num_arenas > 1) ? 4 : 0;
+
+  /// An arena holds the non-full chunk bin of the small chunks it owns and the
+  /// locks to access them. Each thread uses one of the arenas.
+  struct arena_type {
+    non_full_chunk_bin_type non_full_chunk_bin;
+    // Empty small chunks that can be reused without the global chunk lock
+    std::vector<chunk_no_type> spare_chunks;
+#ifdef METALL_ENABLE_MUTEX_IN_SEGMENT_ALLOCATOR
+    std::array<mutex_type, k_num_small_bins> bin_mutex;
+    mutex_type spare_chunks_mutex;
+#endif
+  };
+  using arena_table_type = std::array<arena_type, k_num_arenas>;
+
+#ifdef METALL_USE_NUMA
+  static_assert(METALL_NUMA_REGION_SIZE > 0 &&
+                    METALL_NUMA_REGION_SIZE % k_chunk_size == 0,
+                "METALL_NUMA_REGION_SIZE must be a multiple of the chunk size");
+  static constexpr size_type k_numa_region_num_chunks =
+      METALL_NUMA_REGION_SIZE / k_chunk_size;
+#endif
+
+  // Counters for get_stats(): the number of objects of each bin,
+  // the number of chunks of each small bin, and the number of pops and
+  // refills of the object cache
+  static constexpr std::size_t k_chunk_counter_base = bin_no_mngr::num_bins();
+  static constexpr std::size_t k_cache_pop_counter =
+      k_chunk_counter_base + k_num_small_bins;
+  static constexpr std::size_t k_cache_refill_counter = k_cache_pop_counter + 1;
+#ifndef METALL_DISABLE_STATS
+  using stats_counter_type =
+      mdtl::sharded_counter_array<k_cache_refill_counter + 1>;
+#endif
+
   // Threshold to enable the many allocation feature internally
   static constexpr std::size_t k_many_allocations_threshold = 4;
 
@@ -111,7 +181,7 @@ class segment_allocator {
   // Constructor & assign operator
   // -------------------- //
   explicit segment_allocator(segment_storage_type *segment_storage)
-      : m_non_full_chunk_bin(),
+      : m_arenas(std::make_unique<arena_table_type>()),
         m_chunk_directory(k_max_size / k_chunk_size),
         m_segment_storage(segment_storage)
 #ifndef METALL_DISABLE_OBJECT_CACHE
@@ -120,13 +190,17 @@ class segment_allocator {
 #endif
 #ifdef METALL_ENABLE_MUTEX_IN_SEGMENT_ALLOCATOR
         ,
-        m_chunk_mutex(nullptr),
-        m_bin_mutex(nullptr)
+        m_chunk_mutex(nullptr)
 #endif
   {
 #ifdef METALL_ENABLE_MUTEX_IN_SEGMENT_ALLOCATOR
     m_chunk_mutex = std::make_unique<mutex_type>();
-    m_bin_mutex = std::make_unique<std::array<mutex_type, k_num_small_bins>>();
+#endif
+#ifdef METALL_ENABLE_PERSISTENT_CHUNK_DIRECTORY
+    m_non_full_chunk_bins_ready = std::make_unique<std::atomic_bool>(true);
+#endif
+#ifndef METALL_DISABLE_STATS
+    m_stats_counter = std::make_unique<stats_counter_type>();
 #endif
   }
 
@@ -154,10 +228,34 @@ class segment_allocator {
                             ? priv_allocate_small_object(bin_no)
                             : priv_allocate_large_object(bin_no);
     assert(offset >= 0 || offset == k_null_offset);
+    if (offset != k_null_offset) priv_count(bin_no, 1);
 
     return offset;
   }
 
+  /// \brief Allocates memory space on a NUMA node.
+  /// Small objects are taken from the arena of the node bypassing the object
+  /// cache. The node is ignored unless METALL_USE_NUMA is defined.
+  /// \param nbytes A size to allocate.
+  /// \param node A NUMA node number.
+  /// \return The offset of an allocated memory.
+  /// On error, k_null_offset is returned.
+  difference_type allocate_on_node(const size_type nbytes,
+                                   const unsigned int node) {
+    const bin_no_type bin_no = bin_no_mngr::to_bin_no(nbytes);
+
+    difference_type offset;
+    if (priv_small_object_bin(bin_no)) {
+      priv_allocate_small_objects_from_arena(priv_node_arena_no(node), node,
+                                             bin_no, 1, &offset);
+    } else {
+      offset = priv_allocate_large_object(bin_no, node);
+    }
+    assert(offset >= 0 || offset == k_null_offset);
+    if (offset != k_null_offset) priv_count(bin_no, 1);
+    return offset;
+  }
+
   /// \brief Allocate nbytes bytes of uninitialized storage whose alignment is
   /// specified by alignment. Note that this function adjusts an alignment only
   /// within this segment, i.e., this function does not know the address this
@@ -206,9 +304,14 @@ class segment_allocator {
   void deallocate(const difference_type offset) {
     if (offset == k_null_offset) return;
     assert(offset >= 0);
+#ifdef METALL_ENABLE_PERSISTENT_CHUNK_DIRECTORY
+    // The counters are reset when the bins are rebuilt
+    priv_prepare_non_full_chunk_bins();
+#endif
 
     const chunk_no_type chunk_no = offset / k_chunk_size;
     const bin_no_type bin_no = m_chunk_directory.bin_no(chunk_no);
+    priv_count(bin_no, -1);
 
     if (priv_small_object_bin(bin_no)) {
       priv_deallocate_small_object(offset, bin_no);
@@ -217,6 +320,127 @@ class segment_allocator {
     }
   }
 
+  /// \brief Allocates 'num_allocates' objects of 'nbytes' bytes each.
+  /// Small objects are taken from the global bin holding the bin lock once,
+  /// without going through the object cache.
+  /// \param nbytes Size of each object.
+  /// \param num_allocates Number of objects to allocate.
+  /// \param allocated_offsets Buffer to store the offsets of the allocated
+  /// objects. Must have space for 'num_allocates' elements.
+  /// \return Returns true on success. On error, returns false, nothing is
+  /// allocated and all elements in 'allocated_offsets' are k_null_offset.
+  bool allocate_many(const size_type nbytes, const size_type num_allocates,
+                     difference_type *const allocated_offsets) {
+    if (num_allocates == 0) return true;
+    if (!allocated_offsets || nbytes > k_max_size) return false;
+
+    const bin_no_type bin_no = bin_no_mngr::to_bin_no(nbytes);
+    if (priv_small_object_bin(bin_no)) {
+      priv_allocate_small_objects_from_global(bin_no, num_allocates,
+                                              allocated_offsets);
+    } else {
+      for (size_type i = 0; i < num_allocates; ++i) {
+        allocated_offsets[i] = priv_allocate_large_object(bin_no);
+        if (allocated_offsets[i] == k_null_offset) {
+          std::fill_n(allocated_offsets + i, num_allocates - i, k_null_offset);
+          break;
+        }
+      }
+    }
+
+    const auto num_allocated = num_allocates - std::count(
+        allocated_offsets, allocated_offsets + num_allocates, k_null_offset);
+    priv_count(bin_no, num_allocated);
+    if (num_allocated == num_allocates) {
+      return true;
+    }
+
+    // Roll back
+    deallocate_many(allocated_offsets, num_allocates);
+    std::fill_n(allocated_offsets, num_allocates, k_null_offset);
+    return false;
+  }
+
+  /// \brief Deallocates many objects.
+  /// Consecutive small objects of the same size are returned to the global bin
+  /// holding the bin lock once.
+  /// \param offsets Offsets of the objects to deallocate.
+  /// k_null_offset is ignored.
+  /// \param num_deallocates Number of elements in 'offsets'.
+  void deallocate_many(const difference_type *const offsets,
+                       const size_type num_deallocates) {
+#ifdef METALL_ENABLE_PERSISTENT_CHUNK_DIRECTORY
+    priv_prepare_non_full_chunk_bins();
+#endif
+    size_type i = 0;
+    while (i < num_deallocates) {
+      if (offsets[i] == k_null_offset) {
+        ++i;
+        continue;
+      }
+      assert(offsets[i] >= 0);
+
+      const chunk_no_type chunk_no = offsets[i] / k_chunk_size;
+      const bin_no_type bin_no = m_chunk_directory.bin_no(chunk_no);
+      if (!priv_small_object_bin(bin_no)) {
+        priv_count(bin_no, -1);
+        priv_deallocate_large_object(chunk_no, bin_no);
+        ++i;
+        continue;
+      }
+
+      // Find the run of the objects in the same bin
+      size_type run_end = i + 1;
+      while (run_end < num_deallocates && offsets[run_end] != k_null_offset &&
+             m_chunk_directory.bin_no(offsets[run_end] / k_chunk_size) ==
+                 bin_no) {
+        ++run_end;
+      }
+      priv_count(bin_no, -static_cast<std::int64_t>(run_end - i));
+      priv_deallocate_small_objects_from_global(bin_no, run_end - i,
+                                                &offsets[i]);
+      i = run_end;
+    }
+  }
+
+  /// \brief Tries to change the size of an allocated object without moving it.
+  /// Only a large object can grow or shrink in place,
+  /// as long as it remains a large object.
+  /// A small object succeeds only if its size class does not change.
+  /// \param offset Offset of an allocated object.
+  /// \param nbytes New size in bytes.
+  /// \return Returns true on success; otherwise, false.
+  bool resize_in_place(const difference_type offset, const size_type nbytes) {
+    if (offset == k_null_offset || nbytes > k_max_size) return false;
+    assert(offset >= 0);
+
+    const chunk_no_type chunk_no = offset / k_chunk_size;
+    const bin_no_type bin_no = m_chunk_directory.bin_no(chunk_no);
+    const bin_no_type new_bin_no = bin_no_mngr::to_bin_no(nbytes);
+    if (new_bin_no == bin_no) {
+      return true;
+    }
+    if (priv_small_object_bin(bin_no) || priv_small_object_bin(new_bin_no)) {
+      return false;
+    }
+    if (!priv_resize_large_object(chunk_no, bin_no, new_bin_no)) {
+      return false;
+    }
+    priv_count(bin_no, -1);
+    priv_count(new_bin_no, 1);
+    return true;
+  }
+
+  /// \brief Returns the size of the size class an allocated object belongs to,
+  /// which can be larger than the size requested at allocation.
+  /// \param offset Offset of an allocated object.
+  /// \return Returns the allocated size in bytes.
+  size_type allocated_size(const difference_type offset) const {
+    assert(offset >= 0 && offset != k_null_offset);
+    const chunk_no_type chunk_no = offset / k_chunk_size;
+    return bin_no_mngr::to_object_size(m_chunk_directory.bin_no(chunk_no));
+  }
+
   /// \brief Checks if all memory is deallocated.
   /// This function is not cheap if many objects are allocated.
   /// \return Returns true if all memory is deallocated.
@@ -234,6 +458,13 @@ class segment_allocator {
         m_chunk_directory.num_used_large_chunks() == 0) {
       return true;
     }
+#else
+    // Arenas may keep empty chunks
+    if (k_max_num_spare_chunks > 0 &&
+        m_chunk_directory.get_all_marked_slots().empty() &&
+        m_chunk_directory.num_used_large_chunks() == 0) {
+      return true;
+    }
 #endif
 
     return false;
@@ -245,6 +476,43 @@ class segment_allocator {
   /// thread can increase or decrease chunk directory size at the same time.
   size_type size() const { return m_chunk_directory.size() * k_chunk_size; }
 
+  /// \brief Sets up the management data of a new segment.
+  /// Creates the chunk directory files if
+  /// METALL_ENABLE_PERSISTENT_CHUNK_DIRECTORY is defined;
+  /// otherwise, does nothing.
+  /// \param base_path A base path of the management data files.
+  /// \return Returns true on success; otherwise, false.
+  bool create([[maybe_unused]] const fs::path &base_path) {
+#ifdef METALL_ENABLE_PERSISTENT_CHUNK_DIRECTORY
+    if (!m_chunk_directory.create_persistent(
+            priv_make_file_name(base_path, k_chunk_directory_table_file_name),
+            priv_make_file_name(base_path,
+                                k_chunk_directory_slot_table_file_name))) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Failed to create chunk directory");
+      return false;
+    }
+#endif
+    return true;
+  }
+
+  /// \brief Writes back the management data that is kept in files.
+  /// Does nothing unless METALL_ENABLE_PERSISTENT_CHUNK_DIRECTORY is defined.
+  /// Objects in the object cache are still counted as allocated.
+  /// \param sync If false is specified, this function returns before finishing
+  /// the sync operation.
+  /// \return Returns true on success; otherwise, false.
+  bool sync([[maybe_unused]] const bool sync) {
+#ifdef METALL_ENABLE_PERSISTENT_CHUNK_DIRECTORY
+#ifdef METALL_ENABLE_MUTEX_IN_SEGMENT_ALLOCATOR
+    lock_guard_type chunk_guard(*m_chunk_mutex);
+#endif
+    return m_chunk_directory.sync(sync);
+#else
+    return true;
+#endif
+  }
+
   /// \brief
   /// \param base_path
   /// \return
@@ -252,8 +520,22 @@ class segment_allocator {
 #ifndef METALL_DISABLE_OBJECT_CACHE
     priv_clear_object_cache();
 #endif
+    priv_release_spare_chunks();
+
+#ifdef METALL_ENABLE_PERSISTENT_CHUNK_DIRECTORY
+    // The chunk directory is already in the files and
+    // the non-full chunk bins are rebuilt from it when needed
+    if (m_chunk_directory.persistent()) {
+      if (!m_chunk_directory.sync(true)) {
+        logger::out(logger::level::error, __FILE__, __LINE__,
+                    "Failed to sync chunk directory");
+        return false;
+      }
+      return true;
+    }
+#endif
 
-    if (!m_non_full_chunk_bin.serialize(
+    if (!priv_serialize_non_full_chunk_bins(
             priv_make_file_name(base_path, k_non_full_chunk_bin_file_name))) {
       logger::out(logger::level::error, __FILE__, __LINE__,
                   "Failed to serialize bin directory");
@@ -272,7 +554,34 @@ class segment_allocator {
   /// \param base_path
   /// \return
   bool deserialize(const fs::path &base_path) {
-    if (!m_non_full_chunk_bin.deserialize(
+#ifdef METALL_ENABLE_PERSISTENT_CHUNK_DIRECTORY
+    const auto table_path =
+        priv_make_file_name(base_path, k_chunk_directory_table_file_name);
+    const auto slot_table_path =
+        priv_make_file_name(base_path, k_chunk_directory_slot_table_file_name);
+    if (fs::exists(table_path)) {
+      if (!m_chunk_directory.open_persistent(
+              table_path, slot_table_path, m_segment_storage->read_only())) {
+        logger::out(logger::level::error, __FILE__, __LINE__,
+                    "Failed to open chunk directory");
+        return false;
+      }
+      m_non_full_chunk_bins_ready->store(false);
+      return true;
+    }
+
+    // Migrate a datastore created without the persistent chunk directory
+    if (!m_segment_storage->read_only() &&
+        !m_chunk_directory.create_persistent(table_path, slot_table_path)) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Failed to create chunk directory");
+      return false;
+    }
+#endif
+
+    // All small chunks belong to the first arena after deserialization,
+    // as arena numbers are not persisted
+    if (!m_arenas->at(0).non_full_chunk_bin.deserialize(
             priv_make_file_name(base_path, k_non_full_chunk_bin_file_name))) {
       logger::out(logger::level::error, __FILE__, __LINE__,
                   "Failed to deserialize bin directory");
@@ -284,9 +593,70 @@ class segment_allocator {
                   "Failed to deserialize chunk directory");
       return false;
     }
+    priv_recount_stats();
+
+#ifdef METALL_ENABLE_PERSISTENT_CHUNK_DIRECTORY
+    // The old files are not updated anymore
+    if (m_chunk_directory.persistent() &&
+        (!m_chunk_directory.sync(true) ||
+         !mdtl::remove_file(
+             priv_make_file_name(base_path, k_non_full_chunk_bin_file_name)) ||
+         !mdtl::remove_file(
+             priv_make_file_name(base_path, k_chunk_directory_file_name)))) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Failed to remove old chunk directory files");
+      return false;
+    }
+#endif
     return true;
   }
 
+  /// \brief Sets the statistics of the allocator to 'stats', i.e.,
+  /// the statistics of the bins, the object cache, and the segment size.
+  /// This function only reads counters and does not take any lock
+  /// (except for the first call after opening a segment if
+  /// METALL_ENABLE_PERSISTENT_CHUNK_DIRECTORY is defined).
+  /// \param stats A pointer to the object to store the statistics.
+  void get_stats(manager_stats *const stats) {
+#ifdef METALL_ENABLE_PERSISTENT_CHUNK_DIRECTORY
+    priv_prepare_non_full_chunk_bins();
+#endif
+    stats->segment_size = size();
+
+#ifndef METALL_DISABLE_STATS
+    stats->bins.clear();
+    stats->num_objects = 0;
+    stats->allocated_size = 0;
+    stats->chunk_size = 0;
+    for (std::size_t b = 0; b < bin_no_mngr::num_bins(); ++b) {
+      const auto bin_no = static_cast<bin_no_type>(b);
+      const auto object_size = bin_no_mngr::to_object_size(bin_no);
+      const auto num_objects = priv_load_counter(bin_no);
+      const auto num_chunks =
+          priv_small_object_bin(bin_no)
+              ? priv_load_counter(k_chunk_counter_base + bin_no)
+              : num_objects * ((object_size + k_chunk_size - 1) / k_chunk_size);
+      if (num_objects == 0 && num_chunks == 0) continue;
+
+      stats->bins.push_back({object_size, num_objects, num_chunks});
+      stats->num_objects += num_objects;
+      stats->allocated_size += num_objects * object_size;
+      stats->chunk_size += num_chunks * k_chunk_size;
+    }
+    stats->fragmentation_ratio =
+        (stats->chunk_size > 0)
+            ? 1.0 - static_cast<double>(std::min(stats->allocated_size,
+                                                 stats->chunk_size)) /
+                        static_cast<double>(stats->chunk_size)
+            : 0.0;
+
+    const auto num_pops = priv_load_counter(k_cache_pop_counter);
+    const auto num_refills = priv_load_counter(k_cache_refill_counter);
+    stats->cache_hits = (num_pops > num_refills) ? num_pops - num_refills : 0;
+    stats->cache_misses = num_refills;
+#endif
+  }
+
   /// \brief
   /// \tparam out_stream_type
   /// \param log_out
@@ -295,6 +665,9 @@ class segment_allocator {
 #ifndef METALL_DISABLE_OBJECT_CACHE
     priv_clear_object_cache();
 #endif
+#ifdef METALL_ENABLE_PERSISTENT_CHUNK_DIRECTORY
+    priv_prepare_non_full_chunk_bins();
+#endif
 
     std::vector<size_type> num_used_chunks_per_bin(bin_no_mngr::num_bins(), 0);
 
@@ -346,8 +719,12 @@ class segment_allocator {
                << "\n";
     for (size_type bin_no = 0; bin_no < bin_no_mngr::num_small_bins();
          ++bin_no) {
-      size_type num_non_full_chunks = std::distance(
-          m_non_full_chunk_bin.begin(bin_no), m_non_full_chunk_bin.end(bin_no));
+      size_type num_non_full_chunks = 0;
+      for (const auto &arena : *m_arenas) {
+        num_non_full_chunks +=
+            std::distance(arena.non_full_chunk_bin.begin(bin_no),
+                          arena.non_full_chunk_bin.end(bin_no));
+      }
       (*log_out) << bin_no << "\t" << bin_no_mngr::to_object_size(bin_no)
                  << "\t" << num_non_full_chunks << "\n";
     }
@@ -366,12 +743,148 @@ class segment_allocator {
     return base_name.string() + "_" + item_name;
   }
 
+  // ---------- For arena ---------- //
+  /// \brief Returns the arena number of the calling thread.
+  /// Threads are assigned to the arenas in a round-robin manner.
+  /// If METALL_USE_NUMA is defined and there are multiple NUMA nodes,
+  /// threads use the arena of the node they run on.
+  static unsigned int priv_arena_no() {
+    if constexpr (k_num_arenas == 1) {
+      return 0;
+    }
+#ifdef METALL_USE_NUMA
+    if (mdtl::get_num_numa_nodes() > 1) {
+      return priv_node_arena_no(mdtl::get_numa_node_no());
+    }
+#endif
+    static std::atomic_uint thread_count{0};
+    thread_local static const unsigned int arena_no =
+        thread_count.fetch_add(1, std::memory_order_relaxed) % k_num_arenas;
+    return arena_no;
+  }
+
+  /// \brief Returns the arena number to allocate memory on a NUMA node.
+  static unsigned int priv_node_arena_no(
+      [[maybe_unused]] const unsigned int node) {
+#ifdef METALL_USE_NUMA
+    if (mdtl::get_num_numa_nodes() > 1) return node % k_num_arenas;
+#endif
+    return priv_arena_no();
+  }
+
+  unsigned int priv_owner_arena_no(const difference_type offset) const {
+    if constexpr (k_num_arenas == 1) {
+      return 0;
+    }
+    return m_chunk_directory.arena_no(offset / k_chunk_size);
+  }
+
+  // ---------- For NUMA ---------- //
+  /// \brief Returns the NUMA node number of the calling thread.
+  static unsigned int priv_numa_node_no() {
+#ifdef METALL_USE_NUMA
+    return mdtl::get_numa_node_no();
+#else
+    return 0;
+#endif
+  }
+
+  /// \brief Returns the NUMA node the memory at 'offset' is placed on.
+  static unsigned int priv_numa_node_of(
+      [[maybe_unused]] const difference_type offset) {
+#ifdef METALL_USE_NUMA
+    return (offset / METALL_NUMA_REGION_SIZE) % mdtl::get_num_numa_nodes();
+#else
+    return 0;
+#endif
+  }
+
+  /// \brief Returns the chunk regions of a NUMA node to place new chunks in.
+  /// Returns nullptr if there is only one node.
+  static const interleaved_chunk_regions *priv_numa_regions(
+      [[maybe_unused]] const unsigned int node) {
+#ifdef METALL_USE_NUMA
+    static const auto table = []() {
+      const unsigned int num_nodes = mdtl::get_num_numa_nodes();
+      if (num_nodes > k_num_arenas) {
+        logger::out(logger::level::warning, __FILE__, __LINE__,
+                    "The number of arenas is less than the number of NUMA "
+                    "nodes; some arenas are shared by multiple nodes");
+      }
+      std::vector<interleaved_chunk_regions> table;
+      for (unsigned int n = 0; n < num_nodes; ++n) {
+        table.push_back({k_numa_region_num_chunks, num_nodes, n});
+      }
+      return table;
+    }();
+    if (table.size() > 1) return &table[node % table.size()];
+#endif
+    return nullptr;
+  }
+
+#ifdef METALL_ENABLE_PERSISTENT_CHUNK_DIRECTORY
+  /// \brief Rebuilds the non-full chunk bins from the chunk directory
+  /// if the chunk directory has been opened from the files.
+  /// This is deferred from deserialize() so that opening a segment does not
+  /// scan the chunk directory.
+  /// All non-full small chunks go to the first arena,
+  /// as deserialize() does with the bin file.
+  /// Must be called before the arenas or the arena numbers are accessed.
+  /// The rebuild is O(#of chunks) and holds the chunk lock, which the other
+  /// threads also need to pass this function; thus, the first allocation or
+  /// deallocation after opening, and any concurrent ones, wait for it.
+  void priv_prepare_non_full_chunk_bins() {
+    if (m_non_full_chunk_bins_ready->load(std::memory_order_acquire)) return;
+#ifdef METALL_ENABLE_MUTEX_IN_SEGMENT_ALLOCATOR
+    lock_guard_type chunk_guard(*m_chunk_mutex);
+#endif
+    if (m_non_full_chunk_bins_ready->load(std::memory_order_relaxed)) return;
+
+    m_chunk_directory.rebuild_volatile_data();
+    auto &non_full_chunk_bin = m_arenas->at(0).non_full_chunk_bin;
+    for (chunk_no_type chunk_no = 0; chunk_no < m_chunk_directory.size();
+         ++chunk_no) {
+      if (m_chunk_directory.unused_chunk(chunk_no)) continue;
+      const bin_no_type bin_no = m_chunk_directory.bin_no(chunk_no);
+      if (priv_small_object_bin(bin_no) &&
+          !m_chunk_directory.all_slots_marked(chunk_no)) {
+        non_full_chunk_bin.insert(bin_no, chunk_no);
+      }
+    }
+    priv_recount_stats();
+    m_non_full_chunk_bins_ready->store(true, std::memory_order_release);
+  }
+#endif
+
+  /// \brief Writes the non-full chunk bins of all arenas into a single file
+  /// so that the file format does not depend on the number of arenas.
+  bool priv_serialize_non_full_chunk_bins(const fs::path &path) const {
+    if constexpr (k_num_arenas == 1) {
+      return m_arenas->at(0).non_full_chunk_bin.serialize(path);
+    }
+
+    non_full_chunk_bin_type merged_bin;
+    for (const auto &arena : *m_arenas) {
+      for (bin_no_type b = 0; b < k_num_small_bins; ++b) {
+        for (auto itr = arena.non_full_chunk_bin.begin(b),
+                  end = arena.non_full_chunk_bin.end(b);
+             itr != end; ++itr) {
+          merged_bin.insert(b, *itr);
+        }
+      }
+    }
+    return merged_bin.serialize(path);
+  }
+
   // ---------- For allocation ---------- //
   difference_type priv_allocate_small_object(const bin_no_type bin_no) {
 #ifndef METALL_DISABLE_OBJECT_CACHE
+    static_assert(small_object_cache_type::k_null_offset == k_null_offset,
+                  "The object cache must use the same null offset");
     if (bin_no <= m_object_cache.max_bin_no()) {
+      priv_count(k_cache_pop_counter, 1);
       const auto offset = m_object_cache.pop(
-          bin_no, this, &myself::priv_allocate_small_objects_from_global,
+          bin_no, this, &myself::priv_refill_object_cache,
           &myself::priv_deallocate_small_objects_from_global);
       assert(offset >= 0 || offset == k_null_offset);
       return offset;
@@ -385,39 +898,56 @@ class segment_allocator {
   void priv_allocate_small_objects_from_global(
       const bin_no_type bin_no, const size_type num_allocates,
       difference_type *const allocated_offsets) {
+    priv_allocate_small_objects_from_arena(priv_arena_no(),
+                                           priv_numa_node_no(), bin_no,
+                                           num_allocates, allocated_offsets);
+  }
+
+  /// \brief Allocates small objects from an arena.
+  /// New chunks are placed on 'node' if METALL_USE_NUMA is defined.
+  void priv_allocate_small_objects_from_arena(
+      const unsigned int arena_no, const unsigned int node,
+      const bin_no_type bin_no, const size_type num_allocates,
+      difference_type *const allocated_offsets) {
+#ifdef METALL_ENABLE_PERSISTENT_CHUNK_DIRECTORY
+    priv_prepare_non_full_chunk_bins();
+#endif
 #ifdef METALL_ENABLE_MUTEX_IN_SEGMENT_ALLOCATOR
-    lock_guard_type bin_guard(m_bin_mutex->at(bin_no));
+    lock_guard_type bin_guard(m_arenas->at(arena_no).bin_mutex[bin_no]);
 #endif
 
     if (num_allocates >= k_many_allocations_threshold) {
       priv_allocate_many_small_objects_from_global_without_bin_lock(
-          bin_no, num_allocates, allocated_offsets);
+          arena_no, node, bin_no, num_allocates, allocated_offsets);
     } else {
       for (size_type i = 0; i < num_allocates; ++i) {
         allocated_offsets[i] =
-            priv_allocate_small_object_from_global_without_bin_lock(bin_no);
+            priv_allocate_small_object_from_global_without_bin_lock(
+                arena_no, node, bin_no);
       }
     }
   }
 
   difference_type priv_allocate_small_object_from_global_without_bin_lock(
+      const unsigned int arena_no, const unsigned int node,
       const bin_no_type bin_no) {
     const size_type object_size = bin_no_mngr::to_object_size(bin_no);
+    auto &non_full_chunk_bin = m_arenas->at(arena_no).non_full_chunk_bin;
 
-    if (m_non_full_chunk_bin.empty(bin_no) &&
-        !priv_insert_new_small_object_chunk(bin_no)) {
+    if (non_full_chunk_bin.empty(bin_no) &&
+        !priv_insert_new_small_object_chunk(arena_no, node, bin_no)) {
       return k_null_offset;
     }
 
-    assert(!m_non_full_chunk_bin.empty(bin_no));
-    const chunk_no_type chunk_no = m_non_full_chunk_bin.front(bin_no);
+    assert(!non_full_chunk_bin.empty(bin_no));
+    const chunk_no_type chunk_no = non_full_chunk_bin.front(bin_no);
 
     assert(!m_chunk_directory.all_slots_marked(chunk_no));
     const chunk_slot_no_type chunk_slot_no =
         m_chunk_directory.find_and_mark_slot(chunk_no);
 
     if (m_chunk_directory.all_slots_marked(chunk_no)) {
-      m_non_full_chunk_bin.pop(bin_no);
+      non_full_chunk_bin.pop(bin_no);
     }
     const difference_type offset =
         k_chunk_size * chunk_no + object_size * chunk_slot_no;
@@ -426,22 +956,24 @@ class segment_allocator {
   }
 
   void priv_allocate_many_small_objects_from_global_without_bin_lock(
+      const unsigned int arena_no, const unsigned int node,
       const bin_no_type bin_no, const size_type num_requested_allocates,
       difference_type *const allocated_offsets) {
     if (num_requested_allocates == 0) return;  // Not error, just no work.
     if (!allocated_offsets) return;
+    auto &non_full_chunk_bin = m_arenas->at(arena_no).non_full_chunk_bin;
 
     std::fill_n(allocated_offsets, num_requested_allocates, k_null_offset);
 
     std::size_t cnt_allocations = 0;
     while (cnt_allocations < num_requested_allocates) {
-      if (m_non_full_chunk_bin.empty(bin_no) &&
-          !priv_insert_new_small_object_chunk(bin_no)) {
+      if (non_full_chunk_bin.empty(bin_no) &&
+          !priv_insert_new_small_object_chunk(arena_no, node, bin_no)) {
         return;
       }
 
-      assert(!m_non_full_chunk_bin.empty(bin_no));
-      const chunk_no_type chunk_no = m_non_full_chunk_bin.front(bin_no);
+      assert(!non_full_chunk_bin.empty(bin_no));
+      const chunk_no_type chunk_no = non_full_chunk_bin.front(bin_no);
       assert(!m_chunk_directory.all_slots_marked(chunk_no));
 
       const std::size_t num_to_allocate =
@@ -456,7 +988,7 @@ class segment_allocator {
       }
 
       if (m_chunk_directory.all_slots_marked(chunk_no)) {
-        m_non_full_chunk_bin.pop(bin_no);
+        non_full_chunk_bin.pop(bin_no);
       }
 
       const size_type object_size = bin_no_mngr::to_object_size(bin_no);
@@ -469,24 +1001,67 @@ class segment_allocator {
     assert(cnt_allocations == num_requested_allocates);
   }
 
-  bool priv_insert_new_small_object_chunk(const bin_no_type bin_no) {
+  bool priv_insert_new_small_object_chunk(const unsigned int arena_no,
+                                          const unsigned int node,
+                                          const bin_no_type bin_no) {
+    auto &arena = m_arenas->at(arena_no);
+    if (priv_reuse_spare_chunk(arena, bin_no)) {
+      return true;
+    }
+
     chunk_no_type new_chunk_no;
 #ifdef METALL_ENABLE_MUTEX_IN_SEGMENT_ALLOCATOR
     lock_guard_type chunk_guard(*m_chunk_mutex);
 #endif
-    new_chunk_no = m_chunk_directory.insert(bin_no);
+    new_chunk_no =
+        m_chunk_directory.insert(bin_no, arena_no, priv_numa_regions(node));
     if (!priv_extend_segment_without_lock(new_chunk_no, 1)) {
       return false;
     }
-    m_non_full_chunk_bin.insert(bin_no, new_chunk_no);
+    arena.non_full_chunk_bin.insert(bin_no, new_chunk_no);
+    priv_count(k_chunk_counter_base + bin_no, 1);
+    return true;
+  }
+
+  bool priv_reuse_spare_chunk(arena_type &arena, const bin_no_type bin_no) {
+    if constexpr (k_max_num_spare_chunks == 0) {
+      return false;
+    }
+
+    chunk_no_type chunk_no;
+    {
+#ifdef METALL_ENABLE_MUTEX_IN_SEGMENT_ALLOCATOR
+      lock_guard_type spare_guard(arena.spare_chunks_mutex);
+#endif
+      if (arena.spare_chunks.empty()) {
+        return false;
+      }
+      chunk_no = arena.spare_chunks.back();
+      arena.spare_chunks.pop_back();
+    }
+
+    const bin_no_type old_bin_no = m_chunk_directory.bin_no(chunk_no);
+    if (!m_chunk_directory.reassign_small_chunk(chunk_no, bin_no)) {
+      // Give up the chunk
+      priv_erase_small_chunk(chunk_no);
+      return false;
+    }
+    arena.non_full_chunk_bin.insert(bin_no, chunk_no);
+    priv_count(k_chunk_counter_base + old_bin_no, -1);
+    priv_count(k_chunk_counter_base + bin_no, 1);
     return true;
   }
 
-  difference_type priv_allocate_large_object(const bin_no_type bin_no) {
+  difference_type priv_allocate_large_object(
+      const bin_no_type bin_no, const unsigned int node = priv_numa_node_no()) {
+#ifdef METALL_ENABLE_PERSISTENT_CHUNK_DIRECTORY
+    priv_prepare_non_full_chunk_bins();
+#endif
 #ifdef METALL_ENABLE_MUTEX_IN_SEGMENT_ALLOCATOR
     lock_guard_type chunk_guard(*m_chunk_mutex);
 #endif
-    const chunk_no_type new_chunk_no = m_chunk_directory.insert(bin_no);
+    const chunk_no_type new_chunk_no =
+        m_chunk_directory.insert(bin_no, 0, priv_numa_regions(node));
     const size_type num_chunks =
         (bin_no_mngr::to_object_size(bin_no) + k_chunk_size - 1) / k_chunk_size;
     if (!priv_extend_segment_without_lock(new_chunk_no, num_chunks)) {
@@ -522,7 +1097,10 @@ class segment_allocator {
   void priv_deallocate_small_object(const difference_type offset,
                                     const bin_no_type bin_no) {
 #ifndef METALL_DISABLE_OBJECT_CACHE
-    if (bin_no <= m_object_cache.max_bin_no()) {
+    // Keeps the object cache local to the NUMA node
+    if (bin_no <= m_object_cache.max_bin_no() &&
+        (!priv_numa_regions(0) ||
+         priv_numa_node_of(offset) == priv_numa_node_no())) {
       [[maybe_unused]] const bool ret = m_object_cache.push(
           bin_no, offset, this,
           &myself::priv_deallocate_small_objects_from_global);
@@ -536,18 +1114,40 @@ class segment_allocator {
   void priv_deallocate_small_objects_from_global(
       const bin_no_type bin_no, const size_type num_deallocates,
       const difference_type offsets[]) {
+#ifdef METALL_ENABLE_PERSISTENT_CHUNK_DIRECTORY
+    priv_prepare_non_full_chunk_bins();
+#endif
+    // Objects are returned to the arenas that own their chunks.
+    // Process runs of objects in the same arena holding the bin lock once.
+    size_type i = 0;
+    while (i < num_deallocates) {
+      if (offsets[i] == k_null_offset) {
+        ++i;
+        continue;
+      }
+      const auto arena_no = priv_owner_arena_no(offsets[i]);
+      size_type run_end = i + 1;
+      while (run_end < num_deallocates &&
+             (offsets[run_end] == k_null_offset ||
+              priv_owner_arena_no(offsets[run_end]) == arena_no)) {
+        ++run_end;
+      }
+
 #ifdef METALL_ENABLE_MUTEX_IN_SEGMENT_ALLOCATOR
-    lock_guard_type bin_guard(m_bin_mutex->at(bin_no));
+      lock_guard_type bin_guard(m_arenas->at(arena_no).bin_mutex[bin_no]);
 #endif
-    for (size_type i = 0; i < num_deallocates; ++i) {
-      priv_deallocate_small_object_from_global_without_bin_lock(offsets[i],
-                                                                bin_no);
+      for (; i < run_end; ++i) {
+        priv_deallocate_small_object_from_global_without_bin_lock(
+            arena_no, offsets[i], bin_no);
+      }
     }
   }
 
   void priv_deallocate_small_object_from_global_without_bin_lock(
-      const difference_type offset, const bin_no_type bin_no) {
+      const unsigned int arena_no, const difference_type offset,
+      const bin_no_type bin_no) {
     if (offset == k_null_offset) return;
+    auto &arena = m_arenas->at(arena_no);
 
     const size_type object_size = bin_no_mngr::to_object_size(bin_no);
     const chunk_no_type chunk_no = offset / k_chunk_size;
@@ -556,18 +1156,13 @@ class segment_allocator {
     const bool was_full = m_chunk_directory.all_slots_marked(chunk_no);
     m_chunk_directory.unmark_slot(chunk_no, slot_no);
     if (was_full) {
-      m_non_full_chunk_bin.insert(bin_no, chunk_no);
+      arena.non_full_chunk_bin.insert(bin_no, chunk_no);
     } else if (m_chunk_directory.all_slots_unmarked(chunk_no)) {
       // All slots in the chunk are not used, deallocate it
-      {
-#ifdef METALL_ENABLE_MUTEX_IN_SEGMENT_ALLOCATOR
-        lock_guard_type chunk_guard(*m_chunk_mutex);
-#endif
-        m_chunk_directory.erase(chunk_no);
-        priv_free_chunk(chunk_no, 1);
+      arena.non_full_chunk_bin.erase(bin_no, chunk_no);
+      if (!priv_keep_spare_chunk(arena, chunk_no)) {
+        priv_erase_small_chunk(chunk_no);
       }
-      m_non_full_chunk_bin.erase(bin_no, chunk_no);
-
       return;
     }
 
@@ -577,6 +1172,48 @@ class segment_allocator {
 #endif
   }
 
+  /// \brief Keeps an empty small chunk in the arena for reuse.
+  /// The memory of the chunk is not freed until the chunk is given back to the
+  /// chunk directory, as freeing it requires the global chunk lock.
+  /// \return Returns false if the arena already has enough spare chunks.
+  bool priv_keep_spare_chunk(arena_type &arena, const chunk_no_type chunk_no) {
+    if constexpr (k_max_num_spare_chunks == 0) {
+      return false;
+    }
+    {
+#ifdef METALL_ENABLE_MUTEX_IN_SEGMENT_ALLOCATOR
+      lock_guard_type spare_guard(arena.spare_chunks_mutex);
+#endif
+      if (arena.spare_chunks.size() >= k_max_num_spare_chunks) {
+        return false;
+      }
+      arena.spare_chunks.push_back(chunk_no);
+    }
+    return true;
+  }
+
+  void priv_erase_small_chunk(const chunk_no_type chunk_no) {
+#ifdef METALL_ENABLE_MUTEX_IN_SEGMENT_ALLOCATOR
+    lock_guard_type chunk_guard(*m_chunk_mutex);
+#endif
+    priv_count(k_chunk_counter_base + m_chunk_directory.bin_no(chunk_no), -1);
+    m_chunk_directory.erase(chunk_no);
+    priv_free_chunk(chunk_no, 1);
+  }
+
+  /// \brief Gives all spare chunks back to the chunk directory.
+  void priv_release_spare_chunks() {
+    for (auto &arena : *m_arenas) {
+#ifdef METALL_ENABLE_MUTEX_IN_SEGMENT_ALLOCATOR
+      lock_guard_type spare_guard(arena.spare_chunks_mutex);
+#endif
+      for (const auto chunk_no : arena.spare_chunks) {
+        priv_erase_small_chunk(chunk_no);
+      }
+      arena.spare_chunks.clear();
+    }
+  }
+
   void priv_free_slot_without_bin_lock(const size_type object_size,
                                        const chunk_no_type chunk_no,
                                        const chunk_slot_no_type slot_no,
@@ -640,6 +1277,9 @@ class segment_allocator {
 
   void priv_deallocate_large_object(const chunk_no_type chunk_no,
                                     const bin_no_type bin_no) {
+#ifdef METALL_ENABLE_PERSISTENT_CHUNK_DIRECTORY
+    priv_prepare_non_full_chunk_bins();
+#endif
 #ifdef METALL_ENABLE_MUTEX_IN_SEGMENT_ALLOCATOR
     lock_guard_type chunk_guard(*m_chunk_mutex);
 #endif
@@ -649,6 +1289,39 @@ class segment_allocator {
     priv_free_chunk(chunk_no, num_chunks);
   }
 
+  bool priv_resize_large_object(const chunk_no_type chunk_no,
+                                const bin_no_type bin_no,
+                                const bin_no_type new_bin_no) {
+#ifdef METALL_ENABLE_PERSISTENT_CHUNK_DIRECTORY
+    priv_prepare_non_full_chunk_bins();
+#endif
+#ifdef METALL_ENABLE_MUTEX_IN_SEGMENT_ALLOCATOR
+    lock_guard_type chunk_guard(*m_chunk_mutex);
+#endif
+    const size_type num_chunks =
+        (bin_no_mngr::to_object_size(bin_no) + k_chunk_size - 1) / k_chunk_size;
+    const size_type new_num_chunks =
+        (bin_no_mngr::to_object_size(new_bin_no) + k_chunk_size - 1) /
+        k_chunk_size;
+
+    if (!m_chunk_directory.resize_large_chunk(chunk_no, new_bin_no)) {
+      return false;
+    }
+
+    if (new_num_chunks > num_chunks) {
+      if (!priv_extend_segment_without_lock(chunk_no, new_num_chunks)) {
+        // Failed to extend the segment (fatal error)
+        // Roll back just in case
+        m_chunk_directory.resize_large_chunk(chunk_no, bin_no);
+        return false;
+      }
+    } else if (new_num_chunks < num_chunks) {
+      priv_free_chunk(chunk_no + new_num_chunks, num_chunks - new_num_chunks);
+    }
+
+    return true;
+  }
+
   void priv_free_chunk(const chunk_no_type head_chunk_no,
                        const size_type num_chunks) {
     const off_t offset = head_chunk_no * k_chunk_size;
@@ -659,6 +1332,15 @@ class segment_allocator {
 
   // ---------- For object cache ---------- //
 #ifndef METALL_DISABLE_OBJECT_CACHE
+  /// \brief Allocates objects to refill the object cache.
+  void priv_refill_object_cache(const bin_no_type bin_no,
+                                const size_type num_allocates,
+                                difference_type *const allocated_offsets) {
+    priv_count(k_cache_refill_counter, 1);
+    priv_allocate_small_objects_from_global(bin_no, num_allocates,
+                                            allocated_offsets);
+  }
+
   void priv_clear_object_cache() {
     m_object_cache.clear(this,
                          &myself::priv_deallocate_small_objects_from_global);
@@ -694,14 +1376,65 @@ class segment_allocator {
       }
     }
 
+#ifdef METALL_ENABLE_THREAD_LOCAL_OBJECT_CACHE
+    bool all_found = true;
+    m_object_cache.for_each_thread_local_object(
+        [&small_allocs, &all_found](const bin_no_type,
+                                    const difference_type offset) {
+          all_found &= (small_allocs.erase(offset) == 1);
+        });
+    if (!all_found) {
+      return false;
+    }
+#endif
+
     return small_allocs.empty();
   }
 #endif
 
+  // ---------- For stats ---------- //
+  void priv_count([[maybe_unused]] const std::size_t counter_no,
+                  [[maybe_unused]] const std::int64_t value) {
+#ifndef METALL_DISABLE_STATS
+    m_stats_counter->add(counter_no, value);
+#endif
+  }
+
+#ifndef METALL_DISABLE_STATS
+  std::size_t priv_load_counter(const std::size_t counter_no) const {
+    // Can be negative transiently
+    return std::max<std::int64_t>(m_stats_counter->load(counter_no), 0);
+  }
+#endif
+
+  /// \brief Counts the objects and the chunks in the chunk directory
+  /// again, e.g., after opening a segment.
+  void priv_recount_stats() {
+#ifndef METALL_DISABLE_STATS
+    m_stats_counter->clear();
+    for (chunk_no_type chunk_no = 0; chunk_no < m_chunk_directory.size();) {
+      if (m_chunk_directory.unused_chunk(chunk_no)) {
+        ++chunk_no;
+        continue;
+      }
+      const bin_no_type bin_no = m_chunk_directory.bin_no(chunk_no);
+      if (priv_small_object_bin(bin_no)) {
+        priv_count(bin_no, m_chunk_directory.occupied_slots(chunk_no));
+        priv_count(k_chunk_counter_base + bin_no, 1);
+        ++chunk_no;
+      } else {
+        priv_count(bin_no, 1);
+        chunk_no += (bin_no_mngr::to_object_size(bin_no) + k_chunk_size - 1) /
+                    k_chunk_size;
+      }
+    }
+#endif
+  }
+
   // -------------------- //
   // Private fields
   // -------------------- //
-  non_full_chunk_bin_type m_non_full_chunk_bin;
+  std::unique_ptr<arena_table_type> m_arenas{nullptr};
   chunk_directory_type m_chunk_directory;
   segment_storage_type *m_segment_storage{nullptr};
 
@@ -711,8 +1444,16 @@ class segment_allocator {
 
 #ifdef METALL_ENABLE_MUTEX_IN_SEGMENT_ALLOCATOR
   std::unique_ptr<mutex_type> m_chunk_mutex{nullptr};
-  std::unique_ptr<std::array<mutex_type, k_num_small_bins>> m_bin_mutex{
-      nullptr};
+#endif
+
+#ifdef METALL_ENABLE_PERSISTENT_CHUNK_DIRECTORY
+  // False until the non-full chunk bins are rebuilt after opening
+  // the persistent chunk directory
+  std::unique_ptr<std::atomic_bool> m_non_full_chunk_bins_ready{nullptr};
+#endif
+
+#ifndef METALL_DISABLE_STATS
+  std::unique_ptr<stats_counter_type> m_stats_counter{nullptr};
 #endif
 };
 
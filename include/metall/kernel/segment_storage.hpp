@@ -12,15 +12,30 @@
 #include <thread>
 #include <atomic>
 #include <memory>
+#include <vector>
+#include <algorithm>
+#include <future>
+#include <cstring>
 
 #include "metall/defs.hpp"
 #include "metall/detail/file.hpp"
 #include "metall/detail/file_clone.hpp"
+#include "metall/detail/binary_file.hpp"
 #include "metall/detail/mmap.hpp"
 #include "metall/detail/utilities.hpp"
 #include "metall/logger.hpp"
+#include "metall/tags.hpp"
 #include "metall/kernel/storage.hpp"
 #include "metall/kernel/segment_header.hpp"
+#include "metall/kernel/background_block_copier.hpp"
+
+#ifdef METALL_USE_SOFT_DIRTY_FLUSH
+#include "metall/detail/soft_dirty_page.hpp"
+#endif
+
+#ifdef METALL_USE_NUMA
+#include "metall/detail/numa.hpp"
+#endif
 
 namespace metall::kernel {
 
@@ -38,6 +53,33 @@ class segment_storage {
   // TODO: check block size is a multiple of page size
   static constexpr std::size_t k_block_size = METALL_SEGMENT_BLOCK_SIZE;
 
+  // Files for the block change tracking and delta snapshots.
+  // Both are binary files that have one byte per block:
+  // the change state of the block and whether a delta snapshot holds the
+  // block, respectively.
+  static constexpr const char *k_block_change_states_file_name =
+      "block_change_states";
+  static constexpr const char *k_block_change_states_file_magic = "MTLLBCHG";
+  static constexpr const char *k_delta_block_list_file_name =
+      "delta_block_list";
+  static constexpr const char *k_delta_block_list_file_magic = "MTLLDBLK";
+  static constexpr uint64_t k_binary_file_version = 1;
+
+  // A binary file that has no data; the number of records in its header is
+  // the number of blocks so that the block files do not have to be looked
+  // for one by one at open.
+  static constexpr const char *k_num_blocks_file_name = "num_blocks";
+  static constexpr const char *k_num_blocks_file_magic = "MTLLNBLK";
+
+  /// \brief Whether a block has changed since the change tracking was reset.
+  enum class block_change_state : uint8_t {
+    unchanged = 0,
+    changed = 1,
+    // The block may have changed, e.g., the soft-dirty bits are not available.
+    // Its contents are compared with the previous snapshot.
+    unknown = 2
+  };
+
  public:
   using path_type = storage::path_type;
   using segment_header_type = segment_header;
@@ -51,6 +93,9 @@ class segment_storage {
     if (!priv_set_system_page_size()) {
       priv_set_broken_status();
     }
+#ifdef METALL_USE_HUGE_PAGES
+    priv_set_huge_page_size();
+#endif
   }
 
   ~segment_storage() {
@@ -82,12 +127,27 @@ class segment_storage {
         m_top_path(other.m_top_path),
         m_read_only(other.m_read_only),
         m_free_file_space(other.m_free_file_space),
-        m_block_fd_list(std::move(other.m_block_fd_list))
+        m_block_fd_list(std::move(other.m_block_fd_list)),
+        m_background_copier(std::move(other.m_background_copier)),
+        m_prefetch_tasks(std::move(other.m_prefetch_tasks)),
+        m_max_num_blocks(other.m_max_num_blocks),
+        m_block_change_states(std::move(other.m_block_change_states))
 #ifdef METALL_USE_ANONYMOUS_NEW_MAP
         ,
         m_anonymous_map_flag_list(other.m_anonymous_map_flag_list)
+#endif
+#ifdef METALL_USE_SOFT_DIRTY_FLUSH
+        ,
+        m_soft_dirty_flush(other.m_soft_dirty_flush)
+#endif
+#ifdef METALL_USE_HUGE_PAGES
+        ,
+        m_huge_page_size(other.m_huge_page_size)
 #endif
   {
+#ifdef METALL_USE_SOFT_DIRTY_FLUSH
+    other.m_soft_dirty_flush = false;
+#endif
     other.priv_set_broken_status();
   }
 
@@ -103,8 +163,19 @@ class segment_storage {
     m_read_only = other.m_read_only;
     m_free_file_space = other.m_free_file_space;
     m_block_fd_list = std::move(other.m_block_fd_list);
+    m_background_copier = std::move(other.m_background_copier);
+    m_prefetch_tasks = std::move(other.m_prefetch_tasks);
+    m_max_num_blocks = other.m_max_num_blocks;
+    m_block_change_states = std::move(other.m_block_change_states);
 #ifdef METALL_USE_ANONYMOUS_NEW_MAP
     m_anonymous_map_flag_list = std::move(other.m_anonymous_map_flag_list);
+#endif
+#ifdef METALL_USE_SOFT_DIRTY_FLUSH
+    m_soft_dirty_flush = other.m_soft_dirty_flush;
+    other.m_soft_dirty_flush = false;
+#endif
+#ifdef METALL_USE_HUGE_PAGES
+    m_huge_page_size = other.m_huge_page_size;
 #endif
     other.priv_set_broken_status();
     return (*this);
@@ -174,6 +245,31 @@ class segment_storage {
         offset, nbytes);  // Failing this operation is not a critical error
   }
 
+  /// \brief Gives advice about the access pattern of a region to the kernel,
+  /// i.e., madvise(2) on the region and posix_fadvise(2) on the block files.
+  /// \param offset An offset to the region from the beginning of the segment.
+  /// \param nbytes The size of the region.
+  /// The part beyond the current segment is ignored.
+  /// \param pattern The access pattern.
+  /// \return Returns true if the advice is given; otherwise, false.
+  bool advise(const std::ptrdiff_t offset, const std::size_t nbytes,
+              const access_pattern pattern) const {
+    return priv_advise(offset, nbytes, pattern);
+  }
+
+  /// \brief Reads the pages of a region in the background so that
+  /// accessing the region later does not wait for page faults.
+  /// The segment is not closed until the read finishes.
+  /// \param offset An offset to the region from the beginning of the segment.
+  /// \param nbytes The size of the region.
+  /// The part beyond the current segment is ignored.
+  /// \return Returns an object of std::shared_future.
+  /// If succeeded, its get() returns true; other false.
+  std::shared_future<bool> prefetch_async(const std::ptrdiff_t offset,
+                                          const std::size_t nbytes) {
+    return priv_prefetch_async(offset, nbytes);
+  }
+
   /// \brief Takes a snapshot of the segment.
   /// \param snapshot_path A path to a snapshot.
   /// \param clone If true, uses clone (reflink) for copying files.
@@ -187,6 +283,120 @@ class segment_storage {
                      max_num_threads);
   }
 
+  /// \brief Takes a snapshot of the segment in the background.
+  /// The blocks are write-protected until they are copied so that
+  /// the snapshot holds the data at the time this function is called.
+  /// A write to a block that has not been copied waits until the block is
+  /// copied. The application can keep using the segment.
+  /// sync(), free_region(), and release() wait for the copy as needed.
+  /// \param snapshot_path A path to a snapshot.
+  /// \param clone If true, uses clone (reflink) for copying files.
+  /// \param max_num_threads The maximum number of threads to use.
+  /// If <= 0 is given, the value is automatically determined.
+  /// \return Returns an object of std::shared_future.
+  /// If succeeded, its get() returns true; other false.
+  /// Returns an invalid object if it fails to start copying.
+  std::shared_future<bool> snapshot_async(const path_type &snapshot_path,
+                                          const bool clone,
+                                          const int max_num_threads) {
+    if (!is_open()) return {};
+    // Only one snapshot at a time
+    priv_wait_background_copy();
+
+    const auto dst_top_path = priv_top_dir_path(snapshot_path);
+    if (!mdtl::directory_exist(dst_top_path) &&
+        !mdtl::create_directory(dst_top_path)) {
+      std::string s("Cannot create a directory: " + dst_top_path.string());
+      logger::out(logger::level::error, __FILE__, __LINE__, s.c_str());
+      return {};
+    }
+
+#ifdef METALL_USE_ANONYMOUS_NEW_MAP
+    // Anonymous maps have to be written back to the files before copying
+    for (std::size_t block_no = 0; block_no < m_block_fd_list.size();
+         ++block_no) {
+      if (m_anonymous_map_flag_list[block_no] &&
+          !priv_sync_anonymous_map(block_no)) {
+        return {};
+      }
+    }
+#endif
+
+    std::vector<path_type> source_paths;
+    std::vector<path_type> destination_paths;
+    for (std::size_t block_no = 0; block_no < m_block_fd_list.size();
+         ++block_no) {
+      source_paths.emplace_back(priv_block_file_path(m_top_path, block_no));
+      destination_paths.emplace_back(
+          priv_block_file_path(dst_top_path, block_no));
+    }
+
+    priv_write_num_blocks(dst_top_path, m_block_fd_list.size());
+    m_background_copier = background_block_copier::start(
+        m_segment, k_block_size, std::move(source_paths),
+        std::move(destination_paths), clone, max_num_threads, !m_read_only);
+    if (!m_background_copier) return {};
+    return m_background_copier->result();
+  }
+
+  /// \brief Takes a delta snapshot of the segment.
+  /// A delta snapshot holds only the blocks that have changed since the last
+  /// reset_change_tracking() call, and the other blocks are read from the
+  /// parent snapshots.
+  /// A block that may have changed is copied only if its contents differ from
+  /// the block in the parent snapshots.
+  /// \param snapshot_path A path to a snapshot.
+  /// \param parent_paths Paths to the parent snapshot and its ancestors,
+  /// from the parent to the full snapshot at the root.
+  /// The parent must be the snapshot taken when the change tracking was last
+  /// reset.
+  /// \param clone If true, uses clone (reflink) for copying files.
+  /// \param max_num_threads The maximum number of threads to use.
+  /// If <= 0 is given, the value is automatically determined.
+  /// \return Return true if success; otherwise, false.
+  bool snapshot_delta(const path_type &snapshot_path,
+                      const std::vector<path_type> &parent_paths,
+                      const bool clone, const int max_num_threads) {
+    if (!is_open() || !sync(true)) return false;
+
+    std::vector<path_type> parent_top_paths;
+    for (const auto &path : parent_paths) {
+      parent_top_paths.emplace_back(priv_top_dir_path(path));
+    }
+    return priv_snapshot_delta(priv_top_dir_path(snapshot_path),
+                               parent_top_paths, clone, max_num_threads);
+  }
+
+  /// \brief Marks all blocks as unchanged.
+  /// Called after taking a snapshot to track the blocks changed since then.
+  /// \return Return true if success; otherwise, false.
+  bool reset_change_tracking() {
+    if (!is_open() || m_read_only) return false;
+    for (std::size_t block_no = 0; block_no < m_num_blocks; ++block_no) {
+      m_block_change_states[block_no].store(block_change_state::unchanged);
+    }
+    return priv_write_block_change_states();
+  }
+
+  /// \brief Builds a full segment from a delta snapshot.
+  /// \param snapshot_paths Paths to a delta snapshot and its ancestors,
+  /// from the delta snapshot to the full snapshot at the root.
+  /// \param destination_path A destination path.
+  /// \param clone If true, uses clone (reflink) for copying files.
+  /// \param max_num_threads The maximum number of threads to use.
+  /// If <= 0 is given, the value is automatically determined.
+  /// \return Return true if success; otherwise, false.
+  static bool materialize(const std::vector<path_type> &snapshot_paths,
+                          const path_type &destination_path, const bool clone,
+                          const int max_num_threads) {
+    std::vector<path_type> top_paths;
+    for (const auto &path : snapshot_paths) {
+      top_paths.emplace_back(priv_top_dir_path(path));
+    }
+    return priv_materialize(top_paths, priv_top_dir_path(destination_path),
+                            clone, max_num_threads);
+  }
+
   /// \brief Returns the address of the segment.
   /// \return The address of the segment.
   void *get_segment() const { return m_segment; }
@@ -209,7 +419,14 @@ class segment_storage {
 
   /// \brief Returns the underlying page size.
   /// \return The page size of the system.
-  std::size_t page_size() const { return m_system_page_size; }
+  /// If huge pages are used, returns the huge page size instead
+  /// so that the segment is freed without splitting huge pages.
+  std::size_t page_size() const {
+#ifdef METALL_USE_HUGE_PAGES
+    if (m_huge_page_size > 0) return m_huge_page_size;
+#endif
+    return m_system_page_size;
+  }
 
   /// \brief Checks if the segment is read only.
   /// \return Returns true if the segment is read only; otherwise, returns
@@ -242,18 +459,50 @@ class segment_storage {
     return mdtl::file_exist(file_name);
   }
 
-  static std::size_t priv_get_size(const path_type &top_path) {
-    int block_no = 0;
-    std::size_t total_file_size = 0;
-    while (true) {
-      const auto file_name = priv_block_file_path(top_path, block_no);
-      if (!mdtl::file_exist(file_name)) {
-        break;
-      }
-      total_file_size += mdtl::get_file_size(file_name);
-      ++block_no;
+  /// \brief Returns the number of blocks.
+  /// Uses the number in the file if it matches the block files;
+  /// otherwise, e.g., the segment was written by an older version,
+  /// looks for the block files one by one.
+  static std::size_t priv_get_num_blocks(const path_type &top_path) {
+    std::size_t num_blocks = 0;
+    if (priv_read_num_blocks(top_path, &num_blocks) && num_blocks > 0 &&
+        mdtl::file_exist(priv_block_file_path(top_path, num_blocks - 1)) &&
+        !mdtl::file_exist(priv_block_file_path(top_path, num_blocks))) {
+      return num_blocks;
+    }
+
+    num_blocks = 0;
+    while (mdtl::file_exist(priv_block_file_path(top_path, num_blocks))) {
+      ++num_blocks;
+    }
+    return num_blocks;
+  }
+
+  static bool priv_read_num_blocks(const path_type &top_path,
+                                   std::size_t *const num_blocks) {
+    const auto path = top_path / k_num_blocks_file_name;
+    if (!mdtl::file_exist(path)) return false;
+    mdtl::binary_file::reader reader(path, k_num_blocks_file_magic,
+                                     k_binary_file_version);
+    if (!reader.good()) return false;
+    *num_blocks = reader.num_records();
+    return true;
+  }
+
+  /// \brief Records the number of blocks.
+  /// Failing this operation is not a critical error as the number is checked
+  /// at open.
+  static bool priv_write_num_blocks(const path_type &top_path,
+                                    const std::size_t num_blocks) {
+    const auto path = top_path / k_num_blocks_file_name;
+    mdtl::binary_file::writer writer(path, k_num_blocks_file_magic,
+                                     k_binary_file_version);
+    if (!writer.good() || !writer.close(num_blocks)) {
+      std::string s("Failed to write a file: " + path.string());
+      logger::out(logger::level::warning, __FILE__, __LINE__, s.c_str());
+      return false;
     }
-    return total_file_size;
+    return true;
   }
 
   std::size_t priv_aligment() const {
@@ -268,6 +517,8 @@ class segment_storage {
     m_vm_region = nullptr;
     m_segment = nullptr;
     m_segment_header = nullptr;
+    m_max_num_blocks = 0;
+    m_block_change_states.reset();
     // m_read_only must not be modified here.
   }
 
@@ -410,6 +661,7 @@ class segment_storage {
 
     m_top_path = top_path;
     m_read_only = false;
+    priv_init_block_change_states(block_change_state::changed);
 
     // Create the first block so that we can assume that there is a block always
     // in a segment.
@@ -419,6 +671,7 @@ class segment_storage {
     }
     m_current_segment_size = k_block_size;
     m_num_blocks = 1;
+    priv_write_num_blocks(m_top_path, m_num_blocks);
 
     if (!priv_test_file_space_free(top_path)) {
       std::string s("Failed to test file space free: " + top_path.string());
@@ -428,6 +681,10 @@ class segment_storage {
       return false;
     }
 
+#ifdef METALL_USE_SOFT_DIRTY_FLUSH
+    priv_init_soft_dirty_flush();
+#endif
+
     return true;
   }
 
@@ -442,10 +699,18 @@ class segment_storage {
       logger::out(logger::level::info, __FILE__, __LINE__, s.c_str());
     }
 
+    const auto num_blocks = priv_get_num_blocks(top_path);
+    if (num_blocks == 0) {
+      std::string s("No block file in " + top_path.string());
+      logger::out(logger::level::error, __FILE__, __LINE__, s.c_str());
+      priv_set_broken_status();
+      return false;
+    }
+
     const auto header_size =
         mdtl::round_up(sizeof(segment_header_type), int64_t(priv_aligment()));
     const auto vm_size =
-        header_size + ((read_only) ? priv_get_size(top_path) : capacity);
+        header_size + ((read_only) ? num_blocks * k_block_size : capacity);
     if (!priv_reserve_vm(vm_size)) {
       priv_set_broken_status();
       return false;
@@ -456,42 +721,17 @@ class segment_storage {
     m_top_path = top_path;
     m_read_only = read_only;
 
-    // Maps block files one by one
-    m_num_blocks = 0;
-    while (true) {
-      const auto file_name = priv_block_file_path(m_top_path, m_num_blocks);
-      if (!mdtl::file_exist(file_name)) {
-        break;  // Mapped all files
-      }
-
-      const auto file_size = mdtl::get_file_size(file_name);
-      assert(file_size % page_size() == 0);
-      if (k_block_size != (std::size_t)file_size) {
-        logger::out(logger::level::error, __FILE__, __LINE__,
-                    "File sizes are not the same");
-        priv_release_segment();
-        priv_set_broken_status();
-        return false;
-      }
-
-      const auto fd =
-          priv_map_file(file_name, k_block_size,
-                        std::ptrdiff_t(m_current_segment_size), read_only);
-      if (fd == -1) {
-        std::stringstream ss;
-        ss << "Failed to map a file " << file_name;
-        logger::out(logger::level::error, __FILE__, __LINE__, ss.str().c_str());
-        priv_release_segment();
-        priv_set_broken_status();
-        return false;
-      }
-      m_block_fd_list.emplace_back(fd);
-#ifdef METALL_USE_ANONYMOUS_NEW_MAP
-      m_anonymous_map_flag_list.push_back(false);
-#endif
-      m_current_segment_size += k_block_size;
-      ++m_num_blocks;
+    if (header_size + num_blocks * k_block_size > m_vm_region_size ||
+        !priv_map_blocks_in_parallel(num_blocks, read_only)) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Failed to map the block files");
+      priv_deallocate_segment_header();
+      priv_release_vm_region();
+      priv_set_broken_status();
+      return false;
     }
+    m_num_blocks = num_blocks;
+    m_current_segment_size = num_blocks * k_block_size;
 
     if (!read_only && !priv_test_file_space_free(m_top_path)) {
       std::string s("Failed to test file space free: " + m_top_path.string());
@@ -501,10 +741,13 @@ class segment_storage {
       return false;
     }
 
-    if (m_num_blocks == 0) {
-      priv_set_broken_status();
-      return false;
-    }
+    // The states are not used in the read-only mode
+    priv_init_block_change_states(block_change_state::unknown);
+    if (!read_only) priv_load_block_change_states();
+
+#ifdef METALL_USE_SOFT_DIRTY_FLUSH
+    if (!read_only) priv_init_soft_dirty_flush();
+#endif
 
     return true;
   }
@@ -538,10 +781,67 @@ class segment_storage {
       ++m_num_blocks;
       m_current_segment_size += k_block_size;
     }
+    priv_write_num_blocks(m_top_path, m_num_blocks);
 
     return true;
   }
 
+  /// \brief Opens and maps block files with multiple threads.
+  bool priv_map_blocks_in_parallel(const std::size_t num_blocks,
+                                   const bool read_only) {
+    m_block_fd_list.assign(num_blocks, -1);
+#ifdef METALL_USE_ANONYMOUS_NEW_MAP
+    m_anonymous_map_flag_list.assign(num_blocks, false);
+#endif
+
+    std::atomic_uint_fast64_t block_no_count = 0;
+    std::atomic_uint_fast64_t num_successes = 0;
+    auto map_blocks = [&]() {
+      while (true) {
+        const auto block_no = block_no_count.fetch_add(1);
+        if (block_no >= num_blocks) break;
+
+        const auto file_name = priv_block_file_path(m_top_path, block_no);
+        if (k_block_size != (std::size_t)mdtl::get_file_size(file_name)) {
+          std::string s("Invalid file size: " + file_name.string());
+          logger::out(logger::level::error, __FILE__, __LINE__, s.c_str());
+          continue;
+        }
+
+        const auto fd =
+            priv_map_file(file_name, k_block_size,
+                          std::ptrdiff_t(block_no * k_block_size), read_only);
+        if (fd == -1) {
+          std::string s("Failed to map a file " + file_name.string());
+          logger::out(logger::level::error, __FILE__, __LINE__, s.c_str());
+          continue;
+        }
+        m_block_fd_list[block_no] = fd;
+        num_successes.fetch_add(1);
+      }
+    };
+
+    const auto num_threads = (int)std::min(
+        num_blocks, (std::size_t)std::thread::hardware_concurrency());
+    {
+      std::stringstream ss;
+      ss << "Map " << num_blocks << " files with " << num_threads
+         << " threads";
+      logger::out(logger::level::info, __FILE__, __LINE__, ss.str().c_str());
+    }
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) threads.emplace_back(map_blocks);
+    for (auto &th : threads) th.join();
+
+    if (num_successes == num_blocks) return true;
+
+    for (const auto fd : m_block_fd_list) {
+      if (fd != -1) mdtl::os_close(fd);
+    }
+    m_block_fd_list.clear();
+    return false;
+  }
+
   bool priv_create_new_map(const path_type &top_path,
                            const std::size_t block_number,
                            const std::size_t file_size,
@@ -619,10 +919,43 @@ class segment_storage {
       }
       return -1;
     }
+#ifdef METALL_USE_HUGE_PAGES
+    // Writing back huge pages of a file on a storage device amplifies writes
+    if (m_huge_page_size > 0 && (read_only || mdtl::on_tmpfs(path))) {
+      mdtl::advise_huge_pages(map_addr, file_size);
+    }
+#endif
+#ifdef METALL_USE_NUMA
+    // The page cache of other files does not follow the memory policy
+    if (mdtl::on_tmpfs(path)) {
+      priv_bind_to_numa_nodes(segment_offset, file_size);
+    }
+#endif
 
     return ret.first;
   }
 
+#ifdef METALL_USE_NUMA
+  /// \brief Binds the regions interleaved over the NUMA nodes in
+  /// [segment_offset, segment_offset + size) to their nodes.
+  /// Region i is bound to node (i % #nodes).
+  void priv_bind_to_numa_nodes(const std::ptrdiff_t segment_offset,
+                               const std::size_t size) const {
+    const unsigned int num_nodes = mdtl::get_num_numa_nodes();
+    if (num_nodes == 1) return;
+
+    constexpr std::size_t k_region_size = METALL_NUMA_REGION_SIZE;
+    const std::size_t end = segment_offset + size;
+    for (std::size_t offset = segment_offset; offset < end;) {
+      const std::size_t region_no = offset / k_region_size;
+      const std::size_t next = std::min((region_no + 1) * k_region_size, end);
+      mdtl::bind_to_numa_node(static_cast<char *>(m_segment) + offset,
+                              next - offset, region_no % num_nodes);
+      offset = next;
+    }
+  }
+#endif
+
   int priv_map_anonymous(const path_type &path, const std::size_t region_size,
                          const std::ptrdiff_t segment_offset) const {
     assert(!path.empty());
@@ -646,6 +979,12 @@ class segment_storage {
       logger::out(logger::level::error, __FILE__, __LINE__, s.c_str());
       return -1;
     }
+#ifdef METALL_USE_HUGE_PAGES
+    if (m_huge_page_size > 0) mdtl::advise_huge_pages(map_addr, region_size);
+#endif
+#ifdef METALL_USE_NUMA
+    priv_bind_to_numa_nodes(segment_offset, region_size);
+#endif
 
     // Although we do not map the file, we still open it so that other functions
     // in this class works.
@@ -667,6 +1006,16 @@ class segment_storage {
   bool priv_release_segment() {
     if (!is_open()) return false;
 
+    priv_wait_background_copy();
+    priv_wait_prefetch();
+
+#ifdef METALL_USE_SOFT_DIRTY_FLUSH
+    if (m_soft_dirty_flush) {
+      priv_num_soft_dirty_flush_segments().fetch_sub(1);
+      m_soft_dirty_flush = false;
+    }
+#endif
+
     int succeeded = true;
     for (const auto &fd : m_block_fd_list) {
       succeeded &= mdtl::os_close(fd);
@@ -702,6 +1051,9 @@ class segment_storage {
 
     if (m_read_only) return true;
 
+    // The protection of blocks being copied must not be changed
+    priv_wait_background_copy();
+
     // Protect the region to detect unexpected write by application during msync
     if (!mdtl::mprotect_read_only(m_segment, m_current_segment_size)) {
       logger::out(logger::level::error, __FILE__, __LINE__,
@@ -716,13 +1068,23 @@ class segment_storage {
                   "Failed to msync the segment");
       return false;
     }
+#ifdef METALL_USE_SOFT_DIRTY_FLUSH
+    // Reset while the segment is still read only
+    // so that no write is lost between msync and the reset.
+    // As the reset applies to the whole process, it is skipped if another
+    // segment tracks soft-dirty pages; its dirty pages would be lost.
+    // Not resetting just makes the next flush write back more pages.
+    if (m_soft_dirty_flush && priv_num_soft_dirty_flush_segments() == 1) {
+      mdtl::reset_soft_dirty_bit();
+    }
+#endif
     if (!mdtl::mprotect_read_write(m_segment, m_current_segment_size)) {
       logger::out(logger::level::error, __FILE__, __LINE__,
                   "Failed to set the segment to readable and writable");
       return false;
     }
 
-    return true;
+    return priv_write_block_change_states();
   }
 
   bool priv_parallel_msync(const bool sync) {
@@ -735,10 +1097,20 @@ class segment_storage {
 #ifdef METALL_USE_ANONYMOUS_NEW_MAP
           assert(m_anonymous_map_flag_list.size() > block_no);
           if (m_anonymous_map_flag_list[block_no]) {
+            priv_mark_block(block_no, block_change_state::changed);
             num_successes.fetch_add(priv_sync_anonymous_map(block_no) ? 1 : 0);
             continue;
           }
 #endif
+#ifdef METALL_USE_SOFT_DIRTY_FLUSH
+          if (m_soft_dirty_flush) {
+            num_successes.fetch_add(
+                priv_msync_soft_dirty_pages(block_no, sync) ? 1 : 0);
+            continue;
+          }
+#endif
+          // Any page in the block could have been written
+          priv_mark_block(block_no, block_change_state::unknown);
           const auto map =
               static_cast<char *>(m_segment) + block_no * k_block_size;
           num_successes.fetch_add(mdtl::os_msync(map, k_block_size, sync) ? 1
@@ -769,12 +1141,92 @@ class segment_storage {
     return num_successes == m_block_fd_list.size();
   }
 
+#ifdef METALL_USE_SOFT_DIRTY_FLUSH
+  /// \brief Returns the number of open segments that use soft-dirty pages in
+  /// this process.
+  static std::atomic_int &priv_num_soft_dirty_flush_segments() {
+    static std::atomic_int count{0};
+    return count;
+  }
+
+  void priv_init_soft_dirty_flush() {
+    m_soft_dirty_flush = mdtl::soft_dirty_page_supported();
+    if (m_soft_dirty_flush &&
+        priv_num_soft_dirty_flush_segments().fetch_add(1) == 0) {
+      // New maps report all their pages as soft-dirty until the bits are
+      // reset; nothing has been written to the segment yet.
+      mdtl::reset_soft_dirty_bit();
+    }
+    std::string s("Soft-dirty page test result: ");
+    s += m_soft_dirty_flush ? "success" : "failed";
+    logger::out(logger::level::info, __FILE__, __LINE__, s.c_str());
+  }
+
+  /// \brief msyncs only the runs of soft-dirty pages in a block.
+  /// A block that has no soft-dirty page is not msynced at all.
+  /// A block that has soft-dirty pages is marked as changed.
+  bool priv_msync_soft_dirty_pages(const std::size_t block_no,
+                                   const bool sync) {
+    static constexpr std::size_t k_num_pages_per_read = 4096;
+    const std::size_t page_size = m_system_page_size;
+    const std::size_t num_pages = k_block_size / page_size;
+    char *const block_addr =
+        static_cast<char *>(m_segment) + block_no * k_block_size;
+    const uint64_t first_page_no =
+        reinterpret_cast<uint64_t>(block_addr) / page_size;
+
+    mdtl::pagemap_reader reader;
+    std::vector<uint64_t> pagemap(std::min(num_pages, k_num_pages_per_read));
+    std::size_t run_begin = num_pages;  // No run
+    for (std::size_t p = 0; p < num_pages; p += pagemap.size()) {
+      const std::size_t n = std::min(pagemap.size(), num_pages - p);
+      if (!reader.read(first_page_no + p, n, pagemap.data())) {
+        // Fall back to msync the whole block
+        priv_mark_block(block_no, block_change_state::unknown);
+        return mdtl::os_msync(block_addr, k_block_size, sync);
+      }
+      for (std::size_t i = 0; i < n; ++i) {
+        const bool dirty = mdtl::check_soft_dirty_page(pagemap[i]);
+        if (dirty && run_begin == num_pages) {
+          priv_mark_block(block_no, block_change_state::changed);
+          run_begin = p + i;
+        } else if (!dirty && run_begin != num_pages) {
+          if (!mdtl::os_msync(block_addr + run_begin * page_size,
+                              (p + i - run_begin) * page_size, sync)) {
+            return false;
+          }
+          run_begin = num_pages;
+        }
+      }
+    }
+    if (run_begin != num_pages) {
+      return mdtl::os_msync(block_addr + run_begin * page_size,
+                            (num_pages - run_begin) * page_size, sync);
+    }
+    return true;
+  }
+#endif
+
   bool priv_free_region(const std::ptrdiff_t offset,
                         const std::size_t nbytes) const {
     if (!is_open() || m_read_only) return false;
 
     if (offset + nbytes > m_current_segment_size) return false;
 
+    // Freeing pages does not raise a write fault; thus, make sure that the
+    // pages have been copied.
+    if (m_background_copier) {
+      m_background_copier->wait_for_region(offset, nbytes);
+    }
+
+    // Freeing file space changes the contents of the blocks without writes
+    if (nbytes > 0) {
+      for (std::size_t block_no = offset / k_block_size;
+           block_no <= (offset + nbytes - 1) / k_block_size; ++block_no) {
+        priv_mark_block(block_no, block_change_state::changed);
+      }
+    }
+
 #ifdef METALL_USE_ANONYMOUS_NEW_MAP
     const auto block_no = offset / k_block_size;
     assert(m_anonymous_map_flag_list.size() > block_no);
@@ -789,6 +1241,436 @@ class segment_storage {
       return priv_uncommit_pages(offset, nbytes);
   }
 
+  /// \brief Returns the size of the part of a region in the current segment.
+  std::size_t priv_clamp_to_segment(const std::ptrdiff_t offset,
+                                    const std::size_t nbytes) const {
+    if ((std::size_t)offset >= m_current_segment_size) return 0;
+    return std::min(nbytes, m_current_segment_size - offset);
+  }
+
+  bool priv_advise(const std::ptrdiff_t offset, const std::size_t region_size,
+                   const access_pattern pattern) const {
+    if (!is_open() || offset < 0) return false;
+    const auto nbytes = priv_clamp_to_segment(offset, region_size);
+    if (nbytes == 0) return true;
+
+    const int madvice = priv_madvice(pattern);
+    const int fadvice = priv_fadvice(pattern);
+    if (madvice == -1 && fadvice == -1) {
+      logger::out(logger::level::info, __FILE__, __LINE__,
+                  "The access pattern is not supported");
+      return false;
+    }
+
+    bool ret = true;
+    if (madvice != -1) {
+      const auto begin = mdtl::round_down(offset, m_system_page_size);
+      if (!mdtl::os_madvise(static_cast<char *>(m_segment) + begin,
+                            offset + nbytes - begin, madvice)) {
+        logger::perror(logger::level::warning, __FILE__, __LINE__, "madvise");
+        ret = false;
+      }
+    }
+
+    if (fadvice != -1) {
+      for (std::size_t block_no = offset / k_block_size;
+           block_no <= (offset + nbytes - 1) / k_block_size; ++block_no) {
+#ifdef METALL_USE_ANONYMOUS_NEW_MAP
+        if (m_anonymous_map_flag_list[block_no]) continue;
+#endif
+        const std::ptrdiff_t block_offset = block_no * k_block_size;
+        const auto begin = std::max(offset, block_offset);
+        const auto end = std::min<std::ptrdiff_t>(offset + nbytes,
+                                                  block_offset + k_block_size);
+        ret &= mdtl::os_fadvise(m_block_fd_list[block_no],
+                                begin - block_offset, end - begin, fadvice);
+      }
+    }
+
+    return ret;
+  }
+
+  static int priv_madvice(const access_pattern pattern) {
+    switch (pattern) {
+      case access_pattern::normal:
+        return MADV_NORMAL;
+      case access_pattern::sequential:
+        return MADV_SEQUENTIAL;
+      case access_pattern::random:
+        return MADV_RANDOM;
+      case access_pattern::willneed:
+        return MADV_WILLNEED;
+      case access_pattern::cold:
+#ifdef MADV_COLD
+        return MADV_COLD;
+#else
+        return -1;
+#endif
+    }
+    return -1;
+  }
+
+  static int priv_fadvice(const access_pattern pattern) {
+#ifdef POSIX_FADV_NORMAL
+    switch (pattern) {
+      case access_pattern::normal:
+        return POSIX_FADV_NORMAL;
+      case access_pattern::sequential:
+        return POSIX_FADV_SEQUENTIAL;
+      case access_pattern::random:
+        return POSIX_FADV_RANDOM;
+      case access_pattern::willneed:
+        return POSIX_FADV_WILLNEED;
+      case access_pattern::cold:
+        // POSIX_FADV_DONTNEED does not drop mapped pages
+        return -1;
+    }
+#endif
+    return -1;
+  }
+
+  std::shared_future<bool> priv_prefetch_async(const std::ptrdiff_t offset,
+                                               const std::size_t region_size) {
+    if (!is_open() || offset < 0) {
+      std::promise<bool> failed;
+      failed.set_value(false);
+      return failed.get_future().share();
+    }
+    const auto nbytes = priv_clamp_to_segment(offset, region_size);
+
+    // Forgets finished ones
+    m_prefetch_tasks.erase(
+        std::remove_if(m_prefetch_tasks.begin(), m_prefetch_tasks.end(),
+                       [](const std::shared_future<bool> &task) {
+                         return task.wait_for(std::chrono::seconds(0)) ==
+                                std::future_status::ready;
+                       }),
+        m_prefetch_tasks.end());
+
+    auto *const addr = static_cast<char *>(m_segment) + offset;
+    auto task = std::async(std::launch::async, [addr, nbytes]() {
+                  return mdtl::populate_read(addr, nbytes);
+                }).share();
+    m_prefetch_tasks.push_back(task);
+    return task;
+  }
+
+  void priv_wait_prefetch() {
+    for (auto &task : m_prefetch_tasks) {
+      task.wait();
+    }
+    m_prefetch_tasks.clear();
+  }
+
+  /// \brief Waits for the background copy started by snapshot_async().
+  void priv_wait_background_copy() {
+    if (m_background_copier) {
+      m_background_copier->wait();
+      m_background_copier.reset();
+    }
+  }
+
+  // -------------------- //
+  // Block change tracking and delta snapshots
+  // -------------------- //
+  /// \brief Blocks held by a snapshot.
+  struct snapshot_block_list {
+    path_type top_path;
+    bool delta{false};
+    // The i-th element is 1 if a delta snapshot holds the i-th block.
+    // The size is the number of blocks at the time of the snapshot.
+    std::vector<uint8_t> blocks;
+  };
+
+  void priv_init_block_change_states(const block_change_state state) {
+    m_max_num_blocks = m_vm_region_size / k_block_size;
+    m_block_change_states =
+        std::make_unique<std::atomic<block_change_state>[]>(m_max_num_blocks);
+    for (std::size_t block_no = 0; block_no < m_max_num_blocks; ++block_no) {
+      m_block_change_states[block_no].store(
+          (block_no < m_num_blocks) ? state : block_change_state::changed,
+          std::memory_order_relaxed);
+    }
+  }
+
+  /// \brief Marks a block as changed or unknown.
+  /// A changed block is not marked as unknown.
+  void priv_mark_block(const std::size_t block_no,
+                       const block_change_state state) const {
+    assert(block_no < m_max_num_blocks);
+    if (state == block_change_state::changed) {
+      m_block_change_states[block_no].store(state);
+    } else {
+      auto expected = block_change_state::unchanged;
+      m_block_change_states[block_no].compare_exchange_strong(expected, state);
+    }
+  }
+
+  /// \brief Loads the change states written when the segment was closed.
+  /// The file is removed so that the states are not trusted if the segment
+  /// is modified by a program that does not update them.
+  /// All blocks stay unknown if there is no valid file.
+  void priv_load_block_change_states() {
+    const auto path = m_top_path / k_block_change_states_file_name;
+    if (!mdtl::file_exist(path)) return;
+
+    std::vector<uint8_t> states;
+    if (priv_read_block_list_file(path, k_block_change_states_file_magic,
+                                  &states) &&
+        states.size() == m_num_blocks) {
+      for (std::size_t block_no = 0; block_no < m_num_blocks; ++block_no) {
+        if (states[block_no] <=
+            static_cast<uint8_t>(block_change_state::unknown)) {
+          m_block_change_states[block_no].store(
+              static_cast<block_change_state>(states[block_no]),
+              std::memory_order_relaxed);
+        }
+      }
+    }
+    if (!mdtl::remove_file(path)) {
+      std::string s("Failed to remove a file: " + path.string());
+      logger::out(logger::level::warning, __FILE__, __LINE__, s.c_str());
+    }
+  }
+
+  bool priv_write_block_change_states() const {
+    std::vector<uint8_t> states(m_num_blocks);
+    for (std::size_t block_no = 0; block_no < m_num_blocks; ++block_no) {
+      states[block_no] =
+          static_cast<uint8_t>(m_block_change_states[block_no].load());
+    }
+    return priv_write_block_list_file(
+        m_top_path / k_block_change_states_file_name,
+        k_block_change_states_file_magic, states);
+  }
+
+  /// \brief Writes a file that has one byte per block.
+  static bool priv_write_block_list_file(const path_type &path,
+                                         const char *const magic,
+                                         const std::vector<uint8_t> &values) {
+    mdtl::binary_file::writer writer(path, magic, k_binary_file_version);
+    if (!writer.good() || !writer.write(values.data(), values.size()) ||
+        !writer.pad(values.size()) || !writer.close(values.size())) {
+      std::string s("Failed to write a file: " + path.string());
+      logger::out(logger::level::error, __FILE__, __LINE__, s.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  /// \brief Reads a file written by priv_write_block_list_file().
+  static bool priv_read_block_list_file(const path_type &path,
+                                        const char *const magic,
+                                        std::vector<uint8_t> *const values) {
+    mdtl::binary_file::reader reader(path, magic, k_binary_file_version);
+    if (!reader.good() || reader.remaining() < reader.num_records()) {
+      std::string s("Invalid file: " + path.string());
+      logger::out(logger::level::error, __FILE__, __LINE__, s.c_str());
+      return false;
+    }
+    const auto *const data = reinterpret_cast<const uint8_t *>(reader.data());
+    values->assign(data, data + reader.num_records());
+    return true;
+  }
+
+  static bool priv_read_snapshot_block_lists(
+      const std::vector<path_type> &top_paths,
+      std::vector<snapshot_block_list> *lists) {
+    for (const auto &top_path : top_paths) {
+      snapshot_block_list list;
+      list.top_path = top_path;
+      const auto path = top_path / k_delta_block_list_file_name;
+      list.delta = mdtl::file_exist(path);
+      if (list.delta && !priv_read_block_list_file(
+                            path, k_delta_block_list_file_magic, &list.blocks)) {
+        return false;
+      }
+      lists->emplace_back(std::move(list));
+    }
+    return true;
+  }
+
+  /// \brief Finds the newest copy of a block in snapshots.
+  /// \param lists Snapshots from the newest to the full snapshot.
+  /// \return Returns the path to the block file.
+  /// Returns an empty path if the snapshots do not have the block.
+  static path_type priv_find_block_file(
+      const std::vector<snapshot_block_list> &lists,
+      const std::size_t block_no) {
+    for (const auto &list : lists) {
+      if (!list.delta) {
+        const auto path = priv_block_file_path(list.top_path, block_no);
+        return mdtl::file_exist(path) ? path : path_type();
+      }
+      if (block_no >= list.blocks.size()) {
+        break;  // The block did not exist when the snapshot was taken
+      }
+      if (list.blocks[block_no]) {
+        return priv_block_file_path(list.top_path, block_no);
+      }
+    }
+    return path_type();
+  }
+
+  /// \brief Checks if two block files have the same contents.
+  static bool priv_same_block_file(const path_type &path0,
+                                   const path_type &path1, bool *const same) {
+    static constexpr std::size_t k_buf_size = 1ULL << 22ULL;
+    *same = false;
+    if (mdtl::get_file_size(path0) != mdtl::get_file_size(path1)) return true;
+
+    const int fd0 = ::open(path0.c_str(), O_RDONLY);
+    const int fd1 = ::open(path1.c_str(), O_RDONLY);
+    bool succeeded = (fd0 != -1 && fd1 != -1);
+    if (succeeded) {
+      std::vector<char> buf0(k_buf_size);
+      std::vector<char> buf1(k_buf_size);
+      *same = true;
+      for (off_t offset = 0; *same; offset += k_buf_size) {
+        const auto size0 = ::pread(fd0, buf0.data(), k_buf_size, offset);
+        const auto size1 = ::pread(fd1, buf1.data(), k_buf_size, offset);
+        if (size0 == -1 || size1 == -1) {
+          logger::perror(logger::level::error, __FILE__, __LINE__, "pread");
+          succeeded = false;
+          break;
+        }
+        if (size0 != size1) {
+          *same = false;
+        } else if (size0 == 0) {
+          break;  // EOF
+        } else {
+          *same = (std::memcmp(buf0.data(), buf1.data(), size0) == 0);
+        }
+      }
+    }
+    if (fd0 != -1) mdtl::os_close(fd0);
+    if (fd1 != -1) mdtl::os_close(fd1);
+    return succeeded;
+  }
+
+  static bool priv_copy_block_file(const path_type &source_path,
+                                   const path_type &destination_path,
+                                   const bool clone) {
+    return clone ? mdtl::clone_file(source_path, destination_path)
+                 : mdtl::copy_file(source_path, destination_path);
+  }
+
+  /// \brief Calls 'func(block_no)' for each block with multiple threads.
+  /// \return Returns true if all calls return true.
+  template <typename func_type>
+  static bool priv_for_each_block_in_parallel(const std::size_t num_blocks,
+                                              const int max_num_threads,
+                                              const func_type &func) {
+    std::atomic_uint_fast64_t block_no_count = 0;
+    std::atomic_uint_fast64_t num_successes = 0;
+    const auto num_threads = std::min<std::size_t>(
+        num_blocks, max_num_threads > 0 ? max_num_threads
+                                        : std::thread::hardware_concurrency());
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < num_threads; ++i) {
+      threads.emplace_back([&]() {
+        while (true) {
+          const auto block_no = block_no_count.fetch_add(1);
+          if (block_no >= num_blocks) break;
+          num_successes.fetch_add(func(block_no) ? 1 : 0);
+        }
+      });
+    }
+    for (auto &th : threads) th.join();
+    return num_successes == num_blocks;
+  }
+
+  bool priv_snapshot_delta(const path_type &dst_top_path,
+                           const std::vector<path_type> &parent_top_paths,
+                           const bool clone, const int max_num_threads) {
+    if (!mdtl::directory_exist(dst_top_path) &&
+        !mdtl::create_directory(dst_top_path)) {
+      std::string s("Cannot create a directory: " + dst_top_path.string());
+      logger::out(logger::level::error, __FILE__, __LINE__, s.c_str());
+      return false;
+    }
+
+    std::vector<snapshot_block_list> parents;
+    if (!priv_read_snapshot_block_lists(parent_top_paths, &parents)) {
+      return false;
+    }
+
+    std::vector<uint8_t> copied(m_num_blocks, 0);
+    const bool succeeded = priv_for_each_block_in_parallel(
+        m_num_blocks, max_num_threads, [&](const std::size_t block_no) {
+          const auto src_path = priv_block_file_path(m_top_path, block_no);
+          const auto parent_path = priv_find_block_file(parents, block_no);
+          const auto state = m_block_change_states[block_no].load();
+          if (!parent_path.empty()) {
+            if (state == block_change_state::unchanged) return true;
+            if (state == block_change_state::unknown) {
+              bool same = false;
+              if (!priv_same_block_file(src_path, parent_path, &same)) {
+                return false;
+              }
+              if (same) return true;
+            }
+          }
+          copied[block_no] = 1;
+          return priv_copy_block_file(
+              src_path, priv_block_file_path(dst_top_path, block_no), clone);
+        });
+    if (!succeeded) {
+      std::string s("Failed to copy blocks to " + dst_top_path.string());
+      logger::out(logger::level::error, __FILE__, __LINE__, s.c_str());
+      return false;
+    }
+
+    {
+      std::stringstream ss;
+      ss << "Delta snapshot holds "
+         << std::count(copied.begin(), copied.end(), 1) << " of "
+         << m_num_blocks << " blocks";
+      logger::out(logger::level::info, __FILE__, __LINE__, ss.str().c_str());
+    }
+    return priv_write_block_list_file(
+        dst_top_path / k_delta_block_list_file_name,
+        k_delta_block_list_file_magic, copied);
+  }
+
+  static bool priv_materialize(const std::vector<path_type> &top_paths,
+                               const path_type &dst_top_path, const bool clone,
+                               const int max_num_threads) {
+    std::vector<snapshot_block_list> snapshots;
+    if (!priv_read_snapshot_block_lists(top_paths, &snapshots)) return false;
+    if (snapshots.empty() || !snapshots.front().delta) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "Not a delta snapshot");
+      return false;
+    }
+
+    if (!mdtl::directory_exist(dst_top_path) &&
+        !mdtl::create_directory(dst_top_path)) {
+      std::string s("Cannot create a directory: " + dst_top_path.string());
+      logger::out(logger::level::error, __FILE__, __LINE__, s.c_str());
+      return false;
+    }
+
+    const auto num_blocks = snapshots.front().blocks.size();
+    return priv_for_each_block_in_parallel(
+               num_blocks, max_num_threads,
+               [&](const std::size_t block_no) {
+                 const auto src_path =
+                     priv_find_block_file(snapshots, block_no);
+                 if (src_path.empty()) {
+                   std::string s("No snapshot has block " +
+                                 std::to_string(block_no));
+                   logger::out(logger::level::error, __FILE__, __LINE__,
+                               s.c_str());
+                   return false;
+                 }
+                 return priv_copy_block_file(
+                     src_path, priv_block_file_path(dst_top_path, block_no),
+                     clone);
+               }) &&
+           priv_write_num_blocks(dst_top_path, num_blocks);
+  }
+
   bool priv_uncommit_pages_and_free_file_space(const std::ptrdiff_t offset,
                                                const std::size_t nbytes) const {
     return mdtl::uncommit_shared_pages_and_free_file_space(
@@ -861,6 +1743,25 @@ class segment_storage {
     return true;
   }
 
+#ifdef METALL_USE_HUGE_PAGES
+  /// \brief Sets the transparent huge page size.
+  /// Huge pages are not used if the size is not available or
+  /// does not divide the block size.
+  void priv_set_huge_page_size() {
+    m_huge_page_size = mdtl::get_transparent_huge_page_size();
+    if (m_huge_page_size <= 0 || m_huge_page_size % m_system_page_size != 0 ||
+        k_block_size % m_huge_page_size != 0) {
+      std::string s("Huge pages are not used; huge page size: " +
+                    std::to_string(m_huge_page_size));
+      logger::out(logger::level::warning, __FILE__, __LINE__, s.c_str());
+      m_huge_page_size = 0;
+      return;
+    }
+    std::string s("Huge page size: " + std::to_string(m_huge_page_size));
+    logger::out(logger::level::info, __FILE__, __LINE__, s.c_str());
+  }
+#endif
+
   bool priv_test_file_space_free(const path_type &top_path) {
 #ifdef METALL_DISABLE_FREE_FILE_SPACE
     m_free_file_space = false;
@@ -932,10 +1833,21 @@ class segment_storage {
   bool m_read_only{false};
   bool m_free_file_space{true};
   std::vector<int> m_block_fd_list;
+  std::shared_ptr<background_block_copier> m_background_copier;
+  std::vector<std::shared_future<bool>> m_prefetch_tasks;
+  std::size_t m_max_num_blocks{0};
+  std::unique_ptr<std::atomic<block_change_state>[]> m_block_change_states;
   bool m_broken{false};
 #ifdef METALL_USE_ANONYMOUS_NEW_MAP
   std::vector<int> m_anonymous_map_flag_list;
 #endif
+#ifdef METALL_USE_SOFT_DIRTY_FLUSH
+  bool m_soft_dirty_flush{false};
+#endif
+#ifdef METALL_USE_HUGE_PAGES
+  // 0 if huge pages are not used
+  ssize_t m_huge_page_size{0};
+#endif
 };
 
 }  // namespace metall::kernel
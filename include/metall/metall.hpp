@@ -11,11 +11,19 @@
 #include <metall/logger.hpp>
 #include <metall/version.hpp>
 
+#include <metall/kernel/dedup_segment_storage.hpp>
+
 #if defined(METALL_USE_UMAP) && defined(METALL_USE_PRIVATEER)
 #error \
     "METALL_USE_UMAP and METALL_USE_PRIVATEER cannot be defined at the same time"
 #endif
 
+#if defined(METALL_USE_DEDUP_SEGMENT_STORAGE) && \
+    (defined(METALL_USE_UMAP) || defined(METALL_USE_PRIVATEER))
+#error \
+    "METALL_USE_DEDUP_SEGMENT_STORAGE cannot be defined with METALL_USE_UMAP or METALL_USE_PRIVATEER"
+#endif
+
 #ifdef METALL_USE_PRIVATEER
 #include <metall/ext/privateer.hpp>
 #endif
@@ -28,7 +36,15 @@
 /// \brief The top level of namespace of Metall
 namespace metall {
 
-#if !(defined(METALL_USE_PRIVATEER) || defined(METALL_USE_UMAP))
+/// \brief Metall manager class that uses the deduplicating segment storage.
+/// Pages that have the same contents are stored only once,
+/// and snapshots share the pages with the original datastore.
+using manager_dedup =
+    basic_manager<kernel::storage, kernel::dedup_segment_storage>;
+
+#ifdef METALL_USE_DEDUP_SEGMENT_STORAGE
+using manager = manager_dedup;
+#elif !(defined(METALL_USE_PRIVATEER) || defined(METALL_USE_UMAP))
 /// \brief Default Metall manager class which is an alias of basic_manager with
 /// the default template parameters.
 using manager = basic_manager<>;
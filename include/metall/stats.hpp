@@ -0,0 +1,75 @@
+// Copyright 2023 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+#ifndef METALL_STATS_HPP
+#define METALL_STATS_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace metall {
+
+/// \brief Statistics of a size class (bin) of the allocator.
+struct bin_stats {
+  /// \brief The object size of the bin in bytes.
+  std::size_t object_size{0};
+  /// \brief The number of objects allocated and not deallocated by the
+  /// application.
+  std::size_t num_objects{0};
+  /// \brief The number of chunks used by the bin,
+  /// including the chunks of the objects in the object cache.
+  std::size_t num_chunks{0};
+};
+
+/// \brief Statistics of a manager returned by basic_manager::get_stats().
+/// The counters are updated with relaxed atomic operations;
+/// values taken while other threads allocate memory are not a snapshot.
+/// If METALL_DISABLE_STATS is defined, the counters are not maintained and
+/// only the sizes are set.
+struct manager_stats {
+  /// \brief The statistics of the bins that have objects or chunks,
+  /// in ascending order of the object size.
+  std::vector<bin_stats> bins{};
+
+  /// \brief The number of objects allocated by the application.
+  std::size_t num_objects{0};
+  /// \brief The total size of the allocated objects in bytes,
+  /// counted by the object sizes of their bins.
+  std::size_t allocated_size{0};
+  /// \brief The total size of the used chunks in bytes.
+  std::size_t chunk_size{0};
+  /// \brief The ratio of the used chunks that is not occupied by the allocated
+  /// objects, i.e., 1 - allocated_size / chunk_size.
+  /// The free slots of small chunks and the objects in the object cache are
+  /// counted as fragmentation.
+  double fragmentation_ratio{0.0};
+
+  /// \brief The number of allocations served by the object cache.
+  std::uint64_t cache_hits{0};
+  /// \brief The number of times the object cache took objects from the
+  /// allocator because it did not have any.
+  std::uint64_t cache_misses{0};
+
+  /// \brief The size of the segment being used by the allocator in bytes.
+  std::size_t segment_size{0};
+  /// \brief The size of the segment region mapped from its backing files (or
+  /// memory) in bytes, i.e., the same value as basic_manager::get_size().
+  /// This is not the disk usage of the files, which can be smaller if they
+  /// are sparse.
+  std::size_t mapped_size{0};
+
+  /// \brief The number of times flush() has been called.
+  std::uint64_t num_flushes{0};
+  /// \brief The total time taken by flush() in seconds.
+  double flush_time{0.0};
+  /// \brief The total time taken to write back the segment (msync) in flush()
+  /// in seconds.
+  double msync_time{0.0};
+};
+
+}  // namespace metall
+
+#endif  // METALL_STATS_HPP
@@ -11,6 +11,7 @@
 #include <cassert>
 #include <limits>
 #include <new>
+#include <vector>
 
 #include <metall/offset_ptr.hpp>
 #include <metall/logger.hpp>
@@ -144,6 +145,24 @@ class stl_allocator {
   void destroy(const pointer &ptr) const { priv_destroy(ptr); }
 
   // ---------- This class's unique public functions ---------- //
+  /// \brief Allocates num_allocates storages of n * sizeof(T) bytes each at
+  /// once. \param n The size of each storage in number of T.
+  /// \param num_allocates The number of storages to allocate.
+  /// \param ptrs A buffer to store the pointers to the allocated storages.
+  /// Must have space for num_allocates elements.
+  void allocate_many(const size_type n, const size_type num_allocates,
+                     pointer *const ptrs) const {
+    priv_allocate_many(n, num_allocates, ptrs);
+  }
+
+  /// \brief Deallocates many storages at once.
+  /// \param ptrs Pointers to the storages.
+  /// \param num_deallocates The number of storages to deallocate.
+  void deallocate_many(const pointer *const ptrs,
+                       const size_type num_deallocates) const {
+    priv_deallocate_many(ptrs, num_deallocates);
+  }
+
   /// \brief Returns a pointer that points to manager kernel
   /// \return A pointer that points to manager kernel
   manager_kernel_type *const *get_pointer_to_manager_kernel() const {
@@ -197,6 +216,59 @@ class stl_allocator {
     manager_kernel->deallocate(to_raw_pointer(ptr));
   }
 
+  void priv_allocate_many(const size_type n, const size_type num_allocates,
+                          pointer *const ptrs) const {
+    if (priv_max_size() < n) {
+      throw std::bad_array_new_length();
+    }
+
+    if (!get_pointer_to_manager_kernel()) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "nullptr: cannot access to manager kernel");
+      throw std::bad_alloc();
+    }
+    auto *manager_kernel = *get_pointer_to_manager_kernel();
+    if (!manager_kernel) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "nullptr: cannot access to manager kernel");
+      throw std::bad_alloc();
+    }
+
+    std::vector<void *> addrs(num_allocates);
+    if (!manager_kernel->allocate_many(n * sizeof(T), num_allocates,
+                                       addrs.data())) {
+      throw std::bad_alloc();
+    }
+    for (size_type i = 0; i < num_allocates; ++i) {
+      ptrs[i] = pointer(static_cast<value_type *>(addrs[i]));
+    }
+  }
+
+  void priv_deallocate_many(const pointer *const ptrs,
+                            const size_type num_deallocates) const noexcept {
+    if (!get_pointer_to_manager_kernel()) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "nullptr: cannot access to manager kernel");
+      return;
+    }
+    auto manager_kernel = *get_pointer_to_manager_kernel();
+    if (!manager_kernel) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "nullptr: cannot access to manager kernel");
+      return;
+    }
+    try {
+      std::vector<void *> addrs(num_deallocates);
+      for (size_type i = 0; i < num_deallocates; ++i) {
+        addrs[i] = to_raw_pointer(ptrs[i]);
+      }
+      manager_kernel->deallocate_many(addrs.data(), num_deallocates);
+    } catch (...) {
+      logger::out(logger::level::error, __FILE__, __LINE__,
+                  "An exception has been thrown");
+    }
+  }
+
   size_type priv_max_size() const noexcept {
     return std::numeric_limits<size_type>::max() / sizeof(value_type);
   }
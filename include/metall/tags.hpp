@@ -6,6 +6,9 @@
 #ifndef METALL_TAGS_HPP
 #define METALL_TAGS_HPP
 
+#include <string>
+#include <vector>
+
 #include <metall/detail/char_ptr_holder.hpp>
 
 namespace metall {
@@ -30,6 +33,39 @@ struct open_read_only_t {};
 /// \brief Tag to open an already created segment as read only.
 [[maybe_unused]] static const open_read_only_t open_read_only{};
 
+/// \brief Options to populate the page tables of the application data segment
+/// (pre-fault) when a data store is opened,
+/// so that the first accesses do not wait for page faults.
+struct prefault_option {
+  /// \brief Names of the named objects to populate.
+  /// If empty, the whole segment is populated.
+  /// Only the memory allocated for each named object itself is populated;
+  /// memory the object points to, e.g., the elements of a container, is not
+  /// populated. Populate the whole segment to prefault such memory.
+  std::vector<std::string> object_names{};
+
+  /// \brief The number of threads to use.
+  /// If 0 is given, the value is automatically determined.
+  std::size_t num_threads{0};
+};
+
+/// \brief Access patterns to give to basic_manager::advise().
+enum class access_pattern {
+  /// \brief No special treatment (default).
+  normal,
+  /// \brief Accessed in sequential order;
+  /// data is read ahead aggressively.
+  sequential,
+  /// \brief Accessed in random order; read-ahead is disabled.
+  random,
+  /// \brief Accessed in the near future;
+  /// data is read ahead in the background.
+  willneed,
+  /// \brief Not accessed in the near future;
+  /// the memory is reclaimed first under memory pressure.
+  cold
+};
+
 /// \brief Tag to construct anonymous instances.
 [[maybe_unused]] static const mtlldetail::anonymous_instance_t
     *anonymous_instance = nullptr;
@@ -0,0 +1,32 @@
+// Copyright 2023 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+// Builds a full datastore from a delta snapshot taken by
+// metall::manager::snapshot_delta().
+// Usage: materialize_snapshot delta_snapshot_path destination_path
+
+#include <iostream>
+#include <filesystem>
+
+#include <metall/metall.hpp>
+
+int main(int argc, char *argv[]) {
+  if (argc != 3) {
+    std::cerr << "Usage: " << argv[0]
+              << " delta_snapshot_path destination_path" << std::endl;
+    std::abort();
+  }
+
+  const std::filesystem::path delta_snapshot_path = argv[1];
+  const std::filesystem::path destination_path = argv[2];
+
+  if (!metall::manager::materialize_snapshot(delta_snapshot_path,
+                                             destination_path)) {
+    std::cerr << "Failed to materialize " << delta_snapshot_path << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return 0;
+}
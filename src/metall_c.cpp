@@ -79,6 +79,21 @@ void metall_free(metall_manager* manager, void* ptr) {
   reinterpret_cast<metall::manager*>(manager)->deallocate(ptr);
 }
 
+bool metall_malloc_many(metall_manager* manager, size_t size, size_t n,
+                        void** ptrs) {
+  const auto ret =
+      reinterpret_cast<metall::manager*>(manager)->allocate_many(size, n, ptrs);
+  if (!ret) {
+    errno = ENOMEM;
+  }
+
+  return ret;
+}
+
+void metall_free_many(metall_manager* manager, void* const* ptrs, size_t n) {
+  reinterpret_cast<metall::manager*>(manager)->deallocate_many(ptrs, n);
+}
+
 void* metall_named_malloc(metall_manager* manager, const char* name,
                           size_t size) {
   auto* ptr = reinterpret_cast<metall::manager*>(manager)->construct<unsigned
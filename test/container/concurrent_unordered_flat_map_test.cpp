@@ -0,0 +1,191 @@
+// Copyright 2023 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+
+#include <metall/metall.hpp>
+#include <metall/container/concurrent_unordered_flat_map.hpp>
+#include "../test_utility.hpp"
+
+namespace {
+
+namespace mc = metall::container;
+
+using map_type = mc::concurrent_unordered_flat_map<
+    int, int, std::hash<int>, std::equal_to<int>,
+    std::allocator<std::pair<const int, int>>>;
+
+TEST(ConcurrentUnorderedFlatMapTest, Insert) {
+  map_type map;
+  ASSERT_TRUE(map.empty());
+
+  ASSERT_TRUE(map.insert(std::make_pair(1, 10)));
+  ASSERT_FALSE(map.insert(std::make_pair(1, 20)));  // Duplicate key
+  const std::pair<const int, int> value(2, 20);
+  ASSERT_TRUE(map.insert(value));
+  ASSERT_TRUE(map.try_emplace(3, 30));
+  ASSERT_FALSE(map.try_emplace(3, 40));
+  ASSERT_EQ(map.size(), 3);
+
+  ASSERT_EQ(map.count(1), 1);
+  ASSERT_TRUE(map.contains(3));
+  ASSERT_FALSE(map.contains(4));
+
+  int mapped = 0;
+  ASSERT_TRUE(
+      map.visit(1, [&mapped](const auto &kv) { mapped = kv.second; }));
+  ASSERT_EQ(mapped, 10);
+  ASSERT_FALSE(map.visit(4, [](const auto &) {}));
+}
+
+TEST(ConcurrentUnorderedFlatMapTest, BulkInsert) {
+  map_type map;
+  std::vector<std::pair<int, int>> values;
+  for (int i = 0; i < 1000; ++i) {
+    values.emplace_back(i % 500, i);
+  }
+  ASSERT_EQ(map.insert(values.begin(), values.end()), 500);
+  ASSERT_EQ(map.size(), 500);
+  for (int i = 0; i < 500; ++i) {
+    int mapped = -1;
+    ASSERT_TRUE(
+        map.visit(i, [&mapped](const auto &kv) { mapped = kv.second; }));
+    ASSERT_EQ(mapped, i);  // The first one is inserted
+  }
+}
+
+// Throws when a negative value is copied
+struct throw_on_copy {
+  explicit throw_on_copy(const int v) : value(v) {}
+  throw_on_copy(const throw_on_copy &other) : value(other.value) {
+    if (value < 0) throw std::runtime_error("copy");
+  }
+  throw_on_copy(throw_on_copy &&) noexcept = default;
+  int value;
+};
+
+TEST(ConcurrentUnorderedFlatMapTest, BulkInsertThrow) {
+  mc::concurrent_unordered_flat_map<
+      int, throw_on_copy, std::hash<int>, std::equal_to<int>,
+      std::allocator<std::pair<const int, throw_on_copy>>>
+      map;
+  std::vector<std::pair<int, throw_on_copy>> values;
+  for (int i = 0; i < 1000; ++i) {
+    values.emplace_back(i, throw_on_copy(i == 500 ? -1 : i));
+  }
+  ASSERT_THROW(map.insert(values.begin(), values.end()), std::runtime_error);
+
+  // The elements inserted before the exception are counted
+  std::size_t count = 0;
+  for (int i = 0; i < 1000; ++i) {
+    count += map.count(i);
+  }
+  ASSERT_GT(count, 0);
+  ASSERT_EQ(map.size(), count);
+}
+
+TEST(ConcurrentUnorderedFlatMapTest, InsertOrVisit) {
+  map_type map;
+  auto increment = [](auto &kv) { ++kv.second; };
+  ASSERT_TRUE(map.insert_or_visit(std::make_pair(1, 1), increment));
+  ASSERT_FALSE(map.insert_or_visit(std::make_pair(1, 1), increment));
+  ASSERT_FALSE(map.insert_or_visit(std::make_pair(1, 1), increment));
+
+  int mapped = 0;
+  map.visit(1, [&mapped](const auto &kv) { mapped = kv.second; });
+  ASSERT_EQ(mapped, 3);
+}
+
+TEST(ConcurrentUnorderedFlatMapTest, EraseAndClear) {
+  map_type map;
+  for (int i = 0; i < 100; ++i) {
+    map.try_emplace(i, i);
+  }
+  ASSERT_EQ(map.erase(10), 1);
+  ASSERT_EQ(map.erase(10), 0);
+  ASSERT_EQ(map.size(), 99);
+  ASSERT_FALSE(map.contains(10));
+
+  map.clear();
+  ASSERT_EQ(map.size(), 0);
+  ASSERT_FALSE(map.contains(0));
+}
+
+TEST(ConcurrentUnorderedFlatMapTest, VisitAll) {
+  map_type map;
+  for (int i = 0; i < 100; ++i) {
+    map.try_emplace(i, i);
+  }
+
+  ASSERT_EQ(map.visit_all([](auto &kv) { kv.second *= 2; }), 100);
+
+  const auto &const_map = map;
+  long sum = 0;
+  ASSERT_EQ(const_map.visit_all([&sum](const auto &kv) {
+    ASSERT_EQ(kv.second, kv.first * 2);
+    sum += kv.second;
+  }),
+            100);
+  ASSERT_EQ(sum, 99 * 100);
+}
+
+TEST(ConcurrentUnorderedFlatMapTest, ConcurrentInsert) {
+  map_type map;
+  const int num_threads = 4;
+  const int num_keys = 1 << 14;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&map]() {
+      // All threads try to insert the same keys
+      for (int i = 0; i < num_keys; ++i) {
+        map.insert_or_visit(std::make_pair(i, 1),
+                            [](auto &kv) { ++kv.second; });
+      }
+    });
+  }
+  for (auto &th : threads) {
+    th.join();
+  }
+
+  ASSERT_EQ(map.size(), num_keys);
+  map.visit_all(
+      [num_threads](const auto &kv) { ASSERT_EQ(kv.second, num_threads); });
+}
+
+TEST(ConcurrentUnorderedFlatMapTest, PersistentMap) {
+  using persistent_map_type = mc::concurrent_unordered_flat_map<int, int>;
+  const auto dir_path(test_utility::make_test_path());
+
+  {
+    metall::manager manager(metall::create_only, dir_path);
+    auto *map =
+        manager.construct<persistent_map_type>("map")(manager.get_allocator());
+    for (int i = 0; i < 1000; ++i) {
+      map->try_emplace(i, i * 2);
+    }
+  }
+
+  {
+    metall::manager manager(metall::open_only, dir_path);
+    auto *map = manager.find<persistent_map_type>("map").first;
+    ASSERT_NE(map, nullptr);
+    ASSERT_EQ(map->size(), 1000);
+    for (int i = 0; i < 1000; ++i) {
+      int mapped = -1;
+      ASSERT_TRUE(map->visit(i, [&mapped](auto &kv) { mapped = kv.second; }));
+      ASSERT_EQ(mapped, i * 2);
+    }
+    ASSERT_TRUE(map->try_emplace(1000, 0));
+    ASSERT_EQ(map->size(), 1001);
+    ASSERT_TRUE(manager.destroy_ptr(map));
+  }
+}
+}  // namespace
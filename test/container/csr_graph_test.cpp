@@ -0,0 +1,206 @@
+// Copyright 2023 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+#include "gtest/gtest.h"
+
+#include <random>
+#include <vector>
+#include <tuple>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <atomic>
+
+#include <metall/metall.hpp>
+#include <metall/container/csr_graph.hpp>
+#include "../test_utility.hpp"
+
+namespace {
+
+namespace mc = metall::container;
+
+using edge_type = std::pair<uint64_t, uint64_t>;
+
+std::vector<edge_type> gen_random_edges(const std::size_t num_vertices,
+                                        const std::size_t num_edges) {
+  std::mt19937_64 rnd(123);
+  std::vector<edge_type> edges;
+  for (std::size_t i = 0; i < num_edges; ++i) {
+    edges.emplace_back(rnd() % num_vertices, rnd() % num_vertices);
+  }
+  return edges;
+}
+
+/// \brief Checks the graph against the edges.
+template <typename graph_type>
+void check_graph(const graph_type &graph, const std::size_t num_vertices,
+                 std::vector<edge_type> edges) {
+  ASSERT_EQ(graph.num_vertices(), num_vertices);
+  ASSERT_EQ(graph.num_edges(), edges.size());
+  std::sort(edges.begin(), edges.end());
+  auto edge_itr = edges.begin();
+  for (std::size_t v = 0; v < num_vertices; ++v) {
+    ASSERT_EQ(graph.degree(v), std::distance(graph.neighbors_begin(v),
+                                             graph.neighbors_end(v)));
+    for (auto itr = graph.neighbors_begin(v); itr != graph.neighbors_end(v);
+         ++itr) {
+      ASSERT_EQ(edge_itr->first, v);
+      ASSERT_EQ(edge_itr->second, *itr);
+      ++edge_itr;
+    }
+  }
+  ASSERT_EQ(edge_itr, edges.end());
+}
+
+TEST(CSRGraphTest, Empty) {
+  mc::csr_graph<uint64_t, uint64_t, void, std::allocator<std::byte>> graph;
+  ASSERT_EQ(graph.num_vertices(), 0);
+  ASSERT_EQ(graph.num_edges(), 0);
+
+  std::vector<edge_type> edges;
+  graph.build(4, edges.begin(), edges.end());
+  ASSERT_EQ(graph.num_vertices(), 4);
+  ASSERT_EQ(graph.num_edges(), 0);
+  for (std::size_t v = 0; v < 4; ++v) {
+    ASSERT_EQ(graph.degree(v), 0);
+  }
+
+  graph.build(0, edges.begin(), edges.end());
+  ASSERT_EQ(graph.num_vertices(), 0);
+  ASSERT_EQ(graph.num_edges(), 0);
+  ASSERT_EQ(graph.offsets()[0], 0);
+}
+
+TEST(CSRGraphTest, Build) {
+  const std::size_t num_vertices = 1 << 10;
+  const auto edges = gen_random_edges(num_vertices, 1 << 18);
+  for (const std::size_t num_threads : {1, 4}) {
+    mc::csr_graph<uint64_t, uint64_t, void, std::allocator<std::byte>> graph;
+    mc::csr_graph_build_option option;
+    option.num_threads = num_threads;
+    graph.build(num_vertices, edges.begin(), edges.end(), option);
+    check_graph(graph, num_vertices, edges);
+  }
+}
+
+TEST(CSRGraphTest, BuildFromPartitions) {
+  const std::size_t num_vertices = 1 << 10;
+  const std::size_t num_partitions = 16;
+  const auto edges = gen_random_edges(num_vertices, 1 << 16);
+
+  mc::csr_graph<uint32_t, uint32_t, void, std::allocator<std::byte>> graph;
+  graph.build(num_vertices, num_partitions,
+              [&edges](const std::size_t partition_no, auto &&emit) {
+                for (std::size_t i = partition_no; i < edges.size();
+                     i += num_partitions) {
+                  emit(edges[i].first, edges[i].second);
+                }
+              });
+  check_graph(graph, num_vertices, edges);
+}
+
+TEST(CSRGraphTest, Rebuild) {
+  mc::csr_graph<uint64_t, uint64_t, void, std::allocator<std::byte>> graph;
+  const auto edges0 = gen_random_edges(1 << 8, 1 << 12);
+  graph.build(1 << 8, edges0.begin(), edges0.end());
+
+  const auto edges1 = gen_random_edges(1 << 4, 1 << 6);
+  graph.build(1 << 4, edges1.begin(), edges1.end());
+  check_graph(graph, 1 << 4, edges1);
+}
+
+TEST(CSRGraphTest, Weighted) {
+  using weighted_edge_type = std::tuple<uint64_t, uint64_t, double>;
+  const std::size_t num_vertices = 1 << 8;
+  std::vector<weighted_edge_type> edges;
+  for (const auto &[source, destination] :
+       gen_random_edges(num_vertices, 1 << 12)) {
+    edges.emplace_back(source, destination, source * 0.5 + destination);
+  }
+
+  mc::csr_graph<uint64_t, uint64_t, double, std::allocator<std::byte>> graph;
+  graph.build(num_vertices, edges.begin(), edges.end());
+  ASSERT_EQ(graph.num_edges(), edges.size());
+
+  std::sort(edges.begin(), edges.end());
+  std::size_t i = 0;
+  for (uint64_t v = 0; v < num_vertices; ++v) {
+    ASSERT_EQ(std::distance(graph.weights_begin(v), graph.weights_end(v)),
+              graph.degree(v));
+    auto weight_itr = graph.weights_begin(v);
+    for (auto itr = graph.neighbors_begin(v); itr != graph.neighbors_end(v);
+         ++itr, ++weight_itr, ++i) {
+      ASSERT_EQ(std::get<0>(edges[i]), v);
+      ASSERT_EQ(std::get<1>(edges[i]), *itr);
+      ASSERT_EQ(std::get<2>(edges[i]), *weight_itr);
+    }
+  }
+  ASSERT_EQ(i, edges.size());
+}
+
+TEST(CSRGraphTest, InvalidVertexID) {
+  mc::csr_graph<uint64_t, uint64_t, void, std::allocator<std::byte>> graph;
+  std::vector<edge_type> edges{{0, 1}, {1, 4}};
+  ASSERT_THROW(graph.build(4, edges.begin(), edges.end()), std::out_of_range);
+}
+
+TEST(CSRGraphTest, InconsistentPartition) {
+  mc::csr_graph<uint64_t, uint64_t, void, std::allocator<std::byte>> graph;
+  for (const bool more : {true, false}) {
+    // Gives a different number of edges at the second pass
+    std::atomic<int> num_calls{0};
+    auto reader = [&num_calls, more](const std::size_t, auto &&emit) {
+      const bool second_pass = num_calls.fetch_add(1) > 0;
+      emit(0, 1);
+      emit(1, 2);
+      if (second_pass == more) emit(0, 3);
+    };
+    ASSERT_THROW(graph.build(4, 1, reader), std::logic_error);
+    ASSERT_EQ(graph.num_edges(), 0);
+  }
+}
+
+TEST(CSRGraphTest, OffsetOverflow) {
+  mc::csr_graph<uint64_t, uint8_t, void, std::allocator<std::byte>> graph;
+  const auto edges = gen_random_edges(4, 255);
+  graph.build(4, edges.begin(), edges.end());
+  ASSERT_EQ(graph.num_edges(), 255);
+
+  const auto more_edges = gen_random_edges(4, 256);
+  ASSERT_THROW(graph.build(4, more_edges.begin(), more_edges.end()),
+               std::length_error);
+}
+
+TEST(CSRGraphTest, PersistentGraph) {
+  using graph_type = mc::csr_graph<uint64_t, uint32_t>;
+  const auto dir_path(test_utility::make_test_path());
+  const std::size_t num_vertices = 1 << 12;
+  const auto edges = gen_random_edges(num_vertices, 1 << 16);
+
+  {
+    metall::manager manager(metall::create_only, dir_path);
+    auto *graph =
+        manager.construct<graph_type>("graph")(manager.get_allocator());
+    graph->build(num_vertices, edges.begin(), edges.end());
+  }
+
+  {
+    metall::manager manager(metall::open_read_only, dir_path);
+    const auto *graph = manager.find<graph_type>("graph").first;
+    ASSERT_NE(graph, nullptr);
+    check_graph(*graph, num_vertices, edges);
+
+    // The arrays are used in the datastore without copying
+    const auto *const begin =
+        static_cast<const std::byte *>(manager.get_address());
+    const auto *const end = begin + manager.get_size();
+    for (const auto *ptr :
+         {reinterpret_cast<const std::byte *>(graph->offsets()),
+          reinterpret_cast<const std::byte *>(graph->neighbors())}) {
+      ASSERT_TRUE(begin <= ptr && ptr < end);
+    }
+  }
+}
+}  // namespace
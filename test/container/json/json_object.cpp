@@ -5,6 +5,8 @@
 
 #include "gtest/gtest.h"
 #include <memory>
+#include <string>
+#include <limits>
 #include <metall/json/json.hpp>
 
 namespace mj = metall::json;
@@ -173,4 +175,81 @@ TEST(JSONObjectTest, Equal) {
   GTEST_ASSERT_FALSE(obj == obj_cpy);
   GTEST_ASSERT_TRUE(obj != obj_cpy);
 }
+
+TEST(JSONObjectTest, WideObject) {
+  const int num_keys = 1000;
+  mj::jsndtl::adaptive_object<std::allocator<std::byte>> obj;
+  for (int i = 0; i < num_keys; ++i) {
+    obj["key" + std::to_string(i)].emplace_int64() = i;
+  }
+  GTEST_ASSERT_TRUE(obj.indexed());
+  GTEST_ASSERT_EQ(obj.size(), num_keys);
+  for (int i = 0; i < num_keys; ++i) {
+    const auto key = "key" + std::to_string(i);
+    GTEST_ASSERT_TRUE(obj.contains(key));
+    GTEST_ASSERT_EQ(obj.find(key)->key(), key);
+    GTEST_ASSERT_EQ(obj.at(key).as_int64(), i);
+  }
+  GTEST_ASSERT_FALSE(obj.contains("key1000"));
+  GTEST_ASSERT_FALSE(obj.contains(""));
+
+  // Erase the even keys
+  for (int i = 0; i < num_keys; i += 4) {
+    obj.erase("key" + std::to_string(i));
+  }
+  for (auto itr = obj.begin(); itr != obj.end();) {
+    const int i = std::stoi(std::string(itr->key().substr(3)));
+    itr = (i % 2 == 0) ? obj.erase(itr) : std::next(itr);
+  }
+  GTEST_ASSERT_EQ(obj.size(), num_keys / 2);
+  for (int i = 0; i < num_keys; ++i) {
+    const auto key = "key" + std::to_string(i);
+    GTEST_ASSERT_EQ(obj.contains(key), i % 2 == 1);
+    if (i % 2 == 1) {
+      GTEST_ASSERT_EQ(obj[key].as_int64(), i);
+    }
+  }
+
+  auto obj_cpy(obj);
+  GTEST_ASSERT_TRUE(obj == obj_cpy);
+  GTEST_ASSERT_TRUE(obj_cpy.contains("key999"));
+
+  // The hash table is released when the object becomes small
+  while (obj.size() > 1) {
+    obj.erase(obj.begin());
+  }
+  GTEST_ASSERT_FALSE(obj.indexed());
+  GTEST_ASSERT_TRUE(obj_cpy.contains(obj.begin()->key()));
+}
+
+TEST(JSONObjectTest, IndexThreshold) {
+  using always_indexed_type =
+      mj::jsndtl::adaptive_object<std::allocator<std::byte>, 0>;
+  using never_indexed_type = mj::jsndtl::adaptive_object<
+      std::allocator<std::byte>, std::numeric_limits<std::size_t>::max()>;
+
+  always_indexed_type always_indexed;
+  never_indexed_type never_indexed;
+  for (int i = 0; i < 100; ++i) {
+    always_indexed[std::to_string(i)].emplace_int64() = i;
+    never_indexed[std::to_string(i)].emplace_int64() = i;
+    GTEST_ASSERT_TRUE(always_indexed.indexed());
+    GTEST_ASSERT_FALSE(never_indexed.indexed());
+  }
+  for (int i = 0; i < 100; ++i) {
+    GTEST_ASSERT_EQ(always_indexed[std::to_string(i)].as_int64(), i);
+    GTEST_ASSERT_EQ(never_indexed[std::to_string(i)].as_int64(), i);
+  }
+
+  for (int i = 0; i < 100; ++i) {
+    always_indexed.erase(std::to_string(i));
+    never_indexed.erase(std::to_string(i));
+    GTEST_ASSERT_EQ(always_indexed.size(), 99 - i);
+    GTEST_ASSERT_EQ(never_indexed.size(), 99 - i);
+    for (int j = i + 1; j < 100; ++j) {
+      GTEST_ASSERT_EQ(always_indexed.at(std::to_string(j)).as_int64(), j);
+      GTEST_ASSERT_EQ(never_indexed.at(std::to_string(j)).as_int64(), j);
+    }
+  }
+}
 }  // namespace
\ No newline at end of file
@@ -0,0 +1,173 @@
+// Copyright 2023 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+#include "gtest/gtest.h"
+#include <memory>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <metall/json/json.hpp>
+#include <metall/metall.hpp>
+#include "../../test_utility.hpp"
+
+namespace mj = metall::json;
+namespace bj = boost::json;
+
+namespace {
+
+const std::vector<std::string> documents = {
+    R"({"pi": 3.141, "happy": true, "name": "Alice", "nothing": null})",
+    R"({"list": [1, 0, -2, 18446744073709551615], "object": {"k": "v"}})",
+    R"([[], {}, "", [{"a": [1, {"b": 2.5}]}]])",
+    R"("escaped \"string\" é\n")",
+    R"(-42)",
+    R"(null)"};
+
+/// \brief Generates a JSON larger than the buffer size of the stream parser
+/// so that strings, keys, and numbers are split at buffer boundaries.
+std::string gen_large_json() {
+  std::string json = "{";
+  for (int i = 0; i < 1 << 15; ++i) {
+    if (i > 0) json += ",";
+    json += "\"key" + std::to_string(i) + std::string(i % 31, 'k') + "\":";
+    json += "{\"str\":\"" + std::string(i % 67, 'x') + "\",";
+    json += "\"arr\":[" + std::to_string(i) + "," + std::to_string(i * 0.5) +
+            ",true,null]}";
+  }
+  json += "}";
+  return json;
+}
+
+TEST(JSONParseTest, String) {
+  for (const auto &document : documents) {
+    const auto jv = mj::parse(document);
+    GTEST_ASSERT_EQ(jv, bj::parse(document));
+  }
+}
+
+TEST(JSONParseTest, ExistingValue) {
+  for (const auto &document : documents) {
+    mj::value jv;
+    jv.emplace_string() = "to be overwritten";
+    GTEST_ASSERT_TRUE(mj::parse(document, &jv));
+    GTEST_ASSERT_EQ(jv, bj::parse(document));
+  }
+}
+
+TEST(JSONParseTest, Invalid) {
+  for (const std::string invalid :
+       {"", " ", "{", "[1, 2", R"({"a" 1})", "1 2", "[] x", "tru"}) {
+    mj::value jv;
+    jv.emplace_bool() = true;
+    GTEST_ASSERT_FALSE(mj::parse(invalid, &jv)) << invalid;
+    GTEST_ASSERT_TRUE(jv.is_null());
+    GTEST_ASSERT_TRUE(mj::parse(invalid).is_null());
+  }
+
+  // Trailing whitespaces are accepted
+  GTEST_ASSERT_EQ(mj::parse("[1]\n "), bj::parse("[1]"));
+}
+
+TEST(JSONParseTest, Stream) {
+  for (const auto &document : documents) {
+    std::istringstream input(document + "\n");
+    mj::value jv;
+    GTEST_ASSERT_TRUE(mj::parse(input, &jv));
+    GTEST_ASSERT_EQ(jv, bj::parse(document));
+  }
+
+  {
+    const auto json = gen_large_json();
+    std::istringstream input(json);
+    mj::value jv;
+    GTEST_ASSERT_TRUE(mj::parse(input, &jv));
+    GTEST_ASSERT_EQ(jv, bj::parse(json));
+  }
+
+  for (const std::string invalid : {"", "{", "1 2", "[1]\n[2]"}) {
+    std::istringstream input(invalid);
+    mj::value jv;
+    GTEST_ASSERT_FALSE(mj::parse(input, &jv)) << invalid;
+    GTEST_ASSERT_TRUE(jv.is_null());
+  }
+}
+
+TEST(JSONParseTest, NDJSON) {
+  std::string ndjson;
+  for (const auto &document : documents) {
+    ndjson += document + "\n";
+  }
+  ndjson += gen_large_json() + "\n";
+  ndjson += "\n1\r\n2";  // Blank line, CRLF, and no newline at the end
+
+  std::vector<bj::value> expected;
+  for (const auto &document : documents) {
+    expected.emplace_back(bj::parse(document));
+  }
+  expected.emplace_back(bj::parse(gen_large_json()));
+  expected.emplace_back(1);
+  expected.emplace_back(2);
+
+  {
+    std::istringstream input(ndjson);
+    std::size_t count = 0;
+    GTEST_ASSERT_TRUE(mj::parse_ndjson(
+        input, std::allocator<std::byte>{}, [&](mj::value<> &&jv) {
+          GTEST_ASSERT_EQ(jv, expected[count]);
+          ++count;
+        }));
+    GTEST_ASSERT_EQ(count, expected.size());
+  }
+
+  {
+    std::istringstream input(ndjson);
+    mj::array<> array;
+    GTEST_ASSERT_TRUE(mj::parse_ndjson(input, &array));
+    GTEST_ASSERT_EQ(array.size(), expected.size());
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+      GTEST_ASSERT_EQ(array[i], expected[i]);
+    }
+  }
+}
+
+TEST(JSONParseTest, InvalidNDJSON) {
+  std::istringstream input("[1]\n{\"a\":2}\n{\"b\":\n");
+  mj::array<> array;
+  GTEST_ASSERT_FALSE(mj::parse_ndjson(input, &array));
+  // The valid documents before the invalid one are kept
+  GTEST_ASSERT_EQ(array.size(), 2);
+  GTEST_ASSERT_EQ(array[0], bj::parse("[1]"));
+  GTEST_ASSERT_EQ(array[1], bj::parse(R"({"a":2})"));
+}
+
+TEST(JSONParseTest, PersistentValue) {
+  using value_type = mj::value<metall::manager::allocator_type<std::byte>>;
+  using array_type = mj::array<metall::manager::allocator_type<std::byte>>;
+  const auto dir_path(test_utility::make_test_path());
+  const auto json = gen_large_json();
+
+  {
+    metall::manager manager(metall::create_only, dir_path);
+    auto *jv = manager.construct<value_type>("jv")(manager.get_allocator());
+    std::istringstream input(json);
+    GTEST_ASSERT_TRUE(mj::parse(input, jv));
+
+    auto *array =
+        manager.construct<array_type>("array")(manager.get_allocator());
+    std::istringstream ndjson(json + "\n" + json);
+    GTEST_ASSERT_TRUE(mj::parse_ndjson(ndjson, array));
+  }
+
+  {
+    metall::manager manager(metall::open_read_only, dir_path);
+    const auto expected = bj::parse(json);
+    GTEST_ASSERT_EQ(*manager.find<value_type>("jv").first, expected);
+    const auto &array = *manager.find<array_type>("array").first;
+    GTEST_ASSERT_EQ(array.size(), 2);
+    GTEST_ASSERT_EQ(array[0], expected);
+    GTEST_ASSERT_EQ(array[1], expected);
+  }
+}
+}  // namespace
@@ -0,0 +1,128 @@
+// Copyright 2023 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+#include "gtest/gtest.h"
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <metall/json/json.hpp>
+
+namespace mj = metall::json;
+namespace bj = boost::json;
+
+namespace {
+
+std::string json_string = R"(
+      {
+        "pi": 3.141,
+        "one": 1.0,
+        "happy": true,
+        "sad": false,
+        "name": "Alice",
+        "escaped": "\"quoted\" \\ \n\t\u0001 é",
+        "nothing": null,
+        "min": -9223372036854775808,
+        "max": 18446744073709551615,
+        "list": [1, 0, -2, [], {}, [[]]],
+        "object": {
+          "currency": "USD",
+          "value": 42.99
+        }
+      }
+    )";
+
+TEST(JSONSerializeTest, String) {
+  const auto jv = mj::parse(json_string);
+  const auto str = mj::serialize(jv);
+  GTEST_ASSERT_EQ(bj::parse(str), bj::parse(json_string));
+  GTEST_ASSERT_EQ(str.find('\n'), std::string::npos);
+
+  // Doubles are read back as doubles
+  GTEST_ASSERT_TRUE(mj::parse(str).as_object()["one"].is_double());
+
+  GTEST_ASSERT_EQ(bj::parse(mj::serialize(jv.as_object())),
+                  bj::parse(json_string));
+  GTEST_ASSERT_EQ(bj::parse(mj::serialize(jv.as_object()["list"].as_array())),
+                  bj::parse(R"([1, 0, -2, [], {}, [[]]])"));
+}
+
+TEST(JSONSerializeTest, Double) {
+  for (const double d : {0.0, -0.0, 1.0, -2.5, 0.1, 1e-300, 1e300,
+                         std::numeric_limits<double>::max(),
+                         std::numeric_limits<double>::min(),
+                         std::numeric_limits<double>::denorm_min()}) {
+    mj::value jv;
+    jv = d;
+    const auto read = mj::parse(mj::serialize(jv));
+    GTEST_ASSERT_TRUE(read.is_double());
+    GTEST_ASSERT_EQ(read.as_double(), d);
+  }
+
+  mj::value jv;
+  jv = std::numeric_limits<double>::quiet_NaN();
+  GTEST_ASSERT_EQ(mj::serialize(jv), "null");
+}
+
+TEST(JSONSerializeTest, Stream) {
+  const auto jv = mj::parse(json_string);
+
+  std::stringstream ss;
+  ss << jv;
+  GTEST_ASSERT_EQ(ss.str(), mj::serialize(jv));
+
+  ss.str("");
+  ss << jv.as_object() << '\n' << jv.as_object()["list"].as_array();
+  GTEST_ASSERT_EQ(ss.str(), mj::serialize(jv.as_object()) + "\n" +
+                                mj::serialize(jv.as_object()["list"]));
+
+  ss.str("");
+  mj::serialize(jv, ss);
+  GTEST_ASSERT_EQ(ss.str(), mj::serialize(jv));
+}
+
+TEST(JSONSerializeTest, Buffer) {
+  const auto jv = mj::parse(json_string);
+  const auto expected = mj::serialize(jv);
+
+  for (const std::size_t buffer_size : {1, 7, 4096}) {
+    std::unique_ptr<char[]> buffer(new char[buffer_size]);
+    std::string out;
+    std::size_t num_chunks = 0;
+    GTEST_ASSERT_TRUE(mj::serialize(
+        jv, buffer.get(), buffer_size,
+        [&](const char *const data, const std::size_t size) {
+          GTEST_ASSERT_TRUE(size > 0 && size <= buffer_size);
+          GTEST_ASSERT_EQ(data, buffer.get());
+          out.append(data, size);
+          ++num_chunks;
+        }));
+    GTEST_ASSERT_EQ(out, expected);
+    GTEST_ASSERT_EQ(num_chunks, (expected.size() + buffer_size - 1) /
+                                    buffer_size);
+  }
+
+  GTEST_ASSERT_FALSE(
+      mj::serialize(jv, nullptr, 0, [](const char *, std::size_t) {}));
+}
+
+TEST(JSONSerializeTest, PrettyPrint) {
+  const auto jv = mj::parse(json_string);
+  std::stringstream ss;
+  mj::pretty_print(ss, jv);
+  GTEST_ASSERT_EQ(bj::parse(ss.str()), bj::parse(json_string));
+
+  ss.str("");
+  mj::pretty_print(ss, mj::parse(R"({"a": [1, {}], "b": []})"));
+  GTEST_ASSERT_EQ(ss.str(),
+                  "{\n"
+                  "  \"a\": [\n"
+                  "    1,\n"
+                  "    {}\n"
+                  "  ],\n"
+                  "  \"b\": []\n"
+                  "}\n");
+}
+}  // namespace
@@ -8,6 +8,7 @@
 #include <memory>
 #include <unordered_set>
 #include <filesystem>
+#include <vector>
 
 #include <boost/container/scoped_allocator.hpp>
 #include <boost/interprocess/containers/vector.hpp>
@@ -152,6 +153,26 @@ TEST(StlAllocatorTest, Exception) {
   metall::logger::set_log_level(metall::logger::level_filter::error);
 }
 
+TEST(StlAllocatorTest, AllocateMany) {
+  metall::manager manager(metall::create_only, dir_path(), 1UL << 27UL);
+
+  alloc_type<uint64_t> allocator = manager.get_allocator<uint64_t>();
+  std::vector<alloc_type<uint64_t>::pointer> ptrs(1000);
+  allocator.allocate_many(2, ptrs.size(), ptrs.data());
+
+  std::unordered_set<uint64_t *> set;
+  for (std::size_t i = 0; i < ptrs.size(); ++i) {
+    ASSERT_NE(ptrs[i], nullptr);
+    ptrs[i][0] = i;
+    ptrs[i][1] = i * 2;
+    set.insert(metall::to_raw_pointer(ptrs[i]));
+  }
+  ASSERT_EQ(set.size(), ptrs.size());
+
+  allocator.deallocate_many(ptrs.data(), ptrs.size());
+  ASSERT_TRUE(manager.all_memory_deallocated());
+}
+
 TEST(StlAllocatorTest, Container) {
   {
     metall::manager manager(metall::create_only, dir_path(), 1UL << 27UL);
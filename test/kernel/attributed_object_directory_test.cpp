@@ -5,6 +5,11 @@
 
 #include "gtest/gtest.h"
 #include <memory>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <vector>
 #include <metall/kernel/attributed_object_directory.hpp>
 #include "../test_utility.hpp"
 
@@ -77,6 +82,74 @@ TEST(AttributedObjectDirectoryTest, FindByName) {
   ASSERT_EQ(obj.find("item2")->name(), "item2");
 }
 
+TEST(AttributedObjectDirectoryTest, FindByNameWithoutLock) {
+  directory_type obj;
+
+  obj.insert("item1", 1, 2, 5);
+  obj.insert("item2", 3, 4, 6, "description2");
+  obj.insert("", 7, 8, 9);
+
+  ssize_t offset = 0;
+  std::size_t length = 0;
+  ASSERT_TRUE(obj.find("item1", &offset, &length));
+  ASSERT_EQ(offset, 1);
+  ASSERT_EQ(length, 2);
+  ASSERT_TRUE(obj.find("item2", &offset, &length));
+  ASSERT_EQ(offset, 3);
+  ASSERT_EQ(length, 4);
+  ASSERT_FALSE(obj.find("item3", &offset, &length));
+  ASSERT_FALSE(obj.find("", &offset, &length));
+
+  obj.erase(std::string("item1"));
+  ASSERT_FALSE(obj.find("item1", &offset, &length));
+  obj.erase(ssize_t(3));
+  ASSERT_FALSE(obj.find("item2", &offset, &length));
+}
+
+// Finds names while another thread inserts and erases other names
+TEST(AttributedObjectDirectoryTest, ConcurrentFindAndUpdate) {
+  directory_type obj;
+
+  constexpr ssize_t num_fixed_items = 128;
+  for (ssize_t i = 0; i < num_fixed_items; ++i) {
+    ASSERT_TRUE(obj.insert("fixed" + std::to_string(i), i, i * 2, 0));
+  }
+
+  std::atomic_bool done{false};
+  std::atomic_bool ok{true};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t) {
+    readers.emplace_back([&obj, &done, &ok]() {
+      do {
+        for (ssize_t i = 0; i < num_fixed_items; ++i) {
+          ssize_t offset = 0;
+          std::size_t length = 0;
+          if (!obj.find("fixed" + std::to_string(i), &offset, &length) ||
+              offset != i || length != std::size_t(i * 2)) {
+            ok.store(false);
+          }
+        }
+      } while (!done.load());
+    });
+  }
+
+  // Grows and shrinks the directory repeatedly
+  for (int round = 0; round < 8; ++round) {
+    for (ssize_t i = 0; i < 4096; ++i) {
+      ASSERT_TRUE(obj.insert("temp" + std::to_string(i),
+                             num_fixed_items + i, 1, 0));
+    }
+    for (ssize_t i = 0; i < 4096; ++i) {
+      ASSERT_EQ(obj.erase("temp" + std::to_string(i)), 1);
+    }
+  }
+  done.store(true);
+  for (auto &th : readers) th.join();
+
+  ASSERT_TRUE(ok.load());
+  ASSERT_EQ(obj.size(), num_fixed_items);
+}
+
 TEST(AttributedObjectDirectoryTest, FindByOffset) {
   directory_type obj;
 
@@ -210,6 +283,33 @@ TEST(AttributedObjectDirectoryTest, Deserialize) {
   }
 }
 
+TEST(AttributedObjectDirectoryTest, DeserializeJSONFormat) {
+  test_utility::create_test_dir();
+  const auto file(test_utility::make_test_path());
+
+  {
+    // Format used by older versions
+    std::ofstream ofs(file);
+    ofs << R"({"attributed_objects": [)"
+        << R"({"name": "item1", "offset": "1", "length": "2", )"
+        << R"("type_id": "5", "description": ""}, )"
+        << R"({"name": "item2", "offset": "3", "length": "4", )"
+        << R"("type_id": "6", "description": "description2"}]})";
+  }
+
+  directory_type obj;
+  ASSERT_TRUE(obj.deserialize(file));
+
+  const auto itr1 = obj.find("item1");
+  ASSERT_EQ(itr1->offset(), 1);
+  ASSERT_EQ(itr1->length(), 2);
+  ASSERT_EQ(itr1->type_id(), 5);
+
+  const auto itr2 = obj.find("item2");
+  ASSERT_EQ(itr2->offset(), 3);
+  ASSERT_EQ(itr2->description(), "description2");
+}
+
 TEST(AttributedObjectDirectoryTest, Clear) {
   test_utility::create_test_dir();
   const auto file(test_utility::make_test_path());
@@ -5,6 +5,7 @@
 
 #include "gtest/gtest.h"
 #include <memory>
+#include <fstream>
 #include <metall/kernel/bin_directory.hpp>
 #include <metall/kernel/bin_number_manager.hpp>
 #include <metall/metall.hpp>
@@ -144,4 +145,25 @@ TEST(BinDirectoryTest, Deserialize) {
   }
 }
 
+TEST(BinDirectoryTest, DeserializeTextFormat) {
+  test_utility::create_test_dir();
+  const auto file = test_utility::make_test_path();
+
+  {
+    // Format used by older versions: bin_no value
+    std::ofstream ofs(file);
+    ofs << "0 1\n0 2\n" << num_small_bins - 1 << " 3\n";
+  }
+
+  std::allocator<char> allocator;
+  directory_type obj(allocator);
+  ASSERT_TRUE(obj.deserialize(file));
+  ASSERT_EQ(obj.front(0), 1);
+  obj.pop(0);
+  ASSERT_FALSE(obj.empty(0));
+  obj.pop(0);
+  ASSERT_TRUE(obj.empty(0));
+  ASSERT_EQ(obj.front(num_small_bins - 1), 3);
+}
+
 }  // namespace
\ No newline at end of file
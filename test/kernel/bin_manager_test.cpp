@@ -66,8 +66,18 @@ TEST(BinManagerTest, ToLargeBinNo) {
             bin_no_mngr::num_small_bins() + 2);
   ASSERT_EQ(bin_no_mngr::to_bin_no(k_chunk_size * 3),
             bin_no_mngr::num_small_bins() + 2);
+#ifdef METALL_USE_QUARTER_POWER_OF_TWO_LARGE_SIZE
+  ASSERT_EQ(bin_no_mngr::to_bin_no(k_chunk_size * 3 + 1),
+            bin_no_mngr::num_small_bins() + 3);
+
+  // 33 chunks go to the 40 chunks bin, not 64
+  ASSERT_EQ(bin_no_mngr::to_object_size(
+                bin_no_mngr::to_bin_no(k_chunk_size * 33)),
+            k_chunk_size * 40);
+#else
   ASSERT_EQ(bin_no_mngr::to_bin_no(k_chunk_size * 3 + 1),
             bin_no_mngr::num_small_bins() + 2);
+#endif
 
   ASSERT_EQ(bin_no_mngr::to_bin_no(k_max_size - 1),
             bin_no_mngr::num_small_bins() + bin_no_mngr::num_large_bins() - 1);
@@ -75,4 +85,27 @@ TEST(BinManagerTest, ToLargeBinNo) {
             bin_no_mngr::num_small_bins() + bin_no_mngr::num_large_bins() - 1);
 }
 
+TEST(BinManagerTest, LargeSizes) {
+  for (std::size_t i = bin_no_mngr::num_small_bins();
+       i < bin_no_mngr::num_bins(); ++i) {
+    const auto size = k_size_table<k_chunk_size, k_max_size>[i];
+    ASSERT_EQ(size % k_chunk_size, 0) << size;
+    ASSERT_EQ(bin_no_mngr::to_bin_no(size), i) << size;
+    ASSERT_EQ(bin_no_mngr::to_bin_no(size - 1), i) << size;
+    if (i + 1 < bin_no_mngr::num_bins()) {
+      ASSERT_EQ(bin_no_mngr::to_bin_no(size + 1), i + 1) << size;
+      const auto next_size = k_size_table<k_chunk_size, k_max_size>[i + 1];
+      ASSERT_LT(size, next_size);
+    }
+  }
+}
+
+TEST(BinManagerTest, PowerOfTwoSizes) {
+  // Aligned allocation assumes that all power of 2 sizes exist
+  for (std::size_t size = 8; size <= k_max_size; size *= 2) {
+    ASSERT_EQ(bin_no_mngr::to_object_size(bin_no_mngr::to_bin_no(size)),
+              size);
+  }
+}
+
 }  // namespace
\ No newline at end of file
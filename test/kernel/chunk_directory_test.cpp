@@ -6,6 +6,7 @@
 #include "gtest/gtest.h"
 #include <cstdint>
 #include <memory>
+#include <fstream>
 #include <metall/kernel/chunk_directory.hpp>
 #include <metall/kernel/bin_number_manager.hpp>
 #include <metall/metall.hpp>
@@ -66,6 +67,142 @@ TEST(ChunkDirectoryTest, EraseChunk) {
   ASSERT_EQ(directory.size(), 0);
 }
 
+TEST(ChunkDirectoryTest, ReuseErasedChunk) {
+  chunk_directory_type directory(1 << 20);
+
+  for (uint32_t i = 0; i < 8; ++i) {
+    ASSERT_EQ(directory.insert(0), i);
+  }
+  const auto large_chunk_no = directory.insert(k_num_small_bins + 1);  // 2
+  ASSERT_EQ(large_chunk_no, 8);
+
+  directory.erase(2);
+  directory.erase(5);
+  directory.erase(6);
+
+  // The lowest free chunk is used first
+  ASSERT_EQ(directory.insert(0), 2);
+  // A large chunk fits into the hole at [5, 7)
+  ASSERT_EQ(directory.insert(k_num_small_bins + 1), 5);
+  // No hole is left
+  ASSERT_EQ(directory.insert(0), 10);
+
+  directory.erase(large_chunk_no);
+  ASSERT_EQ(directory.insert(k_num_small_bins), 8);
+  ASSERT_EQ(directory.insert(k_num_small_bins), 9);
+  ASSERT_EQ(directory.size(), 11);
+}
+
+TEST(ChunkDirectoryTest, BestFitLargeChunk) {
+  chunk_directory_type directory(1 << 20);
+
+  for (uint32_t i = 0; i < 10; ++i) {
+    ASSERT_EQ(directory.insert(0), i);
+  }
+  // Make a 3-chunk hole at [1, 4) and a 2-chunk hole at [6, 8)
+  for (const auto chunk_no : {1, 2, 3, 6, 7}) {
+    directory.erase(chunk_no);
+  }
+
+  // The shortest hole is used even though it is not the lowest one
+  ASSERT_EQ(directory.insert(k_num_small_bins + 1), 6);  // 2 chunks
+  ASSERT_EQ(directory.insert(k_num_small_bins + 1), 1);
+  ASSERT_EQ(directory.insert(k_num_small_bins + 1), 10);
+
+  // Freed neighboring chunks are coalesced
+  directory.erase(0);
+  directory.erase(1);
+  ASSERT_EQ(directory.insert(k_num_small_bins + 2), 0);
+#ifdef METALL_USE_QUARTER_POWER_OF_TWO_LARGE_SIZE
+  // 3 chunks are used and the last chunk of the hole is left
+  ASSERT_EQ(bin_no_mngr::to_object_size(k_num_small_bins + 2),
+            3 * k_chunk_size);
+  ASSERT_FALSE(directory.unused_chunk(2));
+  ASSERT_TRUE(directory.unused_chunk(3));
+  ASSERT_EQ(directory.insert(0), 3);
+#else
+  ASSERT_EQ(bin_no_mngr::to_object_size(k_num_small_bins + 2),
+            4 * k_chunk_size);
+  ASSERT_FALSE(directory.unused_chunk(3));
+#endif
+}
+
+TEST(ChunkDirectoryTest, InsertInRegions) {
+  chunk_directory_type directory(16);
+  // Regions of 4 chunks interleaved over 2 sets, e.g., NUMA nodes
+  const metall::kernel::interleaved_chunk_regions regions0{4, 2, 0};
+  const metall::kernel::interleaved_chunk_regions regions1{4, 2, 1};
+
+  ASSERT_EQ(directory.insert(0, 1, &regions1), 4);
+  ASSERT_EQ(directory.arena_no(4), 1);
+  ASSERT_EQ(directory.insert(0, 0, &regions0), 0);
+  ASSERT_EQ(directory.insert(k_num_small_bins + 1, 0, &regions1), 5);  // 2
+  ASSERT_EQ(directory.insert(k_num_small_bins + 1, 0, &regions1), 12);
+  ASSERT_EQ(directory.insert(k_num_small_bins + 1, 0, &regions0), 1);
+
+  ASSERT_EQ(directory.insert(k_num_small_bins + 1, 0, &regions1), 14);
+
+  // Falls back to other regions if there is no space
+  ASSERT_EQ(directory.insert(k_num_small_bins + 1, 0, &regions1), 7);
+  ASSERT_EQ(directory.insert(0, 0, &regions1), 3);
+}
+
+TEST(ChunkDirectoryTest, ResizeLargeChunk) {
+  chunk_directory_type directory(16);
+
+  const auto chno0 = directory.insert(k_num_small_bins);  // 1 chunk
+  const auto chno1 = directory.insert(k_num_small_bins);
+  ASSERT_EQ(chno1, 1);
+
+  ASSERT_FALSE(directory.resize_large_chunk(chno0, k_num_small_bins + 1));
+  ASSERT_TRUE(directory.resize_large_chunk(chno1, k_num_small_bins + 3));
+  ASSERT_EQ(directory.bin_no(chno1), k_num_small_bins + 3);
+  ASSERT_EQ(directory.size(),
+            1 + bin_no_mngr::to_object_size(k_num_small_bins + 3) /
+                    k_chunk_size);
+
+  ASSERT_TRUE(directory.resize_large_chunk(chno1, k_num_small_bins));
+  ASSERT_EQ(directory.size(), 2);
+  ASSERT_EQ(directory.insert(k_num_small_bins + 1), 2);
+
+  directory.erase(chno1);
+  ASSERT_TRUE(directory.resize_large_chunk(chno0, k_num_small_bins + 1));
+  ASSERT_EQ(directory.size(), 4);
+}
+
+TEST(ChunkDirectoryTest, ReassignSmallChunk) {
+  chunk_directory_type directory(4);
+
+  const auto chno = directory.insert(0, 3);
+  ASSERT_EQ(directory.arena_no(chno), 3);
+  directory.find_and_mark_slot(chno);
+  directory.unmark_slot(chno, 0);
+
+  const auto new_bin_no = static_cast<bin_no_mngr::bin_no_type>(
+      bin_no_mngr::to_bin_no(k_chunk_size / 4));
+  ASSERT_TRUE(directory.reassign_small_chunk(chno, new_bin_no));
+  ASSERT_EQ(directory.bin_no(chno), new_bin_no);
+  ASSERT_EQ(directory.slots(chno), 4);
+  ASSERT_EQ(directory.arena_no(chno), 3);  // The owner does not change
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_EQ(directory.find_and_mark_slot(chno), i);
+  }
+  ASSERT_TRUE(directory.all_slots_marked(chno));
+  ASSERT_EQ(directory.size(), 1);
+}
+
+TEST(ChunkDirectoryTest, FillUp) {
+  chunk_directory_type directory(4);
+
+  ASSERT_EQ(directory.insert(k_num_small_bins + 1), 0);  // 2 chunks
+  ASSERT_EQ(directory.insert(0), 2);
+  ASSERT_EQ(directory.insert(0), 3);
+  ASSERT_EQ(directory.size(), 4);
+
+  directory.erase(0);
+  ASSERT_EQ(directory.insert(k_num_small_bins + 1), 0);
+}
+
 TEST(ChunkDirectoryTest, MarkSlot) {
   chunk_directory_type directory(bin_no_mngr::num_small_bins() + 1);
 
@@ -174,6 +311,116 @@ TEST(ChunkDirectoryTest, Deserialize) {
 
     ASSERT_EQ(directory.insert(bin_no_mngr::num_small_bins()),
               large_chunk2_no + 2);
+
+    // Erased chunks are found after deserialization
+    directory.erase(1);
+    ASSERT_EQ(directory.insert(1), 1);
+  }
+}
+
+TEST(ChunkDirectoryTest, DeserializeTextFormat) {
+  ASSERT_TRUE(test_utility::create_test_dir());
+  const auto file(test_utility::make_test_path());
+
+  const auto small_bin_no = static_cast<typename bin_no_mngr::bin_no_type>(
+      bin_no_mngr::num_small_bins() - 1);
+  const uint64_t num_slots =
+      k_chunk_size / bin_no_mngr::to_object_size(small_bin_no);
+  ASSERT_LE(num_slots, 64);
+  {
+    // Format used by older versions:
+    // chunk_no bin_no type [num_occupied_slots slot_occupancy]
+    std::ofstream ofs(file);
+    // Slot 0 is the most significant bit
+    ofs << 0 << " " << static_cast<uint64_t>(small_bin_no) << " 1 1 "
+        << (1ULL << 63ULL) << "\n";
+    ofs << 1 << " " << bin_no_mngr::num_small_bins() + 1 << " 2\n";
+    ofs << 2 << " " << bin_no_mngr::num_small_bins() + 1 << " 3\n";
+  }
+
+  chunk_directory_type directory(8);
+  ASSERT_TRUE(directory.deserialize(file));
+  ASSERT_EQ(directory.bin_no(0), small_bin_no);
+  ASSERT_TRUE(directory.marked_slot(0, 0));
+  ASSERT_EQ(directory.find_and_mark_slot(0), 1);
+  ASSERT_EQ(directory.bin_no(1), bin_no_mngr::num_small_bins() + 1);
+  ASSERT_EQ(directory.size(), 3);
+  ASSERT_EQ(directory.insert(bin_no_mngr::num_small_bins()), 3);
+
+  // Written back in the binary format
+  ASSERT_TRUE(directory.serialize(file));
+  chunk_directory_type directory2(8);
+  ASSERT_TRUE(directory2.deserialize(file));
+  ASSERT_EQ(directory2.bin_no(0), small_bin_no);
+  ASSERT_EQ(directory2.occupied_slots(0), 2);
+  ASSERT_EQ(directory2.size(), 4);
+}
+
+TEST(ChunkDirectoryTest, Persistent) {
+  ASSERT_TRUE(test_utility::create_test_dir());
+  const auto table_file(test_utility::make_test_path("table"));
+  const auto slot_table_file(test_utility::make_test_path("slot_table"));
+
+  {
+    chunk_directory_type directory(bin_no_mngr::num_small_bins() + 5);
+    ASSERT_TRUE(directory.create_persistent(table_file, slot_table_file));
+    ASSERT_TRUE(directory.persistent());
+
+    for (typename bin_no_mngr::bin_no_type bin_no = 0;
+         bin_no < bin_no_mngr::num_small_bins(); ++bin_no) {
+      chunk_no_type new_chunk_no = directory.insert(bin_no);
+      const uint64_t num_slots =
+          k_chunk_size / bin_no_mngr::to_object_size(bin_no);
+      for (uint64_t s = 0; s < num_slots - 1; ++s) {
+        directory.find_and_mark_slot(new_chunk_no);
+      }
+    }
+    directory.insert(bin_no_mngr::num_small_bins());      // 1 chunk
+    directory.insert(bin_no_mngr::num_small_bins() + 1);  // 2 chunks
+    ASSERT_TRUE(directory.sync(true));
+  }
+
+  {
+    chunk_directory_type directory(bin_no_mngr::num_small_bins() + 4);
+    ASSERT_TRUE(directory.open_persistent(table_file, slot_table_file, true));
+    ASSERT_EQ(directory.size(), bin_no_mngr::num_small_bins() + 3);
+    for (uint64_t i = 0; i < bin_no_mngr::num_small_bins(); ++i) {
+      const auto bin_no = static_cast<typename bin_no_mngr::bin_no_type>(i);
+      const auto chunk_no = static_cast<chunk_no_type>(i);
+      const uint64_t num_slots =
+          k_chunk_size / bin_no_mngr::to_object_size(bin_no);
+      ASSERT_EQ(directory.bin_no(chunk_no), bin_no);
+      ASSERT_EQ(directory.occupied_slots(chunk_no), num_slots - 1);
+      ASSERT_TRUE(directory.marked_slot(chunk_no, num_slots - 2));
+      ASSERT_FALSE(directory.marked_slot(chunk_no, num_slots - 1));
+    }
+  }
+
+  {
+    chunk_directory_type directory(bin_no_mngr::num_small_bins() + 4);
+    ASSERT_TRUE(directory.open_persistent(table_file, slot_table_file, false));
+    for (uint64_t i = 0; i < bin_no_mngr::num_small_bins(); ++i) {
+      const auto bin_no = static_cast<typename bin_no_mngr::bin_no_type>(i);
+      const auto chunk_no = static_cast<chunk_no_type>(i);
+      const uint64_t num_slots =
+          k_chunk_size / bin_no_mngr::to_object_size(bin_no);
+      ASSERT_EQ(directory.find_and_mark_slot(chunk_no), num_slots - 1);
+    }
+
+    const auto large_chunk2_no =
+        static_cast<chunk_no_type>(bin_no_mngr::num_small_bins() + 1);
+    ASSERT_EQ(directory.insert(bin_no_mngr::num_small_bins()),
+              large_chunk2_no + 2);
+    directory.erase(1);
+  }
+
+  {
+    chunk_directory_type directory(bin_no_mngr::num_small_bins() + 4);
+    ASSERT_TRUE(directory.open_persistent(table_file, slot_table_file, false));
+    ASSERT_EQ(directory.size(), bin_no_mngr::num_small_bins() + 4);
+    ASSERT_TRUE(directory.unused_chunk(1));
+    ASSERT_EQ(directory.insert(1), 1);
+    ASSERT_TRUE(directory.all_slots_marked(0));
   }
 }
 }  // namespace
@@ -0,0 +1,288 @@
+// Copyright 2023 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+#include "gtest/gtest.h"
+
+#include <sys/stat.h>
+
+#include <fstream>
+
+#include <metall/kernel/dedup_segment_storage.hpp>
+#include "../test_utility.hpp"
+
+namespace {
+using segment_storage_type = metall::kernel::dedup_segment_storage;
+constexpr std::size_t k_page_size = METALL_DEDUP_SEGMENT_PAGE_SIZE;
+constexpr std::size_t k_vm_size = k_page_size * 8;
+
+const std::string &test_dir() {
+  const static std::string path(test_utility::make_test_path());
+  return path;
+}
+
+const std::string &test_file_prefix() {
+  const static std::string path(test_dir() + "/backing_file");
+  return path;
+}
+
+const std::string &snapshot_file_prefix() {
+  const static std::string path(test_dir() + "/snapshot");
+  return path;
+}
+
+void prepare_test_dir() {
+  ASSERT_TRUE(metall::mtlldetail::remove_file(test_dir()));
+  ASSERT_TRUE(metall::mtlldetail::create_directory(test_dir()));
+}
+
+std::filesystem::path page_dir_path(const std::string &base_path) {
+  return metall::kernel::storage::get_path(base_path,
+                                           {"dedup_segment", "pages"});
+}
+
+std::size_t num_page_files(const std::string &base_path) {
+  std::vector<std::filesystem::path> names;
+  EXPECT_TRUE(
+      metall::mtlldetail::get_regular_file_names(page_dir_path(base_path), &names));
+  return names.size();
+}
+
+void fill_page(char *const buf, const std::size_t page_no, const char c) {
+  std::fill(buf + page_no * k_page_size, buf + (page_no + 1) * k_page_size, c);
+}
+
+TEST(DedupSegmentStorageTest, PageSize) {
+  segment_storage_type data_storage;
+  ASSERT_GT(data_storage.page_size(), 0);
+  ASSERT_EQ(k_page_size % data_storage.page_size(), 0);
+}
+
+TEST(DedupSegmentStorageTest, Create) {
+  prepare_test_dir();
+  segment_storage_type data_storage;
+  ASSERT_TRUE(data_storage.create(test_file_prefix(), k_vm_size));
+  ASSERT_TRUE(data_storage.is_open());
+  ASSERT_TRUE(data_storage.check_sanity());
+  ASSERT_NE(data_storage.get_segment(), nullptr);
+  ASSERT_GE(data_storage.size(), k_page_size);
+  auto buf = static_cast<char *>(data_storage.get_segment());
+  for (std::size_t i = 0; i < data_storage.size(); ++i) {
+    ASSERT_EQ(buf[i], 0);
+    buf[i] = '1';
+  }
+}
+
+TEST(DedupSegmentStorageTest, Extend) {
+  prepare_test_dir();
+  segment_storage_type data_storage;
+  ASSERT_TRUE(data_storage.create(test_file_prefix(), k_vm_size));
+
+  ASSERT_TRUE(data_storage.extend(k_vm_size / 2));
+  ASSERT_GE(data_storage.size(), k_vm_size / 2);
+  ASSERT_TRUE(data_storage.extend(k_vm_size));
+  ASSERT_GE(data_storage.size(), k_vm_size);
+  ASSERT_FALSE(data_storage.extend(k_vm_size + k_page_size));
+
+  auto buf = static_cast<char *>(data_storage.get_segment());
+  for (std::size_t i = 0; i < k_vm_size; ++i) {
+    buf[i] = '1';
+    ASSERT_EQ(buf[i], '1');
+  }
+}
+
+TEST(DedupSegmentStorageTest, Open) {
+  {
+    prepare_test_dir();
+    segment_storage_type data_storage;
+    ASSERT_TRUE(data_storage.create(test_file_prefix(), k_vm_size));
+    ASSERT_TRUE(data_storage.extend(k_vm_size));
+    auto buf = static_cast<char *>(data_storage.get_segment());
+    for (std::size_t i = 0; i < k_vm_size; ++i) {
+      buf[i] = static_cast<char>(i % 128);
+    }
+  }
+
+  // Open and Update
+  {
+    segment_storage_type data_storage;
+    ASSERT_TRUE(data_storage.open(test_file_prefix(), k_vm_size, false));
+    ASSERT_TRUE(data_storage.is_open());
+    ASSERT_FALSE(data_storage.read_only());
+    ASSERT_EQ(data_storage.size(), k_vm_size);
+    auto buf = static_cast<char *>(data_storage.get_segment());
+    for (std::size_t i = 0; i < k_vm_size; ++i) {
+      ASSERT_EQ(buf[i], static_cast<char>(i % 128));
+    }
+    buf[k_page_size] = 'x';
+  }
+
+  // Read only
+  {
+    segment_storage_type data_storage;
+    ASSERT_TRUE(data_storage.open(test_file_prefix(), k_vm_size, true));
+    ASSERT_TRUE(data_storage.read_only());
+    auto buf = static_cast<char *>(data_storage.get_segment());
+    ASSERT_EQ(buf[k_page_size], 'x');
+    ASSERT_EQ(buf[k_page_size + 1], static_cast<char>((k_page_size + 1) % 128));
+  }
+}
+
+TEST(DedupSegmentStorageTest, Deduplicate) {
+  prepare_test_dir();
+  segment_storage_type data_storage;
+  ASSERT_TRUE(data_storage.create(test_file_prefix(), k_vm_size));
+  ASSERT_TRUE(data_storage.extend(k_vm_size));
+  auto buf = static_cast<char *>(data_storage.get_segment());
+
+  // Zero pages do not have files
+  ASSERT_TRUE(data_storage.sync(true));
+  ASSERT_EQ(num_page_files(test_file_prefix()), 0);
+
+  for (std::size_t p = 0; p < 6; ++p) {
+    fill_page(buf, p, p % 2 ? 'a' : 'b');
+  }
+  ASSERT_TRUE(data_storage.sync(true));
+  ASSERT_EQ(num_page_files(test_file_prefix()), 2);
+
+  // Pages are still writable after sync
+  fill_page(buf, 0, 'c');
+  fill_page(buf, 2, 'c');
+  ASSERT_TRUE(data_storage.sync(true));
+  ASSERT_EQ(num_page_files(test_file_prefix()), 3);
+
+  // Unreferenced page files are removed
+  fill_page(buf, 4, 'a');
+  ASSERT_TRUE(data_storage.sync(true));
+  ASSERT_EQ(num_page_files(test_file_prefix()), 2);
+
+  fill_page(buf, 0, 0);
+  fill_page(buf, 2, 0);
+  ASSERT_TRUE(data_storage.sync(true));
+  ASSERT_EQ(num_page_files(test_file_prefix()), 1);
+
+  for (std::size_t i = 0; i < k_vm_size; ++i) {
+    const std::size_t p = i / k_page_size;
+    ASSERT_EQ(buf[i], (p < 6 && (p % 2 || p == 4)) ? 'a' : 0);
+  }
+}
+
+TEST(DedupSegmentStorageTest, HashCollision) {
+  prepare_test_dir();
+  const std::string other_prefix(test_dir() + "/other");
+
+  // Find the name of the page file of a page filled with 'a'
+  std::vector<std::filesystem::path> names;
+  {
+    segment_storage_type data_storage;
+    ASSERT_TRUE(data_storage.create(other_prefix, k_vm_size));
+    ASSERT_TRUE(data_storage.extend(k_vm_size));
+    fill_page(static_cast<char *>(data_storage.get_segment()), 0, 'a');
+    ASSERT_TRUE(data_storage.sync(true));
+    ASSERT_TRUE(metall::mtlldetail::get_regular_file_names(
+        page_dir_path(other_prefix), &names));
+    ASSERT_EQ(names.size(), 1);
+  }
+
+  {
+    segment_storage_type data_storage;
+    ASSERT_TRUE(data_storage.create(test_file_prefix(), k_vm_size));
+    ASSERT_TRUE(data_storage.extend(k_vm_size));
+    auto buf = static_cast<char *>(data_storage.get_segment());
+
+    // Emulate a page file that has the same hash but different contents
+    {
+      std::ofstream ofs(page_dir_path(test_file_prefix()) / names[0]);
+      ofs << std::string(k_page_size, 'b');
+    }
+
+    fill_page(buf, 0, 'a');
+    ASSERT_TRUE(data_storage.sync(true));
+    ASSERT_EQ(num_page_files(test_file_prefix()), 2);
+
+    // The page file written for the collision is reused
+    fill_page(buf, 1, 'a');
+    ASSERT_TRUE(data_storage.sync(true));
+    ASSERT_EQ(num_page_files(test_file_prefix()), 2);
+  }
+
+  {
+    segment_storage_type data_storage;
+    ASSERT_TRUE(data_storage.open(test_file_prefix(), k_vm_size, true));
+    auto buf = static_cast<char *>(data_storage.get_segment());
+    for (std::size_t i = 0; i < k_page_size * 2; ++i) {
+      ASSERT_EQ(buf[i], 'a');
+    }
+  }
+}
+
+TEST(DedupSegmentStorageTest, FreeRegion) {
+  prepare_test_dir();
+  segment_storage_type data_storage;
+  ASSERT_TRUE(data_storage.create(test_file_prefix(), k_vm_size));
+  ASSERT_TRUE(data_storage.extend(k_vm_size));
+  auto buf = static_cast<char *>(data_storage.get_segment());
+  for (std::size_t p = 0; p < 4; ++p) {
+    fill_page(buf, p, static_cast<char>('a' + p));
+  }
+  ASSERT_TRUE(data_storage.sync(true));
+  ASSERT_EQ(num_page_files(test_file_prefix()), 4);
+
+  // Frees pages 1 and 2 fully and page 0 partially
+  ASSERT_TRUE(
+      data_storage.free_region(k_page_size / 2, k_page_size * 5 / 2));
+  ASSERT_EQ(buf[k_page_size], 0);
+  ASSERT_EQ(buf[k_page_size * 2], 0);
+  ASSERT_EQ(buf[k_page_size * 3], 'd');
+  ASSERT_TRUE(data_storage.sync(true));
+  ASSERT_EQ(num_page_files(test_file_prefix()), 2);
+}
+
+TEST(DedupSegmentStorageTest, Snapshot) {
+  prepare_test_dir();
+  {
+    segment_storage_type data_storage;
+    ASSERT_TRUE(data_storage.create(test_file_prefix(), k_vm_size));
+    ASSERT_TRUE(data_storage.extend(k_vm_size));
+    auto buf = static_cast<char *>(data_storage.get_segment());
+    for (std::size_t p = 0; p < 4; ++p) {
+      fill_page(buf, p, static_cast<char>('a' + p));
+    }
+    ASSERT_TRUE(data_storage.snapshot(snapshot_file_prefix(), true, 2));
+
+    // The snapshot shares the page files
+    std::vector<std::filesystem::path> names;
+    ASSERT_TRUE(metall::mtlldetail::get_regular_file_names(
+        page_dir_path(snapshot_file_prefix()), &names));
+    ASSERT_EQ(names.size(), 4);
+    for (const auto &name : names) {
+      struct stat st;
+      ASSERT_EQ(::stat((page_dir_path(snapshot_file_prefix()) / name).c_str(),
+                       &st),
+                0);
+      ASSERT_EQ(st.st_nlink, 2);
+    }
+
+    // Updating the original does not change the snapshot
+    fill_page(buf, 0, 'x');
+  }
+
+  {
+    segment_storage_type data_storage;
+    ASSERT_TRUE(data_storage.open(snapshot_file_prefix(), k_vm_size, true));
+    auto buf = static_cast<char *>(data_storage.get_segment());
+    for (std::size_t p = 0; p < 4; ++p) {
+      ASSERT_EQ(buf[p * k_page_size], static_cast<char>('a' + p));
+    }
+  }
+
+  {
+    segment_storage_type data_storage;
+    ASSERT_TRUE(data_storage.open(test_file_prefix(), k_vm_size, true));
+    auto buf = static_cast<char *>(data_storage.get_segment());
+    ASSERT_EQ(buf[0], 'x');
+    ASSERT_EQ(buf[k_page_size], 'b');
+  }
+}
+}  // namespace
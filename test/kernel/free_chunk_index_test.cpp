@@ -0,0 +1,233 @@
+// Copyright 2019 Lawrence Livermore National Security, LLC and other Metall
+// Project Developers. See the top-level COPYRIGHT file for details.
+//
+// SPDX-License-Identifier: (Apache-2.0 OR MIT)
+
+#include "gtest/gtest.h"
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <metall/kernel/free_chunk_index.hpp>
+
+namespace {
+using index_type = metall::kernel::free_chunk_index<uint32_t>;
+
+TEST(FreeChunkIndexTest, Empty) {
+  index_type index(16);
+  ASSERT_EQ(index.find_lowest(), 0);
+  ASSERT_EQ(index.find_best_fit(1), 0);
+  ASSERT_EQ(index.find_best_fit(16), 0);
+  ASSERT_EQ(index.find_best_fit(17), 16);
+  ASSERT_TRUE(index.free(0, 16));
+  ASSERT_EQ(index.end(), 0);
+}
+
+TEST(FreeChunkIndexTest, SetUsed) {
+  index_type index(16);
+
+  index.set_used(0, 3);
+  ASSERT_EQ(index.find_lowest(), 3);
+  ASSERT_FALSE(index.free(2, 1));
+  ASSERT_TRUE(index.free(3, 13));
+  ASSERT_EQ(index.end(), 3);
+
+  index.set_used(5, 1);
+  ASSERT_EQ(index.end(), 6);
+  ASSERT_EQ(index.num_extents(), 1);
+  ASSERT_EQ(index.find_lowest(), 3);
+  ASSERT_EQ(index.find_best_fit(2), 3);
+  ASSERT_EQ(index.find_best_fit(3), 6);
+  ASSERT_EQ(index.find_best_fit(10), 6);
+  ASSERT_EQ(index.find_best_fit(11), 16);
+
+  index.set_used(3, 1);
+  ASSERT_EQ(index.find_lowest(), 4);
+  ASSERT_FALSE(index.free(3, 2));
+  ASSERT_TRUE(index.free(4, 1));
+}
+
+TEST(FreeChunkIndexTest, BestFit) {
+  index_type index(64);
+
+  index.set_used(0, 20);
+  index.set_free(2, 4);    // [2, 6)
+  index.set_free(8, 2);    // [8, 10)
+  index.set_free(12, 3);   // [12, 15)
+  index.set_free(16, 2);   // [16, 18)
+  ASSERT_EQ(index.num_extents(), 4);
+
+  ASSERT_EQ(index.find_lowest(), 2);
+  ASSERT_EQ(index.find_best_fit(1), 8);
+  ASSERT_EQ(index.find_best_fit(2), 8);
+  ASSERT_EQ(index.find_best_fit(3), 12);
+  ASSERT_EQ(index.find_best_fit(4), 2);
+  ASSERT_EQ(index.find_best_fit(5), 20);
+
+  index.set_used(8, 2);
+  ASSERT_EQ(index.find_best_fit(2), 16);
+}
+
+TEST(FreeChunkIndexTest, Coalesce) {
+  index_type index(32);
+
+  index.set_used(0, 20);
+  index.set_free(4, 2);
+  index.set_free(8, 2);
+  ASSERT_EQ(index.num_extents(), 2);
+
+  // Merge with both neighbors
+  index.set_free(6, 2);
+  ASSERT_EQ(index.num_extents(), 1);
+  ASSERT_EQ(index.find_best_fit(6), 4);
+  ASSERT_EQ(index.find_best_fit(7), 20);
+
+  // Merge with the free chunks at the end
+  index.set_free(17, 3);
+  ASSERT_EQ(index.end(), 17);
+  ASSERT_EQ(index.num_extents(), 1);
+  ASSERT_EQ(index.find_best_fit(7), 17);
+  ASSERT_EQ(index.find_best_fit(15), 17);
+  ASSERT_EQ(index.find_best_fit(16), 32);
+
+  index.set_free(10, 7);
+  index.set_free(0, 4);
+  ASSERT_EQ(index.end(), 0);
+  ASSERT_EQ(index.num_extents(), 0);
+
+  index.set_used(3, 1);
+  index.clear();
+  ASSERT_EQ(index.find_best_fit(32), 0);
+}
+
+TEST(FreeChunkIndexTest, Random) {
+  constexpr std::size_t k_num_chunks = 1000;
+  index_type index(k_num_chunks);
+  std::vector<bool> used(k_num_chunks, false);
+
+  auto naive_free = [&used](const std::size_t first, const std::size_t n) {
+    for (std::size_t i = first; i < first + n; ++i) {
+      if (used[i]) return false;
+    }
+    return true;
+  };
+
+  std::mt19937 rnd(123);
+  for (int i = 0; i < 10000; ++i) {
+    const std::size_t first = rnd() % k_num_chunks;
+    const std::size_t n =
+        std::min<std::size_t>(rnd() % 8 + 1, k_num_chunks - first);
+    if (naive_free(first, n)) {
+      index.set_used(first, n);
+      for (std::size_t c = first; c < first + n; ++c) used[c] = true;
+    } else if (used[first]) {
+      std::size_t len = 0;
+      while (first + len < k_num_chunks && used[first + len] && len < n) {
+        ++len;
+      }
+      index.set_free(first, len);
+      for (std::size_t c = first; c < first + len; ++c) used[c] = false;
+    }
+
+    const std::size_t lowest = index.find_lowest();
+    ASSERT_TRUE(lowest == k_num_chunks || !used[lowest]);
+    for (std::size_t c = 0; c < lowest; ++c) ASSERT_TRUE(used[c]);
+
+    const std::size_t query = rnd() % 16 + 1;
+    const std::size_t found = index.find_best_fit(query);
+    if (found < k_num_chunks) {
+      ASSERT_LE(found + query, k_num_chunks);
+      ASSERT_TRUE(naive_free(found, query));
+    }
+  }
+}
+
+TEST(FreeChunkIndexTest, InterleavedRegions) {
+  // Regions of 4 chunks interleaved over 2 sets
+  const metall::kernel::interleaved_chunk_regions regions0{4, 2, 0};
+  const metall::kernel::interleaved_chunk_regions regions1{4, 2, 1};
+  ASSERT_TRUE(regions0.contains(3));
+  ASSERT_FALSE(regions0.contains(4));
+  ASSERT_TRUE(regions1.contains(4));
+  ASSERT_EQ(regions0.lower_bound(5), 8);
+  ASSERT_EQ(regions1.lower_bound(1), 4);
+  ASSERT_EQ(regions1.lower_bound(9), 12);
+
+  index_type index(32);
+  ASSERT_EQ(index.find_lowest(regions0), 0);
+  ASSERT_EQ(index.find_lowest(regions1), 4);
+  ASSERT_EQ(index.find_first_fit(4, regions1), 4);
+
+  index.set_used(0, 6);
+  ASSERT_EQ(index.find_lowest(regions0), 8);
+  ASSERT_EQ(index.find_lowest(regions1), 6);
+  ASSERT_EQ(index.find_first_fit(2, regions1), 6);
+  ASSERT_EQ(index.find_first_fit(3, regions1), 12);
+
+  // A free run across regions does not fit in a region
+  index.set_used(6, 10);
+  index.set_free(10, 4);
+  ASSERT_EQ(index.find_first_fit(2, regions0), 10);
+  ASSERT_EQ(index.find_first_fit(3, regions0), 16);
+  ASSERT_EQ(index.find_first_fit(2, regions1), 12);
+  ASSERT_EQ(index.find_first_fit(3, regions1), 20);
+
+  index.set_used(16, 16);
+  index.set_used(10, 4);
+  ASSERT_EQ(index.find_lowest(regions0), 32);
+  ASSERT_EQ(index.find_first_fit(1, regions1), 32);
+}
+
+TEST(FreeChunkIndexTest, InterleavedRegionsRandom) {
+  constexpr std::size_t k_num_chunks = 1000;
+  constexpr std::size_t k_region_size = 16;
+  index_type index(k_num_chunks);
+  std::vector<bool> used(k_num_chunks, false);
+
+  auto naive_free = [&used](const std::size_t first, const std::size_t n) {
+    for (std::size_t i = first; i < first + n; ++i) {
+      if (used[i]) return false;
+    }
+    return true;
+  };
+
+  std::mt19937 rnd(123);
+  for (int i = 0; i < 10000; ++i) {
+    const std::size_t first = rnd() % k_num_chunks;
+    const std::size_t n =
+        std::min<std::size_t>(rnd() % 8 + 1, k_num_chunks - first);
+    if (naive_free(first, n)) {
+      index.set_used(first, n);
+      for (std::size_t c = first; c < first + n; ++c) used[c] = true;
+    } else if (used[first]) {
+      std::size_t len = 0;
+      while (first + len < k_num_chunks && used[first + len] && len < n) {
+        ++len;
+      }
+      index.set_free(first, len);
+      for (std::size_t c = first; c < first + len; ++c) used[c] = false;
+    }
+
+    const std::size_t num_sets = rnd() % 4 + 1;
+    const metall::kernel::interleaved_chunk_regions regions{
+        k_region_size, num_sets, rnd() % num_sets};
+
+    std::size_t lowest = 0;
+    while (lowest < k_num_chunks &&
+           (used[lowest] || !regions.contains(lowest))) {
+      ++lowest;
+    }
+    ASSERT_EQ(index.find_lowest(regions), lowest);
+
+    const std::size_t query = rnd() % k_region_size + 1;
+    std::size_t fit = 0;
+    while (fit + query <= k_num_chunks &&
+           !(regions.contains(fit) &&
+             fit / k_region_size == (fit + query - 1) / k_region_size &&
+             naive_free(fit, query))) {
+      ++fit;
+    }
+    if (fit + query > k_num_chunks) fit = k_num_chunks;
+    ASSERT_EQ(index.find_first_fit(query, regions), fit);
+  }
+}
+}  // namespace
@@ -14,6 +14,7 @@
 #include <random>
 #include <algorithm>
 #include <scoped_allocator>
+#include <string>
 
 #include <boost/interprocess/containers/vector.hpp>
 #include <boost/unordered_map.hpp>
@@ -288,6 +289,53 @@ TEST(ManagerMultithreadsTest, SizeMixedAllocDeallocMixed) {
 }
 #endif
 
+TEST(ManagerMultithreadsTest, DeallocateByOtherThreads) {
+  std::vector<std::size_t> allocation_size_list;
+  for (std::size_t size = k_min_object_size;
+       size <= manager_type::chunk_size() / 2; size *= 4) {
+    allocation_size_list.insert(allocation_size_list.end(), 256, size);
+  }
+  shuffle_list(&allocation_size_list);
+
+  const auto dir(test_utility::make_test_path());
+  {
+    manager_type manager(metall::create_only, dir);
+    for (int k = 0; k < 2; ++k) {
+      std::vector<void *> addr_list(allocation_size_list.size(), nullptr);
+      OMP_DIRECTIVE(parallel for schedule(static))
+      for (std::size_t i = 0; i < allocation_size_list.size(); ++i) {
+        addr_list[i] = manager.allocate(allocation_size_list[i]);
+      }
+
+      // Deallocate in the reverse order so that objects are deallocated by
+      // threads other than the ones allocated them
+      OMP_DIRECTIVE(parallel for schedule(static))
+      for (std::size_t i = 0; i < addr_list.size(); ++i) {
+        manager.deallocate(addr_list[addr_list.size() - i - 1]);
+      }
+      ASSERT_TRUE(manager.all_memory_deallocated());
+    }
+
+    // Leave some objects
+    OMP_DIRECTIVE(parallel for)
+    for (std::size_t i = 0; i < allocation_size_list.size(); ++i) {
+      manager.construct<std::size_t>(std::to_string(i).c_str())(i);
+    }
+  }
+
+  {
+    manager_type manager(metall::open_only, dir);
+    OMP_DIRECTIVE(parallel for)
+    for (std::size_t i = 0; i < allocation_size_list.size(); ++i) {
+      const auto *const value =
+          manager.find<std::size_t>(std::to_string(i).c_str()).first;
+      EXPECT_EQ(*value, i);
+      EXPECT_TRUE(manager.destroy<std::size_t>(std::to_string(i).c_str()));
+    }
+    ASSERT_TRUE(manager.all_memory_deallocated());
+  }
+}
+
 TEST(ManagerMultithreadsTest, ConstructAndFind) {
   using allocation_element_type = std::array<char, 256>;
   constexpr std::size_t num_allocates = 1024;
@@ -7,6 +7,9 @@
 
 #include <filesystem>
 #include <unordered_set>
+#include <cstring>
+#include <set>
+#include <vector>
 
 #include <metall/metall.hpp>
 #include <metall/kernel/object_size_manager.hpp>
@@ -349,6 +352,19 @@ TEST(ManagerTest, DestroyPtr) {
     ASSERT_FALSE(manager.destroy_ptr(array_obj));
   }
 
+  {
+    manager_type::remove(dir_path());
+    manager_type manager(metall::create_only, dir_path(), 1UL << 30UL);
+    int *obj = manager.construct<int>("obj")();
+    ASSERT_TRUE(manager.destroy_ptr(obj));
+
+    // Not an error --- could have been destroyed by another thread
+    testing::internal::CaptureStderr();
+    const bool destroyed = manager.destroy_ptr(obj);
+    ASSERT_TRUE(testing::internal::GetCapturedStderr().empty());
+    ASSERT_FALSE(destroyed);
+  }
+
   {
     manager_type::remove(dir_path());
     manager_type manager(metall::create_only, dir_path(), 1UL << 30UL);
@@ -1129,6 +1145,116 @@ TEST(ManagerTest, LargeAllocation) {
   }
 }
 
+TEST(ManagerTest, AllocateMany) {
+  manager_type::remove(dir_path());
+  manager_type manager(metall::create_only, dir_path());
+
+  for (const std::size_t size : {std::size_t(8), std::size_t(4096),
+                                 k_chunk_size / 2, k_chunk_size + 1}) {
+    std::vector<void *> addrs(100, nullptr);
+    ASSERT_TRUE(manager.allocate_many(size, addrs.size(), addrs.data()));
+
+    std::set<char *> sorted;
+    for (auto *addr : addrs) {
+      ASSERT_NE(addr, nullptr);
+      std::memset(addr, 1, size);
+      sorted.insert(static_cast<char *>(addr));
+    }
+    // No overlap
+    ASSERT_EQ(sorted.size(), addrs.size());
+    for (auto itr = sorted.begin(); std::next(itr) != sorted.end(); ++itr) {
+      ASSERT_GE(*std::next(itr) - *itr, size);
+    }
+
+    // Deallocate with one of the objects deallocated individually
+    manager.deallocate(addrs[0]);
+    addrs[0] = nullptr;
+    manager.deallocate_many(addrs.data(), addrs.size());
+    ASSERT_TRUE(manager.all_memory_deallocated());
+  }
+
+  // Mixed sizes
+  std::vector<void *> addrs;
+  for (const std::size_t size : {std::size_t(8), std::size_t(64)}) {
+    std::vector<void *> buf(10);
+    ASSERT_TRUE(manager.allocate_many(size, buf.size(), buf.data()));
+    addrs.insert(addrs.end(), buf.begin(), buf.end());
+    addrs.push_back(manager.allocate(k_chunk_size));
+  }
+  manager.deallocate_many(addrs.data(), addrs.size());
+  ASSERT_TRUE(manager.all_memory_deallocated());
+}
+
+TEST(ManagerTest, ExpandInPlace) {
+  manager_type::remove(dir_path());
+  manager_type manager(metall::create_only, dir_path());
+
+  // Assume that the object cache is not used for large allocation
+  auto *const addr1 = static_cast<char *>(manager.allocate(k_chunk_size));
+  auto *const addr2 = static_cast<char *>(manager.allocate(k_chunk_size));
+  ASSERT_EQ(addr2 - addr1, k_chunk_size);
+
+  // Already large enough
+  ASSERT_TRUE(manager.expand_in_place(addr1, k_chunk_size - 1));
+  // The next chunk is used
+  ASSERT_FALSE(manager.expand_in_place(addr1, k_chunk_size * 2));
+  // The chunks after the last one are free
+  ASSERT_TRUE(manager.expand_in_place(addr2, k_chunk_size * 4));
+  ASSERT_EQ(static_cast<char *>(manager.allocate(k_chunk_size)) - addr1,
+            k_chunk_size * 5);
+
+  manager.deallocate(addr2);
+  ASSERT_TRUE(manager.expand_in_place(addr1, k_chunk_size * 2));
+  ASSERT_EQ(static_cast<char *>(manager.allocate(k_chunk_size)) - addr1,
+            k_chunk_size * 2);
+
+  // A small allocation cannot become a large one in place
+  auto *const addr3 = manager.allocate(k_min_object_size);
+  ASSERT_FALSE(manager.expand_in_place(addr3, k_chunk_size));
+}
+
+TEST(ManagerTest, Reallocate) {
+  manager_type::remove(dir_path());
+  manager_type manager(metall::create_only, dir_path());
+
+  // Works as allocate
+  auto *const addr1 =
+      static_cast<char *>(manager.reallocate(nullptr, k_chunk_size));
+  ASSERT_NE(addr1, nullptr);
+  std::memset(addr1, 1, k_chunk_size);
+
+  // Grow in place
+  ASSERT_EQ(manager.reallocate(addr1, k_chunk_size * 3), addr1);
+  auto *const addr2 = static_cast<char *>(manager.allocate(k_chunk_size));
+#ifdef METALL_USE_QUARTER_POWER_OF_TWO_LARGE_SIZE
+  ASSERT_EQ(addr2 - addr1, k_chunk_size * 3);
+#else
+  // Rounded up to the power-of-two size class
+  ASSERT_EQ(addr2 - addr1, k_chunk_size * 4);
+#endif
+
+  // Shrink in place; the freed chunks are reusable
+  ASSERT_EQ(manager.reallocate(addr1, k_chunk_size), addr1);
+  ASSERT_EQ(manager.allocate(k_chunk_size), addr1 + k_chunk_size);
+
+  // Move as the next chunk is used
+  auto *const addr3 =
+      static_cast<char *>(manager.reallocate(addr1, k_chunk_size * 2));
+  ASSERT_NE(addr3, addr1);
+  for (std::size_t i = 0; i < k_chunk_size; ++i) {
+    ASSERT_EQ(addr3[i], 1);
+  }
+
+  // Small to small
+  auto *const addr4 = static_cast<char *>(manager.allocate(8));
+  std::memset(addr4, 2, 8);
+  auto *const addr5 = static_cast<char *>(manager.reallocate(addr4, 1024));
+  for (std::size_t i = 0; i < 8; ++i) {
+    ASSERT_EQ(addr5[i], 2);
+  }
+  ASSERT_EQ(manager.reallocate(addr5, 1000), addr5);
+}
+
 TEST(ManagerTest, AllMemoryDeallocated) {
   {
     manager_type::remove(dir_path());
@@ -1217,6 +1343,195 @@ TEST(ManagerTest, Flush) {
   ASSERT_FALSE(manager_type::consistent(dir_path()));
 }
 
+TEST(ManagerTest, AdviseAndPrefetch) {
+  constexpr std::size_t length = k_chunk_size * 4;
+  manager_type::remove(dir_path());
+  {
+    manager_type manager(metall::create_only, dir_path());
+    auto *const data = static_cast<char *>(manager.allocate(length));
+    ASSERT_NE(data, nullptr);
+    std::fill(data, data + length, 'a');
+
+    for (const auto pattern :
+         {metall::access_pattern::sequential, metall::access_pattern::random,
+          metall::access_pattern::willneed, metall::access_pattern::normal}) {
+      ASSERT_TRUE(manager.advise(data, length, pattern));
+    }
+    // Does not change the data
+    manager.advise(data, length, metall::access_pattern::cold);
+    ASSERT_EQ(data[0], 'a');
+    ASSERT_EQ(data[length - 1], 'a');
+
+    // Out of the segment
+    ASSERT_FALSE(
+        manager.advise(static_cast<const char *>(manager.get_address()) - 1,
+                       length, metall::access_pattern::random));
+
+    auto prefetch = manager.prefetch_async(data, length);
+    ASSERT_TRUE(prefetch.get());
+  }
+
+  {
+    manager_type manager(metall::open_read_only, dir_path());
+    // The whole segment
+    ASSERT_TRUE(manager.advise(manager.get_address(), manager.get_size(),
+                               metall::access_pattern::sequential));
+    // The manager waits for the prefetch when it is closed
+    manager.prefetch_async(manager.get_address(), manager.get_size());
+  }
+}
+
+TEST(ManagerTest, Prefault) {
+  constexpr std::size_t length = k_chunk_size * 4;
+  manager_type::remove(dir_path());
+  {
+    manager_type manager(metall::create_only, dir_path());
+    auto *const data = manager.construct<char>("data")[length]('a');
+    ASSERT_NE(data, nullptr);
+    ASSERT_NE(manager.construct<int>("int")(10), nullptr);
+  }
+
+  {
+    metall::prefault_option option;
+    option.num_threads = 3;
+    manager_type manager(metall::open_read_only, dir_path(), option);
+    ASSERT_TRUE(manager.check_sanity());
+    auto *const data = manager.find<char>("data").first;
+    ASSERT_EQ(data[0], 'a');
+    ASSERT_EQ(data[length - 1], 'a');
+  }
+
+  {
+    metall::prefault_option option;
+    option.object_names = {"data", "int"};
+    manager_type manager(metall::open_only, dir_path(), option);
+    ASSERT_TRUE(manager.check_sanity());
+    ASSERT_EQ(*manager.find<int>("int").first, 10);
+    ASSERT_NE(manager.construct<int>("int2")(20), nullptr);
+  }
+
+  {
+    // Fails to prefault, but the data store is still usable
+    metall::prefault_option option;
+    option.object_names = {"unknown"};
+    manager_type manager(metall::open_read_only, dir_path(), option);
+    ASSERT_TRUE(manager.check_sanity());
+    ASSERT_EQ(*manager.find<int>("int2").first, 20);
+  }
+}
+
+TEST(ManagerTest, AllocateOnNode) {
+  manager_type::remove(dir_path());
+  {
+    manager_type manager(metall::create_only, dir_path());
+    std::vector<char *> addrs;
+    for (unsigned int node = 0; node < 4; ++node) {
+      for (const std::size_t size :
+           {std::size_t(8), k_chunk_size / 2, k_chunk_size * 2}) {
+        auto *const addr =
+            static_cast<char *>(manager.allocate_on_node(size, node));
+        ASSERT_NE(addr, nullptr);
+        std::fill(addr, addr + size, static_cast<char>(node));
+        addrs.push_back(addr);
+      }
+    }
+    for (auto *const addr : addrs) manager.deallocate(addr);
+    ASSERT_TRUE(manager.all_memory_deallocated());
+  }
+
+  {
+    manager_type manager(metall::open_read_only, dir_path());
+    ASSERT_EQ(manager.allocate_on_node(8, 0), nullptr);
+  }
+}
+
+#ifndef METALL_DISABLE_STATS
+// Returns the statistics of the bin for 'object_size'
+metall::bin_stats find_bin_stats(const metall::manager_stats &stats,
+                                 const std::size_t object_size) {
+  for (const auto &bin : stats.bins) {
+    if (bin.object_size == object_size) return bin;
+  }
+  return {object_size, 0, 0};
+}
+#endif
+
+TEST(ManagerTest, GetStats) {
+  manager_type::remove(dir_path());
+  std::size_t num_objects = 0;
+  {
+    manager_type manager(metall::create_only, dir_path());
+    const auto base = manager.get_stats();
+    ASSERT_EQ(base.mapped_size, manager.get_size());
+    ASSERT_EQ(base.num_flushes, 0);
+
+    std::vector<void *> small_objects;
+    for (int i = 0; i < 100; ++i) {
+      small_objects.push_back(manager.allocate(8));
+    }
+    std::vector<void *> many_objects(10, nullptr);
+    ASSERT_TRUE(manager.allocate_many(16, 10, many_objects.data()));
+    std::vector<void *> large_objects;
+    for (int i = 0; i < 3; ++i) {
+      large_objects.push_back(manager.allocate(k_chunk_size * 2));
+    }
+
+    auto stats = manager.get_stats();
+    ASSERT_GE(stats.segment_size, k_chunk_size * 7);
+    ASSERT_GE(stats.mapped_size, stats.segment_size);
+#ifndef METALL_DISABLE_STATS
+    ASSERT_EQ(stats.num_objects, base.num_objects + 113);
+    ASSERT_EQ(find_bin_stats(stats, 8).num_objects,
+              find_bin_stats(base, 8).num_objects + 100);
+    ASSERT_GE(find_bin_stats(stats, 8).num_chunks, 1);
+    ASSERT_EQ(find_bin_stats(stats, 16).num_objects,
+              find_bin_stats(base, 16).num_objects + 10);
+    ASSERT_EQ(find_bin_stats(stats, k_chunk_size * 2).num_objects, 3);
+    ASSERT_EQ(find_bin_stats(stats, k_chunk_size * 2).num_chunks, 6);
+    ASSERT_GE(stats.allocated_size, 8 * 100 + 16 * 10 + k_chunk_size * 6);
+    ASSERT_GE(stats.chunk_size, stats.allocated_size);
+    ASSERT_GE(stats.fragmentation_ratio, 0.0);
+    ASSERT_LT(stats.fragmentation_ratio, 1.0);
+#ifndef METALL_DISABLE_OBJECT_CACHE
+    ASSERT_GT(stats.cache_hits + stats.cache_misses, 0);
+#endif
+#else
+    ASSERT_EQ(stats.num_objects, 0);
+    ASSERT_TRUE(stats.bins.empty());
+#endif
+
+    for (auto *const addr : small_objects) manager.deallocate(addr);
+    manager.deallocate_many(many_objects.data(), many_objects.size());
+    manager.deallocate(large_objects[0]);
+    ASSERT_NE(manager.reallocate(large_objects[1], k_chunk_size * 4), nullptr);
+
+    manager.flush();
+    stats = manager.get_stats();
+#ifndef METALL_DISABLE_STATS
+    ASSERT_EQ(stats.num_objects, base.num_objects + 2);
+    ASSERT_EQ(find_bin_stats(stats, 8).num_objects,
+              find_bin_stats(base, 8).num_objects);
+    ASSERT_EQ(find_bin_stats(stats, k_chunk_size * 2).num_objects, 1);
+    ASSERT_EQ(find_bin_stats(stats, k_chunk_size * 4).num_chunks, 4);
+    ASSERT_EQ(stats.num_flushes, 1);
+    ASSERT_GE(stats.flush_time, stats.msync_time);
+    num_objects = stats.num_objects;
+#else
+    ASSERT_EQ(stats.num_flushes, 0);
+#endif
+  }
+
+  {
+    // The counters are restored from the allocation information
+    manager_type manager(metall::open_read_only, dir_path());
+    const auto stats = manager.get_stats();
+    ASSERT_EQ(stats.num_objects, num_objects);
+#ifndef METALL_DISABLE_STATS
+    ASSERT_EQ(find_bin_stats(stats, k_chunk_size * 4).num_objects, 1);
+#endif
+  }
+}
+
 TEST(ManagerTest, AnonymousConstruct) {
   manager_type::remove(dir_path());
   manager_type *manager;
@@ -1291,6 +1606,75 @@ TEST(ManagerTest, Version) {
     manager_type manager(metall::open_only, dir_path());
     ASSERT_EQ(manager_type::get_version(dir_path()), METALL_VERSION);
   }
+
+  namespace mdtl = metall::mtlldetail;
+  const auto metadata_path = metall::kernel::storage::get_path(
+      dir_path(), {"management", "manager_metadata"});
+  const auto set_version = [&metadata_path](const metall::version_type ver) {
+    mdtl::ptree::node_type metadata;
+    ASSERT_TRUE(mdtl::ptree::read_json(metadata_path, &metadata));
+    ASSERT_EQ(mdtl::ptree::erase("version", &metadata), 1);
+    ASSERT_TRUE(mdtl::ptree::add_value("version", ver, &metadata));
+    ASSERT_TRUE(mdtl::ptree::write_json(metadata, metadata_path));
+  };
+
+  // A datastore created by a newer version cannot be opened
+  set_version(METALL_VERSION + 1);
+  ASSERT_FALSE(manager_type::consistent(dir_path()));
+
+  // A datastore created by an older supported version can be opened
+  set_version(2800);
+  ASSERT_TRUE(manager_type::consistent(dir_path()));
+  {
+    manager_type manager(metall::open_read_only, dir_path());
+    ASSERT_EQ(manager_type::get_version(dir_path()), 2800);
+  }
+  {
+    // Updated as the management data is written in the current format
+    manager_type manager(metall::open_only, dir_path());
+    ASSERT_EQ(manager_type::get_version(dir_path()), METALL_VERSION);
+  }
+  ASSERT_TRUE(manager_type::consistent(dir_path()));
+}
+
+TEST(ManagerTest, LargeSizeClass) {
+  namespace mdtl = metall::mtlldetail;
+  manager_type::remove(dir_path());
+  {
+    manager_type manager(metall::create_only, dir_path());
+    manager.construct<int>("int")(10);
+  }
+  ASSERT_TRUE(manager_type::consistent(dir_path()));
+
+  // Emulate a datastore created before the size class name was recorded,
+  // i.e., one that uses the power of two large size classes
+  const auto metadata_path = metall::kernel::storage::get_path(
+      dir_path(), {"management", "manager_metadata"});
+  mdtl::ptree::node_type metadata;
+  ASSERT_TRUE(mdtl::ptree::read_json(metadata_path, &metadata));
+  ASSERT_EQ(mdtl::ptree::erase("large_size_class", &metadata), 1);
+  ASSERT_TRUE(mdtl::ptree::write_json(metadata, metadata_path));
+
+#ifdef METALL_USE_QUARTER_POWER_OF_TWO_LARGE_SIZE
+  ASSERT_FALSE(manager_type::consistent(dir_path()));
+  {
+    manager_type manager(metall::open_only, dir_path());
+    ASSERT_FALSE(manager.check_sanity());
+  }
+#else
+  // Datastores created by older versions are opened as before
+  ASSERT_TRUE(manager_type::consistent(dir_path()));
+  {
+    manager_type manager(metall::open_only, dir_path());
+    ASSERT_TRUE(manager.check_sanity());
+    ASSERT_EQ(*manager.find<int>("int").first, 10);
+    auto *const large = static_cast<char *>(
+        manager.allocate(manager_type::chunk_size() * 3));
+    ASSERT_NE(large, nullptr);
+    manager.deallocate(large);
+  }
+  ASSERT_TRUE(manager_type::consistent(dir_path()));
+#endif
 }
 
 TEST(ManagerTest, Description) {
@@ -9,6 +9,8 @@
 #include <vector>
 #include <utility>
 #include <random>
+#include <thread>
+#include <limits>
 
 #include <metall/metall.hpp>
 #include <metall/kernel/bin_number_manager.hpp>
@@ -25,9 +27,15 @@ class dummy_allocator {
   explicit dummy_allocator(const std::size_t max_bin_no)
       : records(max_bin_no + 1), num_allocs(max_bin_no + 1, 0) {}
 
+  // Objects that exceed 'max_num_allocs' are not allocated,
+  // and the null offset is stored instead
   void allocate(const bin_no_manager::bin_no_type bin_no, const std::size_t n,
                 std::ptrdiff_t *const offsets) {
     for (std::size_t i = 0; i < n; ++i) {
+      if (records[bin_no].size() >= max_num_allocs) {
+        offsets[i] = std::numeric_limits<std::ptrdiff_t>::max();
+        continue;
+      }
       offsets[i] = (std::ptrdiff_t)(num_allocs[bin_no]++);
       records[bin_no].insert(offsets[i]);
     }
@@ -43,6 +51,7 @@ class dummy_allocator {
 
   std::vector<std::unordered_set<std::ptrdiff_t>> records;
   std::vector<std::size_t> num_allocs;
+  std::size_t max_num_allocs{std::numeric_limits<std::size_t>::max()};
 };
 
 using cache_type =
@@ -121,6 +130,41 @@ TEST(ObjectCacheTest, SequentialSingleBinManyObjects) {
   }
 }
 
+TEST(ObjectCacheTest, AllocationFailure) {
+  cache_type cache;
+  dummy_allocator alloc(cache.max_bin_no());
+
+  std::vector<std::ptrdiff_t> offsets;
+  const auto pop = [&]() {
+    const auto off = cache.pop(0, &alloc, &dummy_allocator::allocate,
+                               &dummy_allocator::deallocate);
+    if (off != cache_type::k_null_offset) offsets.push_back(off);
+    return off;
+  };
+
+  // Only some objects in a refill are allocated
+  alloc.max_num_allocs = 3;
+  for (std::size_t i = 0; i < 3; ++i) {
+    ASSERT_NE(pop(), cache_type::k_null_offset);
+    ASSERT_EQ(alloc.records[0].count(offsets.back()), 1);
+  }
+  ASSERT_EQ(pop(), cache_type::k_null_offset);
+  ASSERT_EQ(pop(), cache_type::k_null_offset);
+
+  // No null offset is left in the cache
+  alloc.max_num_allocs = std::numeric_limits<std::size_t>::max();
+  for (std::size_t i = 0; i < 256; ++i) {
+    ASSERT_NE(pop(), cache_type::k_null_offset);
+    ASSERT_EQ(alloc.records[0].count(offsets.back()), 1);
+  }
+
+  for (const auto off : offsets) {
+    cache.push(0, off, &alloc, &dummy_allocator::deallocate);
+  }
+  cache.clear(&alloc, &dummy_allocator::deallocate);
+  ASSERT_EQ(alloc.records[0].size(), 0);
+}
+
 TEST(ObjectCacheTest, Random) {
   cache_type cache;
   dummy_allocator alloc(cache.max_bin_no());
@@ -153,4 +197,78 @@ TEST(ObjectCacheTest, Random) {
     ASSERT_EQ(alloc.records[b].size(), 0);
   }
 }
-}  // namespace
\ No newline at end of file
+
+TEST(ObjectCacheTest, ReuseAfterClear) {
+  cache_type cache;
+  dummy_allocator alloc(cache.max_bin_no());
+
+  for (int k = 0; k < 2; ++k) {
+    std::vector<std::ptrdiff_t> offsets;
+    for (std::size_t i = 0; i < 1 << 16; ++i) {
+      offsets.push_back(cache.pop(0, &alloc, &dummy_allocator::allocate,
+                                  &dummy_allocator::deallocate));
+    }
+    for (const auto off : offsets) {
+      cache.push(0, off, &alloc, &dummy_allocator::deallocate);
+    }
+
+    // The cache must be usable after clear()
+    cache.clear(&alloc, &dummy_allocator::deallocate);
+    ASSERT_EQ(alloc.records[0].size(), 0);
+  }
+}
+
+#ifdef METALL_ENABLE_THREAD_LOCAL_OBJECT_CACHE
+TEST(ObjectCacheTest, ThreadExit) {
+  cache_type cache;
+  dummy_allocator alloc(cache.max_bin_no());
+
+  const auto run = [&cache, &alloc]() {
+    std::vector<std::ptrdiff_t> offsets;
+    for (std::size_t i = 0; i < 1024; ++i) {
+      offsets.push_back(cache.pop(0, &alloc, &dummy_allocator::allocate,
+                                  &dummy_allocator::deallocate));
+    }
+    for (const auto off : offsets) {
+      cache.push(0, off, &alloc, &dummy_allocator::deallocate);
+    }
+  };
+
+  // The per-thread cache of an exited thread is taken over by the next thread
+  for (int i = 0; i < 4; ++i) {
+    std::thread th(run);
+    th.join();
+    ASSERT_EQ(cache.num_thread_local_caches(), 1);
+  }
+
+  // Objects cached by the exited threads are still owned by the cache
+  std::size_t num_thread_local_objects = 0;
+  cache.for_each_thread_local_object(
+      [&alloc, &num_thread_local_objects](const auto bin_no, const auto off) {
+        ASSERT_EQ(alloc.records[bin_no].count(off), 1);
+        ++num_thread_local_objects;
+      });
+  ASSERT_GT(num_thread_local_objects, 0);
+
+  cache.clear(&alloc, &dummy_allocator::deallocate);
+  for (const auto &per_bin : alloc.records) {
+    ASSERT_EQ(per_bin.size(), 0);
+  }
+}
+
+TEST(ObjectCacheTest, MultipleCaches) {
+  dummy_allocator alloc(cache_type::max_bin_no());
+  for (int i = 0; i < 4; ++i) {
+    // Caches must not share per-thread caches even if they are allocated at
+    // the same address
+    cache_type cache;
+    const auto off = cache.pop(1, &alloc, &dummy_allocator::allocate,
+                               &dummy_allocator::deallocate);
+    cache.push(1, off, &alloc, &dummy_allocator::deallocate);
+    ASSERT_EQ(cache.num_thread_local_caches(), 1);
+    cache.clear(&alloc, &dummy_allocator::deallocate);
+    ASSERT_EQ(alloc.records[1].size(), 0);
+  }
+}
+#endif
+}  // namespace
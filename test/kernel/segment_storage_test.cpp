@@ -29,6 +29,8 @@ void prepare_test_dir() {
 TEST(MultifileSegmentStorageTest, PageSize) {
   segment_storage_type data_storage;
   ASSERT_GT(data_storage.page_size(), 0);
+  ASSERT_EQ(data_storage.page_size() % metall::mtlldetail::get_page_size(), 0);
+  ASSERT_EQ(METALL_SEGMENT_BLOCK_SIZE % data_storage.page_size(), 0);
 }
 
 TEST(MultifileSegmentStorageTest, Create) {
@@ -176,4 +178,73 @@ TEST(MultifileSegmentStorageTest, Sync) {
     }
   }
 }
+
+TEST(MultifileSegmentStorageTest, SyncRepeatedly) {
+  constexpr std::size_t vm_size = 1ULL << 22ULL;
+  {
+    prepare_test_dir();
+    segment_storage_type data_storage;
+    ASSERT_TRUE(data_storage.create(test_file_prefix(), vm_size));
+    ASSERT_TRUE(data_storage.extend(vm_size));
+    auto buf = static_cast<char *>(data_storage.get_segment());
+    const std::size_t page_size = data_storage.page_size();
+
+    // Update different pages between syncs
+    for (std::size_t r = 0; r < 4; ++r) {
+      for (std::size_t p = r; p < vm_size / page_size; p += 4) {
+        buf[p * page_size] = static_cast<char>('0' + r);
+      }
+      ASSERT_TRUE(data_storage.sync(true));
+    }
+    // Nothing is updated
+    ASSERT_TRUE(data_storage.sync(true));
+    buf[0] = 'x';
+    ASSERT_TRUE(data_storage.sync(true));
+  }
+
+  {
+    segment_storage_type data_storage;
+    ASSERT_TRUE(data_storage.open(test_file_prefix(), vm_size, true));
+    auto buf = static_cast<char *>(data_storage.get_segment());
+    const std::size_t page_size = data_storage.page_size();
+    ASSERT_EQ(buf[0], 'x');
+    for (std::size_t p = 1; p < vm_size / page_size; ++p) {
+      ASSERT_EQ(buf[p * page_size], static_cast<char>('0' + p % 4));
+    }
+  }
+}
+
+TEST(MultifileSegmentStorageTest, OpenMultipleBlocks) {
+  constexpr std::size_t block_size = METALL_SEGMENT_BLOCK_SIZE;
+  constexpr std::size_t num_blocks = 3;
+  {
+    prepare_test_dir();
+    segment_storage_type data_storage;
+    ASSERT_TRUE(data_storage.create(test_file_prefix(), block_size * 4));
+    ASSERT_TRUE(data_storage.extend(block_size * num_blocks));
+    auto buf = static_cast<char *>(data_storage.get_segment());
+    for (std::size_t b = 0; b < num_blocks; ++b) {
+      buf[b * block_size] = static_cast<char>('0' + b);
+    }
+  }
+
+  const auto check = [](const bool read_only) {
+    segment_storage_type data_storage;
+    ASSERT_TRUE(
+        data_storage.open(test_file_prefix(), block_size * 4, read_only));
+    ASSERT_EQ(data_storage.size(), block_size * num_blocks);
+    auto buf = static_cast<char *>(data_storage.get_segment());
+    for (std::size_t b = 0; b < num_blocks; ++b) {
+      ASSERT_EQ(buf[b * block_size], static_cast<char>('0' + b));
+    }
+  };
+  check(false);
+  check(true);
+
+  // The block files are looked for if the number of blocks is not recorded
+  ASSERT_TRUE(metall::mtlldetail::remove_file(
+      metall::kernel::storage::get_path(test_file_prefix(),
+                                        {"segment", "num_blocks"})));
+  check(true);
+}
 }  // namespace
\ No newline at end of file
@@ -5,8 +5,11 @@
 
 #include "gtest/gtest.h"
 
+#include <signal.h>
+
 #include <string>
 #include <filesystem>
+#include <future>
 
 #include <metall/metall.hpp>
 
@@ -65,4 +68,176 @@ TEST(SnapshotTest, Snapshot) {
     ASSERT_EQ(*b, 2);
   }
 }
+
+TEST(SnapshotTest, SnapshotAsync) {
+  metall::manager::remove(original_dir_path());
+  metall::manager::remove(snapshot_dir_path());
+
+  constexpr std::size_t num_elements = 1ULL << 20ULL;
+  {
+    metall::manager manager(metall::create_only, original_dir_path());
+
+    auto *const array = manager.construct<uint64_t>("array")[num_elements]();
+    for (std::size_t i = 0; i < num_elements; ++i) array[i] = i;
+
+    struct sigaction segv_action_before {};
+    ASSERT_EQ(::sigaction(SIGSEGV, nullptr, &segv_action_before), 0);
+
+    auto result = manager.snapshot_async(snapshot_dir_path(), true);
+    ASSERT_TRUE(result.valid());
+
+    // Update the data while the snapshot is being taken
+    for (std::size_t i = 0; i < num_elements; ++i) array[i] = i * 2;
+    [[maybe_unused]] auto a = manager.construct<uint32_t>("a")(1);
+
+    ASSERT_TRUE(result.get());
+    ASSERT_TRUE(metall::manager::consistent(snapshot_dir_path()));
+    ASSERT_NE(metall::manager::get_uuid(original_dir_path()),
+              metall::manager::get_uuid(snapshot_dir_path()));
+
+    // The fault handler installed for the copy has been removed
+    struct sigaction segv_action_after {};
+    ASSERT_EQ(::sigaction(SIGSEGV, nullptr, &segv_action_after), 0);
+    ASSERT_EQ(segv_action_after.sa_handler, segv_action_before.sa_handler);
+
+    // The original data store must keep the updates
+    for (std::size_t i = 0; i < num_elements; ++i) array[i] += 1;
+  }
+
+  {
+    metall::manager manager(metall::open_read_only,
+                            original_dir_path().c_str());
+    const auto *const array = manager.find<uint64_t>("array").first;
+    ASSERT_NE(array, nullptr);
+    for (std::size_t i = 0; i < num_elements; ++i) {
+      ASSERT_EQ(array[i], i * 2 + 1);
+    }
+    ASSERT_NE(manager.find<uint32_t>("a").first, nullptr);
+  }
+
+  {
+    metall::manager manager(metall::open_read_only,
+                            snapshot_dir_path().c_str());
+    // The snapshot must hold the data at the time it was taken
+    const auto *const array = manager.find<uint64_t>("array").first;
+    ASSERT_NE(array, nullptr);
+    for (std::size_t i = 0; i < num_elements; ++i) {
+      ASSERT_EQ(array[i], i);
+    }
+    ASSERT_EQ(manager.find<uint32_t>("a").first, nullptr);
+  }
+}
+
+fs::path delta_snapshot_dir_path(const int no) {
+  const fs::path path(
+      test_utility::make_test_path("delta_snapshot" + std::to_string(no)));
+  return path;
+}
+
+fs::path materialized_dir_path() {
+  const fs::path path(test_utility::make_test_path("materialized"));
+  return path;
+}
+
+// Returns the total size of the segment block files in a data store
+std::size_t block_files_size(const fs::path &path) {
+  std::size_t size = 0;
+  for (const auto &entry : fs::recursive_directory_iterator(path)) {
+    if (entry.is_regular_file() &&
+        entry.path().filename().string().rfind("block-", 0) == 0) {
+      size += entry.file_size();
+    }
+  }
+  return size;
+}
+
+// Allocates an array without touching its pages
+uint32_t *allocate_array(metall::manager *manager, const char *const name,
+                         const std::size_t num_elements) {
+  auto *const array = static_cast<uint32_t *>(
+      manager->allocate(num_elements * sizeof(uint32_t)));
+  manager->construct<metall::offset_ptr<uint32_t>>(name)(array);
+  return array;
+}
+
+TEST(SnapshotTest, SnapshotDelta) {
+  metall::manager::remove(original_dir_path());
+  metall::manager::remove(snapshot_dir_path());
+  metall::manager::remove(materialized_dir_path());
+  for (int i = 0; i < 4; ++i) metall::manager::remove(delta_snapshot_dir_path(i));
+
+  // Spans multiple segment blocks
+  const std::size_t num_elements = METALL_SEGMENT_BLOCK_SIZE / 2;
+  {
+    metall::manager manager(metall::create_only, original_dir_path());
+
+    // No snapshot to take a delta from
+    ASSERT_FALSE(manager.snapshot_delta(delta_snapshot_dir_path(0)));
+
+    auto *const array = allocate_array(&manager, "array", num_elements);
+    array[0] = 1;
+    array[num_elements - 1] = 0;
+    ASSERT_TRUE(manager.snapshot(snapshot_dir_path()));
+
+    // Only the end of the array is changed
+    array[num_elements - 1] = 2;
+    ASSERT_TRUE(manager.snapshot_delta(delta_snapshot_dir_path(1)));
+    ASSERT_FALSE(metall::manager::consistent(delta_snapshot_dir_path(1)));
+    ASSERT_LT(block_files_size(delta_snapshot_dir_path(1)),
+              block_files_size(original_dir_path()));
+
+    // Extends the segment
+    array[0] = 3;
+    auto *const array2 = allocate_array(&manager, "array2", num_elements);
+    array2[0] = 0;
+    array2[num_elements - 1] = 4;
+    ASSERT_TRUE(manager.snapshot_delta(delta_snapshot_dir_path(2)));
+  }
+
+  // The change tracking is kept across close and open
+  {
+    metall::manager manager(metall::open_only, original_dir_path());
+    manager.find<metall::offset_ptr<uint32_t>>("array2").first->get()[0] = 5;
+    ASSERT_TRUE(manager.snapshot_delta(delta_snapshot_dir_path(3)));
+    ASSERT_NE(metall::manager::get_uuid(original_dir_path()),
+              metall::manager::get_uuid(delta_snapshot_dir_path(3)));
+  }
+
+  auto check = [&num_elements](const int delta_no, const uint32_t array0,
+                               const uint32_t array_last,
+                               const uint32_t array2_0,
+                               const uint32_t array2_last) {
+    metall::manager::remove(materialized_dir_path());
+    ASSERT_TRUE(metall::manager::materialize_snapshot(
+        delta_snapshot_dir_path(delta_no), materialized_dir_path()));
+    ASSERT_TRUE(metall::manager::consistent(materialized_dir_path()));
+    ASSERT_EQ(metall::manager::get_uuid(delta_snapshot_dir_path(delta_no)),
+              metall::manager::get_uuid(materialized_dir_path()));
+
+    metall::manager manager(metall::open_read_only, materialized_dir_path());
+    const auto *const array =
+        manager.find<metall::offset_ptr<uint32_t>>("array").first;
+    ASSERT_NE(array, nullptr);
+    ASSERT_EQ(array->get()[0], array0);
+    ASSERT_EQ(array->get()[num_elements - 1], array_last);
+    const auto *const array2 =
+        manager.find<metall::offset_ptr<uint32_t>>("array2").first;
+    if (delta_no < 2) {
+      ASSERT_EQ(array2, nullptr);
+      return;
+    }
+    ASSERT_NE(array2, nullptr);
+    ASSERT_EQ(array2->get()[0], array2_0);
+    ASSERT_EQ(array2->get()[num_elements - 1], array2_last);
+  };
+  check(1, 1, 2, 0, 0);
+  check(2, 3, 2, 0, 4);
+  check(3, 3, 2, 5, 4);
+
+  // Cannot be materialized without its parent
+  metall::manager::remove(delta_snapshot_dir_path(1));
+  metall::manager::remove(materialized_dir_path());
+  ASSERT_FALSE(metall::manager::materialize_snapshot(
+      delta_snapshot_dir_path(2), materialized_dir_path()));
+}
 }  // namespace
\ No newline at end of file
@@ -13,18 +13,20 @@ using object_size_manager =
                                         k_max_segment_size>;
 
 int main() {
-  std::cout << "Bin number,\tSize,\tMax Internal Fragmentation Size"
+  // The worst case is a request that is 1 byte larger than the previous size
+  std::cout << "Bin number,\tSize,\tMax Internal Fragmentation Size,\tMax "
+               "Internal Fragmentation Ratio"
             << std::endl;
   std::size_t pre_size = 8;
   for (std::size_t i = 0; i < object_size_manager::num_sizes(); ++i) {
     const auto size = object_size_manager::at(i);
-    if (i == 0 || i >= object_size_manager::num_small_sizes())
-      std::cout << i << "\t" << size << "\tN/A" << std::endl;
+    if (i == 0)
+      std::cout << i << "\t" << size << "\tN/A\tN/A" << std::endl;
     else
-      std::cout << i << "\t" << size << "\t"
+      std::cout << i << "\t" << size << "\t" << (size - pre_size - 1) << "\t"
                 << (double)(size - pre_size - 1) / (pre_size + 1) << std::endl;
     pre_size = size;
   }
 
   return 0;
-}
\ No newline at end of file
+}